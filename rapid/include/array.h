@@ -1,4 +1,9 @@
 #pragma once
 
 #include "array/arrayCore.h"
+#include "array/sparse.h"
+#include "array/npy.h"
+#include "array/join.h"
+#include "array/indexing.h"
+#include "array/scan.h"
 #include "array/prettyPrint.h"
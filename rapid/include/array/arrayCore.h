@@ -3,8 +3,15 @@
 #include "../internal.h"
 #include "../rapid_math.h"
 #include "../io.h"
+#include "../tuning.h"
 
 #include "fromData.h"
+#include "expression.h"
+#include "reduce.h"
+#include "transpose.h"
+#include "gemm.h"
+#include "random.h"
+#include "fileMap.h"
 
 #ifndef RAPID_NO_BLAS
 #include "cblasAPI.h"
@@ -87,6 +94,98 @@ namespace rapid
 				return newDims;
 			}
 
+			/// <summary>
+			/// The reference count shared by every array linked to the same
+			/// memory. Arrays sharing data may be copied and destroyed on
+			/// different threads, so the count is atomic. Memory that was not
+			/// allocated with new[], such as a mapped file, is freed by
+			/// "release" instead. "readOnly" is set if the memory cannot be
+			/// written to, and "borrowed" is set if it belongs to something
+			/// other than the arrays referring to it
+			/// </summary>
+			struct RefCount : std::atomic<uint64>
+			{
+				using std::atomic<uint64>::atomic;
+
+				std::function<void()> release;
+				bool readOnly = false;
+				bool borrowed = false;
+			};
+
+			/// <summary>
+			/// Allocate a new reference count, owned by a single array
+			/// </summary>
+			/// <returns></returns>
+			inline RefCount *newRefCount()
+			{
+				return new RefCount(1);
+			}
+
+			/// <summary>
+			/// Add a reference to some memory. A new reference can only be
+			/// created from an existing one, so no ordering is required
+			/// </summary>
+			/// <param name="count"></param>
+			inline void incRef(RefCount *count)
+			{
+				count->fetch_add(1, std::memory_order_relaxed);
+			}
+
+			/// <summary>
+			/// Remove a reference to some memory and return true if it was
+			/// the last one. The release makes every write through this
+			/// reference visible to the thread that frees the memory
+			/// </summary>
+			/// <param name="count"></param>
+			/// <returns></returns>
+			inline bool decRef(RefCount *count)
+			{
+				return count->fetch_sub(1, std::memory_order_acq_rel) == 1;
+			}
+
+			/// <summary>
+			/// Calculate the strides of an array with a given shape that
+			/// is stored contiguously in row-major order
+			/// </summary>
+			/// <param name="shape"></param>
+			/// <returns></returns>
+			inline std::vector<uint64> contiguousStride(const std::vector<uint64> &shape)
+			{
+				std::vector<uint64> res(shape.size());
+				uint64 sig = 1;
+
+				for (uint64 i = shape.size(); i > 0; i--)
+				{
+					res[i - 1] = sig;
+					sig *= shape[i - 1];
+				}
+
+				return res;
+			}
+
+			/// <summary>
+			/// Return the strides of an array in the form stored by an
+			/// Array object. If the strides describe contiguous, row-major
+			/// memory, an empty vector is returned. Dimensions of size one
+			/// are never stepped over, so their strides are ignored
+			/// </summary>
+			/// <param name="shape"></param>
+			/// <param name="stride"></param>
+			/// <returns></returns>
+			inline std::vector<uint64> normalizedStride(const std::vector<uint64> &shape, const std::vector<uint64> &stride)
+			{
+				uint64 sig = 1;
+
+				for (uint64 i = shape.size(); i > 0; i--)
+				{
+					if (shape[i - 1] != 1 && stride[i - 1] != sig)
+						return stride;
+					sig *= shape[i - 1];
+				}
+
+				return std::vector<uint64>();
+			}
+
 			template<typename _Ty>
 			inline std::vector<_Ty> subVector(const std::vector<_Ty> &vec, uint64 start = (uint64) -1, uint64 end = (uint64) -1)
 			{
@@ -129,6 +228,21 @@ namespace rapid
 			MASSIVE = 0b0100
 		};
 
+		/// <summary>
+		/// Choose whether to run an operation in serial or in parallel,
+		/// using the crossover points in tuning.h
+		/// </summary>
+		/// <param name="op"></param>
+		/// <param name="work"></param>
+		/// <returns></returns>
+		inline ExecutionType executionType(tuning::Op op, uint64 work)
+		{
+			return tuning::parallel(op, work) ? ExecutionType::PARALLEL : ExecutionType::SERIAL;
+		}
+
+		template<typename t>
+		class SparseArray;
+
 		/// <summary>
 		/// A powerful and fast ndarray type, supporting a wide variety
 		/// of optimized functions and routines. It also supports different
@@ -140,9 +254,10 @@ namespace rapid
 		{
 		public:
 			std::vector<uint64> shape;
+			std::vector<uint64> stride; // Empty if the data is contiguous and row-major
 			arrayType *dataOrigin = nullptr;
 			arrayType *dataStart = nullptr;
-			uint64 *originCount = nullptr;
+			utils::RefCount *originCount = nullptr;
 			bool isZeroDim;
 
 			// #ifdef RAPID_CUDA
@@ -358,6 +473,238 @@ namespace rapid
 				}
 			}
 
+			/// <summary>
+			/// Evaluate an expression and store the result in an array. The
+			/// entire expression is calculated in a single pass over memory,
+			/// so no temporary arrays are created. The result array must be
+			/// the same size as the expression, but this is not checked when
+			/// running, so it is the responsibility of the user to ensure this
+			/// function is called safely.
+			///
+			/// Expressions made only from operations with SIMD kernels are
+			/// always evaluated in blocks, so each operation is applied to a
+			/// whole block with a single vectorized loop
+			/// </summary>
+			/// <typeparam name="Expression"></typeparam>
+			/// <param name="expr"></param>
+			/// <param name="c"></param>
+			template<typename Expression>
+			inline static void evaluateExpression(const Expression &expr, Array<arrayType> &c)
+			{
+				uint64 size = math::prod(c.shape);
+				auto mode = executionType(Expression::cheap ? tuning::Op::ARITHMETIC : tuning::Op::ELEMENTWISE, size);
+
+				if (c.isContiguous() && expr.isContiguous() && !Expression::vectorized)
+					expressionOp(expr, c, mode);
+				else
+					blockExpressionOp(expr, c, mode);
+			}
+
+			/// <summary>
+			/// Apply an expression to every element of an array, where every
+			/// operand is read at the same index as the result, allowing for
+			/// a simple, flat loop
+			/// </summary>
+			/// <typeparam name="Expression"></typeparam>
+			/// <param name="expr"></param>
+			/// <param name="c"></param>
+			/// <param name="mode"></param>
+			template<typename Expression>
+			inline static void expressionOp(const Expression &expr, Array<arrayType> &c, ExecutionType mode)
+			{
+				uint64 size = math::prod(c.shape);
+
+				if (mode == ExecutionType::SERIAL)
+				{
+					// Serial execution on CPU
+					uint64 index = 0;
+
+					if (size > 3)
+					{
+						for (index = 0; index < size - 3; index += 4)
+						{
+							c.dataStart[index + 0] = expr.contiguous(index + 0);
+							c.dataStart[index + 1] = expr.contiguous(index + 1);
+							c.dataStart[index + 2] = expr.contiguous(index + 2);
+							c.dataStart[index + 3] = expr.contiguous(index + 3);
+						}
+					}
+
+					for (; index < size; index++)
+						c.dataStart[index] = expr.contiguous(index);
+				}
+				else if (mode == ExecutionType::PARALLEL)
+				{
+					// Parallel execution on CPU
+					const long count = (long) size;
+					long index = 0;
+
+				#pragma omp parallel for shared(count, expr, c) private(index) default(none)
+					for (index = 0; index < count; ++index)
+						c.dataStart[index] = expr.contiguous(index);
+				}
+				else
+				{
+					message::RapidError("Mode Error", "Invalid mode for expression evaluation. Must be SERIAL or PARALLEL").display();
+				}
+			}
+
+			/// <summary>
+			/// Apply an expression that broadcasts its operands, or that reads
+			/// from or writes to non-contiguous arrays. The result is split
+			/// into blocks within which every operand is either contiguous or
+			/// constant, so the broadcast mapping is only calculated once per
+			/// block and the elements of each block are calculated with flat loops
+			/// </summary>
+			/// <typeparam name="Expression"></typeparam>
+			/// <param name="expr"></param>
+			/// <param name="c"></param>
+			/// <param name="mode"></param>
+			template<typename Expression>
+			inline static void blockExpressionOp(const Expression &expr, Array<arrayType> &c, ExecutionType mode)
+			{
+				uint64 size = math::prod(c.shape);
+				uint64 length = math::min(expr.blockLength(), size);
+
+				if (!c.isContiguous())
+					length = math::min(length, c.shape[c.shape.size() - 1]);
+
+				uint64 blocksPerRow = (length + expr::blockSize - 1) / expr::blockSize;
+				uint64 blocks = (size / length) * blocksPerRow;
+
+				if (mode == ExecutionType::SERIAL)
+				{
+					// Serial execution on CPU
+					for (uint64 block = 0; block < blocks; block++)
+						evaluateBlock(expr, c, block, length, blocksPerRow);
+				}
+				else if (mode == ExecutionType::PARALLEL)
+				{
+					// Parallel execution on CPU
+					const long count = (long) blocks;
+					long block = 0;
+
+				#pragma omp parallel for shared(count, length, blocksPerRow, expr, c) private(block) default(none)
+					for (block = 0; block < count; ++block)
+						evaluateBlock(expr, c, block, length, blocksPerRow);
+				}
+				else
+				{
+					message::RapidError("Mode Error", "Invalid mode for expression evaluation. Must be SERIAL or PARALLEL").display();
+				}
+			}
+
+			/// <summary>
+			/// Evaluate a single block of an expression and store it in the
+			/// result. Rows of "length" elements are split into blocks of at
+			/// most expr::blockSize elements
+			/// </summary>
+			/// <typeparam name="Expression"></typeparam>
+			/// <param name="expr"></param>
+			/// <param name="c"></param>
+			/// <param name="block"></param>
+			/// <param name="length"></param>
+			/// <param name="blocksPerRow"></param>
+			template<typename Expression>
+			inline static void evaluateBlock(const Expression &expr, Array<arrayType> &c, uint64 block,
+											 uint64 length, uint64 blocksPerRow)
+			{
+				uint64 part = (block % blocksPerRow) * expr::blockSize;
+				uint64 index = (block / blocksPerRow) * length + part;
+				uint64 len = math::min(expr::blockSize, length - part);
+
+				typename Expression::valueType buffer[expr::blockSize];
+				arrayType *dst = c.dataStart + c.offsetOf(index);
+
+				if (c.isContiguous())
+				{
+					// Write directly into the result if it has the same type
+					const auto *src = expr.block(index, len, blockBuffer(dst, buffer));
+
+					if ((const void *) src != (const void *) dst)
+						simd::convert(src, dst, len);
+				}
+				else
+				{
+					const auto *src = expr.block(index, len, buffer);
+					uint64 inc = c.stride[c.stride.size() - 1];
+
+					for (uint64 i = 0; i < len; i++)
+						dst[i * inc] = (arrayType) src[i];
+				}
+			}
+
+			inline static arrayType *blockBuffer(arrayType *dst, arrayType * /*buffer*/)
+			{
+				return dst;
+			}
+
+			template<typename t>
+			inline static t *blockBuffer(arrayType * /*dst*/, t *buffer)
+			{
+				return buffer;
+			}
+
+			/// <summary>
+			/// Link this array to the memory of a temporary array, so it can
+			/// be reused to store the result of an expression. Returns false
+			/// if there is no suitable array
+			/// </summary>
+			/// <param name="buffer"></param>
+			/// <param name="newShape"></param>
+			/// <returns></returns>
+			inline bool reuse(const Array<arrayType> *buffer, const std::vector<uint64> &newShape)
+			{
+				if (buffer == nullptr)
+					return false;
+
+				set(*buffer);
+				shape = newShape;
+				return true;
+			}
+
+			template<typename t>
+			inline bool reuse(const Array<t> *buffer, const std::vector<uint64> &newShape)
+			{
+				return false;
+			}
+
+			/// <summary>
+			/// Evaluate an expression directly into the memory of this array.
+			/// If the expression reads from this array in a way that would
+			/// cause values to be overwritten before they are used, the result
+			/// is calculated in a temporary array first
+			/// </summary>
+			/// <typeparam name="Expression"></typeparam>
+			/// <param name="expr"></param>
+			template<typename Expression>
+			inline void assignExpression(const Expression &expr)
+			{
+				rapidAssert(isWritable(), "Cannot write to a read-only array");
+
+				if (expr.aliasSafe(*this, true))
+				{
+					evaluateExpression(expr, *this);
+				}
+				else
+				{
+					auto tmp = Array<arrayType>(shape);
+					evaluateExpression(expr, tmp);
+					evaluateExpression(ArrayLeaf<arrayType>(tmp), *this);
+				}
+			}
+
+			/// <summary>
+			/// Copy the elements of this array, in row-major order, into
+			/// contiguous memory. Transposed views are copied in tiles,
+			/// see transpose.h
+			/// </summary>
+			/// <param name="dst"></param>
+			inline void gather(arrayType *dst) const
+			{
+				transpose::copy(dataStart, strides(), dst, utils::contiguousStride(shape), shape);
+			}
+
 			/// <summary>
 			/// Resize an array to different dimensions and return the result.
 			/// The data stored in the array is copied, so an update in the
@@ -370,8 +717,9 @@ namespace rapid
 				rapidAssert(newShape.size() == 2, "Resizing currently only supports 2D array");
 
 				Array<arrayType> res(newShape);
+				const auto src = packed();
 				auto resData = res.dataStart;
-				auto thisData = dataStart;
+				auto thisData = src.dataStart;
 
 				for (uint64 i = 0; i < rapid::math::min(shape[0], newShape[0]); i++)
 					memcpy(resData + i * newShape[1], thisData + i * shape[1],
@@ -394,108 +742,13 @@ namespace rapid
 				freeSelf();
 
 				originCount = newThis.originCount;
-				(*originCount)++;
+				utils::incRef(originCount);
 
 				dataOrigin = newThis.dataOrigin;
 				dataStart = newThis.dataStart;
 
 				shape = newShape;
-			}
-
-			static int calculateArithmeticMode(const std::vector<uint64> &a, const std::vector<uint64> &b)
-			{
-				// Check for direct or indirect shape match
-				int mode = -1; // Addition mode
-
-				uint64 aSize = a.size();
-				uint64 bSize = b.size();
-
-				uint64 prodA = math::prod(a);
-				uint64 prodB = math::prod(b);
-
-				if (a == b)
-				{
-					// Check for exact shape match
-					mode = 0;
-				}
-				else if (aSize < bSize &&
-						 prodA == prodB &&
-						 a == utils::subVector(b, bSize - aSize))
-				{
-					// Check if last dimensions of other match *this, and all other dimensions are 1
-					// E.g. [1 2] + [[[3 4]]] => [4 6]
-					mode = 0;
-				}
-				else if (aSize > bSize &&
-						 prodA == prodB &&
-						 utils::subVector(a, aSize - bSize) == b)
-				{
-					// Check if last dimensions of *this match other, and all other dimensions are 1
-					// E.g. [[[1 2]]] + [3 4] => [[[4 6]]]
-					mode = 0;
-				}
-				else if (prodB == 1)
-				{
-					// Check if other is a single value array
-					// E.g. [1 2 3] + [10] => [11 12 13]
-
-					mode = 1;
-				}
-				else if (prodA == 1)
-				{
-					// Check if this is a single value array
-					// E.g. [10] + [1 2 3] => [11 12 13]
-
-					mode = 2;
-				}
-				else if (utils::subVector(a, 1) == b)
-				{
-					// Check for "row by row" addition
-					// E.g. [[1 2]   +   [5 6]    =>   [[ 6  8]
-					//       [3 4]]                     [ 8 10]]
-					mode = 3;
-				}
-				else if (a == utils::subVector(b, 1))
-				{
-					// Check for reverse "row by row" addition
-					// E.g. [1 2]  +   [[3 4]     =>   [[4 6]
-					//                  [5 6]]          [6 8]]
-					mode = 4;
-				}
-				else if (prodA == prodB &&
-						 prodA == a[0] &&
-						 a[0] == b[bSize - 1])
-				{
-					// Check for grid addition
-					// E.g. [[1]    +    [3 4]    =>    [[4 5]
-					//       [2]]                        [5 6]]
-					mode = 5;
-				}
-				else if (prodA == prodB &&
-						 prodB == b[0] &&
-						 a[aSize - 1] == b[0])
-				{
-					// Check for reverse grid addition
-					// E.g. [1 2]   +    [[3]     =>    [[4 5]
-					//                    [4]]           [5 6]]
-					mode = 6;
-				}
-				else if (a[aSize - 1] == 1 && utils::subVector(a, 0, aSize - 1) == utils::subVector(b, 0, bSize - 1))
-				{
-					// Check for "column by column" addition
-					// E.g. [[1]     +    [[10 11]      =>     [[11 12]
-					//       [2]]          [12 13]]             [14 15]]
-					mode = 7;
-				}
-				else if (b[bSize - 1] == 1 && utils::subVector(a, 0, aSize - 1) == utils::subVector(b, 0, bSize - 1))
-				{
-					// Check for reverse "column by column" addition
-					// E.g.  [[1 2]    +    [[5]      =>     [[ 6  7]
-					//        [3 4]]         [6]]             [ 9 10]]
-					mode = 8;
-				}
-
-				return mode;
+				stride.clear();
 			}
 
 		public:
@@ -520,12 +773,13 @@ namespace rapid
 
 				isZeroDim = other.isZeroDim;
 				shape = other.shape;
+				stride = other.stride;
 
 				dataStart = other.dataStart;
 				dataOrigin = other.dataOrigin;
 
 				originCount = other.originCount;
-				(*originCount)++;
+				utils::incRef(originCount);
 			}
 
 			/// <summary>
@@ -545,8 +799,7 @@ namespace rapid
 					dataStart = new arrayType[1];
 
 					dataOrigin = dataStart;
-					originCount = new uint64;
-					*originCount = 1;
+					originCount = utils::newRefCount();
 				}
 				else
 				{
@@ -556,77 +809,318 @@ namespace rapid
 					dataStart = new arrayType[math::prod(arrShape)];
 
 					dataOrigin = dataStart;
-					originCount = new uint64;
-					*originCount = 1;
+					originCount = utils::newRefCount();
 				}
 			}
 
-			inline static Array<arrayType> fromScalar(const arrayType &val)
+			/// <summary>
+			/// Create an array whose memory is a file mapped into memory,
+			/// starting "offset" bytes into the file, which holds the raw
+			/// values in row-major order. Nothing is read until it is used,
+			/// and read-only mappings of the same file share memory between
+			/// processes. The file is unmapped when the last array
+			/// referring to it is destroyed.
+			///
+			/// Writing to a READ_ONLY mapping is an error, which is reported
+			/// in debug builds. Expressions never reuse its memory for their
+			/// results
+			/// </summary>
+			/// <param name="path"></param>
+			/// <param name="arrShape"></param>
+			/// <param name="mode"></param>
+			/// <param name="access"></param>
+			/// <param name="offset"></param>
+			/// <returns></returns>
+			inline static Array<arrayType> mapFile(const std::string &path, const std::vector<uint64> &arrShape,
+												   MapMode mode = MapMode::READ_ONLY,
+												   MapAccess access = MapAccess::NORMAL, uint64 offset = 0)
 			{
-				Array<arrayType> res;
+				rapidAssert(!arrShape.empty() && math::prod(arrShape) > 0, "Cannot map an empty array");
 
-				res.isZeroDim = true;
-				res.shape = {1};
+				const uint64 bytes = math::prod(arrShape) * sizeof(arrayType);
+				fileMap::Region region;
+				std::string error;
 
-				res.dataStart = new arrayType[1];
-				res.dataStart[0] = val;
+				if (!fileMap::map(path, offset, bytes, mode, region, error))
+				{
+					message::RapidError("Map Error", error + " \"" + path + "\"").display();
+					return Array<arrayType>();
+				}
+
+				fileMap::advise(region.data, bytes, access);
 
+				Array<arrayType> res;
+				res.isZeroDim = false;
+				res.shape = arrShape;
+				res.dataStart = (arrayType *) region.data;
 				res.dataOrigin = res.dataStart;
-				res.originCount = new uint64;
-				(*res.originCount) = 1;
+				res.originCount = utils::newRefCount();
+				res.originCount->readOnly = mode == MapMode::READ_ONLY;
+				res.originCount->release = [region]()
+				{
+					fileMap::unmap(region);
+				};
 
 				return res;
 			}
 
 			/// <summary>
-			/// Create an array from an existing array. The array that is created
-			/// will inherit the same data as the array it is created from, so an
-			/// update in one will cause an update in the other.
+			/// Create an array from memory allocated elsewhere, without
+			/// copying it. "deleter" is called with "data" when the last
+			/// array referring to the memory is destroyed, so the memory can
+			/// come from any allocator, shared memory or another library.
+			/// The values must be contiguous and in row-major order
 			/// </summary>
-			/// <param name="other"></param>
-			Array(const Array<arrayType> &other)
+			/// <param name="data"></param>
+			/// <param name="arrShape"></param>
+			/// <param name="deleter"></param>
+			/// <returns></returns>
+			inline static Array<arrayType> fromBuffer(arrayType *data, const std::vector<uint64> &arrShape,
+													  std::function<void(arrayType *)> deleter)
 			{
-				isZeroDim = other.isZeroDim;
-				shape = other.shape;
-				dataOrigin = other.dataOrigin;
-				dataStart = other.dataStart;
-				originCount = other.originCount;
+				auto res = fromBuffer(data, arrShape);
 
-				if (originCount)
-					(*originCount)++;
+				if (deleter)
+				{
+					res.originCount->borrowed = false;
+					res.originCount->release = [data, deleter]()
+					{
+						deleter(data);
+					};
+				}
+
+				return res;
 			}
 
 			/// <summary>
-			/// Set one array equal to another and copy the memory.
-			/// This means an update in one array will not trigger
-			/// an update in the other
+			/// Create an array that refers to memory owned by something
+			/// else, without copying it. The memory is never freed by the
+			/// array, so it must outlive every array referring to it.
+			/// Expressions never write their results into it
 			/// </summary>
-			/// <param name="other"></param>
+			/// <param name="data"></param>
+			/// <param name="arrShape"></param>
 			/// <returns></returns>
-			Array<arrayType> &operator=(const Array<arrayType> &other)
+			inline static Array<arrayType> fromBuffer(arrayType *data, const std::vector<uint64> &arrShape)
 			{
-				if (!other.originCount)
-					return *this;
-
-				if (originCount != nullptr)
-				{
-					rapidAssert(shape == other.shape, "Invalid shape for array setting");
-
-					memcpy(dataStart, other.dataStart, math::prod(shape) * sizeof(arrayType));
-				}
-				else
-				{
-					shape = std::vector<uint64>(other.shape.begin(), other.shape.end());
+				rapidAssert(data != nullptr, "Cannot create an array from a null buffer");
 
-					dataStart = new arrayType[math::prod(shape)];
-					memcpy(dataStart, other.dataStart, math::prod(shape) * sizeof(arrayType));
+				Array<arrayType> res;
+				res.isZeroDim = arrShape.empty() || math::prod(arrShape) == 0;
+				res.shape = res.isZeroDim ? std::vector<uint64>{1} : arrShape;
+				res.dataStart = data;
+				res.dataOrigin = data;
+				res.originCount = utils::newRefCount();
+				res.originCount->release = []() {};
+				res.originCount->borrowed = true;
 
-					dataOrigin = dataStart;
-					originCount = new uint64;
-					(*originCount) = 1;
-				}
+				return res;
+			}
 
-				isZeroDim = other.isZeroDim;
+			/// <summary>
+			/// Create an array that refers to read-only memory owned by
+			/// something else, in the same way. Writing to the array is an
+			/// error, which is reported in debug builds, and expressions
+			/// never reuse its memory
+			/// </summary>
+			/// <param name="data"></param>
+			/// <param name="arrShape"></param>
+			/// <returns></returns>
+			inline static Array<arrayType> fromBuffer(const arrayType *data, const std::vector<uint64> &arrShape)
+			{
+				auto res = fromBuffer(const_cast<arrayType *>(data), arrShape);
+				res.originCount->readOnly = true;
+				return res;
+			}
+
+			/// <summary>
+			/// Tell the operating system how the memory of this array will
+			/// be accessed. This is mainly useful for arrays created with
+			/// mapFile, where it controls how much of the file is read ahead
+			/// </summary>
+			/// <param name="access"></param>
+			inline void advise(MapAccess access) const
+			{
+				fileMap::advise(dataStart, math::prod(shape) * sizeof(arrayType), access);
+			}
+
+			inline static Array<arrayType> fromScalar(const arrayType &val)
+			{
+				Array<arrayType> res;
+
+				res.isZeroDim = true;
+				res.shape = {1};
+
+				res.dataStart = new arrayType[1];
+				res.dataStart[0] = val;
+
+				res.dataOrigin = res.dataStart;
+				res.originCount = utils::newRefCount();
+
+				return res;
+			}
+
+			/// <summary>
+			/// Create an array from an existing array. The array that is created
+			/// will inherit the same data as the array it is created from, so an
+			/// update in one will cause an update in the other.
+			/// </summary>
+			/// <param name="other"></param>
+			Array(const Array<arrayType> &other)
+			{
+				isZeroDim = other.isZeroDim;
+				shape = other.shape;
+				stride = other.stride;
+				dataOrigin = other.dataOrigin;
+				dataStart = other.dataStart;
+				originCount = other.originCount;
+
+				if (originCount)
+					utils::incRef(originCount);
+			}
+
+			/// <summary>
+			/// Create an array from a temporary array. The data is taken
+			/// from the other array, which is left uninitialized, so no
+			/// memory is copied and the reference count is unchanged
+			/// </summary>
+			/// <param name="other"></param>
+			Array(Array<arrayType> &&other) noexcept
+				: shape(std::move(other.shape)), stride(std::move(other.stride)), dataOrigin(other.dataOrigin),
+				dataStart(other.dataStart), originCount(other.originCount), isZeroDim(other.isZeroDim)
+			{
+				other.dataOrigin = nullptr;
+				other.dataStart = nullptr;
+				other.originCount = nullptr;
+			}
+
+			/// <summary>
+			/// Set one array equal to another and copy the memory.
+			/// This means an update in one array will not trigger
+			/// an update in the other
+			/// </summary>
+			/// <param name="other"></param>
+			/// <returns></returns>
+			Array<arrayType> &operator=(const Array<arrayType> &other)
+			{
+				if (!other.originCount)
+					return *this;
+
+				if (originCount != nullptr)
+				{
+					rapidAssert(shape == other.shape, "Invalid shape for array setting");
+					rapidAssert(isWritable(), "Cannot write to a read-only array");
+
+					if (stride.empty() && other.stride.empty())
+						memcpy(dataStart, other.dataStart, math::prod(shape) * sizeof(arrayType));
+					else if (!overlaps(other))
+						transpose::copy(other.dataStart, other.strides(), dataStart, strides(), shape);
+					else
+						assignExpression(ArrayLeaf<arrayType>(other));
+				}
+				else
+				{
+					set(other.copy());
+				}
+
+				isZeroDim = other.isZeroDim;
+
+				return *this;
+			}
+
+			/// <summary>
+			/// Set one array equal to a temporary array. If no other array
+			/// shares the memory of this array, the memory of the temporary
+			/// is taken and nothing is copied. Otherwise, the data is copied
+			/// so that any linked arrays are updated as well
+			/// </summary>
+			/// <param name="other"></param>
+			/// <returns></returns>
+			Array<arrayType> &operator=(Array<arrayType> &&other)
+			{
+				if (!other.originCount || this == &other)
+					return *this;
+
+				if (originCount != nullptr)
+				{
+					rapidAssert(shape == other.shape, "Invalid shape for array setting");
+
+					// Memory that is mapped from a file or borrowed from
+					// elsewhere must be written to, not replaced
+					if (!isUnique() || !isReusable())
+						return *this = (const Array<arrayType> &) other;
+				}
+
+				freeSelf();
+
+				shape = std::move(other.shape);
+				stride = std::move(other.stride);
+				dataOrigin = other.dataOrigin;
+				dataStart = other.dataStart;
+				originCount = other.originCount;
+				isZeroDim = other.isZeroDim;
+
+				other.dataOrigin = nullptr;
+				other.dataStart = nullptr;
+				other.originCount = nullptr;
+
+				return *this;
+			}
+
+			/// <summary>
+			/// Create an array from an expression. The expression is
+			/// evaluated directly into the memory of the new array
+			/// </summary>
+			/// <typeparam name="E"></typeparam>
+			/// <param name="expr"></param>
+			template<typename E, typename std::enable_if<expr::traits<E>::isNode, int>::type = 0>
+			Array(const E &expr) : Array(expr.shape)
+			{
+				evaluateExpression(expr, *this);
+				isZeroDim = expr.isZeroDim;
+			}
+
+			/// <summary>
+			/// Create an array from a temporary expression. If the expression
+			/// reads from a temporary array that nothing else refers to, such
+			/// as the result of a function, the result is written into the
+			/// memory of that array instead of allocating new memory
+			/// </summary>
+			/// <typeparam name="E"></typeparam>
+			/// <param name="expr"></param>
+			template<typename E, typename std::enable_if<expr::traits<E>::isNode &&
+				!std::is_reference<E>::value, int>::type = 0>
+			Array(E &&expr)
+			{
+				if (!reuse(expr.expiring(), expr.shape))
+					set(Array<arrayType>(expr.shape));
+
+				evaluateExpression(expr, *this);
+				isZeroDim = expr.isZeroDim;
+			}
+
+			/// <summary>
+			/// Set an array equal to the result of an expression. If the
+			/// array has already been initialized, the result is written
+			/// into the existing memory and no new memory is allocated
+			/// </summary>
+			/// <typeparam name="E"></typeparam>
+			/// <param name="expr"></param>
+			/// <returns></returns>
+			template<typename E, typename std::enable_if<expr::traits<E>::isNode, int>::type = 0>
+			Array<arrayType> &operator=(E &&expr)
+			{
+				if (originCount != nullptr)
+				{
+					rapidAssert(shape == expr.shape, "Invalid shape for array setting");
+					assignExpression(expr);
+				}
+				else
+				{
+					set(Array<arrayType>(std::forward<E>(expr)));
+				}
+
+				isZeroDim = expr.isZeroDim;
 
 				return *this;
 			}
@@ -640,7 +1134,6 @@ namespace rapid
 			Array<arrayType> &operator=(const arrayType &other)
 			{
 				fill(other);
-				isZeroDim = other.isZeroDim;
 				return *this;
 			}
 
@@ -654,14 +1147,18 @@ namespace rapid
 			/// <param name="dataStart"></param>
 			/// <param name="originCount"></param>
 			/// <param name="isZeroDim"></param>
+			/// <param name="arrStride"></param>
 			/// <returns></returns>
 			static inline Array<arrayType> fromData(const std::vector<uint64> &arrDims,
 													arrayType *newDataOrigin, arrayType *dataStart,
-													uint64 *originCount, bool isZeroDim)
+													utils::RefCount *originCount, bool isZeroDim,
+													const std::vector<uint64> &arrStride = std::vector<uint64>())
 			{
 				Array<arrayType> res;
 				res.isZeroDim = isZeroDim;
 				res.shape = std::vector<uint64>(arrDims.begin(), arrDims.end());
+				if (!arrStride.empty())
+					res.stride = utils::normalizedStride(arrDims, arrStride);
 				res.dataOrigin = newDataOrigin;
 				res.dataStart = dataStart;
 				res.originCount = originCount;
@@ -801,11 +1298,13 @@ namespace rapid
 				if (originCount)
 				{
 					// Only delete data if originCount becomes zero
-					(*originCount)--;
-
-					if ((*originCount) == 0)
+					if (utils::decRef(originCount))
 					{
-						delete[] dataOrigin;
+						if (originCount->release)
+							originCount->release();
+						else
+							delete[] dataOrigin;
+
 						delete originCount;
 					}
 				}
@@ -826,6 +1325,37 @@ namespace rapid
 				return originCount != nullptr;
 			}
 
+			/// <summary>
+			/// Returns true if the memory of this array can be written to.
+			/// Only read-only file mappings cannot be
+			/// </summary>
+			/// <returns></returns>
+			inline bool isWritable() const
+			{
+				return originCount != nullptr && !originCount->readOnly;
+			}
+
+			/// <summary>
+			/// Returns true if the memory of this array may be used to hold
+			/// the result of an expression that reads from it. Memory that is
+			/// read-only or borrowed from elsewhere is never reused
+			/// </summary>
+			/// <returns></returns>
+			inline bool isReusable() const
+			{
+				return isWritable() && !originCount->borrowed;
+			}
+
+			/// <summary>
+			/// Returns true if no other array refers to the memory of
+			/// this array, so it can be modified or taken freely
+			/// </summary>
+			/// <returns></returns>
+			inline bool isUnique() const
+			{
+				return originCount != nullptr && originCount->load(std::memory_order_acquire) == 1;
+			}
+
 			/// <summary>
 			/// Access a subarray or value of an array. The result is linked
 			/// to the parent array, so an update in one will trigger an update
@@ -837,17 +1367,92 @@ namespace rapid
 			{
 				rapidAssert(index < shape[0], "Index out of range for array subscript");
 
-				(*originCount)++;
+				utils::incRef(originCount);
 
 				if (shape.size() == 1)
 				{
-					return Array<arrayType>::fromData({1}, dataOrigin, dataStart + utils::ndToScalar({index}, shape),
+					return Array<arrayType>::fromData({1}, dataOrigin, dataStart + offsetOf(index),
 													  originCount, true);
 				}
 
 				std::vector<uint64> resShape(shape.begin() + 1, shape.end());
-				return Array<arrayType>::fromData(resShape, dataOrigin, dataStart + utils::ndToScalar({index}, shape),
-												  originCount, isZeroDim);
+
+				if (stride.empty())
+					return Array<arrayType>::fromData(resShape, dataOrigin, dataStart + utils::ndToScalar({index}, shape),
+													  originCount, isZeroDim);
+
+				return Array<arrayType>::fromData(resShape, dataOrigin, dataStart + index * stride[0],
+												  originCount, isZeroDim, utils::subVector(stride, 1));
+			}
+
+			/// <summary>
+			/// Returns true if the elements of the array are stored
+			/// contiguously in row-major order. Views created by
+			/// transposing, slicing or broadcasting an array may not be
+			/// </summary>
+			/// <returns></returns>
+			inline bool isContiguous() const
+			{
+				return stride.empty();
+			}
+
+			/// <summary>
+			/// Return the number of elements to step over in memory to
+			/// move one position along each dimension of the array
+			/// </summary>
+			/// <returns></returns>
+			inline std::vector<uint64> strides() const
+			{
+				return stride.empty() ? utils::contiguousStride(shape) : stride;
+			}
+
+			/// <summary>
+			/// Convert the index of an element in row-major order into
+			/// its memory offset from the start of the array's data
+			/// </summary>
+			/// <param name="index"></param>
+			/// <returns></returns>
+			inline uint64 offsetOf(uint64 index) const
+			{
+				if (stride.empty())
+					return index;
+
+				uint64 offset = 0;
+
+				for (uint64 i = shape.size(); i > 0; i--)
+				{
+					offset += (index % shape[i - 1]) * stride[i - 1];
+					index /= shape[i - 1];
+				}
+
+				return offset;
+			}
+
+			/// <summary>
+			/// Return the number of elements between the first and last
+			/// element of the array in memory, inclusive
+			/// </summary>
+			/// <returns></returns>
+			inline uint64 span() const
+			{
+				if (stride.empty())
+					return math::prod(shape);
+
+				uint64 res = 1;
+				for (uint64 i = 0; i < shape.size(); i++)
+					res += (shape[i] - 1) * stride[i];
+				return res;
+			}
+
+			/// <summary>
+			/// Return a contiguous version of the array. If the array is
+			/// already contiguous, the result is linked to it, otherwise
+			/// the data is copied
+			/// </summary>
+			/// <returns></returns>
+			inline Array<arrayType> packed() const
+			{
+				return stride.empty() ? *this : copy();
 			}
 
 			/// <summary>
@@ -870,7 +1475,7 @@ namespace rapid
 				}
 			#endif
 
-				return dataStart[utils::ndToScalar(index, shape)];
+				return dataStart[indexOffset(index)];
 			}
 
 			/// <summary>
@@ -891,1287 +1496,426 @@ namespace rapid
 						message::RapidError("Index Error", "Index out of range or negative");
 				}
 			#endif
+				rapidAssert(isWritable(), "Cannot write to a read-only array");
 
-				dataStart[utils::ndToScalar(index, shape)] = val;
+				dataStart[indexOffset(index)] = val;
 			}
 
-			inline Array<arrayType> operator-() const
+			/// <summary>
+			/// Convert a multi-dimensional index into a memory offset
+			/// from the start of the array's data
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="index"></param>
+			/// <returns></returns>
+			template<typename t>
+			inline uint64 indexOffset(const std::initializer_list<t> &index) const
 			{
-					auto res = Array<arrayType>(shape);
+				if (stride.empty())
+					return utils::ndToScalar(index, shape);
 
-					Array<arrayType>::unaryOpArray(*this, res,
-												   math::prod(shape) > 10000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-												   [](arrayType x)
-					{
-						return -x;
-					});
+				uint64 offset = 0;
+				uint64 dim = 0;
 
-					return res;
+				for (const auto &val : index)
+					offset += (uint64) val * stride[dim++];
+
+				return offset;
 			}
 
 			/// <summary>
-			/// Array add Array
+			/// Apply an elementwise operation between this array and another
+			/// array or expression, and store the result in this array. The
+			/// other operand must broadcast to the shape of this array
 			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="E"></typeparam>
 			/// <param name="other"></param>
 			/// <returns></returns>
-			inline Array<arrayType> operator+(const Array<arrayType> &other) const
+			template<typename Op, typename E>
+			inline Array<arrayType> &inplaceOperation(const E &other)
 			{
-				auto mode = calculateArithmeticMode(shape, other.shape);
-
-			#ifdef RAPID_DEBUG
-				if (mode == -1)
-				{
-					std::string shapeThis;
-					std::string shapeOther;
-
-					for (uint64 i = 0; i < shape.size(); i++)
-						shapeThis += std::to_string(shape[i]) + (i == shape.size() - 1 ? "" : ", ");
+				auto res = expr::makeBinary<Op>(*this, other);
 
-					for (uint64 i = 0; i < other.shape.size(); i++)
-						shapeOther += std::to_string(other.shape[i]) + (i == other.shape.size() - 1 ? "" : ", ");
+				if (res.shape != shape)
+					message::RapidError("Broadcast Error", std::string("Cannot ") + Op::name() + " arrays inplace with shapes (" +
+										expr::shapeToString(shape) + ") and (" + expr::shapeToString(other.shape) + ")").display();
 
-					rapidAssert(mode != -1, "Cannot add arrays with shapes (" + shapeThis + ") and (" + shapeOther + ")");
-				}
-			#endif
+				assignExpression(res);
+				return *this;
+			}
 
-				switch (mode)
-				{
-					case 0:
-						{
-							// Cases:
-							//  > Exact match
-							//  > End dimensions of other match this
-							//  > End dimensions of this match other
+			template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+			inline Array<arrayType> &operator+=(const E &other)
+			{
+				return inplaceOperation<expr::Add>(other);
+			}
 
-							auto res = Array<arrayType>(shape);
+			template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+			inline Array<arrayType> &operator-=(const E &other)
+			{
+				return inplaceOperation<expr::Sub>(other);
+			}
 
-							Array<arrayType>::binaryOpArrayArray(*this, other, res,
-																 math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																 [](arrayType x, arrayType y)
-							{
-								return x + y;
-							});
+			template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+			inline Array<arrayType> &operator*=(const E &other)
+			{
+				return inplaceOperation<expr::Mul>(other);
+			}
 
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 1:
-						{
-							// Cases:
-							//  > Other is a single value
+			template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+			inline Array<arrayType> &operator/=(const E &other)
+			{
+				return inplaceOperation<expr::Div>(other);
+			}
 
-							auto res = Array<arrayType>(shape);
+			inline Array<arrayType> &operator+=(const arrayType &other)
+			{
+				assignExpression(expr::makeScalar<expr::Add>(*this, other));
+				return *this;
+			}
 
-							Array<arrayType>::binaryOpArrayScalar(*this, other.dataStart[0], res,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x + y;
-							});
+			inline Array<arrayType> &operator-=(const arrayType &other)
+			{
+				assignExpression(expr::makeScalar<expr::Sub>(*this, other));
+				return *this;
+			}
 
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 2:
-						{
-							// Cases:
-							//  > This is a single value
+			inline Array<arrayType> &operator*=(const arrayType &other)
+			{
+				assignExpression(expr::makeScalar<expr::Mul>(*this, other));
+				return *this;
+			}
 
-							auto res = Array<arrayType>(other.shape);
+			inline Array<arrayType> &operator/=(const arrayType &other)
+			{
+				assignExpression(expr::makeScalar<expr::Div>(*this, other));
+				return *this;
+			}
 
-							Array<arrayType>::binaryOpScalarArray(dataStart[0], other, res,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x + y;
-							});
+			/// <summary>
+			/// Fill an array with a scalar value
+			/// </summary>
+			/// <param name="val"></param>
+			inline void fill(const arrayType &val)
+			{
+				rapidAssert(isWritable(), "Cannot write to a read-only array");
 
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 3:
-						{
-							// Cases:
-							//  > "Row by row" addition
+				if (!stride.empty())
+				{
+					assignExpression(ScalarLeaf<arrayType>(val));
+					return;
+				}
 
-							auto res = Array<arrayType>(shape);
+				Array<arrayType>::unaryOpArray(*this, *this,
+											   executionType(tuning::Op::ARITHMETIC, math::prod(shape)),
+											   [=](arrayType x)
+				{
+					return val;
+				});
+			}
 
-							for (uint64 i = 0; i < shape[0]; i++)
-								res[i] = (*this)[i] + other;
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 4:
-						{
-							// Cases:
-							//  > Reverse "row by row" addition
-
-							auto res = Array<arrayType>(other.shape);
-
-							for (uint64 i = 0; i < other.shape[0]; i++)
-								res[i] = (*this) + other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 5:
-						{
-							// Cases
-							//  > Grid addition
-
-							auto resShape = std::vector<uint64>(other.shape.size() + 1);
-							for (uint64 i = 0; i < other.shape.size(); i++)
-								resShape[i] = shape[i];
-							resShape[other.shape.size()] = other.shape[other.shape.size() - 1];
-
-							auto res = Array<arrayType>(resShape);
-
-							for (uint64 i = 0; i < resShape[0]; i++)
-								res[i] = (*this)[i] + other;
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 6:
-						{
-							// Cases
-							//  > Reverse grid addition
-
-							auto resShape = std::vector<uint64>(shape.size() + 1);
-							for (uint64 i = 0; i < shape.size(); i++)
-								resShape[i] = other.shape[i];
-							resShape[shape.size()] = shape[shape.size() - 1];
-
-							auto res = Array<arrayType>(resShape);
-
-							for (uint64 i = 0; i < resShape[0]; i++)
-								res[i] = (*this) + other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 7:
-						{
-							// Cases
-							//  > "Column by column" addition
-
-							auto res = Array<arrayType>(other.shape);
-
-							for (uint64 i = 0; i < res.shape[0]; i++)
-								res[i] = (*this)[i] + other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 8:
-						{
-							// Cases
-							//  > "Column by column" addition
-
-							auto res = Array<arrayType>(shape);
-
-							for (uint64 i = 0; i < res.shape[0]; i++)
-								res[i] = (*this)[i] + other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					default:
-						{
-							message::RapidError("Addition Error", "Invalid addition mode '" + std::to_string(mode) + "'").display();
-						}
-				}
-			}
-
-			/// <summary>
-			/// Array sub Array
-			/// </summary>
-			/// <param name="other"></param>
-			/// <returns></returns>
-			inline Array<arrayType> operator-(const Array<arrayType> &other) const
+			inline Array<arrayType> filled(const arrayType &val)
 			{
-				auto mode = calculateArithmeticMode(shape, other.shape);
-
-			#ifdef RAPID_DEBUG
-				if (mode == -1)
-				{
-					std::string shapeThis;
-					std::string shapeOther;
-
-					for (uint64 i = 0; i < shape.size(); i++)
-						shapeThis += std::to_string(shape[i]) + (i == shape.size() - 1 ? "" : ", ");
-
-					for (uint64 i = 0; i < other.shape.size(); i++)
-						shapeOther += std::to_string(other.shape[i]) + (i == other.shape.size() - 1 ? "" : ", ");
-
-					rapidAssert(mode != -1, "Cannot subtract arrays with shapes (" + shapeThis + ") and (" + shapeOther + ")");
-				}
-			#endif
+				auto res = Array<arrayType>(shape);
 
-				switch (mode)
+				Array<arrayType>::unaryOpArray(res, res,
+											   executionType(tuning::Op::ARITHMETIC, math::prod(shape)),
+											   [=](arrayType x)
 				{
-					case 0:
-						{
-							// Cases:
-							//  > Exact match
-							//  > End dimensions of other match this
-							//  > End dimensions of this match other
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayArray(*this, other, res,
-																 math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																 [](arrayType x, arrayType y)
-							{
-								return x - y;
-							});
-
-							return res;
-						}
-					case 1:
-						{
-							// Cases:
-							//  > Other is a single value
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayScalar(*this, other.dataStart[0], res,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x - y;
-							});
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 2:
-						{
-							// Cases:
-							//  > This is a single value
-
-							auto res = Array<arrayType>(other.shape);
-
-							Array<arrayType>::binaryOpScalarArray(dataStart[0], other, res,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x - y;
-							});
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 3:
-						{
-							// Cases:
-							//  > "Row by row" subtraction
-
-							auto res = Array<arrayType>(shape);
-
-							for (uint64 i = 0; i < shape[0]; i++)
-								res[i] = (*this)[i] - other;
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 4:
-						{
-							// Cases:
-							//  > Reverse "row by row" subtraction
-
-							auto res = Array<arrayType>(other.shape);
-
-							for (uint64 i = 0; i < other.shape[0]; i++)
-								res[i] = (*this) - other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 5:
-						{
-							// Cases
-							//  > Grid subtraction
-
-							auto resShape = std::vector<uint64>(other.shape.size() + 1);
-							for (uint64 i = 0; i < other.shape.size(); i++)
-								resShape[i] = shape[i];
-							resShape[other.shape.size()] = other.shape[other.shape.size() - 1];
-
-							auto res = Array<arrayType>(resShape);
-
-							for (uint64 i = 0; i < resShape[0]; i++)
-								res[i] = (*this)[i] - other;
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 6:
-						{
-							// Cases
-							//  > Reverse grid subtraction
-
-							auto resShape = std::vector<uint64>(shape.size() + 1);
-							for (uint64 i = 0; i < shape.size(); i++)
-								resShape[i] = other.shape[i];
-							resShape[shape.size()] = shape[shape.size() - 1];
-
-							auto res = Array<arrayType>(resShape);
-
-							for (uint64 i = 0; i < resShape[0]; i++)
-								res[i] = (*this) - other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 7:
-						{
-							// Cases
-							//  > "Column by column" subtraction
-
-							auto res = Array<arrayType>(other.shape);
-
-							for (uint64 i = 0; i < res.shape[0]; i++)
-								res[i] = (*this)[i] - other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 8:
-						{
-							// Cases
-							//  > reverse "column by column" subtraction
-
-							auto res = Array<arrayType>(shape);
-
-							for (uint64 i = 0; i < res.shape[0]; i++)
-								res[i] = (*this)[i] - other[i];
+					return val;
+				});
 
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					default:
-						{
-							message::RapidError("Subtraction Error", "Invalid subtraction mode '" + std::to_string(mode) + "'").display();
-						}
-				}
+				return res;
 			}
 
 			/// <summary>
-			/// Array mul Array
+			/// Fill the array with random values, uniformly distributed in
+			/// [min, max) for floating point types and in [min, max] for
+			/// integral types, drawn from the global generator (see
+			/// rng::seed)
 			/// </summary>
-			/// <param name="other"></param>
-			/// <returns></returns>
-			inline Array<arrayType> operator*(const Array<arrayType> &other) const
+			/// <param name="min"></param>
+			/// <param name="max"></param>
+			inline void fillRandom(const arrayType min = -1, const arrayType max = 1)
 			{
-				auto mode = calculateArithmeticMode(shape, other.shape);
+				rapidAssert(isWritable(), "Cannot write to a read-only array");
 
-			#ifdef RAPID_DEBUG
-				if (mode == -1)
+				if (!stride.empty())
 				{
-					std::string shapeThis;
-					std::string shapeOther;
-
-					for (uint64 i = 0; i < shape.size(); i++)
-						shapeThis += std::to_string(shape[i]) + (i == shape.size() - 1 ? "" : ", ");
-
-					for (uint64 i = 0; i < other.shape.size(); i++)
-						shapeOther += std::to_string(other.shape[i]) + (i == other.shape.size() - 1 ? "" : ", ");
-
-					rapidAssert(mode != -1, "Cannot multiply arrays with shapes (" + shapeThis + ") and (" + shapeOther + ")");
+					auto tmp = Array<arrayType>(shape);
+					tmp.fillRandom(min, max);
+					*this = tmp;
+					return;
 				}
-			#endif
-
-				switch (mode)
-				{
-					case 0:
-						{
-							// Cases:
-							//  > Exact match
-							//  > End dimensions of other match this
-							//  > End dimensions of this match other
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayArray(*this, other, res,
-																 math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																 [](arrayType x, arrayType y)
-							{
-								return x * y;
-							});
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 1:
-						{
-							// Cases:
-							//  > Other is a single value
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayScalar(*this, other.dataStart[0], res,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x * y;
-							});
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 2:
-						{
-							// Cases:
-							//  > This is a single value
-
-							auto res = Array<arrayType>(other.shape);
-
-							Array<arrayType>::binaryOpScalarArray(dataStart[0], other, res,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x * y;
-							});
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 3:
-						{
-							// Cases:
-							//  > "Row by row" multiplication
-
-							auto res = Array<arrayType>(shape);
-
-							for (uint64 i = 0; i < shape[0]; i++)
-								res[i] = (*this)[i] * other;
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 4:
-						{
-							// Cases:
-							//  > Reverse "row by row" multiplication
-
-							auto res = Array<arrayType>(other.shape);
-
-							for (uint64 i = 0; i < other.shape[0]; i++)
-								res[i] = (*this) * other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 5:
-						{
-							// Cases
-							//  > Grid multiplication
 
-							auto resShape = std::vector<uint64>(other.shape.size() + 1);
-							for (uint64 i = 0; i < other.shape.size(); i++)
-								resShape[i] = shape[i];
-							resShape[other.shape.size()] = other.shape[other.shape.size() - 1];
-
-							auto res = Array<arrayType>(resShape);
-
-							for (uint64 i = 0; i < resShape[0]; i++)
-								res[i] = (*this)[i] * other;
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 6:
-						{
-							// Cases
-							//  > Reverse grid multiplication
-
-							auto resShape = std::vector<uint64>(shape.size() + 1);
-							for (uint64 i = 0; i < shape.size(); i++)
-								resShape[i] = other.shape[i];
-							resShape[shape.size()] = shape[shape.size() - 1];
-
-							auto res = Array<arrayType>(resShape);
-
-							for (uint64 i = 0; i < resShape[0]; i++)
-								res[i] = (*this) * other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 7:
-						{
-							// Cases
-							//  > "Column by column" multiplication
-
-							auto res = Array<arrayType>(other.shape);
-
-							for (uint64 i = 0; i < res.shape[0]; i++)
-								res[i] = (*this)[i] * other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 8:
-						{
-							// Cases
-							//  > reverse "column by column" multiplication
-
-							auto res = Array<arrayType>(shape);
-
-							for (uint64 i = 0; i < res.shape[0]; i++)
-								res[i] = (*this)[i] * other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					default:
-						{
-							message::RapidError("Multiplication Error", "Invalid multiplication mode '" + std::to_string(mode) + "'").display();
-						}
-				}
+				rng::global().uniform(dataStart, math::prod(shape), min, max);
 			}
 
 			/// <summary>
-			/// Array div Array
+			/// Fill the array with normally distributed random values
 			/// </summary>
-			/// <param name="other"></param>
-			/// <returns></returns>
-			inline Array<arrayType> operator/(const Array<arrayType> &other) const
+			/// <param name="mean"></param>
+			/// <param name="std"></param>
+			inline void fillNormal(const arrayType mean = 0, const arrayType std = 1)
 			{
-				auto mode = calculateArithmeticMode(shape, other.shape);
+				rapidAssert(isWritable(), "Cannot write to a read-only array");
 
-			#ifdef RAPID_DEBUG
-				if (mode == -1)
+				if (!stride.empty())
 				{
-					std::string shapeThis;
-					std::string shapeOther;
-
-					for (uint64 i = 0; i < shape.size(); i++)
-						shapeThis += std::to_string(shape[i]) + (i == shape.size() - 1 ? "" : ", ");
-
-					for (uint64 i = 0; i < other.shape.size(); i++)
-						shapeOther += std::to_string(other.shape[i]) + (i == other.shape.size() - 1 ? "" : ", ");
-
-					rapidAssert(mode != -1, "Cannot divide arrays with shapes (" + shapeThis + ") and (" + shapeOther + ")");
+					auto tmp = Array<arrayType>(shape);
+					tmp.fillNormal(mean, std);
+					*this = tmp;
+					return;
 				}
-			#endif
-
-				switch (mode)
-				{
-					case 0:
-						{
-							// Cases:
-							//  > Exact match
-							//  > End dimensions of other match this
-							//  > End dimensions of this match other
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayArray(*this, other, res,
-																 math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																 [](arrayType x, arrayType y)
-							{
-								return x / y;
-							});
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 1:
-						{
-							// Cases:
-							//  > Other is a single value
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayScalar(*this, other.dataStart[0], res,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x / y;
-							});
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 2:
-						{
-							// Cases:
-							//  > This is a single value
-
-							auto res = Array<arrayType>(other.shape);
-
-							Array<arrayType>::binaryOpScalarArray(dataStart[0], other, res,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x / y;
-							});
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 3:
-						{
-							// Cases:
-							//  > "Row by row" division
-
-							auto res = Array<arrayType>(shape);
-
-							for (uint64 i = 0; i < shape[0]; i++)
-								res[i] = (*this)[i] / other;
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 4:
-						{
-							// Cases:
-							//  > Reverse "row by row" division
 
-							auto res = Array<arrayType>(other.shape);
-
-							for (uint64 i = 0; i < other.shape[0]; i++)
-								res[i] = (*this) / other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 5:
-						{
-							// Cases
-							//  > Grid division
-
-							auto resShape = std::vector<uint64>(other.shape.size() + 1);
-							for (uint64 i = 0; i < other.shape.size(); i++)
-								resShape[i] = shape[i];
-							resShape[other.shape.size()] = other.shape[other.shape.size() - 1];
-
-							auto res = Array<arrayType>(resShape);
-
-							for (uint64 i = 0; i < resShape[0]; i++)
-								res[i] = (*this)[i] / other;
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 6:
-						{
-							// Cases
-							//  > Reverse grid division
-
-							auto resShape = std::vector<uint64>(shape.size() + 1);
-							for (uint64 i = 0; i < shape.size(); i++)
-								resShape[i] = other.shape[i];
-							resShape[shape.size()] = shape[shape.size() - 1];
-
-							auto res = Array<arrayType>(resShape);
-
-							for (uint64 i = 0; i < resShape[0]; i++)
-								res[i] = (*this) / other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 7:
-						{
-							// Cases
-							//  > "Column by column" division
-
-							auto res = Array<arrayType>(other.shape);
-
-							for (uint64 i = 0; i < res.shape[0]; i++)
-								res[i] = (*this)[i] / other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					case 8:
-						{
-							// Cases
-							//  > reverse "column by column" division
-
-							auto res = Array<arrayType>(shape);
-
-							for (uint64 i = 0; i < res.shape[0]; i++)
-								res[i] = (*this)[i] / other[i];
-
-							res.isZeroDim = isZeroDim && other.isZeroDim;
-							return res;
-						}
-					default:
-						{
-							message::RapidError("Division Error", "Invalid division mode '" + std::to_string(mode) + "'").display();
-						}
-				}
+				rng::global().normal(dataStart, math::prod(shape), mean, std);
 			}
 
 			/// <summary>
-			/// Array add Scalar
+			/// Fill the array with normally distributed random values,
+			/// redrawing any more than two standard deviations from the mean
 			/// </summary>
-			/// <typeparam name="t"></typeparam>
-			/// <param name="other"></param>
-			/// <returns></returns>
-			template<typename t>
-			inline Array<arrayType> operator+(const t &other) const
+			/// <param name="mean"></param>
+			/// <param name="std"></param>
+			inline void fillTruncatedNormal(const arrayType mean = 0, const arrayType std = 1)
 			{
-					auto res = Array<arrayType>(shape);
-					Array <arrayType> ::binaryOpArrayScalar(*this, (arrayType) other,
-															res, math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-															[](arrayType x, arrayType y)
-					{
-						return x + y;
-					});
+				rapidAssert(isWritable(), "Cannot write to a read-only array");
 
-					res.isZeroDim = isZeroDim;
-					return res;
-			}
-
-			/// <summary>
-			/// Array sub Scalar
-			/// </summary>
-			/// <typeparam name="t"></typeparam>
-			/// <param name="other"></param>
-			/// <returns></returns>
-			template<typename t>
-			inline Array<arrayType> operator-(const t &other) const
-			{
-					auto res = Array<arrayType>(shape);
-					Array<arrayType>::binaryOpArrayScalar(*this, (arrayType) other, res,
-														  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-														  [](arrayType x, arrayType y)
-					{
-						return x - y;
-					});
+				if (!stride.empty())
+				{
+					auto tmp = Array<arrayType>(shape);
+					tmp.fillTruncatedNormal(mean, std);
+					*this = tmp;
+					return;
+				}
 
-					res.isZeroDim = isZeroDim;
-					return res;
+				rng::global().truncatedNormal(dataStart, math::prod(shape), mean, std);
 			}
 
 			/// <summary>
-			/// Array mul Scalar
+			/// Return an array whose final two dimensions are in a layout
+			/// that can be passed directly to a BLAS routine as a matrix.
+			/// Arrays with contiguous rows or columns, such as transposed
+			/// views, are returned as they are, with "trans" and "ld" set to
+			/// describe the layout. Otherwise, a contiguous copy is returned
 			/// </summary>
-			/// <typeparam name="t"></typeparam>
-			/// <param name="other"></param>
+			/// <param name="trans"></param>
+			/// <param name="ld"></param>
 			/// <returns></returns>
-			template<typename t>
-			inline Array<arrayType> operator*(const t &other) const
+			inline Array<arrayType> blasOperand(bool &trans, uint64 &ld) const
 			{
-					auto res = Array<arrayType>(shape);
-					Array<arrayType>::binaryOpArrayScalar(*this, (arrayType) other, res,
-														  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-														  [](arrayType x, arrayType y)
-					{
-						return x * y;
-					});
+				const uint64 row = shape.size() - 2, col = shape.size() - 1;
 
-					res.isZeroDim = isZeroDim;
-					return res;
-			}
+				trans = false;
+				ld = shape[col];
 
-			/// <summary>
-			/// Array div Scalar
-			/// </summary>
-			/// <typeparam name="t"></typeparam>
-			/// <param name="other"></param>
-			/// <returns></returns>
-			template<typename t>
-			inline Array<arrayType> operator/(const t &other) const
-			{
-					auto res = Array<arrayType>(shape);
-					Array<arrayType>::binaryOpArrayScalar(*this, (arrayType) other, res,
-														  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-														  [](arrayType x, arrayType y)
-					{
-						return x / y;
-					});
-
-					res.isZeroDim = isZeroDim;
-					return res;
-			}
-
-			inline Array<arrayType> &operator+=(const Array<arrayType> &other)
-			{
-				auto mode = calculateArithmeticMode(shape, other.shape);
-
-			#ifdef RAPID_DEBUG
-				if (mode == -1 ||
-					mode == 2 ||
-					mode == 4 ||
-					mode == 5 ||
-					mode == 6 ||
-					mode == 7)
-				{
-					std::string shapeThis;
-					std::string shapeOther;
-
-					for (uint64 i = 0; i < shape.size(); i++)
-						shapeThis += std::to_string(shape[i]) + (i == shape.size() - 1 ? "" : ", ");
-
-					for (uint64 i = 0; i < other.shape.size(); i++)
-						shapeOther += std::to_string(other.shape[i]) + (i == other.shape.size() - 1 ? "" : ", ");
-
-					rapidAssert(false, "Cannot add arrays inplace with shapes (" + shapeThis + ") and (" + shapeOther + ")");
-				}
-			#endif
-
-				switch (mode)
-				{
-					case 0:
-						{
-							// Cases:
-							//  > Exact match
-							//  > End dimensions of other match this
-							//  > End dimensions of this match other
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayArray(*this, other, *this,
-																 math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																 [](arrayType x, arrayType y)
-							{
-								return x + y;
-							});
-
-							return *this;
-						}
-					case 1:
-						{
-							// Cases:
-							//  > Other is a single value
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayScalar(*this, other.dataStart[0], *this,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x + y;
-							});
-
-							return *this;
-						}
-					case 3:
-						{
-							// Cases:
-							//  > "Row by row" addition
-
-							for (uint64 i = 0; i < shape[0]; i++)
-								(*this)[i] += other;
-
-							return *this;
-						}
-					case 8:
-						{
-							// Cases
-							//  > reverse "column by column" addition
-
-							for (uint64 i = 0; i < shape[0]; i++)
-								(*this)[i] += other[i];
-
-							return *this;
-						}
-					default:
-						{
-							message::RapidError("Addition Error", "Invalid addition mode '" + std::to_string(mode) + "'").display();
-						}
-				}
-
-				return *this;
-			}
-
-			inline Array<arrayType> &operator-=(const Array<arrayType> &other)
-			{
-				auto mode = calculateArithmeticMode(shape, other.shape);
-
-			#ifdef RAPID_DEBUG
-				if (mode == -1 ||
-					mode == 2 ||
-					mode == 4 ||
-					mode == 5 ||
-					mode == 6 ||
-					mode == 7)
-				{
-					std::string shapeThis;
-					std::string shapeOther;
-
-					for (uint64 i = 0; i < shape.size(); i++)
-						shapeThis += std::to_string(shape[i]) + (i == shape.size() - 1 ? "" : ", ");
-
-					for (uint64 i = 0; i < other.shape.size(); i++)
-						shapeOther += std::to_string(other.shape[i]) + (i == other.shape.size() - 1 ? "" : ", ");
-
-					rapidAssert(false, "Cannot subtract arrays inplace with shapes (" + shapeThis + ") and (" + shapeOther + ")");
-				}
-			#endif
-
-				switch (mode)
-				{
-					case 0:
-						{
-							// Cases:
-							//  > Exact match
-							//  > End dimensions of other match this
-							//  > End dimensions of this match other
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayArray(*this, other, *this,
-																 math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																 [](arrayType x, arrayType y)
-							{
-								return x - y;
-							});
-
-							return *this;
-						}
-					case 1:
-						{
-							// Cases:
-							//  > Other is a single value
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayScalar(*this, other.dataStart[0], *this,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x - y;
-							});
-
-							return *this;
-						}
-					case 3:
-						{
-							// Cases:
-							//  > "Row by row" subtraction
-
-							for (uint64 i = 0; i < shape[0]; i++)
-								(*this)[i] -= other;
-
-							return *this;
-						}
-					case 8:
-						{
-							// Cases
-							//  > reverse "column by column" subtraction
-
-							for (uint64 i = 0; i < shape[0]; i++)
-								(*this)[i] -= other[i];
-
-							return *this;
-						}
-					default:
-						{
-							message::RapidError("Subtraction Error", "Invalid subtraction mode '" + std::to_string(mode) + "'").display();
-						}
-				}
-
-				return *this;
-			}
-
-			inline Array<arrayType> &operator*=(const Array<arrayType> &other)
-			{
-				auto mode = calculateArithmeticMode(shape, other.shape);
+				if (stride.empty())
+					return *this;
 
-			#ifdef RAPID_DEBUG
-				if (mode == -1 ||
-					mode == 2 ||
-					mode == 4 ||
-					mode == 5 ||
-					mode == 6 ||
-					mode == 7)
+				if ((stride[col] == 1 || shape[col] == 1) && stride[row] >= shape[col])
 				{
-					std::string shapeThis;
-					std::string shapeOther;
-
-					for (uint64 i = 0; i < shape.size(); i++)
-						shapeThis += std::to_string(shape[i]) + (i == shape.size() - 1 ? "" : ", ");
-
-					for (uint64 i = 0; i < other.shape.size(); i++)
-						shapeOther += std::to_string(other.shape[i]) + (i == other.shape.size() - 1 ? "" : ", ");
-
-					rapidAssert(false, "Cannot multiply arrays inplace with shapes (" + shapeThis + ") and (" + shapeOther + ")");
+					ld = stride[row];
+					return *this;
 				}
-			#endif
 
-				switch (mode)
+				if ((stride[row] == 1 || shape[row] == 1) && stride[col] >= shape[row])
 				{
-					case 0:
-						{
-							// Cases:
-							//  > Exact match
-							//  > End dimensions of other match this
-							//  > End dimensions of this match other
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayArray(*this, other, *this,
-																 math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																 [](arrayType x, arrayType y)
-							{
-								return x * y;
-							});
-
-							return *this;
-						}
-					case 1:
-						{
-							// Cases:
-							//  > Other is a single value
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayScalar(*this, other.dataStart[0], *this,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x * y;
-							});
-
-							return *this;
-						}
-					case 3:
-						{
-							// Cases:
-							//  > "Row by row" multiplication
-
-							for (uint64 i = 0; i < shape[0]; i++)
-								(*this)[i] *= other;
-
-							return *this;
-						}
-					case 8:
-						{
-							// Cases
-							//  > reverse "column by column" multiplication
-
-							for (uint64 i = 0; i < shape[0]; i++)
-								(*this)[i] *= other[i];
-
-							return *this;
-						}
-					default:
-						{
-							message::RapidError("Multiplication Error", "Invalid multiplication mode '" + std::to_string(mode) + "'").display();
-						}
+					trans = true;
+					ld = stride[col];
+					return *this;
 				}
 
-				return *this;
+				return copy();
 			}
 
-			inline Array<arrayType> &operator/=(const Array<arrayType> &other)
+			/// <summary>
+			/// Return the shape of the dot product of this array with
+			/// another, following the rules described for "dot"
+			/// </summary>
+			/// <param name="other"></param>
+			/// <returns></returns>
+			inline std::vector<uint64> dotShape(const Array<arrayType> &other) const
 			{
-				auto mode = calculateArithmeticMode(shape, other.shape);
+				std::vector<uint64> resShape;
 
-			#ifdef RAPID_DEBUG
-				if (mode == -1 ||
-					mode == 2 ||
-					mode == 4 ||
-					mode == 5 ||
-					mode == 6 ||
-					mode == 7)
+				// Matrix vector product
+				if (utils::subVector(shape, 1) == other.shape)
 				{
-					std::string shapeThis;
-					std::string shapeOther;
-
-					for (uint64 i = 0; i < shape.size(); i++)
-						shapeThis += std::to_string(shape[i]) + (i == shape.size() - 1 ? "" : ", ");
+					resShape.emplace_back(shape[0]);
 
-					for (uint64 i = 0; i < other.shape.size(); i++)
-						shapeOther += std::to_string(other.shape[i]) + (i == other.shape.size() - 1 ? "" : ", ");
+					if (other.shape.size() > 1)
+					{
+						rapidAssert(other.shape[other.shape.size() - 1] == other.shape[other.shape.size() - 2],
+									"Columns of A must match rows of B for dot math::product");
+						resShape.insert(resShape.end(), other.shape.begin(), other.shape.end());
+					}
 
-					rapidAssert(false, "Cannot divide arrays inplace with shapes (" + shapeThis + ") and (" + shapeOther + ")");
+					return resShape;
 				}
-			#endif
 
-				switch (mode)
+				// Reverse matrix vector product
+				if (shape == utils::subVector(other.shape, 1))
 				{
-					case 0:
-						{
-							// Cases:
-							//  > Exact match
-							//  > End dimensions of other match this
-							//  > End dimensions of this match other
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayArray(*this, other, *this,
-																 math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																 [](arrayType x, arrayType y)
-							{
-								return x / y;
-							});
-
-							return *this;
-						}
-					case 1:
-						{
-							// Cases:
-							//  > Other is a single value
-
-							auto res = Array<arrayType>(shape);
-
-							Array<arrayType>::binaryOpArrayScalar(*this, other.dataStart[0], *this,
-																  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-																  [](arrayType x, arrayType y)
-							{
-								return x / y;
-							});
-
-							return *this;
-						}
-					case 3:
-						{
-							// Cases:
-							//  > "Row by row" division
-
-							for (uint64 i = 0; i < shape[0]; i++)
-								(*this)[i] /= other;
-
-							return *this;
-						}
-					case 8:
-						{
-							// Cases
-							//  > reverse "column by column" division
+					resShape.emplace_back(other.shape[0]);
 
-							for (uint64 i = 0; i < shape[0]; i++)
-								(*this)[i] /= other[i];
+					if (shape.size() > 1)
+					{
+						rapidAssert(shape[shape.size() - 1] == shape[shape.size() - 2],
+									"Columns of A must match rows of B for dot math::product");
+						resShape.insert(resShape.end(), shape.begin(), shape.end());
+					}
 
-							return *this;
-						}
-					default:
-						{
-							message::RapidError("Division Error", "Invalid division mode '" + std::to_string(mode) + "'").display();
-						}
+					return resShape;
 				}
 
-				return *this;
-			}
+				rapidAssert(shape.size() == other.shape.size(), "Invalid number of dimensions for array dot product");
 
-			inline Array<arrayType> &operator+=(const arrayType &other)
-			{
-				if (location == CPU)
-				{
-					Array<arrayType>::binaryOpArrayScalar(*this, other, *this,
-														  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-														  [](arrayType x, arrayType y)
-					{
-						return x + y;
-					});
-				}
-			#ifdef RAPID_CUDA
-				else if (location == GPU)
+				if (shape.size() == 1)
 				{
-					cuda::add_array_scalar(math::prod(shape), dataStart, 1, other, dataStart, 1);
+					rapidAssert(shape[0] == other.shape[0], "Invalid shape for array math::product");
+					return {1};
 				}
-			#endif
 
-				return *this;
-			}
-
-			inline Array<arrayType> &operator-=(const arrayType &other)
-			{
-				if (location == CPU)
-				{
-					Array<arrayType>::binaryOpArrayScalar(*this, other, *this,
-														  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-														  [](arrayType x, arrayType y)
-					{
-						return x - y;
-					});
-				}
-			#ifdef RAPID_CUDA
-				else if (location == GPU)
-				{
-					cuda::sub_array_scalar(math::prod(shape), dataStart, 1, other, dataStart, 1);
-				}
-			#endif
+				rapidAssert(shape[shape.size() - 1] == other.shape[other.shape.size() - 2],
+							"Columns of A must match rows of B for dot math::product");
 
-				return *this;
+				resShape = shape;
+				resShape[resShape.size() - 1] = other.shape[other.shape.size() - 1];
+				return resShape;
 			}
 
-			inline Array<arrayType> &operator*=(const arrayType &other)
+			/// <summary>
+			/// Returns true if any element of this array shares memory
+			/// with an element of another array
+			/// </summary>
+			/// <param name="other"></param>
+			/// <returns></returns>
+			inline bool overlaps(const Array<arrayType> &other) const
 			{
-				if (location == CPU)
-				{
-					Array<arrayType>::binaryOpArrayScalar(*this, other, *this,
-														  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-														  [](arrayType x, arrayType y)
-					{
-						return x * y;
-					});
-				}
-			#ifdef RAPID_CUDA
-				else if (location == GPU)
-				{
-					cuda::mul_array_scalar(math::prod(shape), dataStar, 1, other, dataStart, 1);
-				}
-			#endif
+				if (!isInitialized() || !other.isInitialized())
+					return false;
 
-				return *this;
+				return dataStart < other.dataStart + other.span() && other.dataStart < dataStart + span();
 			}
 
-			inline Array<arrayType> &operator/=(const arrayType &other)
+			/// <summary>
+			/// Store "alpha * res + beta * out" in "out". If "beta" is zero,
+			/// the previous values of "out" are not read
+			/// </summary>
+			/// <param name="res"></param>
+			/// <param name="out"></param>
+			/// <param name="alpha"></param>
+			/// <param name="beta"></param>
+			static inline void scaleInto(const Array<arrayType> &res, Array<arrayType> &out, arrayType alpha, arrayType beta)
 			{
-				if (location == CPU)
+				if (beta == 0)
 				{
-					Array<arrayType>::binaryOpArrayScalar(*this, other, *this,
-														  math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-														  [](arrayType x, arrayType y)
-					{
-						return x / y;
-					});
+					if (alpha == 1)
+						out = res;
+					else
+						out = res * alpha;
 				}
-			#ifdef RAPID_CUDA
-				else if (location == GPU)
+				else
 				{
-					cuda::div_array_scalar(math::prod(shape), dataStart, 1, other, dataStart, 1);
-				}
-			#endif
-
-				return *this;
+					out = res * alpha + out * beta;
+				}
 			}
 
 			/// <summary>
-			/// Fill an array with a scalar value
+			/// Calculate the product of this matrix with a vector and store
+			/// "alpha * product + beta * out" in "out", which must be a
+			/// contiguous vector with one element for each row of the matrix
 			/// </summary>
-			/// <param name="val"></param>
-			inline void fill(const arrayType &val)
+			/// <param name="vec"></param>
+			/// <param name="out"></param>
+			/// <param name="alpha"></param>
+			/// <param name="beta"></param>
+			inline void matrixVectorDot(const Array<arrayType> &vec, Array<arrayType> &out,
+										arrayType alpha, arrayType beta) const
 			{
-				Array<arrayType>::unaryOpArray(*this, *this,
-											   math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-											   [=](arrayType x)
-				{
-					return val;
-				});
+				const uint64 incX = vec.strides()[0];
+
+			#ifndef RAPID_NO_BLAS
+				bool trans;
+				uint64 ld;
+				const auto a = blasOperand(trans, ld);
+				imp::rapid_gemv(trans, shape[0], shape[1], alpha, a.dataStart, ld, vec.dataStart, incX, beta, out.dataStart);
+			#else
+				const auto strideA = strides();
+				gemm::gemv(shape[0], shape[1], dataStart, strideA[0], strideA[1], vec.dataStart, incX, out.dataStart, alpha, beta);
+			#endif
 			}
 
-			inline Array<arrayType> filled(const arrayType &val)
+			/// <summary>
+			/// Calculate the dot product of two arrays with the same number
+			/// of dimensions, three or more, as a batch of matrix products of
+			/// their final two dimensions, one for each index of the leading
+			/// dimensions, which must match. "alpha * product + beta * out" is
+			/// stored in "out", which must be contiguous and have the shape of
+			/// the result
+			/// </summary>
+			/// <param name="other"></param>
+			/// <param name="out"></param>
+			/// <param name="alpha"></param>
+			/// <param name="beta"></param>
+			inline void batchedDot(const Array<arrayType> &other, Array<arrayType> &out,
+								   arrayType alpha, arrayType beta) const
 			{
-				auto res = Array<arrayType>(shape);
+				const uint64 dims = shape.size();
+				rapidAssert(utils::subVector(shape, 0, 2) == utils::subVector(other.shape, 0, 2),
+							"Leading dimensions of arrays must match for batched dot product");
 
-				Array<arrayType>::unaryOpArray(res, res,
-											   math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-											   [=](arrayType x)
-				{
-					return val;
-				});
+				const uint64 M = shape[dims - 2];
+				const uint64 N = shape[dims - 1];
+				const uint64 K = other.shape[dims - 1];
+				const uint64 batch = math::prod(utils::subVector(shape, 0, 2));
 
-				return res;
-			}
+			#ifndef RAPID_NO_BLAS
+				// Matrices with a contiguous dimension are passed to BLAS
+				// directly, and the batch is otherwise copied
+				bool transA, transB;
+				uint64 lda, ldb;
+				const auto a = blasOperand(transA, lda);
+				const auto b = other.blasOperand(transB, ldb);
+			#else
+				const auto &a = *this;
+				const auto &b = other;
+			#endif
 
-			inline void fillRandom(const arrayType min = -1, const arrayType max = 1)
-			{
-				Array<arrayType>::unaryOpArray(*this, *this,
-											   math::prod(shape) > 1000000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-											   [=](arrayType x)
+				const auto strideA = a.strides();
+				const auto strideB = b.strides();
+
+				// Find the first element of every matrix in the batch
+				std::vector<const arrayType *> ptrA(batch), ptrB(batch);
+				std::vector<arrayType *> ptrC(batch);
+
+				for (uint64 i = 0; i < batch; i++)
 				{
-					return math::random<arrayType>(min, max);
-				});
+					uint64 offsetA = 0, offsetB = 0, rest = i;
+
+					for (uint64 dim = dims - 2; dim > 0; dim--)
+					{
+						const uint64 pos = rest % shape[dim - 1];
+						rest /= shape[dim - 1];
+						offsetA += pos * strideA[dim - 1];
+						offsetB += pos * strideB[dim - 1];
+					}
+
+					ptrA[i] = a.dataStart + offsetA;
+					ptrB[i] = b.dataStart + offsetB;
+					ptrC[i] = out.dataStart + i * M * K;
+				}
+
+			#ifndef RAPID_NO_BLAS
+				imp::rapid_gemm_batch(transA, transB, batch, M, N, K, alpha, ptrA.data(), lda,
+									  ptrB.data(), ldb, beta, ptrC.data(), K);
+			#else
+				gemm::gemmBatched(batch, M, N, K,
+								  ptrA.data(), strideA[dims - 2], strideA[dims - 1],
+								  ptrB.data(), strideB[dims - 2], strideB[dims - 1],
+								  ptrC.data(), K, alpha, beta);
+			#endif
 			}
 
 			/// <summary>
@@ -2186,38 +1930,91 @@ namespace rapid
 			/// <returns></returns>
 			inline Array<arrayType> dot(const Array<arrayType> &other) const
 			{
-				// Matrix vector product
-				if (utils::subVector(shape, 1) == other.shape)
+				Array<arrayType> res(dotShape(other));
+				dot(other, res);
+				return res;
+			}
+
+			/// <summary>
+			/// Calculate the product of this vector or matrix with a
+			/// sparse matrix, without creating a dense copy of it. This
+			/// is defined in sparse.h
+			/// </summary>
+			/// <param name="other"></param>
+			/// <returns></returns>
+			inline Array<arrayType> dot(const SparseArray<arrayType> &other) const;
+
+			/// <summary>
+			/// Calculate the dot product with another array and store
+			/// "alpha * product + beta * out" in "out", which must have the
+			/// shape of the result. If "beta" is zero, the previous values of
+			/// "out" are not read, so "C += A^T B" can be written as
+			/// a.transposed().dot(b, c, 1, 1).
+			///
+			/// If "out" is contiguous, or is a matrix with contiguous rows,
+			/// and does not share memory with either input, the result is
+			/// written into it directly and no temporary array is allocated.
+			/// Transposed views are passed to the matrix product as they are,
+			/// without being copied. The packing buffers used by the matrix
+			/// product are kept by each thread, so repeated products of a
+			/// similar size do not allocate them again
+			/// </summary>
+			/// <param name="other"></param>
+			/// <param name="out"></param>
+			/// <param name="alpha"></param>
+			/// <param name="beta"></param>
+			/// <returns></returns>
+			inline Array<arrayType> &dot(const Array<arrayType> &other, Array<arrayType> &out,
+										 arrayType alpha = 1, arrayType beta = 0) const
+			{
+				const auto resShape = dotShape(other);
+
+				if (!out.isInitialized())
 				{
-					std::vector<uint64> resShape;
-					resShape.emplace_back(shape[0]);
+					out.set(Array<arrayType>(resShape));
+					beta = 0;
+				}
 
-					if (other.shape.size() > 1)
-						resShape.insert(resShape.end(), other.shape.begin(), other.shape.end());
+				rapidAssert(out.shape == resShape, "Invalid shape for output of array dot product");
+				rapidAssert(out.isWritable(), "Cannot write the output of an array dot product to a read-only array");
 
-					auto res = Array<arrayType>(resShape);
+				// A matrix product can write to any output with contiguous rows
+				const bool rowMajor = shape.size() == 2 && other.shape.size() == 2 && out.strides()[1] == 1;
 
-					for (uint64 i = 0; i < shape[0]; i++)
-						res[i] = (*this)[i].dot(other);
+				if ((!out.isContiguous() && !rowMajor) || out.overlaps(*this) || out.overlaps(other))
+				{
+					const auto tmp = dot(other);
+					scaleInto(tmp, out, alpha, beta);
+					return out;
+				}
 
-					return res;
+				// Matrix vector product
+				if (utils::subVector(shape, 1) == other.shape)
+				{
+					if (shape.size() == 2)
+					{
+						matrixVectorDot(other, out, alpha, beta);
+						return out;
+					}
+
+					// Each matrix of this array is multiplied by "other", so it
+					// is broadcast along the leading dimension without copying
+					batchedDot(other.broadcastTo(shape), out, alpha, beta);
+					return out;
 				}
 
 				// Reverse matrix vector product
 				if (shape == utils::subVector(other.shape, 1))
 				{
-					std::vector<uint64> resShape;
-					resShape.emplace_back(other.shape[0]);
-
-					if (shape.size() > 1)
-						resShape.insert(resShape.end(), shape.begin(), shape.end());
-
-					auto res = Array<arrayType>(resShape);
-
-					for (uint64 i = 0; i < shape[0]; i++)
-						res[i] = other[i].dot((*this));
+					if (other.shape.size() == 2)
+					{
+						other.matrixVectorDot(*this, out, alpha, beta);
+						return out;
+					}
 
-					return res;
+					// Every matrix of "other" is multiplied by this array
+					other.batchedDot(broadcastTo(other.shape), out, alpha, beta);
+					return out;
 				}
 
 				rapidAssert(shape.size() == other.shape.size(), "Invalid number of dimensions for array dot product");
@@ -2228,46 +2025,39 @@ namespace rapid
 				{
 					case 1:
 						{
-							rapidAssert(shape[0] == other.shape[0], "Invalid shape for array math::product");
 							rapidAssert(isZeroDim == other.isZeroDim, "Invalid value for array math::product");
 
-							Array<arrayType> res(shape);
-							res.isZeroDim = true;
-							res.dataStart[0] = imp::rapid_dot(shape[0], dataStart, other.dataStart);
+							const auto res = imp::rapid_dot(shape[0], dataStart, strides()[0],
+															other.dataStart, other.strides()[0]);
 
-							return res;
+							out.isZeroDim = true;
+							out.dataStart[0] = beta == 0 ? alpha * res : alpha * res + beta * out.dataStart[0];
+
+							return out;
 						}
 					case 2:
 						{
-							rapidAssert(shape[1] == other.shape[0], "Columns of A must match rows of B for dot math::product");
-
-							Array<arrayType> res({shape[0], other.shape[1]});
-
 							const uint64 M = shape[0];
 							const uint64 N = shape[1];
 							const uint64 K = other.shape[1];
 
-							const arrayType *a = dataStart;
-							const arrayType *b = other.dataStart;
-							arrayType *c = res.dataStart;
+							// Transposed views are passed to BLAS directly, so only
+							// arrays with no contiguous dimension need to be copied
+							bool transA, transB;
+							uint64 lda, ldb;
+							const auto a = blasOperand(transA, lda);
+							const auto b = other.blasOperand(transB, ldb);
+							arrayType *c = out.dataStart;
 
-							imp::rapid_gemm(M, N, K, a, b, c);
+							imp::rapid_gemm(transA, transB, M, N, K, alpha, a.dataStart, lda,
+											b.dataStart, ldb, beta, c, out.strides()[0]);
 
-							return res;
+							return out;
 						}
 					default:
 						{
-							std::vector<uint64> resShape = shape;
-							resShape[resShape.size() - 2] = shape[shape.size() - 2];
-							resShape[resShape.size() - 1] = other.shape[other.shape.size() - 1];
-							Array<arrayType> res(resShape);
-
-							for (uint64 i = 0; i < shape[0]; i++)
-							{
-								res[i] = (*this)[i].dot(other[i]);
-							}
-
-							return res;
+							batchedDot(other, out, alpha, beta);
+							return out;
 						}
 				}
 			#else
@@ -2279,99 +2069,53 @@ namespace rapid
 				{
 					case 1:
 						{
-							rapidAssert(shape[0] == other.shape[0], "Invalid shape for array math::product");
 							rapidAssert(isZeroDim == other.isZeroDim, "Invalid value for array math::product");
 
-							Array<arrayType> res({1});
-							res.isZeroDim = true;
-							res.dataStart[0] = 0;
+							const uint64 incA = strides()[0];
+							const uint64 incB = other.strides()[0];
+							typename accumulator<arrayType>::type res = 0;
+
+							if (incA == 1 && incB == 1)
+							{
+								res = simd::dot(dataStart, other.dataStart, shape[0]);
+							}
+							else
+							{
+								for (uint64 i = 0; i < shape[0]; i++)
+									res += dataStart[i * incA] * other.dataStart[i * incB];
+							}
 
-							for (uint64 i = 0; i < shape[0]; i++)
-								res.dataStart[0] += dataStart[i] * other.dataStart[i];
+							out.isZeroDim = true;
+							out.dataStart[0] = beta == 0 ? alpha * res : alpha * res + beta * out.dataStart[0];
 
-							return res;
+							return out;
 						}
 					case 2:
 						{
-							rapidAssert(shape[1] == other.shape[0], "Columns of A must match rows of B for dot math::product");
-							uint64 mode;
-							uint64 size = shape[0] * shape[1] * other.shape[1];
-
-							if (size < 8000) mode = 0;
-							else if (size < 64000000) mode = 1;
 						#ifndef RAPID_NO_AMP
-							else mode = 2;
-						#else
-							else mode = 1;
+							if (shape[0] * shape[1] * other.shape[1] < 64000000)
 						#endif
-
-							Array<arrayType> res({shape[0], other.shape[1]});
-
-							if (mode == 0)
-							{
-								// Serial
-
-								uint64 M = shape[0];
-								uint64 N = shape[1];
-								uint64 K = other.shape[1];
-
-								const arrayType *a = dataStart;
-								const arrayType *b = other.dataStart;
-								arrayType *c = res.dataStart;
-
-								uint64 i, j, k;
-								arrayType tmp;
-
-								for (i = 0; i < M; ++i)
-								{
-									for (j = 0; j < K; ++j)
-									{
-										tmp = 0;
-
-										for (k = 0; k < N; ++k)
-											tmp += a[k + i * N] * b[j + k * K];
-
-										c[j + i * K] = tmp;
-									}
-								}
-							}
-							else if (mode == 1)
 							{
-								// Parallel
-
-								auto M = (long long) shape[0];
-								auto N = (long long) shape[1];
-								auto K = (long long) other.shape[1];
-
-								const arrayType *a = dataStart;
-								const arrayType *b = other.dataStart;
-								arrayType *c = res.dataStart;
-
-								long long i, j, k;
-								arrayType tmp;
-
-							#pragma omp parallel for shared(M, N, K, a, b, c) private(i, j, k, tmp) default(none)
-								for (i = 0; i < M; ++i)
-								{
-									for (j = 0; j < K; ++j)
-									{
-										tmp = 0;
-
-										for (k = 0; k < N; ++k)
-											tmp += a[k + i * N] * b[j + k * K];
-
-										c[j + i * K] = tmp;
-									}
-								}
+								// Blocked, packed product. Any strides are handled
+								// while packing, so transposed views are not copied
+								const auto strideA = strides();
+								const auto strideB = other.strides();
+
+								gemm::gemm(shape[0], shape[1], other.shape[1],
+										   dataStart, strideA[0], strideA[1],
+										   other.dataStart, strideB[0], strideB[1],
+										   out.dataStart, out.strides()[0], alpha, beta);
 							}
 						#ifndef RAPID_NO_AMP
-							else if (mode == 2)
+							else
 							{
 								// Massive parallel
 
 								// Tile size
 								static const int TS = 32;
 
+								Array<arrayType> res({shape[0], other.shape[1]});
+
 								const auto resizedThis = internal_resized({math::roundUp(shape[0], (uint64) TS),
 																		  math::roundUp(shape[1], (uint64) TS)});
 								const auto resizedOther = internal_resized({math::roundUp(other.shape[0], (uint64) TS),
@@ -2428,24 +2172,16 @@ namespace rapid
 
 								memcpy(res.dataStart, resVector.data(), sizeof(arrayType) * math::prod(res.shape));
 								res.internal_resize({shape[0], other.shape[1]});
+								scaleInto(res, out, alpha, beta);
 							}
 						#endif
 
-							return res;
+							return out;
 						}
 					default:
 						{
-							std::vector<uint64> resShape = shape;
-							resShape[resShape.size() - 2] = shape[shape.size() - 2];
-							resShape[resShape.size() - 1] = other.shape[other.shape.size() - 1];
-							Array<arrayType> res(resShape);
-
-							for (uint64 i = 0; i < shape[0]; i++)
-							{
-								res[i] = (operator[](i).dot(other[i]));
-							}
-
-							return res;
+							batchedDot(other, out, alpha, beta);
+							return out;
 						}
 				}
 			#endif
@@ -2455,7 +2191,10 @@ namespace rapid
 			/// Transpose an array and return the result. If the
 			/// array is one dimensional, a vector is returned. The
 			/// order in which the transpose occurs can be set with
-			/// the "axes" parameter
+			/// the "axes" parameter. The result is a view that is
+			/// linked to the parent array, so no data is copied.
+			/// If "dataOnly" is true, the transposed data is copied
+			/// into an array with the original shape instead
 			/// </summary>
 			/// <param name="axes"></param>
 			/// <returns></returns>
@@ -2472,140 +2211,111 @@ namespace rapid
 				}
 			#endif
 
-				// Check if a transposition is required
-				bool cpy = !axes.empty();
-				for (uint64 i = 0; i < axes.size(); i++) if (axes[i] != i) cpy = false;
-				if (cpy) return copy();
-
-				std::vector<uint64> newDims;
+				const auto thisStride = strides();
+				std::vector<uint64> newDims(shape.size());
+				std::vector<uint64> newStride(shape.size());
 
-				if (dataOnly)
-				{
-					newDims = std::vector<uint64>(shape.begin(), shape.end());
-				}
-				else
+				for (uint64 i = 0; i < shape.size(); i++)
 				{
-					newDims = std::vector<uint64>(shape.size());
-					if (axes.empty())
-						for (uint64 i = 0; i < shape.size(); i++)
-							newDims[i] = shape[shape.size() - i - 1];
-					else
-						for (uint64 i = 0; i < shape.size(); i++)
-							newDims[i] = shape[axes[i]];
+					uint64 axis = axes.empty() ? shape.size() - i - 1 : axes[i];
+					newDims[i] = shape[axis];
+					newStride[i] = thisStride[axis];
 				}
 
-				const uint64 newDimsProd = math::prod(newDims);
-				const uint64 shapeProd = math::prod(shape);
+				utils::incRef(originCount);
+				auto res = Array<arrayType>::fromData(newDims, dataOrigin, dataStart, originCount, isZeroDim, newStride);
 
-				// Edge case for 1D array
-				if (shape.size() == 1 || (axes.size() == 1 && axes[0] == 0))
+				if (dataOnly)
 				{
-					auto res = Array<arrayType>(newDims);
-					memcpy(res.dataStart, dataStart, sizeof(arrayType) * newDimsProd);
-					return res;
+					auto data = res.copy();
+					data.shape = shape;
+					return data;
 				}
 
-				if (shape.size() == 2)
-				{
-					auto res = Array<arrayType>(newDims);
-
-					uint64 rows = shape[0];
-					uint64 cols = shape[1];
+				return res;
+			}
 
-					if (rows * cols < 1000000)
-					{
-						for (uint64 i = 0; i < rows; i++)
-						{
-							for (uint64 j = 0; j < cols; j++)
-								res.dataStart[i + j * rows] = dataStart[j + i * cols];
-						}
-					}
-					else
-					{
-						int64 i = 0, j = 0;
-						const arrayType *thisData = dataStart;
-						arrayType *resData = res.dataStart;
-						auto minCols = rapid::math::max(cols, 3) - 3;
+			/// <summary>
+			/// Transpose an array and copy the result into "out", which
+			/// must have the transposed shape. The order in which the
+			/// transpose occurs can be set with the "axes" parameter.
+			/// "out" may share memory with this array, in which case a
+			/// temporary copy is made first
+			/// </summary>
+			/// <param name="out"></param>
+			/// <param name="axes"></param>
+			/// <returns></returns>
+			inline Array<arrayType> &transposed(Array<arrayType> &out, const std::vector<uint64> &axes = std::vector<uint64>()) const
+			{
+				const auto view = transposed(axes);
 
-					#pragma omp parallel for private(i, j) shared(resData, thisData, minCols, rows, cols) default(none)
-						for (i = 0; i < rows; i++)
-						{
-							for (j = 0; j < minCols; j++)
-							{
-								int64 p1 = i + j * rows;
-								int64 p2 = j + i * cols;
+				if (out.isInitialized())
+					rapidAssert(out.shape == view.shape, "Invalid shape for output of array transpose");
 
-								resData[p1 + 0] = thisData[p2 + 0];
-								resData[p1 + 1] = thisData[p2 + 1];
-								resData[p1 + 2] = thisData[p2 + 2];
-								resData[p1 + 3] = thisData[p2 + 3];
-							}
+				out = view;
+				return out;
+			}
 
-							for (; j < cols; j++)
-								resData[i + j * rows] = thisData[+i * cols];
-						}
-					}
+			/// <summary>
+			/// Return a view of the elements in the range [start, stop)
+			/// along a given axis, taking every "step"th element. The
+			/// result is linked to the parent array, so no data is copied
+			/// and an update in one will trigger an update in the other
+			/// </summary>
+			/// <param name="start"></param>
+			/// <param name="stop"></param>
+			/// <param name="step"></param>
+			/// <param name="axis"></param>
+			/// <returns></returns>
+			inline Array<arrayType> slice(uint64 start, uint64 stop, uint64 step = 1, uint64 axis = 0) const
+			{
+				rapidAssert(axis < shape.size(), "Axis out of range for array slice");
+				rapidAssert(step > 0, "Step for array slice must be greater than zero");
 
-					return res;
-				}
+				stop = math::min(stop, shape[axis]);
+				rapidAssert(start < stop, "Array slice must contain at least one element");
 
-				auto res = Array<arrayType>(newDims);
+				const auto thisStride = strides();
+				auto newDims = shape;
+				auto newStride = thisStride;
 
-				std::vector<uint64> indices(shape.size(), 0);
-				std::vector<uint64> indicesRes(shape.size(), 0);
+				newDims[axis] = (stop - start + step - 1) / step;
+				newStride[axis] = thisStride[axis] * step;
 
-				if (shapeProd < 62000)
-				{
-					for (int64 i = 0; i < shapeProd; i++)
-					{
-						if (axes.empty())
-							for (int64 j = 0; j < shape.size(); j++)
-								indicesRes[j] = indices[shape.size() - j - 1];
-						else
-							for (int64 j = 0; j < shape.size(); j++)
-								indicesRes[j] = indices[axes[j]];
+				utils::incRef(originCount);
+				return Array<arrayType>::fromData(newDims, dataOrigin, dataStart + start * thisStride[axis],
+												  originCount, isZeroDim, newStride);
+			}
 
-						res.dataStart[imp::dimsToIndex(newDims, indicesRes)] = dataStart[imp::dimsToIndex(shape, indices)];
+			/// <summary>
+			/// Return a view of the array broadcast to a larger shape.
+			/// Dimensions of size one, and any dimensions added to the
+			/// front of the shape, are repeated without copying any data
+			/// </summary>
+			/// <param name="newShape"></param>
+			/// <returns></returns>
+			inline Array<arrayType> broadcastTo(const std::vector<uint64> &newShape) const
+			{
+				if (newShape.size() < shape.size())
+					message::RapidError("Broadcast Error", "Cannot broadcast array with shape (" + expr::shapeToString(shape) +
+										") to shape (" + expr::shapeToString(newShape) + ")").display();
 
-						indices[shape.size() - 1]++;
-						int64 index = shape.size() - 1;
+				const auto thisStride = strides();
+				const uint64 lead = newShape.size() - shape.size();
+				std::vector<uint64> newStride(newShape.size(), 0);
 
-						while (indices[index] >= shape[index] && index > 0)
-						{
-							indices[index] = 0;
-							index--;
-							indices[index]++;
-						}
-					}
-				}
-				else
+				for (uint64 i = 0; i < shape.size(); i++)
 				{
-					for (int64 i = 0; i < shapeProd; i++)
-					{
-						if (axes.empty())
-							for (int64 j = 0; j < shape.size(); j++)
-								indicesRes[j] = indices[shape.size() - j - 1];
-						else
-							for (int64 j = 0; j < shape.size(); j++)
-								indicesRes[j] = indices[axes[j]];
-
-						res.dataStart[imp::dimsToIndex(newDims, indicesRes)] = dataStart[imp::dimsToIndex(shape, indices)];
-
-						indices[shape.size() - 1]++;
-						int64 index = shape.size() - 1;
-
-						while (indices[index] >= shape[index] && index > 0)
-						{
-							indices[index] = 0;
-							index--;
-							indices[index]++;
-						}
-					}
+					if (shape[i] == newShape[lead + i])
+						newStride[lead + i] = thisStride[i];
+					else if (shape[i] != 1)
+						message::RapidError("Broadcast Error", "Cannot broadcast array with shape (" + expr::shapeToString(shape) +
+											") to shape (" + expr::shapeToString(newShape) + ")").display();
 				}
 
-				return res;
-
-				return Array<arrayType>({0, 0});
+				utils::incRef(originCount);
+				return Array<arrayType>::fromData(newShape, dataOrigin, dataStart, originCount,
+												  isZeroDim && math::prod(newShape) == 1, newStride);
 			}
 
 		#define AUTO ((uint64) -1)
@@ -2620,6 +2330,9 @@ namespace rapid
 			/// <returns></returns>
 			inline Array<arrayType> reshaped(const std::vector<uint64> &newShape) const
 			{
+				if (!stride.empty())
+					return copy().reshaped(newShape);
+
 				auto tmpNewShape = std::vector<uint64>(newShape.size(), 1);
 				auto undefined = (uint64) -1;
 
@@ -2651,7 +2364,7 @@ namespace rapid
 				else
 					zeroDim = false;
 
-				(*originCount)++;
+				utils::incRef(originCount);
 				auto res = Array<arrayType>::fromData(tmpNewShape, dataOrigin, dataStart, originCount, zeroDim);
 
 				return res;
@@ -2663,6 +2376,11 @@ namespace rapid
 			/// <param name="newShape"></param>
 			inline void reshape(const std::vector<uint64> &newShape)
 			{
+				// The elements of a non-contiguous view cannot be reinterpreted
+				// with a different shape, so the data must be copied first
+				if (!stride.empty())
+					set(copy());
+
 				auto tmpNewShape = std::vector<uint64>(newShape.size(), 1);
 				auto undefined = (uint64) -1;
 
@@ -2699,13 +2417,45 @@ namespace rapid
 			inline Array<arrayType> mapped(Lambda func) const
 			{
 				auto res = Array<arrayType>(shape);
-				auto size = math::prod(shape);
-				auto mode = ExecutionType::SERIAL;
+				mapped(func, res);
+				return res;
+			}
+
+			/// <summary>
+			/// Apply a function to every element of the array and store
+			/// the result in "out", which must have the same shape. "out"
+			/// may be this array, so the function can be applied in place
+			/// </summary>
+			/// <typeparam name="Lambda"></typeparam>
+			/// <param name="func"></param>
+			/// <param name="out"></param>
+			/// <returns></returns>
+			template<typename Lambda>
+			inline Array<arrayType> &mapped(Lambda func, Array<arrayType> &out) const
+			{
+				if (!out.isInitialized())
+					out.set(Array<arrayType>(shape));
 
-				if (size > 10000) mode = ExecutionType::PARALLEL;
+				rapidAssert(out.shape == shape, "Invalid shape for output of array map");
+				rapidAssert(out.isWritable(), "Cannot write the output of an array map to a read-only array");
 
-				unaryOpArray(*this, res, mode, func);
-				return res;
+				auto mode = executionType(tuning::Op::MAP, math::prod(shape));
+
+				// Each element is only read before it is written, so the
+				// result can be stored in this array, but not in any other
+				// array sharing its memory
+				bool inPlace = isContiguous() && out.dataStart == dataStart;
+
+				if (!out.isContiguous() || (!inPlace && out.overlaps(*this)))
+				{
+					const auto tmp = mapped(func);
+					out = tmp;
+					return out;
+				}
+
+				unaryOpArray(packed(), out, mode, func);
+				out.isZeroDim = isZeroDim;
+				return out;
 			}
 
 			/// <summary>
@@ -2718,11 +2468,10 @@ namespace rapid
 				Array<arrayType> res;
 				res.isZeroDim = isZeroDim;
 				res.shape = shape;
-				res.originCount = new uint64;
-				*(res.originCount) = 1;
+				res.originCount = utils::newRefCount();
 
 					res.dataStart = new arrayType[math::prod(shape)];
-					memcpy(res.dataStart, dataStart, sizeof(arrayType) * math::prod(shape));
+					gather(res.dataStart);
 				
 				res.dataOrigin = res.dataStart;
 
@@ -2743,6 +2492,12 @@ namespace rapid
 			return os << arr.toString();
 		}
 
+		template<typename E, typename std::enable_if<expr::traits<E>::isNode, int>::type = 0>
+		std::ostream &operator<<(std::ostream &os, const E &expr)
+		{
+			return os << expr.eval().toString();
+		}
+
 		template<typename t>
 		inline Array<t> fromScalar(const t &val)
 		{
@@ -2755,8 +2510,7 @@ namespace rapid
 				res.dataStart[0] = val;
 
 			res.dataOrigin = res.dataStart;
-			res.originCount = new uint64;
-			(*res.originCount) = 1;
+			res.originCount = utils::newRefCount();
 
 			return res;
 		}
@@ -2889,6 +2643,58 @@ namespace rapid
 			return res;
 		}
 
+		/// <summary>
+		/// Create a new array filled with random values, uniformly
+		/// distributed in [min, max)
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="shape"></param>
+		/// <param name="min"></param>
+		/// <param name="max"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> uniform(const std::vector<uint64> &shape, t min = -1, t max = 1)
+		{
+			auto res = Array<t>(shape);
+			res.fillRandom(min, max);
+			return res;
+		}
+
+		/// <summary>
+		/// Create a new array filled with normally distributed
+		/// random values
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="shape"></param>
+		/// <param name="mean"></param>
+		/// <param name="std"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> normal(const std::vector<uint64> &shape, t mean = 0, t std = 1)
+		{
+			auto res = Array<t>(shape);
+			res.fillNormal(mean, std);
+			return res;
+		}
+
+		/// <summary>
+		/// Create a new array filled with normally distributed
+		/// random values, all within two standard deviations
+		/// of the mean
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="shape"></param>
+		/// <param name="mean"></param>
+		/// <param name="std"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> truncatedNormal(const std::vector<uint64> &shape, t mean = 0, t std = 1)
+		{
+			auto res = Array<t>(shape);
+			res.fillTruncatedNormal(mean, std);
+			return res;
+		}
+
 		/// <summary>
 		/// Create a new array of the same size and dimensions as
 		/// another array, but fill it with zeros.
@@ -2914,481 +2720,657 @@ namespace rapid
 		template<typename t>
 		inline Array<t> onesLike(const Array<t> &other)
 		{
-			auto res = Array<t>(other.shape);
-			res.fill((t) 1);
-			return res;
+			auto res = Array<t>(other.shape);
+			res.fill((t) 1);
+			return res;
+		}
+
+		/// <summary>
+		/// Take the elementwise minimum of an array or expression and
+		/// a scalar value
+		/// </summary>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="x"></param>
+		/// <returns></returns>
+		template<typename E, typename v, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::scalarType<expr::Minimum, E> minimum(E &&arr, v x)
+		{
+			return expr::makeScalar<expr::Minimum>(std::forward<E>(arr), x);
+		}
+
+		/// <summary>
+		/// Take the elementwise maximum of an array or expression and
+		/// a scalar value
+		/// </summary>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="x"></param>
+		/// <returns></returns>
+		template<typename E, typename v, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::scalarType<expr::Maximum, E> maximum(E &&arr, v x)
+		{
+			return expr::makeScalar<expr::Maximum>(std::forward<E>(arr), x);
+		}
+
+		/// <summary>
+		/// Returns 1 where an element is less than a scalar value,
+		/// and 0 otherwise
+		/// </summary>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="x"></param>
+		/// <returns></returns>
+		template<typename E, typename v, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::scalarType<expr::Less, E> less(E &&arr, v x)
+		{
+			return expr::makeScalar<expr::Less>(std::forward<E>(arr), x);
 		}
 
 		/// <summary>
-		/// Reverse addition
+		/// Returns 1 where an element is greater than a scalar value,
+		/// and 0 otherwise
 		/// </summary>
-		/// <typeparam name="t"></typeparam>
-		/// <param name="val"></param>
-		/// <param name="other"></param>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="x"></param>
 		/// <returns></returns>
-		template<typename t, typename v>
-		inline Array<t> operator+(v val, const Array<t> &other)
+		template<typename E, typename v, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::scalarType<expr::Greater, E> greater(E &&arr, v x)
 		{
-			auto res = Array<t>(other.shape);
-			Array<t>::binaryOpScalarArray((t) val, other, res,
-											   math::prod(other.shape) > 10000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-											   [](t x, t y)
-			{
-				return x + y;
-			});
-
-			res.isZeroDim = other.isZeroDim;
-			return res;
+			return expr::makeScalar<expr::Greater>(std::forward<E>(arr), x);
 		}
 
 		/// <summary>
-		/// Reverse subtraction
+		/// Calculate the absolute value of every element
+		/// in an array or expression
 		/// </summary>
-		/// <typeparam name="t"></typeparam>
-		/// <param name="val"></param>
-		/// <param name="other"></param>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
 		/// <returns></returns>
-		template<typename t, typename v>
-		inline Array<t> operator-(v val, const Array<t> &other)
+		template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Abs, E> abs(E &&arr)
 		{
-			auto res = Array<t>(other.shape);
-			Array<t>::binaryOpScalarArray((t) val, other, res,
-											   math::prod(other.shape) > 10000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-											   [](t x, t y)
-			{
-				return x - y;
-			});
-
-			res.isZeroDim = other.isZeroDim;
-			return res;
+			return expr::makeUnary<expr::Abs>(std::forward<E>(arr));
 		}
 
 		/// <summary>
-		/// Reverse multiplication
+		/// Calculate the exponent of every value
+		/// in an array or expression. The accuracy of
+		/// this and the other elementary functions can
+		/// be chosen per call, as in
+		/// exp<simd::Accuracy::FAST>(x), or for every
+		/// call with simd::setAccuracy
 		/// </summary>
-		/// <typeparam name="t"></typeparam>
-		/// <param name="val"></param>
-		/// <param name="other"></param>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
 		/// <returns></returns>
-		template<typename t, typename v>
-		inline Array<t> operator*(v val, const Array<t> &other)
+		template<simd::Accuracy mode = simd::Accuracy::DEFAULT, typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Exp<mode>, E> exp(E &&arr)
 		{
-			auto res = Array<t>(other.shape);
-			Array<t>::binaryOpScalarArray((t) val, other, res,
-											   math::prod(other.shape) > 10000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-											   [](t x, t y)
-			{
-				return x * y;
-			});
-
-			res.isZeroDim = other.isZeroDim;
-			return res;
+			return expr::makeUnary<expr::Exp<mode>>(std::forward<E>(arr));
 		}
 
 		/// <summary>
-		/// Reverse division
+		/// Calculate the natural logarithm of every
+		/// value in an array or expression
 		/// </summary>
-		/// <typeparam name="t"></typeparam>
-		/// <param name="val"></param>
-		/// <param name="other"></param>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
 		/// <returns></returns>
-		template<typename t, typename v>
-		inline Array<t> operator/(v val, const Array<t> &other)
+		template<simd::Accuracy mode = simd::Accuracy::DEFAULT, typename E,
+			typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Log<mode>, E> log(E &&arr)
 		{
-				auto res = Array<t>(other.shape);
-				Array<t>::binaryOpScalarArray((t) val, other, res,
-												   math::prod(other.shape) > 10000 ? ExecutionType::PARALLEL : ExecutionType::SERIAL,
-												   [](t x, t y)
-				{
-					return x / y;
-				});
-
-				res.isZeroDim = other.isZeroDim;
-				return res;
+			return expr::makeUnary<expr::Log<mode>>(std::forward<E>(arr));
 		}
 
-		template<typename t, typename v>
-		inline Array<t> minimum(const Array<t> &arr, v x)
+		/// <summary>
+		/// Calculate the logistic sigmoid, 1 / (1 + e^-x),
+		/// of every value in an array or expression
+		/// </summary>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
+		/// <returns></returns>
+		template<simd::Accuracy mode = simd::Accuracy::DEFAULT, typename E,
+			typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Sigmoid<mode>, E> sigmoid(E &&arr)
 		{
-				return arr.mapped([&](t val)
-				{
-					return val < (t) x ? val : (t) x;
-				});
+			return expr::makeUnary<expr::Sigmoid<mode>>(std::forward<E>(arr));
 		}
 
-		template<typename t, typename v>
-		inline Array<t> maximum(const Array<t> &arr, v x)
+		/// <summary>
+		/// Square every element in an array or
+		/// expression
+		/// </summary>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
+		/// <returns></returns>
+		template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Square, E> square(E &&arr)
 		{
-				return arr.mapped([&](t val)
-				{
-					return val > (t) x ? val : (t) x;
-				});
+			return expr::makeUnary<expr::Square>(std::forward<E>(arr));
 		}
 
-		template<typename t, typename v>
-		inline Array<t> less(const Array<t> &arr, v x)
+		/// <summary>
+		/// Square root every element in an array
+		/// or expression
+		/// </summary>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
+		/// <returns></returns>
+		template<simd::Accuracy mode = simd::Accuracy::DEFAULT, typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Sqrt<mode>, E> sqrt(E &&arr)
 		{
-				return arr.mapped([&](t val)
-				{
-					return val < (t) x ? 1 : 0;
-				});
+			return expr::makeUnary<expr::Sqrt<mode>>(std::forward<E>(arr));
 		}
 
-		template<typename t, typename v>
-		inline Array<t> greater(const Array<t> &arr, v x)
+		/// <summary>
+		/// Calculate the reciprocal square root of every
+		/// element in an array or expression
+		/// </summary>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="arr"></param>
+		/// <returns></returns>
+		template<simd::Accuracy mode = simd::Accuracy::DEFAULT, typename E,
+			typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Rsqrt<mode>, E> rsqrt(E &&arr)
 		{
-			return arr.mapped([&](t val)
-			{
-				return val > (t) x ? 1 : 0;
-			});
+			return expr::makeUnary<expr::Rsqrt<mode>>(std::forward<E>(arr));
 		}
 
 		/// <summary>
-		/// Sum all of the elements of an array
+		/// Raise an array or expression to a power
 		/// </summary>
-		/// <typeparam name="t"></typeparam>
+		/// <typeparam name="E"></typeparam>
 		/// <param name="arr"></param>
+		/// <param name="power"></param>
 		/// <returns></returns>
-		template<typename t>
-		inline Array<t> sum(const Array<t> &arr, uint64 axis = (uint64) -1, uint64 depth = 0)
+		template<simd::Accuracy mode = simd::Accuracy::DEFAULT, typename E, typename p,
+			typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::scalarType<expr::Pow<mode>, E> pow(E &&arr, p power)
+		{
+			return expr::makeScalar<expr::Pow<mode>>(std::forward<E>(arr), power);
+		}
+
+		namespace imp
 		{
-			if (axis == (uint64) -1 || arr.shape.size() == 1)
+			/// <summary>
+			/// Mark the dimensions of an array that are reduced. An axis
+			/// of -1 reduces every dimension
+			/// </summary>
+			/// <param name="shape"></param>
+			/// <param name="axes"></param>
+			/// <returns></returns>
+			inline std::vector<bool> reducedAxes(const std::vector<uint64> &shape, const std::vector<uint64> &axes)
 			{
-				t res = 0;
+				std::vector<bool> res(shape.size(), false);
 
-				for (uint64 i = 0; i < math::prod(arr.shape); i++)
-					res += arr.dataStart[i];
-				return Array<t>::fromScalar(res);
-			}
+				for (const auto &axis : axes)
+				{
+					if (axis == (uint64) -1)
+					{
+						std::fill(res.begin(), res.end(), true);
+						continue;
+					}
+
+					rapidAssert(axis < shape.size(), "Axis '" + std::to_string(axis) +
+								"' is out of bounds for array with '" + std::to_string(shape.size()) +
+								"' dimensions");
 
-			rapidAssert(axis < arr.shape.size(), "Axis '" + std::to_string(axis) +
-						"' is out of bounds for array with '" + std::to_string(arr.shape.size()) +
-						"' dimensions");
+					res[axis] = true;
+				}
 
-			std::vector<uint64> transposeOrder(arr.shape.size());
+				return res;
+			}
 
-			if (depth == 0)
+			/// <summary>
+			/// Return the number of elements reduced into each output
+			/// </summary>
+			/// <param name="shape"></param>
+			/// <param name="axes"></param>
+			/// <returns></returns>
+			inline uint64 reducedCount(const std::vector<uint64> &shape, const std::vector<uint64> &axes)
 			{
-				for (uint64 i = 0; i < axis; i++)
-					transposeOrder[i] = i;
+				const auto reduced = reducedAxes(shape, axes);
+				uint64 res = 1;
 
-				for (uint64 i = axis; i < arr.shape.size() - 1; i++)
-					transposeOrder[i] = depth == 0 ? (i + 1) : i;
+				for (uint64 i = 0; i < shape.size(); i++)
+					if (reduced[i])
+						res *= shape[i];
 
-				transposeOrder[transposeOrder.size() - 1] = axis;
+				return res;
 			}
-			else
+
+			/// <summary>
+			/// Reduce every element of an array with the engine in reduce.h,
+			/// copying the array first if it is not contiguous
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="arr"></param>
+			/// <returns></returns>
+			template<typename Op, typename t>
+			inline t reduceAll(const Array<t> &arr)
 			{
-				for (uint64 i = 0; i < arr.shape.size(); i++)
-					transposeOrder[i] = i;
+				const auto src = arr.packed();
+				return reduce::reduce<Op>(src.dataStart, math::prod(src.shape));
 			}
 
-			auto fixed = arr.transposed(transposeOrder);
+			/// <summary>
+			/// Reduce an array along a set of axes. Strided arrays are
+			/// reduced in place, without being copied
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="arr"></param>
+			/// <param name="axes"></param>
+			/// <param name="keepdims"></param>
+			/// <returns></returns>
+			template<typename Op, typename t>
+			inline Array<t> reduceAxes(const Array<t> &arr, const std::vector<uint64> &axes, bool keepdims)
+			{
+				const auto reduced = reducedAxes(arr.shape, axes);
 
-			std::vector<uint64> resShape;
-			for (uint64 i = 0; i < transposeOrder.size() - 1; i++)
-				resShape.emplace_back(arr.shape[transposeOrder[i]]);
+				std::vector<uint64> resShape;
+				bool all = true;
 
-			Array<t> res(resShape);
+				for (uint64 i = 0; i < arr.shape.size(); i++)
+				{
+					if (!reduced[i])
+					{
+						resShape.emplace_back(arr.shape[i]);
+						all = false;
+					}
+					else if (keepdims)
+					{
+						resShape.emplace_back(1);
+					}
+				}
 
-			for (uint64 outer = 0; outer < res.shape[0]; outer++)
-				res[outer] = sum(fixed[outer], math::max(axis, 1) - 1, depth + 1);
+				if (all)
+				{
+					const t val = reduceAll<Op>(arr);
+					if (resShape.empty())
+						return Array<t>::fromScalar(val);
 
-			return res;
-		}
+					Array<t> res(resShape);
+					res.dataStart[0] = val;
+					return res;
+				}
 
-		template<typename t>
-		inline Array<t> mean(const Array<t> &arr, uint64 axis = (uint64) -1, int depth = 0)
-		{
-			// Mean of all values
-			if (axis == (uint64) -1 || arr.shape.size() == 1)
-			{
-				return Array<t>(sum(arr) / math::prod(arr.shape));
+				Array<t> res(resShape);
+				reduce::reduceAxes<Op>(arr.dataStart, arr.shape, arr.strides(), reduced, res.dataStart);
+				return res;
 			}
 
-			rapidAssert(axis < arr.shape.size(), "Axis '" + std::to_string(axis) +
-						"' is out of bounds for array with '" + std::to_string(arr.shape.size()) +
-						"' dimensions");
-
-			std::vector<uint64> transposeOrder(arr.shape.size());
-
-			if (depth == 0)
+			/// <summary>
+			/// Find the positions of the minimum or maximum values along
+			/// an axis of an array, or in the flattened array for an axis
+			/// of -1
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="arr"></param>
+			/// <param name="axis"></param>
+			/// <param name="keepdims"></param>
+			/// <param name="name"></param>
+			/// <returns></returns>
+			template<typename Op, typename t>
+			inline Array<uint64> argAxis(const Array<t> &arr, uint64 axis, bool keepdims, const char *name)
 			{
-				for (uint64 i = 0; i < axis; i++)
-					transposeOrder[i] = i;
+				rapidAssert(math::prod(arr.shape) > 0, std::string("Cannot find the ") + name + " of an empty array");
 
-				for (uint64 i = axis; i < arr.shape.size() - 1; i++)
-					transposeOrder[i] = depth == 0 ? (i + 1) : i;
+				const auto src = arr.packed();
 
-				transposeOrder[transposeOrder.size() - 1] = axis;
-			}
-			else
-			{
-				for (uint64 i = 0; i < arr.shape.size(); i++)
-					transposeOrder[i] = i;
-			}
+				if (axis == (uint64) -1 || (arr.shape.size() == 1 && !keepdims))
+				{
+					rapidAssert(axis == (uint64) -1 || axis == 0, "Axis '" + std::to_string(axis) +
+								"' is out of bounds for array with '1' dimensions");
 
-			auto fixed = arr.transposed(transposeOrder);
+					const uint64 index = reduce::arg<Op>(src.dataStart, math::prod(src.shape));
+					if (!keepdims)
+						return Array<uint64>::fromScalar(index);
+
+					Array<uint64> res(std::vector<uint64>(arr.shape.size(), 1));
+					res.dataStart[0] = index;
+					return res;
+				}
 
-			std::vector<uint64> resShape;
-			for (uint64 i = 0; i < transposeOrder.size() - 1; i++)
-				resShape.emplace_back(arr.shape[transposeOrder[i]]);
+				rapidAssert(axis < arr.shape.size(), "Axis '" + std::to_string(axis) +
+							"' is out of bounds for array with '" + std::to_string(arr.shape.size()) +
+							"' dimensions");
 
-			Array<t> res(resShape);
+				uint64 outer = 1, inner = 1;
+				for (uint64 i = 0; i < axis; i++)
+					outer *= arr.shape[i];
+				for (uint64 i = axis + 1; i < arr.shape.size(); i++)
+					inner *= arr.shape[i];
 
-			for (uint64 outer = 0; outer < res.shape[0]; outer++)
-				res[outer] = mean(fixed[outer], math::max(axis, 1) - 1, depth + 1);
+				auto resShape = arr.shape;
+				if (keepdims)
+					resShape[axis] = 1;
+				else
+					resShape.erase(resShape.begin() + axis);
 
-			return res;
+				Array<uint64> res(resShape);
+				reduce::argAxis<Op>(src.dataStart, outer, arr.shape[axis], inner, res.dataStart);
+				return res;
+			}
 		}
 
+		/// <summary>
+		/// Sum the elements of an array along an axis, or every element
+		/// for an axis of -1. If "keepdims" is true, the reduced axes are
+		/// kept with a length of one, so the result broadcasts against the
+		/// input. See reduce.h for the summation algorithms
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="axis"></param>
+		/// <param name="keepdims"></param>
+		/// <returns></returns>
 		template<typename t>
-		inline Array<t> abs(const Array<t> &arr)
+		inline Array<t> sum(const Array<t> &arr, uint64 axis = (uint64) -1, bool keepdims = false)
 		{
-			Array<t> result(arr.shape);
-
-			ExecutionType mode;
-			if (math::prod(arr.shape) > 10000)
-				mode = ExecutionType::PARALLEL;
-			else
-				mode = ExecutionType::SERIAL;
-
-			Array<t>::unaryOpArray(arr, result, mode, [](t x)
-			{
-				return math::abs(x);
-			});
-
-			return result;
+			return imp::reduceAxes<expr::Add>(arr, {axis}, keepdims);
 		}
 
 		/// <summary>
-		/// Calculate the exponent of every value
-		/// in an array, and return the result
+		/// Sum the elements of an array along several axes at once
 		/// </summary>
 		/// <typeparam name="t"></typeparam>
 		/// <param name="arr"></param>
+		/// <param name="axes"></param>
+		/// <param name="keepdims"></param>
 		/// <returns></returns>
 		template<typename t>
-		inline Array<t> exp(const Array<t> &arr)
+		inline Array<t> sum(const Array<t> &arr, const std::vector<uint64> &axes, bool keepdims = false)
 		{
-			Array<t> result(arr.shape);
-
-			ExecutionType mode;
-			if (math::prod(arr.shape) > 10000)
-				mode = ExecutionType::PARALLEL;
-			else
-				mode = ExecutionType::SERIAL;
-
-			Array<t>::unaryOpArray(arr, result, mode, [](t x)
-			{
-				return std::exp(x);
-			});
-
-			return result;
+			return imp::reduceAxes<expr::Add>(arr, axes, keepdims);
 		}
 
 		/// <summary>
-		/// Square every element in an array and return
-		/// the result
+		/// Calculate the mean of an array along one or more axes, in
+		/// the same way as sum
 		/// </summary>
 		/// <typeparam name="t"></typeparam>
 		/// <param name="arr"></param>
+		/// <param name="axes"></param>
+		/// <param name="keepdims"></param>
 		/// <returns></returns>
 		template<typename t>
-		inline Array<t> square(const Array<t> &arr)
+		inline Array<t> mean(const Array<t> &arr, const std::vector<uint64> &axes, bool keepdims = false)
 		{
-			Array<t> result(arr.shape);
-
-			ExecutionType mode;
-			if (math::prod(arr.shape) > 10000)
-				mode = ExecutionType::PARALLEL;
-			else
-				mode = ExecutionType::SERIAL;
-
-			Array<t>::unaryOpArray(arr, result, mode, [](t x)
-			{
-				return x * x;
-			});
+			return Array<t>(sum(arr, axes, keepdims) / (typename accumulator<t>::type) imp::reducedCount(arr.shape, axes));
+		}
 
-			return result;
+		template<typename t>
+		inline Array<t> mean(const Array<t> &arr, uint64 axis = (uint64) -1, bool keepdims = false)
+		{
+			return mean(arr, std::vector<uint64>({axis}), keepdims);
 		}
 
 		/// <summary>
-		/// Square root every element in an array
-		/// and return the result
+		/// Calculate the variance of an array along one or more axes, in
+		/// the same way as sum
 		/// </summary>
 		/// <typeparam name="t"></typeparam>
 		/// <param name="arr"></param>
+		/// <param name="axes"></param>
+		/// <param name="keepdims"></param>
 		/// <returns></returns>
 		template<typename t>
-		inline Array<t> sqrt(const Array<t> &arr)
+		inline Array<t> var(const Array<t> &arr, const std::vector<uint64> &axes, bool keepdims = false)
 		{
-			Array<t> result(arr.shape);
-
-			ExecutionType mode;
-			if (math::prod(arr.shape) > 10000)
-				mode = ExecutionType::PARALLEL;
-			else
-				mode = ExecutionType::SERIAL;
-
-			Array<t>::unaryOpArray(arr, result, mode, [](t x)
-			{
-				return std::sqrt(x);
-			});
+			const Array<t> centred = arr - mean(arr, axes, true);
+			return mean(Array<t>(square(centred)), axes, keepdims);
+		}
 
-			return result;
+		template<typename t>
+		inline Array<t> var(const Array<t> &arr, uint64 axis = (uint64) -1, bool keepdims = false)
+		{
+			return var(arr, std::vector<uint64>({axis}), keepdims);
 		}
 
 		/// <summary>
-		/// Raise an array to a power
+		/// Multiply the elements of an array together along one or more
+		/// axes, in the same way as sum
 		/// </summary>
 		/// <typeparam name="t"></typeparam>
 		/// <param name="arr"></param>
-		/// <param name="power"></param>
+		/// <param name="axes"></param>
+		/// <param name="keepdims"></param>
 		/// <returns></returns>
-		template<typename t, typename p>
-		inline Array<t> pow(const Array<t> &arr, p power)
+		template<typename t>
+		inline Array<t> prod(const Array<t> &arr, const std::vector<uint64> &axes, bool keepdims = false)
 		{
-			Array<t> result(arr.shape);
-
-			ExecutionType mode;
-			if (math::prod(arr.shape) > 10000)
-				mode = ExecutionType::PARALLEL;
-			else
-				mode = ExecutionType::SERIAL;
-
-			Array<t>::unaryOpArray(arr, result, mode, [=](t x)
-			{
-				return std::pow(x, (t) power);
-			});
+			return imp::reduceAxes<expr::Mul>(arr, axes, keepdims);
+		}
 
-			return result;
+		template<typename t>
+		inline Array<t> prod(const Array<t> &arr, uint64 axis = (uint64) -1, bool keepdims = false)
+		{
+			return imp::reduceAxes<expr::Mul>(arr, {axis}, keepdims);
 		}
 
+		/// <summary>
+		/// Find the smallest elements of an array along one or more
+		/// axes, in the same way as sum
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="axes"></param>
+		/// <param name="keepdims"></param>
+		/// <returns></returns>
 		template<typename t>
-		inline Array<t> var(const Array<t> &arr, const uint64 axis = (uint64) -1, const uint64 depth = 0)
+		inline Array<t> min(const Array<t> &arr, const std::vector<uint64> &axes, bool keepdims = false)
 		{
-			// Default variation calculation on flattened array
-			if (axis == (uint64) -1 || arr.shape.size() == 1)
-				return mean(square(abs(arr - mean(arr))));
+			rapidAssert(math::prod(arr.shape) > 0, "Cannot find the minimum of an empty array");
+			return imp::reduceAxes<expr::Minimum>(arr, axes, keepdims);
+		}
 
-			rapidAssert(axis < arr.shape.size(), "Axis '" + std::to_string(axis) +
-						"' is out of bounds for array with '" + std::to_string(arr.shape.size()) +
-						"' dimensions");
+		template<typename t>
+		inline Array<t> min(const Array<t> &arr, uint64 axis = (uint64) -1, bool keepdims = false)
+		{
+			return min(arr, std::vector<uint64>({axis}), keepdims);
+		}
 
-			std::vector<uint64> transposeOrder(arr.shape.size());
+		/// <summary>
+		/// Find the largest elements of an array along one or more
+		/// axes, in the same way as sum
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="axes"></param>
+		/// <param name="keepdims"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> max(const Array<t> &arr, const std::vector<uint64> &axes, bool keepdims = false)
+		{
+			rapidAssert(math::prod(arr.shape) > 0, "Cannot find the maximum of an empty array");
+			return imp::reduceAxes<expr::Maximum>(arr, axes, keepdims);
+		}
 
-			if (depth == 0)
-			{
-				for (uint64 i = 0; i < axis; i++)
-					transposeOrder[i] = i;
+		template<typename t>
+		inline Array<t> max(const Array<t> &arr, uint64 axis = (uint64) -1, bool keepdims = false)
+		{
+			return max(arr, std::vector<uint64>({axis}), keepdims);
+		}
 
-				for (uint64 i = axis; i < arr.shape.size() - 1; i++)
-					transposeOrder[i] = depth == 0 ? (i + 1) : i;
+		/// <summary>
+		/// Find the index of the first smallest element along an axis
+		/// of an array. For an axis of -1, the index is into the
+		/// flattened array
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="axis"></param>
+		/// <param name="keepdims"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<uint64> argmin(const Array<t> &arr, uint64 axis = (uint64) -1, bool keepdims = false)
+		{
+			return imp::argAxis<expr::Minimum>(arr, axis, keepdims, "minimum");
+		}
 
-				transposeOrder[transposeOrder.size() - 1] = axis;
-			}
-			else
-			{
-				for (uint64 i = 0; i < arr.shape.size(); i++)
-					transposeOrder[i] = i;
-			}
+		/// <summary>
+		/// Find the index of the first largest element along an axis
+		/// of an array, in the same way as argmin
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="axis"></param>
+		/// <param name="keepdims"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<uint64> argmax(const Array<t> &arr, uint64 axis = (uint64) -1, bool keepdims = false)
+		{
+			return imp::argAxis<expr::Maximum>(arr, axis, keepdims, "maximum");
+		}
 
-			auto fixed = arr.transposed(transposeOrder);
+		// Reductions of expressions evaluate the expression once and
+		// then reduce the result
+
+	#define imp_reduce_expr(name)																				\
+		template<typename E, typename std::enable_if<expr::traits<E>::isNode, int>::type = 0>					\
+		inline Array<typename E::storageType> name(const E &expr, uint64 axis = (uint64) -1,						\
+												 bool keepdims = false)											\
+		{																										\
+			return name(expr.eval(), axis, keepdims);															\
+		}																										\
+																												\
+		template<typename E, typename std::enable_if<expr::traits<E>::isNode, int>::type = 0>					\
+		inline Array<typename E::storageType> name(const E &expr, const std::vector<uint64> &axes,				\
+												 bool keepdims = false)											\
+		{																										\
+			return name(expr.eval(), axes, keepdims);															\
+		}
 
-			std::vector<uint64> resShape;
-			for (uint64 i = 0; i < transposeOrder.size() - 1; i++)
-				resShape.emplace_back(arr.shape[transposeOrder[i]]);
+		imp_reduce_expr(sum)
+		imp_reduce_expr(mean)
+		imp_reduce_expr(var)
+		imp_reduce_expr(prod)
+		imp_reduce_expr(min)
+		imp_reduce_expr(max)
 
-			Array<t> res(resShape);
+	#undef imp_reduce_expr
 
-			for (uint64 outer = 0; outer < res.shape[0]; outer++)
-				res[outer] = var(fixed[outer], math::max(axis, 1) - 1, depth + 1);
+		template<typename E, typename std::enable_if<expr::traits<E>::isNode, int>::type = 0>
+		inline Array<uint64> argmin(const E &expr, uint64 axis = (uint64) -1, bool keepdims = false)
+		{
+			return argmin(expr.eval(), axis, keepdims);
+		}
 
-			return res;
+		template<typename E, typename std::enable_if<expr::traits<E>::isNode, int>::type = 0>
+		inline Array<uint64> argmax(const E &expr, uint64 axis = (uint64) -1, bool keepdims = false)
+		{
+			return argmax(expr.eval(), axis, keepdims);
 		}
 
-		template<typename t>
-		inline Array<t> sin(const Array<t> &arr)
+		template<simd::Accuracy mode = simd::Accuracy::DEFAULT, typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Sin<mode>, E> sin(E &&arr)
 		{
-			return arr.mapped([](t val)
-			{
-				return std::sin(val);
-			});
+			return expr::makeUnary<expr::Sin<mode>>(std::forward<E>(arr));
 		}
 
-		template<typename t>
-		inline Array<t> cos(const Array<t> &arr)
+		template<simd::Accuracy mode = simd::Accuracy::DEFAULT, typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Cos<mode>, E> cos(E &&arr)
 		{
-			return arr.mapped([](t val)
-			{
-				return std::cos(val);
-			});
+			return expr::makeUnary<expr::Cos<mode>>(std::forward<E>(arr));
 		}
 
-		template<typename t>
-		inline Array<t> tan(const Array<t> &arr)
+		template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Tan, E> tan(E &&arr)
 		{
-			return arr.mapped([](t val)
-			{
-				return std::tan(val);
-			});
+			return expr::makeUnary<expr::Tan>(std::forward<E>(arr));
 		}
 
-		template<typename t>
-		inline Array<t> asin(const Array<t> &arr)
+		template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Asin, E> asin(E &&arr)
 		{
-			return arr.mapped([](t val)
-			{
-				return std::asin(val);
-			});
+			return expr::makeUnary<expr::Asin>(std::forward<E>(arr));
 		}
 
-		template<typename t>
-		inline Array<t> acos(const Array<t> &arr)
+		template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Acos, E> acos(E &&arr)
 		{
-			return arr.mapped([](t val)
-			{
-				return std::acos(val);
-			});
+			return expr::makeUnary<expr::Acos>(std::forward<E>(arr));
 		}
 
-		template<typename t>
-		inline Array<t> atan(const Array<t> &arr)
+		template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Atan, E> atan(E &&arr)
 		{
-			return arr.mapped([](t val)
-			{
-				return std::atan(val);
-			});
+			return expr::makeUnary<expr::Atan>(std::forward<E>(arr));
 		}
 
-		template<typename t>
-		inline Array<t> sinh(const Array<t> &arr)
+		template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Sinh, E> sinh(E &&arr)
 		{
-			return arr.mapped([](t val)
-			{
-				return std::sinh(val);
-			});
+			return expr::makeUnary<expr::Sinh>(std::forward<E>(arr));
 		}
 
-		template<typename t>
-		inline Array<t> cosh(const Array<t> &arr)
+		template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Cosh, E> cosh(E &&arr)
 		{
-			return arr.mapped([](t val)
-			{
-				return std::cosh(val);
-			});
+			return expr::makeUnary<expr::Cosh>(std::forward<E>(arr));
 		}
 
-		template<typename t>
-		inline Array<t> tanh(const Array<t> &arr)
+		template<simd::Accuracy mode = simd::Accuracy::DEFAULT, typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Tanh<mode>, E> tanh(E &&arr)
 		{
-			return arr.mapped([](t val)
-			{
-				return std::tanh(val);
-			});
+			return expr::makeUnary<expr::Tanh<mode>>(std::forward<E>(arr));
+		}
+
+		/// <summary>
+		/// Variants of the elementwise functions above which store the
+		/// result in "out" instead of returning an expression, as in
+		/// exp(x, out) or pow(x, 2, out). "out" must have the shape of
+		/// the result, and may share memory with the input. Once "out"
+		/// is initialized, no memory is allocated. For arithmetic, the
+		/// same is achieved with "out = a + b"
+		/// </summary>
+	#define imp_out_unary(name)																					\
+		template<typename E, typename t, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>	\
+		inline Array<t> &name(E &&arr, Array<t> &out)															\
+		{																										\
+			return out = name(std::forward<E>(arr));															\
+		}
+
+	#define imp_out_scalar(name)																				\
+		template<typename E, typename v, typename t,															\
+			typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>									\
+		inline Array<t> &name(E &&arr, v x, Array<t> &out)														\
+		{																										\
+			return out = name(std::forward<E>(arr), x);															\
 		}
 
+		imp_out_unary(abs)
+		imp_out_unary(exp)
+		imp_out_unary(log)
+		imp_out_unary(sigmoid)
+		imp_out_unary(rsqrt)
+		imp_out_unary(square)
+		imp_out_unary(sqrt)
+		imp_out_unary(sin)
+		imp_out_unary(cos)
+		imp_out_unary(tan)
+		imp_out_unary(asin)
+		imp_out_unary(acos)
+		imp_out_unary(atan)
+		imp_out_unary(sinh)
+		imp_out_unary(cosh)
+		imp_out_unary(tanh)
+
+		imp_out_scalar(pow)
+		imp_out_scalar(minimum)
+		imp_out_scalar(maximum)
+		imp_out_scalar(less)
+		imp_out_scalar(greater)
+
+	#undef imp_out_unary
+	#undef imp_out_scalar
+
 		/// <summary>
 		/// Create a vector of a given length where the first element
 		/// is "start" and the final element is "end", increasing in
@@ -3476,7 +3458,7 @@ namespace rapid
 			rapidAssert(a.shape.size() == 1 && b.shape.size() == 1, "Invalid size for meshgrid. Must be a 1D array");
 			Array<t> result({2, b.shape[0], a.shape[0]});
 
-			if (math::prod(result.shape) < 10000)
+			if (!tuning::parallel(tuning::Op::ELEMENTWISE, math::prod(result.shape)))
 			{
 				for (int64 i = 0; i < b.shape[0]; i++)
 					for (int64 j = 0; j < a.shape[0]; j++)
@@ -3523,14 +3505,15 @@ namespace rapid
 			auto xx = mesh[0];
 			auto yy = mesh[1];
 
-			auto kernel = exp(-0.5 * (square(xx) + square(yy)) / (sigma * sigma));
+			Array<t> kernel = exp(-0.5 * (square(xx) + square(yy)) / (sigma * sigma));
 			return kernel / sum(kernel);
 		}
 
 		/// <summary>
 		/// Cast an array from one type to another. This makes a copy of the array,
 		/// and therefore altering a value in one will not cause an update in the
-		/// other.
+		/// other. Casts between half and single precision are vectorized,
+		/// see simd::convert
 		/// </summary>
 		/// <typeparam name="res"></typeparam>
 		/// <typeparam name="src"></typeparam>
@@ -3540,17 +3523,28 @@ namespace rapid
 		inline Array<resT> cast(const Array<srcT> &src)
 		{
 			Array<resT> res(src.shape);
+			const auto data = src.packed();
+			const uint64 size = math::prod(src.shape);
 
-			if (math::prod(src.shape) < 10000)
+			if (!tuning::parallel(tuning::Op::ELEMENTWISE, size))
 			{
-				for (int64 i = 0; i < math::prod(src.shape); i++)
-					res.dataStart[i] = (resT) src.dataStart[i];
+				simd::convert(data.dataStart, res.dataStart, size);
 			}
 			else
 			{
-			#pragma omp parallel for
-				for (int64 i = 0; i < math::prod(src.shape); i++)
-					res.dataStart[i] = (resT) src.dataStart[i];
+				// Convert in chunks, so each one is still vectorized
+				constexpr uint64 chunk = 4096;
+				const long chunks = (long) ((size + chunk - 1) / chunk);
+				const srcT *from = data.dataStart;
+				resT *to = res.dataStart;
+				long index = 0;
+
+			#pragma omp parallel for shared(chunks, size, from, to) private(index) default(none)
+				for (index = 0; index < chunks; ++index)
+				{
+					const uint64 start = (uint64) index * chunk;
+					simd::convert(from + start, to + start, size - start < chunk ? size - start : chunk);
+				}
 			}
 
 			return res;
@@ -1,6 +1,13 @@
 #pragma once
 
 #include "../internal.h"
+#include "../tuning.h"
+
+#include "gemm.h"
+
+// Define RAPID_BLAS_BATCH if the BLAS library provides cblas_sgemm_batch
+// and cblas_dgemm_batch with the grouped interface used by MKL. Otherwise,
+// batches of products are calculated one product at a time
 
 namespace rapid
 {
@@ -9,55 +16,178 @@ namespace rapid
 		namespace imp
 		{
 			template<typename t>
-			inline t rapid_dot(uint64 len,
-							   const t *__restrict a,
-							   const t *__restrict b)
+			inline typename accumulator<t>::type rapid_dot(uint64 len,
+														   const t *__restrict a, uint64 incA,
+														   const t *__restrict b, uint64 incB)
 			{
-				static_assert(false, "Invalid type for vectorDot");
+				// BLAS only supports single and double precision values.
+				// Half precision values are accumulated in single precision
+				typename accumulator<t>::type res = 0;
+				for (uint64 i = 0; i < len; i++)
+					res += (typename accumulator<t>::type) a[i * incA] * b[i * incB];
+				return res;
 			}
 
 			template<>
 			inline float64 rapid_dot(uint64 len,
-									const float64 *__restrict a,
-									const float64 *__restrict b)
+									const float64 *__restrict a, uint64 incA,
+									const float64 *__restrict b, uint64 incB)
 			{
-				return cblas_ddot((blasint) len, a, (blasint) 1, b, (blasint) 1);
+				return cblas_ddot((blasint) len, a, (blasint) incA, b, (blasint) incB);
 			}
 
 			template<>
 			inline float32 rapid_dot(uint64 len,
-								   const float32 *__restrict a,
-								   const float32 *__restrict b)
+								   const float32 *__restrict a, uint64 incA,
+								   const float32 *__restrict b, uint64 incB)
+			{
+				return cblas_sdot((blasint) len, a, (blasint) incA, b, (blasint) incB);
+			}
+
+			template<typename t>
+			inline void rapid_gemm(bool transA, bool transB, uint64 M, uint64 N, uint64 K, t alpha,
+								   const t *__restrict a, uint64 lda,
+								   const t *__restrict b, uint64 ldb,
+								   t beta, t *__restrict c, uint64 ldc)
+			{
+				// Other types use the built-in product
+				gemm::gemm(M, N, K,
+						   a, transA ? 1 : lda, transA ? lda : 1,
+						   b, transB ? 1 : ldb, transB ? ldb : 1,
+						   c, ldc, alpha, beta);
+			}
+
+			template<>
+			inline void rapid_gemm(bool transA, bool transB, uint64 M, uint64 N, uint64 K, float64 alpha,
+								   const float64 *__restrict a, uint64 lda,
+								   const float64 *__restrict b, uint64 ldb,
+								   float64 beta, float64 *__restrict c, uint64 ldc)
+			{
+				cblas_dgemm(CblasRowMajor, transA ? CblasTrans : CblasNoTrans, transB ? CblasTrans : CblasNoTrans,
+							(blasint) M, (blasint) K, (blasint) N,
+							alpha, a, (blasint) lda, b, (blasint) ldb, beta, c, (blasint) ldc);
+			}
+
+			template<>
+			inline void rapid_gemm(bool transA, bool transB, uint64 M, uint64 N, uint64 K, float32 alpha,
+								   const float32 *__restrict a, uint64 lda,
+								   const float32 *__restrict b, uint64 ldb,
+								   float32 beta, float32 *__restrict c, uint64 ldc)
+			{
+				cblas_sgemm(CblasRowMajor, transA ? CblasTrans : CblasNoTrans, transB ? CblasTrans : CblasNoTrans,
+							(blasint) M, (blasint) K, (blasint) N,
+							alpha, a, (blasint) lda, b, (blasint) ldb, beta, c, (blasint) ldc);
+			}
+
+			template<typename t>
+			inline void rapid_gemv(bool trans, uint64 M, uint64 N, t alpha,
+								   const t *__restrict a, uint64 lda,
+								   const t *__restrict x, uint64 incX,
+								   t beta, t *__restrict y)
+			{
+				gemm::gemv(M, N, a, trans ? 1 : lda, trans ? lda : 1, x, incX, y, alpha, beta);
+			}
+
+			template<>
+			inline void rapid_gemv(bool trans, uint64 M, uint64 N, float64 alpha,
+								   const float64 *__restrict a, uint64 lda,
+								   const float64 *__restrict x, uint64 incX,
+								   float64 beta, float64 *__restrict y)
+			{
+				// A transposed matrix is stored with its dimensions swapped
+				cblas_dgemv(CblasRowMajor, trans ? CblasTrans : CblasNoTrans,
+							(blasint) (trans ? N : M), (blasint) (trans ? M : N),
+							alpha, a, (blasint) lda, x, (blasint) incX, beta, y, 1);
+			}
+
+			template<>
+			inline void rapid_gemv(bool trans, uint64 M, uint64 N, float32 alpha,
+								   const float32 *__restrict a, uint64 lda,
+								   const float32 *__restrict x, uint64 incX,
+								   float32 beta, float32 *__restrict y)
 			{
-				return cblas_sdot((blasint) len, a, (blasint) 1, b, (blasint) 1);
+				cblas_sgemv(CblasRowMajor, trans ? CblasTrans : CblasNoTrans,
+							(blasint) (trans ? N : M), (blasint) (trans ? M : N),
+							alpha, a, (blasint) lda, x, (blasint) incX, beta, y, 1);
 			}
 
 			template<typename t>
-			inline void rapid_gemm(uint64 M, uint64 N, uint64 K,
-								   const t *__restrict a,
-								   const t *__restrict b,
-								   t *__restrict c)
+			inline void builtin_gemm_batch(bool transA, bool transB, uint64 batch, uint64 M, uint64 N, uint64 K, t alpha,
+										   const t *const *a, uint64 lda,
+										   const t *const *b, uint64 ldb,
+										   t beta, t *const *c, uint64 ldc)
 			{
-				static_assert(false, "Invalid type for vectorDot");
+				gemm::gemmBatched(batch, M, N, K,
+								  a, transA ? 1 : lda, transA ? lda : 1,
+								  b, transB ? 1 : ldb, transB ? ldb : 1,
+								  c, ldc, alpha, beta);
+			}
+
+			template<typename t>
+			inline void rapid_gemm_batch(bool transA, bool transB, uint64 batch, uint64 M, uint64 N, uint64 K, t alpha,
+										 const t *const *a, uint64 lda,
+										 const t *const *b, uint64 ldb,
+										 t beta, t *const *c, uint64 ldc)
+			{
+				builtin_gemm_batch(transA, transB, batch, M, N, K, alpha, a, lda, b, ldb, beta, c, ldc);
 			}
 
 			template<>
-			inline void rapid_gemm(uint64 M, uint64 N, uint64 K,
-								   const float64 *__restrict a,
-								   const float64 *__restrict b,
-								   float64 *__restrict c)
+			inline void rapid_gemm_batch(bool transA, bool transB, uint64 batch, uint64 M, uint64 N, uint64 K, float64 alpha,
+										 const float64 *const *a, uint64 lda,
+										 const float64 *const *b, uint64 ldb,
+										 float64 beta, float64 *const *c, uint64 ldc)
 			{
-				cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, (blasint) M, (blasint) K, (blasint) N,
-							1., a, (blasint) N, b, (blasint) K, 0., c, (blasint) K);
+			#ifdef RAPID_BLAS_BATCH
+				const CBLAS_TRANSPOSE opA = transA ? CblasTrans : CblasNoTrans;
+				const CBLAS_TRANSPOSE opB = transB ? CblasTrans : CblasNoTrans;
+				const blasint m = (blasint) M, n = (blasint) K, k = (blasint) N;
+				const blasint ldaInt = (blasint) lda, ldbInt = (blasint) ldb, ldcInt = (blasint) ldc;
+				const blasint size = (blasint) batch;
+
+				cblas_dgemm_batch(CblasRowMajor, &opA, &opB, &m, &n, &k, &alpha,
+								  const_cast<const float64 **>(a), &ldaInt, const_cast<const float64 **>(b), &ldbInt,
+								  &beta, const_cast<float64 **>(c), &ldcInt, 1, &size);
+			#else
+				// BLAS runs each large product in parallel, but small products
+				// are faster with the batch split between the threads
+				if (!tuning::parallel(tuning::Op::MATMUL, M * N * K))
+				{
+					builtin_gemm_batch(transA, transB, batch, M, N, K, alpha, a, lda, b, ldb, beta, c, ldc);
+					return;
+				}
+
+				for (uint64 i = 0; i < batch; i++)
+					rapid_gemm(transA, transB, M, N, K, alpha, a[i], lda, b[i], ldb, beta, c[i], ldc);
+			#endif
 			}
 
 			template<>
-			inline void rapid_gemm(uint64 M, uint64 N, uint64 K,
-								   const float32 *__restrict a,
-								   const float32 *__restrict b,
-								   float32 *__restrict c)
+			inline void rapid_gemm_batch(bool transA, bool transB, uint64 batch, uint64 M, uint64 N, uint64 K, float32 alpha,
+										 const float32 *const *a, uint64 lda,
+										 const float32 *const *b, uint64 ldb,
+										 float32 beta, float32 *const *c, uint64 ldc)
 			{
-				cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, (blasint) M, (blasint) K, (blasint) N, 1., a, (blasint) N, b, (blasint) K, 0., c, (blasint) K);
+			#ifdef RAPID_BLAS_BATCH
+				const CBLAS_TRANSPOSE opA = transA ? CblasTrans : CblasNoTrans;
+				const CBLAS_TRANSPOSE opB = transB ? CblasTrans : CblasNoTrans;
+				const blasint m = (blasint) M, n = (blasint) K, k = (blasint) N;
+				const blasint ldaInt = (blasint) lda, ldbInt = (blasint) ldb, ldcInt = (blasint) ldc;
+				const blasint size = (blasint) batch;
+
+				cblas_sgemm_batch(CblasRowMajor, &opA, &opB, &m, &n, &k, &alpha,
+								  const_cast<const float32 **>(a), &ldaInt, const_cast<const float32 **>(b), &ldbInt,
+								  &beta, const_cast<float32 **>(c), &ldcInt, 1, &size);
+			#else
+				if (!tuning::parallel(tuning::Op::MATMUL, M * N * K))
+				{
+					builtin_gemm_batch(transA, transB, batch, M, N, K, alpha, a, lda, b, ldb, beta, c, ldc);
+					return;
+				}
+
+				for (uint64 i = 0; i < batch; i++)
+					rapid_gemm(transA, transB, M, N, K, alpha, a[i], lda, b[i], ldb, beta, c[i], ldc);
+			#endif
 			}
 		}
 	}
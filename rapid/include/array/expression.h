@@ -0,0 +1,970 @@
+#pragma once
+
+#include "../internal.h"
+#include "../rapid_math.h"
+#include "../io.h"
+
+#include "simd.h"
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		template<typename arrayType>
+		class Array;
+
+		namespace expr
+		{
+			/**************************/
+			/* Elementwise operations */
+			/**************************/
+
+			// Operations marked as "cheap" are limited by memory bandwidth,
+			// so expressions made only from them need far more elements
+			// before running them in parallel becomes worthwhile
+
+			struct Add
+			{
+				static constexpr bool cheap = true;
+				static inline const char *name() { return "add"; }
+				template<typename t> static inline t apply(const t &x, const t &y) { return x + y; }
+			};
+
+			struct Sub
+			{
+				static constexpr bool cheap = true;
+				static inline const char *name() { return "subtract"; }
+				template<typename t> static inline t apply(const t &x, const t &y) { return x - y; }
+			};
+
+			struct Mul
+			{
+				static constexpr bool cheap = true;
+				static inline const char *name() { return "multiply"; }
+				template<typename t> static inline t apply(const t &x, const t &y) { return x * y; }
+			};
+
+			struct Div
+			{
+				static constexpr bool cheap = true;
+				static inline const char *name() { return "divide"; }
+				template<typename t> static inline t apply(const t &x, const t &y) { return x / y; }
+			};
+
+			// The elementary functions take the accuracy of their
+			// vectorized kernels as a parameter. The scalar fallback always
+			// uses the standard library
+
+			template<simd::Accuracy mode = simd::Accuracy::DEFAULT>
+			struct Pow
+			{
+				static constexpr bool cheap = false;
+				static inline const char *name() { return "raise"; }
+				template<typename t> static inline t apply(const t &x, const t &y) { return std::pow(x, y); }
+			};
+
+			struct Minimum
+			{
+				static constexpr bool cheap = true;
+				static inline const char *name() { return "find the minimum of"; }
+				template<typename t> static inline t apply(const t &x, const t &y) { return x < y ? x : y; }
+			};
+
+			struct Maximum
+			{
+				static constexpr bool cheap = true;
+				static inline const char *name() { return "find the maximum of"; }
+				template<typename t> static inline t apply(const t &x, const t &y) { return x > y ? x : y; }
+			};
+
+			struct Less
+			{
+				static constexpr bool cheap = true;
+				static inline const char *name() { return "compare"; }
+				template<typename t> static inline t apply(const t &x, const t &y) { return x < y ? 1 : 0; }
+			};
+
+			struct Greater
+			{
+				static constexpr bool cheap = true;
+				static inline const char *name() { return "compare"; }
+				template<typename t> static inline t apply(const t &x, const t &y) { return x > y ? 1 : 0; }
+			};
+
+			struct Negate
+			{
+				static constexpr bool cheap = true;
+				template<typename t> static inline t apply(const t &x) { return -x; }
+			};
+
+			struct Abs
+			{
+				static constexpr bool cheap = true;
+				template<typename t> static inline t apply(const t &x) { return math::abs(x); }
+			};
+
+			struct Square
+			{
+				static constexpr bool cheap = true;
+				template<typename t> static inline t apply(const t &x) { return x * x; }
+			};
+
+			template<simd::Accuracy mode = simd::Accuracy::DEFAULT>
+			struct Sqrt
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::sqrt(x); }
+			};
+
+			template<simd::Accuracy mode = simd::Accuracy::DEFAULT>
+			struct Rsqrt
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return (t) 1 / std::sqrt(x); }
+			};
+
+			template<simd::Accuracy mode = simd::Accuracy::DEFAULT>
+			struct Exp
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::exp(x); }
+			};
+
+			template<simd::Accuracy mode = simd::Accuracy::DEFAULT>
+			struct Log
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::log(x); }
+			};
+
+			template<simd::Accuracy mode = simd::Accuracy::DEFAULT>
+			struct Sin
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::sin(x); }
+			};
+
+			template<simd::Accuracy mode = simd::Accuracy::DEFAULT>
+			struct Cos
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::cos(x); }
+			};
+
+			struct Tan
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::tan(x); }
+			};
+
+			struct Asin
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::asin(x); }
+			};
+
+			struct Acos
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::acos(x); }
+			};
+
+			struct Atan
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::atan(x); }
+			};
+
+			struct Sinh
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::sinh(x); }
+			};
+
+			struct Cosh
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::cosh(x); }
+			};
+
+			template<simd::Accuracy mode = simd::Accuracy::DEFAULT>
+			struct Tanh
+			{
+				static constexpr bool cheap = false;
+				template<typename t> static inline t apply(const t &x) { return std::tanh(x); }
+			};
+
+			template<simd::Accuracy mode = simd::Accuracy::DEFAULT>
+			struct Sigmoid
+			{
+				static constexpr bool cheap = false;
+				template<typename t>
+				static inline t apply(const t &x)
+				{
+					// Written so the exponent never overflows
+					const t e = std::exp(-std::abs(x));
+					return (x < 0 ? e : (t) 1) / ((t) 1 + e);
+				}
+			};
+
+			// Expressions that cannot be evaluated as a flat loop are evaluated
+			// in blocks of at most this many elements. Each block is small enough
+			// to stay in cache, and is processed with simple, vectorisable loops
+			static constexpr uint64 blockSize = 256;
+
+			/// <summary>
+			/// Map an index in the result of an expression to an index in
+			/// one of its operands, following NumPy's broadcasting rules.
+			/// The default mapping is the identity, which allows the
+			/// expression to be evaluated as a flat loop.
+			///
+			/// Each run of adjacent dimensions that are not broadcast is
+			/// stored as a single term, so the mapping is calculated in
+			/// ((index / div) % mod) * mul for every term. Within an aligned
+			/// block of "length" elements, consecutive indices map either
+			/// to consecutive indices (step = 1) or to the same index (step = 0)
+			/// </summary>
+			struct Broadcast
+			{
+				struct Term
+				{
+					uint64 div;
+					uint64 mod;
+					uint64 mul;
+				};
+
+				bool identity = true;
+				std::vector<Term> terms;
+				uint64 length = (uint64) -1;
+				uint64 step = 1;
+
+				Broadcast() = default;
+
+				/// <summary>
+				/// Create the mapping from an array with a given shape to
+				/// an operand broadcast to that shape. The shapes must be
+				/// compatible, but this is not checked here
+				/// </summary>
+				Broadcast(const std::vector<uint64> &resShape, const std::vector<uint64> &operandShape)
+				{
+					if (math::prod(resShape) == math::prod(operandShape))
+						return;
+
+					identity = false;
+					step = 0;
+
+					const uint64 lead = resShape.size() - operandShape.size();
+					uint64 resStride = 1, operandStride = 1;
+					bool inRun = false;
+					bool innermost = true;
+
+					for (uint64 i = resShape.size(); i > 0; i--)
+					{
+						uint64 dim = resShape[i - 1];
+						uint64 operandDim = i - 1 < lead ? 1 : operandShape[i - 1 - lead];
+
+						// Dimensions of size one are never stepped over
+						if (dim == 1)
+							continue;
+
+						if (operandDim == dim)
+						{
+							if (!inRun)
+								terms.push_back({resStride, 1, operandStride});
+							terms.back().mod *= dim;
+							inRun = true;
+						}
+						else
+						{
+							inRun = false;
+						}
+
+						if (innermost)
+							step = operandDim == dim ? 1 : 0;
+						innermost = false;
+
+						resStride *= dim;
+						operandStride *= operandDim;
+					}
+
+					if (!terms.empty())
+						length = step ? terms[0].mod : terms[0].div;
+				}
+
+				/// <summary>
+				/// Create a mapping in which every index maps to the first
+				/// element of the operand
+				/// </summary>
+				/// <returns></returns>
+				static inline Broadcast constant()
+				{
+					Broadcast res;
+					res.identity = false;
+					res.step = 0;
+					return res;
+				}
+
+				inline bool isIdentity() const
+				{
+					return identity;
+				}
+
+				inline uint64 map(uint64 index) const
+				{
+					if (identity)
+						return index;
+
+					uint64 res = 0;
+					for (const auto &term : terms)
+						res += ((index / term.div) % term.mod) * term.mul;
+					return res;
+				}
+			};
+
+			inline std::string shapeToString(const std::vector<uint64> &shape)
+			{
+				std::string res;
+
+				for (uint64 i = 0; i < shape.size(); i++)
+					res += std::to_string(shape[i]) + (i == shape.size() - 1 ? "" : ", ");
+
+				return res;
+			}
+		}
+
+		/// <summary>
+		/// A leaf of an expression which reads from an array. The array is
+		/// stored by value, which links it to the original data without
+		/// copying it, so an expression never outlives the memory it reads.
+		/// Half precision values are widened to single precision as they
+		/// are read, so the whole expression is calculated in single
+		/// precision and only rounded when it is stored
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		template<typename t>
+		class ArrayLeaf
+		{
+		public:
+			using valueType = typename accumulator<t>::type;
+			using storageType = t;
+			static constexpr bool isExpression = true;
+			static constexpr bool cheap = true;
+			static constexpr bool vectorized = simd::isVectorType<valueType>::value;
+
+			std::vector<uint64> shape;
+			bool isZeroDim;
+
+			ArrayLeaf(const Array<t> &arr) : shape(arr.shape), isZeroDim(arr.isZeroDim), m_Array(arr), m_Data(arr.dataStart)
+			{}
+
+			/// <summary>
+			/// Create a leaf from a temporary array. The array is moved into
+			/// the leaf, so if nothing else refers to its memory, the memory
+			/// can be reused to store the result of the expression
+			/// </summary>
+			ArrayLeaf(Array<t> &&arr) : shape(arr.shape), isZeroDim(arr.isZeroDim), m_Array(std::move(arr)),
+				m_Data(m_Array.dataStart), m_Expiring(true)
+			{}
+
+			inline valueType contiguous(uint64 index) const
+			{
+				return m_Data[index];
+			}
+
+			/// <summary>
+			/// Return a pointer to "len" consecutive elements of the
+			/// expression, starting at "index". Contiguous data is read
+			/// in place, otherwise it is gathered into "buffer"
+			/// </summary>
+			inline const valueType *block(uint64 index, uint64 len, valueType *buffer) const
+			{
+				if (m_Array.isContiguous())
+					return read(m_Data + index, len, buffer);
+
+				const t *src = m_Data + m_Array.offsetOf(index);
+				const uint64 inc = m_Array.stride[m_Array.stride.size() - 1];
+
+				for (uint64 i = 0; i < len; i++)
+					buffer[i] = src[i * inc];
+
+				return buffer;
+			}
+
+			/// <summary>
+			/// Return the length of the aligned blocks that can be read
+			/// with a single call to block()
+			/// </summary>
+			inline uint64 blockLength() const
+			{
+				return m_Array.isContiguous() ? (uint64) -1 : shape[shape.size() - 1];
+			}
+
+			inline bool isContiguous() const
+			{
+				return m_Array.isContiguous();
+			}
+
+			/// <summary>
+			/// Returns true if the expression can be written into an array
+			/// while it is being evaluated. This is only the case if no
+			/// element is read after the same location has been written
+			/// </summary>
+			inline bool aliasSafe(const Array<t> &dst, bool identity) const
+			{
+				const t *dataEnd = m_Data + m_Array.span();
+
+				if (dataEnd <= dst.dataStart || m_Data >= dst.dataStart + dst.span())
+					return true;
+
+				return identity && m_Data == dst.dataStart && m_Array.stride == dst.stride;
+			}
+
+			/// <summary>
+			/// Arrays of different types never share memory
+			/// </summary>
+			template<typename d>
+			inline bool aliasSafe(const Array<d> &dst, bool identity) const
+			{
+				return true;
+			}
+
+			/// <summary>
+			/// Return the temporary array this leaf reads from, if nothing
+			/// else refers to its memory and it can be reused. Otherwise,
+			/// nullptr is returned
+			/// </summary>
+			inline const Array<t> *expiring() const
+			{
+				if (m_Expiring && m_Array.isUnique() && m_Array.isContiguous() && m_Array.isReusable())
+					return &m_Array;
+				return nullptr;
+			}
+
+			inline Array<t> eval() const
+			{
+				return m_Array.copy();
+			}
+
+			inline operator Array<t>() const
+			{
+				return eval();
+			}
+
+		private:
+			Array<t> m_Array;
+			const t *m_Data;
+			bool m_Expiring = false;
+
+			static inline const valueType *read(const valueType *src, uint64 /*len*/, valueType * /*buffer*/)
+			{
+				return src;
+			}
+
+			template<typename s>
+			static inline const valueType *read(const s *src, uint64 len, valueType *buffer)
+			{
+				simd::convert(src, buffer, len);
+				return buffer;
+			}
+		};
+
+		/// <summary>
+		/// A leaf of an expression which holds a single scalar value, used
+		/// with arrays of type "t". The value is held in the type the
+		/// expression is calculated in
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		template<typename t>
+		class ScalarLeaf
+		{
+		public:
+			using valueType = typename accumulator<t>::type;
+			using storageType = t;
+			static constexpr bool isExpression = true;
+			static constexpr bool cheap = true;
+			static constexpr bool vectorized = simd::isVectorType<valueType>::value;
+
+			ScalarLeaf(const valueType &val) : m_Val(val)
+			{}
+
+			inline valueType contiguous(uint64 /*index*/) const
+			{
+				return m_Val;
+			}
+
+			inline const valueType *block(uint64 /*index*/, uint64 len, valueType *buffer) const
+			{
+				for (uint64 i = 0; i < len; i++)
+					buffer[i] = m_Val;
+
+				return buffer;
+			}
+
+			inline uint64 blockLength() const
+			{
+				return (uint64) -1;
+			}
+
+			inline bool isContiguous() const
+			{
+				return true;
+			}
+
+			template<typename d>
+			inline bool aliasSafe(const Array<d> &dst, bool identity) const
+			{
+				return true;
+			}
+
+			inline const Array<t> *expiring() const
+			{
+				return nullptr;
+			}
+
+		private:
+			valueType m_Val;
+		};
+
+		namespace expr
+		{
+			/// <summary>
+			/// True for leaves holding a single value, which only need to
+			/// be read once for every block of an expression
+			/// </summary>
+			/// <typeparam name="E"></typeparam>
+			template<typename E>
+			struct isScalar : std::false_type
+			{};
+
+			template<typename t>
+			struct isScalar<ScalarLeaf<t>> : std::true_type
+			{};
+		}
+
+		/// <summary>
+		/// An elementwise operation applied to a single expression.
+		/// Nothing is calculated until the expression is evaluated,
+		/// either by assigning it to an array or by calling eval()
+		/// </summary>
+		/// <typeparam name="Op"></typeparam>
+		/// <typeparam name="E"></typeparam>
+		template<typename Op, typename E>
+		class UnaryExpression
+		{
+		public:
+			static constexpr bool isExpression = true;
+			static constexpr bool cheap = Op::cheap && E::cheap;
+			using valueType = typename E::valueType;
+			using storageType = typename E::storageType;
+			static constexpr bool vectorized = simd::vectorizable<Op, valueType>::value && E::vectorized;
+
+			std::vector<uint64> shape;
+			bool isZeroDim;
+
+			UnaryExpression(E operand) : shape(operand.shape), isZeroDim(operand.isZeroDim), m_Operand(std::move(operand))
+			{}
+
+			inline valueType contiguous(uint64 index) const
+			{
+				return Op::apply(m_Operand.contiguous(index));
+			}
+
+			inline const valueType *block(uint64 index, uint64 len, valueType *buffer) const
+			{
+				const valueType *src = m_Operand.block(index, len, buffer);
+				simd::unary<Op>(src, buffer, len);
+				return buffer;
+			}
+
+			inline uint64 blockLength() const
+			{
+				return m_Operand.blockLength();
+			}
+
+			inline bool isContiguous() const
+			{
+				return m_Operand.isContiguous();
+			}
+
+			template<typename d>
+			inline bool aliasSafe(const Array<d> &dst, bool identity) const
+			{
+				return m_Operand.aliasSafe(dst, identity);
+			}
+
+			inline const Array<storageType> *expiring() const
+			{
+				return m_Operand.expiring();
+			}
+
+			inline Array<storageType> eval() const
+			{
+				Array<storageType> res(shape);
+				Array<storageType>::evaluateExpression(*this, res);
+				res.isZeroDim = isZeroDim;
+				return res;
+			}
+
+			inline operator Array<storageType>() const
+			{
+				return eval();
+			}
+
+		private:
+			E m_Operand;
+		};
+
+		/// <summary>
+		/// An elementwise operation applied to two expressions, which
+		/// may be broadcast against each other. Nothing is calculated
+		/// until the expression is evaluated, either by assigning it
+		/// to an array or by calling eval()
+		/// </summary>
+		/// <typeparam name="Op"></typeparam>
+		/// <typeparam name="L"></typeparam>
+		/// <typeparam name="R"></typeparam>
+		template<typename Op, typename L, typename R>
+		class BinaryExpression
+		{
+		public:
+			static constexpr bool isExpression = true;
+			static constexpr bool cheap = Op::cheap && L::cheap && R::cheap;
+			using valueType = typename L::valueType;
+			using storageType = typename L::storageType;
+			static constexpr bool vectorized = simd::vectorizable<Op, valueType>::value && L::vectorized && R::vectorized;
+
+			std::vector<uint64> shape;
+			bool isZeroDim;
+
+			BinaryExpression(L lhs, R rhs, const std::vector<uint64> &resShape, bool resZeroDim,
+							 const expr::Broadcast &lhsMap = expr::Broadcast(),
+							 const expr::Broadcast &rhsMap = expr::Broadcast())
+				: shape(resShape), isZeroDim(resZeroDim), m_Lhs(std::move(lhs)), m_Rhs(std::move(rhs)),
+				m_LhsMap(lhsMap), m_RhsMap(rhsMap)
+			{}
+
+			inline valueType contiguous(uint64 index) const
+			{
+				return Op::apply(m_Lhs.contiguous(index), m_Rhs.contiguous(index));
+			}
+
+			/// <summary>
+			/// Calculate "len" consecutive elements of the expression,
+			/// starting at "index", and store them in "buffer". An operand
+			/// that is broadcast along the block is only read once
+			/// </summary>
+			inline const valueType *block(uint64 index, uint64 len, valueType *buffer) const
+			{
+				valueType lhsBuffer[expr::blockSize];
+				valueType rhsBuffer[expr::blockSize];
+
+				const bool lhsStep = m_LhsMap.step && !expr::isScalar<L>::value;
+				const bool rhsStep = m_RhsMap.step && !expr::isScalar<R>::value;
+
+				const valueType *lhs = m_Lhs.block(m_LhsMap.map(index), lhsStep ? len : 1, lhsBuffer);
+				const valueType *rhs = m_Rhs.block(m_RhsMap.map(index), rhsStep ? len : 1, rhsBuffer);
+
+				if (lhsStep || rhsStep)
+				{
+					simd::binary<Op>(lhs, lhsStep, rhs, rhsStep, buffer, len);
+				}
+				else
+				{
+					const valueType val = Op::apply(lhs[0], rhs[0]);
+					for (uint64 i = 0; i < len; i++)
+						buffer[i] = val;
+				}
+
+				return buffer;
+			}
+
+			/// <summary>
+			/// Return the length of the aligned blocks within which every
+			/// operand can be read with a single call to block()
+			/// </summary>
+			inline uint64 blockLength() const
+			{
+				uint64 res = math::min(m_LhsMap.length, m_RhsMap.length);
+
+				if (m_LhsMap.step)
+					res = math::min(res, m_Lhs.blockLength());
+				if (m_RhsMap.step)
+					res = math::min(res, m_Rhs.blockLength());
+
+				return res;
+			}
+
+			inline bool isContiguous() const
+			{
+				return m_LhsMap.isIdentity() && m_RhsMap.isIdentity() &&
+					m_Lhs.isContiguous() && m_Rhs.isContiguous();
+			}
+
+			template<typename d>
+			inline bool aliasSafe(const Array<d> &dst, bool identity) const
+			{
+				return m_Lhs.aliasSafe(dst, identity && m_LhsMap.isIdentity()) &&
+					m_Rhs.aliasSafe(dst, identity && m_RhsMap.isIdentity());
+			}
+
+			/// <summary>
+			/// Return a temporary array, read with the same shape as the
+			/// result, whose memory can be reused to store the result
+			/// </summary>
+			inline const Array<storageType> *expiring() const
+			{
+				const Array<storageType> *res = m_LhsMap.isIdentity() ? m_Lhs.expiring() : nullptr;
+				if (res == nullptr && m_RhsMap.isIdentity())
+					res = m_Rhs.expiring();
+				return res;
+			}
+
+			inline Array<storageType> eval() const
+			{
+				Array<storageType> res(shape);
+				Array<storageType>::evaluateExpression(*this, res);
+				res.isZeroDim = isZeroDim;
+				return res;
+			}
+
+			inline operator Array<storageType>() const
+			{
+				return eval();
+			}
+
+		private:
+			L m_Lhs;
+			R m_Rhs;
+			expr::Broadcast m_LhsMap;
+			expr::Broadcast m_RhsMap;
+		};
+
+		namespace expr
+		{
+			/// <summary>
+			/// Information about a type that can be used in an expression.
+			/// Arrays are wrapped in an ArrayLeaf, while expressions are
+			/// used directly
+			/// </summary>
+			template<typename E, typename = void>
+			struct operandTraits
+			{
+				static constexpr bool isOperand = false;
+				static constexpr bool isNode = false;
+			};
+
+			template<typename E>
+			struct operandTraits<E, typename std::enable_if<E::isExpression>::type>
+			{
+				static constexpr bool isOperand = true;
+				static constexpr bool isNode = true;
+
+				using valueType = typename E::storageType;
+				using leafType = E;
+
+				static inline const E &leaf(const E &e)
+				{
+					return e;
+				}
+
+				static inline E leaf(E &&e)
+				{
+					return std::move(e);
+				}
+			};
+
+			template<typename t>
+			struct operandTraits<Array<t>, void>
+			{
+				static constexpr bool isOperand = true;
+				static constexpr bool isNode = false;
+
+				using valueType = t;
+				using leafType = ArrayLeaf<t>;
+
+				static inline ArrayLeaf<t> leaf(const Array<t> &arr)
+				{
+					return ArrayLeaf<t>(arr);
+				}
+
+				static inline ArrayLeaf<t> leaf(Array<t> &&arr)
+				{
+					return ArrayLeaf<t>(std::move(arr));
+				}
+			};
+
+			// References and cv-qualifiers are ignored, so operands can be
+			// forwarded into an expression, allowing temporaries to be moved
+			template<typename E>
+			using traits = operandTraits<typename std::decay<E>::type>;
+
+			/// <summary>
+			/// Calculate the shape of the result of an elementwise operation
+			/// on two arrays, as well as the mapping from the result to each
+			/// of the operands. Shapes are broadcast following NumPy's rules,
+			/// so dimensions are aligned from the end, and each pair must be
+			/// equal or contain a one. An array with only a single element is
+			/// treated like a scalar, and the result takes the other shape
+			/// </summary>
+			inline void broadcastShapes(const std::vector<uint64> &a, const std::vector<uint64> &b, const char *opName,
+										std::vector<uint64> &resShape, Broadcast &aMap, Broadcast &bMap)
+			{
+				if (a == b)
+				{
+					resShape = a;
+					return;
+				}
+
+				if (math::prod(b) == 1)
+				{
+					resShape = a;
+					bMap = Broadcast::constant();
+					return;
+				}
+
+				if (math::prod(a) == 1)
+				{
+					resShape = b;
+					aMap = Broadcast::constant();
+					return;
+				}
+
+				const uint64 dims = math::max(a.size(), b.size());
+				resShape = std::vector<uint64>(dims);
+
+				for (uint64 i = 0; i < dims; i++)
+				{
+					uint64 dimA = i < dims - a.size() ? 1 : a[i - (dims - a.size())];
+					uint64 dimB = i < dims - b.size() ? 1 : b[i - (dims - b.size())];
+
+					if (dimA != dimB && dimA != 1 && dimB != 1)
+						message::RapidError("Broadcast Error", std::string("Cannot ") + opName + " arrays with shapes (" +
+											shapeToString(a) + ") and (" + shapeToString(b) + ")").display();
+
+					resShape[i] = dimA == 1 ? dimB : dimA;
+				}
+
+				aMap = Broadcast(resShape, a);
+				bMap = Broadcast(resShape, b);
+			}
+
+			template<typename Op, typename L, typename R>
+			using binaryType = BinaryExpression<Op, typename traits<L>::leafType, typename traits<R>::leafType>;
+
+			template<typename Op, typename L>
+			using scalarType = BinaryExpression<Op, typename traits<L>::leafType, ScalarLeaf<typename traits<L>::valueType>>;
+
+			template<typename Op, typename R>
+			using reverseScalarType = BinaryExpression<Op, ScalarLeaf<typename traits<R>::valueType>, typename traits<R>::leafType>;
+
+			template<typename Op, typename E>
+			using unaryType = UnaryExpression<Op, typename traits<E>::leafType>;
+
+			// Operands are forwarded, so temporary arrays are moved into the
+			// expression rather than being shared with it
+
+			template<typename Op, typename L, typename R>
+			inline binaryType<Op, L, R> makeBinary(L &&lhs, R &&rhs)
+			{
+				using valueType = typename traits<L>::valueType;
+				static_assert(std::is_same<valueType, typename traits<R>::valueType>::value,
+							  "Cannot combine arrays with different types in an expression");
+
+				std::vector<uint64> resShape;
+				Broadcast lhsMap, rhsMap;
+				broadcastShapes(lhs.shape, rhs.shape, Op::name(), resShape, lhsMap, rhsMap);
+				bool zeroDim = lhs.isZeroDim && rhs.isZeroDim;
+
+				return binaryType<Op, L, R>(traits<L>::leaf(std::forward<L>(lhs)), traits<R>::leaf(std::forward<R>(rhs)),
+											resShape, zeroDim, lhsMap, rhsMap);
+			}
+
+			template<typename Op, typename L, typename S>
+			inline scalarType<Op, L> makeScalar(L &&lhs, const S &rhs)
+			{
+				using valueType = typename traits<L>::valueType;
+				std::vector<uint64> resShape = lhs.shape;
+				bool zeroDim = lhs.isZeroDim;
+
+				using scalarValue = typename ScalarLeaf<valueType>::valueType;
+
+				return scalarType<Op, L>(traits<L>::leaf(std::forward<L>(lhs)), ScalarLeaf<valueType>((scalarValue) rhs),
+										 resShape, zeroDim);
+			}
+
+			template<typename Op, typename S, typename R>
+			inline reverseScalarType<Op, R> makeReverseScalar(const S &lhs, R &&rhs)
+			{
+				using valueType = typename traits<R>::valueType;
+				std::vector<uint64> resShape = rhs.shape;
+				bool zeroDim = rhs.isZeroDim;
+
+				using scalarValue = typename ScalarLeaf<valueType>::valueType;
+
+				return reverseScalarType<Op, R>(ScalarLeaf<valueType>((scalarValue) lhs), traits<R>::leaf(std::forward<R>(rhs)),
+												resShape, zeroDim);
+			}
+
+			template<typename Op, typename E>
+			inline unaryType<Op, E> makeUnary(E &&operand)
+			{
+				return unaryType<Op, E>(traits<E>::leaf(std::forward<E>(operand)));
+			}
+		}
+
+		namespace expr
+		{
+			/// <summary>
+			/// Types that can be combined with an array as a single value
+			/// </summary>
+			/// <typeparam name="S"></typeparam>
+			template<typename S>
+			struct isScalarValue : std::integral_constant<bool, std::is_arithmetic<S>::value || isHalf<S>::value>
+			{};
+		}
+
+	#define RAPID_EXPRESSION_OPERATOR(op, functor)																			\
+		template<typename L, typename R,																					\
+			typename std::enable_if<expr::traits<L>::isOperand && expr::traits<R>::isOperand, int>::type = 0>				\
+		inline expr::binaryType<functor, L, R> operator op(L &&lhs, R &&rhs)												\
+		{																													\
+			return expr::makeBinary<functor>(std::forward<L>(lhs), std::forward<R>(rhs));									\
+		}																													\
+																															\
+		template<typename L, typename S,																					\
+			typename std::enable_if<expr::traits<L>::isOperand && expr::isScalarValue<S>::value, int>::type = 0>				\
+		inline expr::scalarType<functor, L> operator op(L &&lhs, const S &rhs)												\
+		{																													\
+			return expr::makeScalar<functor>(std::forward<L>(lhs), rhs);													\
+		}																													\
+																															\
+		template<typename S, typename R,																					\
+			typename std::enable_if<expr::isScalarValue<S>::value && expr::traits<R>::isOperand, int>::type = 0>				\
+		inline expr::reverseScalarType<functor, R> operator op(const S &lhs, R &&rhs)										\
+		{																													\
+			return expr::makeReverseScalar<functor>(lhs, std::forward<R>(rhs));												\
+		}
+
+		// Array/expression arithmetic. Each operator returns an expression
+		// which is only evaluated when it is assigned to an array, so
+		// a chain of operations runs as a single loop over memory
+		RAPID_EXPRESSION_OPERATOR(+, expr::Add)
+		RAPID_EXPRESSION_OPERATOR(-, expr::Sub)
+		RAPID_EXPRESSION_OPERATOR(*, expr::Mul)
+		RAPID_EXPRESSION_OPERATOR(/, expr::Div)
+
+	#undef RAPID_EXPRESSION_OPERATOR
+
+		/// <summary>
+		/// Negate an array or expression
+		/// </summary>
+		/// <typeparam name="E"></typeparam>
+		/// <param name="operand"></param>
+		/// <returns></returns>
+		template<typename E, typename std::enable_if<expr::traits<E>::isOperand, int>::type = 0>
+		inline expr::unaryType<expr::Negate, E> operator-(E &&operand)
+		{
+			return expr::makeUnary<expr::Negate>(std::forward<E>(operand));
+		}
+	}
+}
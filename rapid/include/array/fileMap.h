@@ -0,0 +1,210 @@
+#pragma once
+
+#include "../internal.h"
+
+#ifndef RAPID_OS_WINDOWS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		/// <summary>
+		/// How the memory of a file mapped into an array can be used.
+		/// READ_ONLY memory is shared with every other process mapping
+		/// the file, and writing to it is an error. COPY_ON_WRITE memory
+		/// can be written to, but each page is copied the first time it is
+		/// changed, so the file is never modified. READ_WRITE memory is
+		/// shared, and changes are written back to the file
+		/// </summary>
+		enum class MapMode
+		{
+			READ_ONLY = 0,
+			COPY_ON_WRITE = 1,
+			READ_WRITE = 2
+		};
+
+		/// <summary>
+		/// Hints about the order the memory of a mapped file will be read
+		/// in, which the operating system uses to decide which pages to
+		/// read ahead. WILL_NEED starts reading the whole file immediately.
+		/// The hints are ignored on Windows
+		/// </summary>
+		enum class MapAccess
+		{
+			NORMAL = 0,
+			SEQUENTIAL = 1,
+			RANDOM = 2,
+			WILL_NEED = 3
+		};
+
+		namespace fileMap
+		{
+			/// <summary>
+			/// A mapped range of a file. "base" and "length" describe the
+			/// whole mapping, which starts on a page boundary, and "data"
+			/// is the first byte that was requested
+			/// </summary>
+			struct Region
+			{
+				void *base = nullptr;
+				uint64 length = 0;
+				void *data = nullptr;
+			};
+
+			/// <summary>
+			/// Map "bytes" bytes of a file, starting "offset" bytes into it.
+			/// Returns false and sets "error" if the file could not be opened
+			/// or mapped, or is too short
+			/// </summary>
+			/// <param name="path"></param>
+			/// <param name="offset"></param>
+			/// <param name="bytes"></param>
+			/// <param name="mode"></param>
+			/// <param name="region"></param>
+			/// <param name="error"></param>
+			/// <returns></returns>
+			inline bool map(const std::string &path, uint64 offset, uint64 bytes, MapMode mode,
+							Region &region, std::string &error)
+			{
+			#ifdef RAPID_OS_WINDOWS
+				const DWORD access = mode == MapMode::READ_WRITE ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+				HANDLE file = CreateFileA(path.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+										  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+				if (file == INVALID_HANDLE_VALUE)
+				{
+					error = "Unable to open file";
+					return false;
+				}
+
+				LARGE_INTEGER size;
+				if (!GetFileSizeEx(file, &size) || (uint64) size.QuadPart < offset + bytes)
+				{
+					CloseHandle(file);
+					error = "File is too short for the requested shape";
+					return false;
+				}
+
+				const DWORD protect = mode == MapMode::READ_ONLY ? PAGE_READONLY :
+					mode == MapMode::COPY_ON_WRITE ? PAGE_WRITECOPY : PAGE_READWRITE;
+				HANDLE mapping = CreateFileMappingA(file, nullptr, protect, 0, 0, nullptr);
+				CloseHandle(file);
+
+				if (mapping == nullptr)
+				{
+					error = "Unable to map file";
+					return false;
+				}
+
+				// Views must start on a multiple of the allocation granularity
+				SYSTEM_INFO info;
+				GetSystemInfo(&info);
+				const uint64 start = offset - offset % info.dwAllocationGranularity;
+
+				const DWORD view = mode == MapMode::READ_ONLY ? FILE_MAP_READ :
+					mode == MapMode::COPY_ON_WRITE ? FILE_MAP_COPY : FILE_MAP_WRITE;
+				region.length = bytes + (offset - start);
+				region.base = MapViewOfFile(mapping, view, (DWORD) (start >> 32), (DWORD) start, (SIZE_T) region.length);
+				CloseHandle(mapping);
+
+				if (region.base == nullptr)
+				{
+					error = "Unable to map file";
+					return false;
+				}
+			#elif !defined(RAPID_OS_UNKNOWN)
+				const int file = open(path.c_str(), mode == MapMode::READ_WRITE ? O_RDWR : O_RDONLY);
+				if (file < 0)
+				{
+					error = "Unable to open file";
+					return false;
+				}
+
+				struct stat info;
+				if (fstat(file, &info) != 0 || (uint64) info.st_size < offset + bytes)
+				{
+					close(file);
+					error = "File is too short for the requested shape";
+					return false;
+				}
+
+				// Mappings must start on a page boundary
+				const uint64 page = (uint64) sysconf(_SC_PAGESIZE);
+				const uint64 start = offset - offset % page;
+
+				const int protect = mode == MapMode::READ_ONLY ? PROT_READ : PROT_READ | PROT_WRITE;
+				const int flags = mode == MapMode::COPY_ON_WRITE ? MAP_PRIVATE : MAP_SHARED;
+				region.length = bytes + (offset - start);
+				region.base = mmap(nullptr, (size_t) region.length, protect, flags, file, (off_t) start);
+
+				// The mapping keeps the file open
+				close(file);
+
+				if (region.base == MAP_FAILED)
+				{
+					region.base = nullptr;
+					error = "Unable to map file";
+					return false;
+				}
+			#else
+				error = "Memory mapped files are not supported on this platform";
+				return false;
+			#endif
+
+				region.data = (char *) region.base + (region.length - bytes);
+				return true;
+			}
+
+			/// <summary>
+			/// Unmap a region created by fileMap::map
+			/// </summary>
+			/// <param name="region"></param>
+			inline void unmap(const Region &region)
+			{
+			#ifdef RAPID_OS_WINDOWS
+				UnmapViewOfFile(region.base);
+			#elif !defined(RAPID_OS_UNKNOWN)
+				munmap(region.base, (size_t) region.length);
+			#endif
+			}
+
+			/// <summary>
+			/// Tell the operating system how "bytes" bytes of memory starting
+			/// at "data" will be accessed. Only whole pages are affected
+			/// </summary>
+			/// <param name="data"></param>
+			/// <param name="bytes"></param>
+			/// <param name="access"></param>
+			inline void advise(const void *data, uint64 bytes, MapAccess access)
+			{
+			#if !defined(RAPID_OS_WINDOWS) && !defined(RAPID_OS_UNKNOWN)
+				const uint64 page = (uint64) sysconf(_SC_PAGESIZE);
+				const uint64 address = (uint64) data;
+				const uint64 start = address - address % page;
+
+				int advice = MADV_NORMAL;
+				switch (access)
+				{
+					case MapAccess::SEQUENTIAL:
+						advice = MADV_SEQUENTIAL;
+						break;
+					case MapAccess::RANDOM:
+						advice = MADV_RANDOM;
+						break;
+					case MapAccess::WILL_NEED:
+						advice = MADV_WILLNEED;
+						break;
+					default:
+						break;
+				}
+
+				madvise((void *) start, (size_t) (bytes + (address - start)), advice);
+			#endif
+			}
+		}
+	}
+}
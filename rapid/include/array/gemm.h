@@ -0,0 +1,621 @@
+#pragma once
+
+#include "../internal.h"
+#include "../tuning.h"
+
+#include "simd.h"
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		namespace gemm
+		{
+			/// <summary>
+			/// The number of steps of the inner dimension in each block. A
+			/// panel of A and a panel of B this deep fit in the L1 cache
+			/// </summary>
+			constexpr uint64 blockDepth = 256;
+
+			/// <summary>
+			/// The number of rows of A packed at once. A block of A this
+			/// large fits in the L2 cache
+			/// </summary>
+			constexpr uint64 blockRows = 96;
+
+			/// <summary>
+			/// The number of columns of B packed at once. A block of B this
+			/// large is intended to stay in the last level cache
+			/// </summary>
+			constexpr uint64 blockCols = 4096;
+
+			/// <summary>
+			/// The number of elements of the result of a matrix vector
+			/// product that are accumulated at once when the columns of the
+			/// matrix are contiguous. A strip of the result this long stays
+			/// in the L1 cache while every column is added to it
+			/// </summary>
+			constexpr uint64 gemvStrip = 2048;
+
+			namespace imp
+			{
+				/// <summary>
+				/// Return a buffer of at least "size" elements that belongs to
+				/// the calling thread. The buffer is kept and reused by later
+				/// products on the same thread, so products of a similar size
+				/// do not allocate any memory after the first
+				/// </summary>
+				template<typename t>
+				inline t *workspace(uint64 size)
+				{
+					thread_local std::unique_ptr<t[]> buffer;
+					thread_local uint64 capacity = 0;
+
+					if (capacity < size)
+					{
+						buffer.reset(new t[size]);
+						capacity = size;
+					}
+
+					return buffer.get();
+				}
+
+				/// <summary>
+				/// Multiply every element of an M by K matrix with rows "ldc"
+				/// elements apart by "beta". If "beta" is zero, the elements
+				/// are set to zero without being read, so they may hold any
+				/// value, as in BLAS
+				/// </summary>
+				template<typename t>
+				inline void scale(uint64 M, uint64 K, t beta, t *c, uint64 ldc)
+				{
+					for (uint64 i = 0; i < M; i++)
+						for (uint64 j = 0; j < K; j++)
+							c[i * ldc + j] = beta == 0 ? 0 : beta * c[i * ldc + j];
+				}
+
+				/// <summary>
+				/// Copy a block of "rows" rows of A by "depth" steps, multiplied
+				/// by "alpha", into panels of "panelRows" rows, laid out in the
+				/// order they are read by the micro-kernel. Rows past the end of
+				/// the block are filled with zeros. Half precision values are
+				/// widened as they are copied
+				/// </summary>
+				template<typename t, typename s>
+				inline void packA(const s *a, uint64 rowA, uint64 colA, uint64 rows, uint64 depth,
+								  uint64 panelRows, t alpha, t *packed)
+				{
+					for (uint64 i = 0; i < rows; i += panelRows)
+					{
+						const uint64 count = rows - i < panelRows ? rows - i : panelRows;
+
+						for (uint64 p = 0; p < depth; p++)
+						{
+							const s *src = a + i * rowA + p * colA;
+
+							uint64 r = 0;
+							for (; r < count; r++)
+								packed[r] = alpha * (t) src[r * rowA];
+							for (; r < panelRows; r++)
+								packed[r] = 0;
+
+							packed += panelRows;
+						}
+					}
+				}
+
+				/// <summary>
+				/// Copy a single panel of "cols" columns of B by "depth" steps,
+				/// padded with zeros to "panelCols" columns
+				/// </summary>
+				template<typename t, typename s>
+				inline void packB(const s *b, uint64 rowB, uint64 colB, uint64 cols, uint64 depth,
+								  uint64 panelCols, t *packed)
+				{
+					for (uint64 p = 0; p < depth; p++)
+					{
+						const s *src = b + p * rowB;
+
+						uint64 j = 0;
+						if (colB == 1)
+						{
+							simd::convert(src, packed, cols);
+							j = cols;
+						}
+						else
+						{
+							for (; j < cols; j++)
+								packed[j] = (t) src[j * colB];
+						}
+
+						for (; j < panelCols; j++)
+							packed[j] = 0;
+
+						packed += panelCols;
+					}
+				}
+
+				/// <summary>
+				/// Multiply a packed block of A by a packed block of B, one
+				/// register tile at a time. Tiles that extend past the edge
+				/// of C are calculated in "edge" and copied into place
+				/// </summary>
+				template<typename t>
+				inline void multiplyBlock(const simd::GemmKernel<t> &kernel, uint64 rows, uint64 cols, uint64 depth,
+										  const t *packedA, const t *packedB, t *c, uint64 ldc, bool accumulate,
+										  t *edge)
+				{
+					for (uint64 j = 0; j < cols; j += kernel.cols)
+					{
+						const uint64 tileCols = cols - j < kernel.cols ? cols - j : kernel.cols;
+						const t *panelB = packedB + j * depth;
+
+						for (uint64 i = 0; i < rows; i += kernel.rows)
+						{
+							const uint64 tileRows = rows - i < kernel.rows ? rows - i : kernel.rows;
+							const t *panelA = packedA + i * depth;
+							t *tile = c + i * ldc + j;
+
+							if (tileRows == kernel.rows && tileCols == kernel.cols)
+							{
+								kernel.func(depth, panelA, panelB, tile, ldc, accumulate);
+								continue;
+							}
+
+							kernel.func(depth, panelA, panelB, edge, kernel.cols, false);
+
+							for (uint64 r = 0; r < tileRows; r++)
+								for (uint64 col = 0; col < tileCols; col++)
+									tile[r * ldc + col] = accumulate ? tile[r * ldc + col] + edge[r * kernel.cols + col]
+																	 : edge[r * kernel.cols + col];
+						}
+					}
+				}
+
+				/// <summary>
+				/// Calculate a matrix product as described for gemm::gemm,
+				/// either in serial or using every thread. The elements of A
+				/// and B are stored as "s", and are converted to "t", which
+				/// the product is calculated in, as they are packed
+				/// </summary>
+				template<typename t, typename s>
+				inline void gemm(uint64 M, uint64 N, uint64 K, t alpha,
+								 const s *a, uint64 rowA, uint64 colA,
+								 const s *b, uint64 rowB, uint64 colB,
+								 t beta, t *c, uint64 ldc, bool parallel)
+				{
+					if (M == 0 || K == 0)
+						return;
+
+					// The first block of the product overwrites C if beta is
+					// zero, and otherwise every block is added to C once it has
+					// been scaled
+					if (N == 0 || (beta != 0 && beta != 1))
+						scale(M, K, beta, c, ldc);
+
+					if (N == 0)
+						return;
+
+					const auto kernel = simd::gemmKernel<t>();
+
+				#ifdef _OPENMP
+					const uint64 threads = parallel ? (uint64) omp_get_max_threads() : 1;
+				#else
+					const uint64 threads = 1;
+				#endif
+
+					// Use smaller blocks of A if there would otherwise be fewer
+					// blocks than threads
+					uint64 rows = blockRows;
+					if (threads > 1)
+					{
+						const uint64 share = ((M + threads - 1) / threads + kernel.rows - 1) / kernel.rows * kernel.rows;
+						rows = share < rows ? share : rows;
+					}
+
+					const uint64 rowBlocks = (M + rows - 1) / rows;
+
+					// Each block of B is split into one strip of panels per task,
+					// so every thread has work even if there is only one block of A
+					const uint64 colPanels = ((K < blockCols ? K : blockCols) + kernel.cols - 1) / kernel.cols;
+					uint64 colSplit = 1;
+					if (rowBlocks < threads)
+					{
+						colSplit = (threads + rowBlocks - 1) / rowBlocks;
+						colSplit = colSplit < colPanels ? colSplit : colPanels;
+					}
+
+					const uint64 tasks = rowBlocks * colSplit;
+					const uint64 depthMax = N < blockDepth ? N : blockDepth;
+
+					// Every thread packs its blocks of A into its own buffer
+					const uint64 sizeB = colPanels * kernel.cols * depthMax;
+					const uint64 sizeA = threads * rows * depthMax;
+					t *packedB = workspace<t>(sizeB + sizeA + threads * kernel.rows * kernel.cols);
+					t *packedA = packedB + sizeB, *edge = packedA + sizeA;
+
+					for (uint64 jc = 0; jc < K; jc += blockCols)
+					{
+						const uint64 cols = K - jc < blockCols ? K - jc : blockCols;
+						const uint64 panels = (cols + kernel.cols - 1) / kernel.cols;
+						const uint64 panelsPerTask = (panels + colSplit - 1) / colSplit;
+
+						for (uint64 pc = 0; pc < N; pc += blockDepth)
+						{
+							const uint64 depth = N - pc < blockDepth ? N - pc : blockDepth;
+							const bool accumulate = pc > 0 || beta != 0;
+
+							auto packPanel = [&](uint64 panel)
+							{
+								const uint64 j = panel * kernel.cols;
+								const uint64 count = cols - j < kernel.cols ? cols - j : kernel.cols;
+								packB(b + pc * rowB + (jc + j) * colB, rowB, colB, count, depth, kernel.cols,
+										   packedB + j * depth);
+							};
+
+							auto multiply = [&](uint64 task)
+							{
+								const uint64 block = task / colSplit;
+								const uint64 firstPanel = (task % colSplit) * panelsPerTask;
+								if (firstPanel >= panels)
+									return;
+
+								const uint64 i = block * rows;
+								const uint64 blockRowCount = M - i < rows ? M - i : rows;
+								const uint64 j = firstPanel * kernel.cols;
+								const uint64 lastCol = (firstPanel + panelsPerTask) * kernel.cols;
+								const uint64 colCount = (lastCol < cols ? lastCol : cols) - j;
+
+							#ifdef _OPENMP
+								const uint64 thread = parallel ? (uint64) omp_get_thread_num() : 0;
+							#else
+								const uint64 thread = 0;
+							#endif
+
+								t *threadA = packedA + thread * rows * depthMax;
+								packA(a + i * rowA + pc * colA, rowA, colA, blockRowCount, depth, kernel.rows, alpha, threadA);
+								multiplyBlock(kernel, blockRowCount, colCount, depth, threadA, packedB + j * depth,
+											  c + i * ldc + jc + j, ldc, accumulate,
+											  edge + thread * kernel.rows * kernel.cols);
+							};
+
+							if (!parallel)
+							{
+								for (uint64 panel = 0; panel < panels; panel++)
+									packPanel(panel);
+
+								for (uint64 task = 0; task < tasks; task++)
+									multiply(task);
+							}
+							else
+							{
+								long index = 0;
+
+							#pragma omp parallel for shared(panels, packPanel) private(index) default(none)
+								for (index = 0; index < (long) panels; ++index)
+									packPanel(index);
+
+							#pragma omp parallel for shared(tasks, multiply) private(index) default(none)
+								for (index = 0; index < (long) tasks; ++index)
+									multiply(index);
+							}
+						}
+					}
+				}
+
+				/// <summary>
+				/// Calculate a half precision matrix product in single
+				/// precision. A and B are widened as they are packed, and the
+				/// product is accumulated in a single precision copy of C,
+				/// which is rounded once the product is complete
+				/// </summary>
+				template<typename t, typename std::enable_if<isHalf<t>::value, int>::type = 0>
+				inline void gemm(uint64 M, uint64 N, uint64 K, t alpha,
+								 const t *a, uint64 rowA, uint64 colA,
+								 const t *b, uint64 rowB, uint64 colB,
+								 t beta, t *c, uint64 ldc, bool parallel)
+				{
+					if (M == 0 || K == 0)
+						return;
+
+					std::unique_ptr<float32[]> product(new float32[M * K]);
+
+					if (beta != 0)
+						for (uint64 i = 0; i < M; i++)
+							simd::convert(c + i * ldc, product.get() + i * K, K);
+
+					gemm(M, N, K, (float32) alpha, a, rowA, colA, b, rowB, colB, (float32) beta, product.get(), K, parallel);
+
+					for (uint64 i = 0; i < M; i++)
+						simd::convert(product.get() + i * K, c + i * ldc, K);
+				}
+
+				/// <summary>
+				/// The number of elements of a row or column of A that are
+				/// widened at a time by a half precision matrix vector product
+				/// </summary>
+				constexpr uint64 gemvConvertBlock = 256;
+
+				/// <summary>
+				/// Calculate the dot product of a contiguous row of A with x
+				/// </summary>
+				template<typename t>
+				inline t dotRow(const t *row, const t *x, uint64 len)
+				{
+					return simd::dot(row, x, len);
+				}
+
+				template<typename t, typename s>
+				inline t dotRow(const s *row, const t *x, uint64 len)
+				{
+					t buffer[gemvConvertBlock];
+					t res = 0;
+
+					for (uint64 j = 0; j < len; j += gemvConvertBlock)
+					{
+						const uint64 count = len - j < gemvConvertBlock ? len - j : gemvConvertBlock;
+						simd::convert(row + j, buffer, count);
+						res += simd::dot(buffer, x + j, count);
+					}
+
+					return res;
+				}
+
+				/// <summary>
+				/// Add alpha multiplied by a contiguous strip of a column of A,
+				/// no longer than gemvStrip, to y
+				/// </summary>
+				template<typename t>
+				inline void axpyColumn(t alpha, const t *column, t *y, uint64 len)
+				{
+					simd::axpy(alpha, column, y, len);
+				}
+
+				template<typename t, typename s>
+				inline void axpyColumn(t alpha, const s *column, t *y, uint64 len)
+				{
+					t buffer[gemvStrip];
+					simd::convert(column, buffer, len);
+					simd::axpy(alpha, buffer, y, len);
+				}
+
+				/// <summary>
+				/// Calculate a matrix vector product as described for
+				/// gemm::gemv, where x is contiguous. The elements of A are
+				/// stored as "s" and converted to "t" as they are read
+				/// </summary>
+				template<typename t, typename s>
+				inline void gemv(uint64 M, uint64 N, const s *a, uint64 rowA, uint64 colA,
+								 const t *x, t *y, t alpha, t beta)
+				{
+					const bool parallel = tuning::parallel(tuning::Op::REDUCE, M * N);
+
+					if (rowA == 1 && colA != 1 && M > 1)
+					{
+						const uint64 strips = (M + gemvStrip - 1) / gemvStrip;
+
+						auto strip = [&](uint64 index)
+						{
+							const uint64 i = index * gemvStrip;
+							const uint64 len = M - i < gemvStrip ? M - i : gemvStrip;
+
+							imp::scale(1, len, beta, y + i, len);
+
+							for (uint64 j = 0; j < N; j++)
+								axpyColumn(alpha * x[j], a + j * colA + i, y + i, len);
+						};
+
+						if (!parallel || strips == 1)
+						{
+							for (uint64 index = 0; index < strips; index++)
+								strip(index);
+							return;
+						}
+
+						long index = 0;
+
+					#pragma omp parallel for shared(strips, strip) private(index) default(none)
+						for (index = 0; index < (long) strips; ++index)
+							strip(index);
+
+						return;
+					}
+
+					auto row = [&](uint64 i)
+					{
+						const s *rowStart = a + i * rowA;
+
+						t res = 0;
+
+						if (colA == 1)
+						{
+							res = dotRow(rowStart, x, N);
+						}
+						else
+						{
+							for (uint64 j = 0; j < N; j++)
+								res += (t) rowStart[j * colA] * x[j];
+						}
+
+						y[i] = beta == 0 ? alpha * res : alpha * res + beta * y[i];
+					};
+
+					if (!parallel)
+					{
+						for (uint64 i = 0; i < M; i++)
+							row(i);
+						return;
+					}
+
+					long index = 0;
+
+				#pragma omp parallel for shared(M, row) private(index) default(none)
+					for (index = 0; index < (long) M; ++index)
+						row(index);
+				}
+
+				template<typename t>
+				inline void gemv(uint64 M, uint64 N, const t *a, uint64 rowA, uint64 colA,
+								 const t *x, uint64 incX, t *y, t alpha, t beta, std::true_type)
+				{
+					// The vector is read once for every row, so it is worth
+					// making it contiguous
+					if (incX != 1 && N > 1)
+					{
+						t *packedX = workspace<t>(N);
+						for (uint64 j = 0; j < N; j++)
+							packedX[j] = x[j * incX];
+						x = packedX;
+					}
+
+					gemv(M, N, a, rowA, colA, x, y, alpha, beta);
+				}
+
+				/// <summary>
+				/// Half precision products are calculated in single precision,
+				/// with the vector and the result widened once and A widened as
+				/// it is read
+				/// </summary>
+				template<typename t>
+				inline void gemv(uint64 M, uint64 N, const t *a, uint64 rowA, uint64 colA,
+								 const t *x, uint64 incX, t *y, t alpha, t beta, std::false_type)
+				{
+					using acc = typename accumulator<t>::type;
+
+					acc *wideX = workspace<acc>(N + M);
+					acc *wideY = wideX + N;
+
+					for (uint64 j = 0; j < N; j++)
+						wideX[j] = (acc) x[j * incX];
+
+					if (beta != 0)
+						simd::convert(y, wideY, M);
+
+					gemv(M, N, a, rowA, colA, (const acc *) wideX, wideY, (acc) alpha, (acc) beta);
+					simd::convert((const acc *) wideY, y, M);
+				}
+			}
+
+			/// <summary>
+			/// Calculate the matrix product C = alpha * A * B + beta * C,
+			/// where A has M rows and N columns, B has N rows and K columns,
+			/// and C has M rows and K columns. A and B may have any strides,
+			/// so transposed views can be passed directly, and the rows of C
+			/// are "ldc" elements apart. If "beta" is zero, C is not read.
+			/// C must not overlap A or B.
+			///
+			/// The product is calculated in cache-sized blocks. Each block
+			/// of B is packed into panels as wide as the register tile of
+			/// the micro-kernel, and each block of A into panels as tall as
+			/// it, so the micro-kernel reads both contiguously. Blocks of A
+			/// are multiplied in parallel for large products, and the
+			/// columns are split between the threads as well when there are
+			/// too few rows to go around
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="M"></param>
+			/// <param name="N"></param>
+			/// <param name="K"></param>
+			/// <param name="a"></param>
+			/// <param name="rowA"></param>
+			/// <param name="colA"></param>
+			/// <param name="b"></param>
+			/// <param name="rowB"></param>
+			/// <param name="colB"></param>
+			/// <param name="c"></param>
+			/// <param name="ldc"></param>
+			/// <param name="alpha"></param>
+			/// <param name="beta"></param>
+			template<typename t>
+			inline void gemm(uint64 M, uint64 N, uint64 K,
+							 const t *a, uint64 rowA, uint64 colA,
+							 const t *b, uint64 rowB, uint64 colB,
+							 t *c, uint64 ldc, t alpha = 1, t beta = 0)
+			{
+				imp::gemm(M, N, K, alpha, a, rowA, colA, b, rowB, colB, beta, c, ldc,
+						  tuning::parallel(tuning::Op::MATMUL, M * N * K));
+			}
+
+			/// <summary>
+			/// Calculate a batch of "batch" matrix products with the same
+			/// shapes, layouts and scaling, as described for gemm::gemm, where the
+			/// i'th product reads a[i] and b[i] and writes c[i]. Batches of
+			/// small products are split between the threads, with each
+			/// product calculated in serial. Larger products are calculated
+			/// one after the other, each using every thread
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="batch"></param>
+			/// <param name="M"></param>
+			/// <param name="N"></param>
+			/// <param name="K"></param>
+			/// <param name="a"></param>
+			/// <param name="rowA"></param>
+			/// <param name="colA"></param>
+			/// <param name="b"></param>
+			/// <param name="rowB"></param>
+			/// <param name="colB"></param>
+			/// <param name="c"></param>
+			/// <param name="ldc"></param>
+			/// <param name="alpha"></param>
+			/// <param name="beta"></param>
+			template<typename t>
+			inline void gemmBatched(uint64 batch, uint64 M, uint64 N, uint64 K,
+									const t *const *a, uint64 rowA, uint64 colA,
+									const t *const *b, uint64 rowB, uint64 colB,
+									t *const *c, uint64 ldc, t alpha = 1, t beta = 0)
+			{
+				const uint64 work = M * N * K;
+
+				if (tuning::parallel(tuning::Op::MATMUL, work) || !tuning::parallel(tuning::Op::MATMUL, work * batch))
+				{
+					for (uint64 i = 0; i < batch; i++)
+						gemm(M, N, K, a[i], rowA, colA, b[i], rowB, colB, c[i], ldc, alpha, beta);
+					return;
+				}
+
+				long index = 0;
+
+			#pragma omp parallel for shared(batch, M, N, K, alpha, a, rowA, colA, b, rowB, colB, beta, c, ldc) private(index) default(none)
+				for (index = 0; index < (long) batch; ++index)
+					imp::gemm(M, N, K, alpha, a[index], rowA, colA, b[index], rowB, colB, beta, c[index], ldc, false);
+			}
+
+			/// <summary>
+			/// Calculate the matrix vector product y = alpha * A * x + beta * y, where A has M
+			/// rows and N columns with any strides, x has N elements "incX"
+			/// apart and y has M contiguous elements. If "beta" is zero, y
+			/// is not read. y must not overlap A or x.
+			///
+			/// If the rows of A are contiguous, each element of y is a
+			/// vectorized dot product. If the columns are, as they are for
+			/// a transposed view, y is built up a strip at a time by adding
+			/// a multiple of each column. Rows or strips are calculated in
+			/// parallel for large matrices. The product reads every element
+			/// of A once, so it is treated as a reduction when deciding
+			/// whether to run in parallel
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="M"></param>
+			/// <param name="N"></param>
+			/// <param name="a"></param>
+			/// <param name="rowA"></param>
+			/// <param name="colA"></param>
+			/// <param name="x"></param>
+			/// <param name="incX"></param>
+			/// <param name="y"></param>
+			/// <param name="alpha"></param>
+			/// <param name="beta"></param>
+			template<typename t>
+			inline void gemv(uint64 M, uint64 N, const t *a, uint64 rowA, uint64 colA,
+							 const t *x, uint64 incX, t *y, t alpha = 1, t beta = 0)
+			{
+				if (M == 0)
+					return;
+
+				imp::gemv(M, N, a, rowA, colA, x, incX, y, alpha, beta,
+						  std::is_same<t, typename accumulator<t>::type>());
+			}
+		}
+	}
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include "../internal.h"
+#include "../rapid_math.h"
+
+#include <limits>
+
+namespace rapid
+{
+	namespace imp
+	{
+		inline uint32 floatBits(float32 value)
+		{
+			uint32 bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		inline float32 bitsFloat(uint32 bits)
+		{
+			float32 value;
+			memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+
+		/// <summary>
+		/// Convert a single precision value to the bits of the nearest
+		/// IEEE half precision value, rounding ties to even. Values too
+		/// large for half precision become infinity
+		/// </summary>
+		/// <param name="value"></param>
+		/// <returns></returns>
+		inline uint16_t floatToHalf(float32 value)
+		{
+			uint32 bits = floatBits(value);
+			const uint16_t sign = (uint16_t) ((bits >> 16) & 0x8000);
+			bits &= 0x7FFFFFFF;
+
+			// Infinity and NaN, keeping NaN quiet
+			if (bits >= 0x7F800000)
+				return sign | 0x7C00 | (bits > 0x7F800000 ? 0x200 | ((bits >> 13) & 0x3FF) : 0);
+
+			// Anything from halfway between the largest value and 2^16 up
+			if (bits >= 0x477FF000)
+				return sign | 0x7C00;
+
+			// Subnormal results are multiples of 2^-24
+			if (bits < 0x38800000)
+			{
+				const uint32 exponent = bits >> 23;
+				if (exponent < 102)
+					return sign;
+
+				const uint32 mantissa = (bits & 0x7FFFFF) | 0x800000;
+				const uint32 shift = 126 - exponent;
+				const uint32 rem = mantissa & ((1u << shift) - 1);
+				const uint32 halfway = 1u << (shift - 1);
+				uint32 res = mantissa >> shift;
+
+				if (rem > halfway || (rem == halfway && (res & 1)))
+					res++;
+
+				return sign | (uint16_t) res;
+			}
+
+			// Rebias the exponent. Rounding up may carry into the exponent,
+			// which gives the correct result
+			uint32 res = (bits - 0x38000000) >> 13;
+			const uint32 rem = bits & 0x1FFF;
+
+			if (rem > 0x1000 || (rem == 0x1000 && (res & 1)))
+				res++;
+
+			return sign | (uint16_t) res;
+		}
+
+		/// <summary>
+		/// Convert the bits of a half precision value to single precision.
+		/// Every half precision value can be represented exactly
+		/// </summary>
+		/// <param name="bits"></param>
+		/// <returns></returns>
+		inline float32 halfToFloat(uint16_t bits)
+		{
+			const uint32 sign = (uint32) (bits & 0x8000) << 16;
+			const uint32 exponent = (bits >> 10) & 0x1F;
+			const uint32 mantissa = bits & 0x3FF;
+
+			if (exponent == 0x1F)
+				return bitsFloat(sign | 0x7F800000 | (mantissa << 13));
+
+			if (exponent != 0)
+				return bitsFloat(sign | ((exponent + 112) << 23) | (mantissa << 13));
+
+			// Zero and subnormal values
+			const float32 res = (float32) mantissa * 5.9604644775390625e-8f;
+			return sign ? -res : res;
+		}
+
+		/// <summary>
+		/// Convert a single precision value to the bits of the nearest
+		/// bfloat16 value, rounding ties to even
+		/// </summary>
+		/// <param name="value"></param>
+		/// <returns></returns>
+		inline uint16_t floatToBfloat(float32 value)
+		{
+			const uint32 bits = floatBits(value);
+
+			if ((bits & 0x7FFFFFFF) > 0x7F800000)
+				return (uint16_t) ((bits >> 16) | 0x40);
+
+			return (uint16_t) ((bits + 0x7FFF + ((bits >> 16) & 1)) >> 16);
+		}
+
+		inline float32 bfloatToFloat(uint16_t bits)
+		{
+			return bitsFloat((uint32) bits << 16);
+		}
+	}
+
+	/// <summary>
+	/// An IEEE 754 half precision (binary16) value, with 11 bits of
+	/// precision and a range of about 6e-8 to 65504. Only the value is
+	/// stored, so an array of float16 takes half the memory of an array of
+	/// float32. Arithmetic is carried out in single precision, and the
+	/// result is rounded when it is stored
+	/// </summary>
+	struct float16
+	{
+		uint16_t bits;
+
+		float16() = default;
+
+		float16(float32 value) : bits(imp::floatToHalf(value))
+		{}
+
+		template<typename t, typename std::enable_if<std::is_arithmetic<t>::value, int>::type = 0>
+		float16(t value) : bits(imp::floatToHalf((float32) value))
+		{}
+
+		static inline float16 fromBits(uint16_t bits)
+		{
+			float16 res;
+			res.bits = bits;
+			return res;
+		}
+
+		inline operator float32() const
+		{
+			return imp::halfToFloat(bits);
+		}
+
+		inline float16 &operator+=(float32 other) { return *this = (float32) *this + other; }
+		inline float16 &operator-=(float32 other) { return *this = (float32) *this - other; }
+		inline float16 &operator*=(float32 other) { return *this = (float32) *this * other; }
+		inline float16 &operator/=(float32 other) { return *this = (float32) *this / other; }
+	};
+
+	/// <summary>
+	/// A bfloat16 value, which has the range of a float32 but only 8 bits
+	/// of precision, stored in the upper half of a float32. Arithmetic is
+	/// carried out in single precision, as for float16
+	/// </summary>
+	struct bfloat16
+	{
+		uint16_t bits;
+
+		bfloat16() = default;
+
+		bfloat16(float32 value) : bits(imp::floatToBfloat(value))
+		{}
+
+		template<typename t, typename std::enable_if<std::is_arithmetic<t>::value, int>::type = 0>
+		bfloat16(t value) : bits(imp::floatToBfloat((float32) value))
+		{}
+
+		static inline bfloat16 fromBits(uint16_t bits)
+		{
+			bfloat16 res;
+			res.bits = bits;
+			return res;
+		}
+
+		inline operator float32() const
+		{
+			return imp::bfloatToFloat(bits);
+		}
+
+		inline bfloat16 &operator+=(float32 other) { return *this = (float32) *this + other; }
+		inline bfloat16 &operator-=(float32 other) { return *this = (float32) *this - other; }
+		inline bfloat16 &operator*=(float32 other) { return *this = (float32) *this * other; }
+		inline bfloat16 &operator/=(float32 other) { return *this = (float32) *this / other; }
+	};
+
+	/// <summary>
+	/// Half precision types, which are stored in 16 bits but calculated
+	/// with in single precision
+	/// </summary>
+	/// <typeparam name="t"></typeparam>
+	template<typename t>
+	struct isHalf : std::false_type
+	{};
+
+	template<> struct isHalf<float16> : std::true_type {};
+	template<> struct isHalf<bfloat16> : std::true_type {};
+
+	/// <summary>
+	/// The type that values of type "t" are calculated and accumulated
+	/// in. Expressions, reductions and matrix products on half precision
+	/// arrays work in single precision, and only round when storing the
+	/// result
+	/// </summary>
+	/// <typeparam name="t"></typeparam>
+	template<typename t>
+	struct accumulator
+	{
+		using type = t;
+	};
+
+	template<> struct accumulator<float16> { using type = float32; };
+	template<> struct accumulator<bfloat16> { using type = float32; };
+
+	inline std::ostream &operator<<(std::ostream &os, const float16 &val)
+	{
+		return os << (float32) val;
+	}
+
+	inline std::ostream &operator<<(std::ostream &os, const bfloat16 &val)
+	{
+		return os << (float32) val;
+	}
+
+	namespace math
+	{
+		template<typename type, typename std::enable_if<isHalf<type>::value, int>::type = 0>
+		inline type random(const type &min, const type &max)
+		{
+			return (type) random((float32) min, (float32) max);
+		}
+	}
+}
+
+namespace std
+{
+	template<>
+	class numeric_limits<rapid::float16>
+	{
+	public:
+		static constexpr bool is_specialized = true;
+		static constexpr bool is_signed = true;
+		static constexpr bool is_integer = false;
+		static constexpr bool is_exact = false;
+		static constexpr bool has_infinity = true;
+		static constexpr bool has_quiet_NaN = true;
+		static constexpr int digits = 11;
+		static constexpr int digits10 = 3;
+		static constexpr int max_digits10 = 5;
+		static constexpr int radix = 2;
+
+		static inline rapid::float16 min() { return rapid::float16::fromBits(0x0400); }
+		static inline rapid::float16 max() { return rapid::float16::fromBits(0x7BFF); }
+		static inline rapid::float16 lowest() { return rapid::float16::fromBits(0xFBFF); }
+		static inline rapid::float16 epsilon() { return rapid::float16::fromBits(0x1400); }
+		static inline rapid::float16 infinity() { return rapid::float16::fromBits(0x7C00); }
+		static inline rapid::float16 quiet_NaN() { return rapid::float16::fromBits(0x7E00); }
+		static inline rapid::float16 denorm_min() { return rapid::float16::fromBits(0x0001); }
+	};
+
+	template<>
+	class numeric_limits<rapid::bfloat16>
+	{
+	public:
+		static constexpr bool is_specialized = true;
+		static constexpr bool is_signed = true;
+		static constexpr bool is_integer = false;
+		static constexpr bool is_exact = false;
+		static constexpr bool has_infinity = true;
+		static constexpr bool has_quiet_NaN = true;
+		static constexpr int digits = 8;
+		static constexpr int digits10 = 2;
+		static constexpr int max_digits10 = 4;
+		static constexpr int radix = 2;
+
+		static inline rapid::bfloat16 min() { return rapid::bfloat16::fromBits(0x0080); }
+		static inline rapid::bfloat16 max() { return rapid::bfloat16::fromBits(0x7F7F); }
+		static inline rapid::bfloat16 lowest() { return rapid::bfloat16::fromBits(0xFF7F); }
+		static inline rapid::bfloat16 epsilon() { return rapid::bfloat16::fromBits(0x3C00); }
+		static inline rapid::bfloat16 infinity() { return rapid::bfloat16::fromBits(0x7F80); }
+		static inline rapid::bfloat16 quiet_NaN() { return rapid::bfloat16::fromBits(0x7FC0); }
+		static inline rapid::bfloat16 denorm_min() { return rapid::bfloat16::fromBits(0x0001); }
+	};
+}
@@ -0,0 +1,479 @@
+#pragma once
+
+#include "../internal.h"
+#include "../tuning.h"
+
+#include "arrayCore.h"
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		namespace indexing
+		{
+			/// <summary>
+			/// The number of elements gathered, or masked elements counted,
+			/// by a single thread at a time
+			/// </summary>
+			constexpr uint64 blockSize = 4096;
+
+			/// <summary>
+			/// The number of rows ahead of the current row that a gather
+			/// starts loading. Rows are read in the order of the indices,
+			/// which the processor cannot predict
+			/// </summary>
+			constexpr uint64 prefetchDistance = 8;
+
+			namespace imp
+			{
+				template<typename I>
+				inline int64 normalizeIndex(I index, uint64 len, std::true_type)
+				{
+					return index < 0 ? (int64) index + (int64) len : (int64) index;
+				}
+
+				template<typename I>
+				inline int64 normalizeIndex(I index, uint64 len, std::false_type)
+				{
+					return (int64) index;
+				}
+
+				/// <summary>
+				/// Return the indices in row-major order as offsets along an
+				/// axis of length "len". Negative indices count back from the
+				/// end of the axis, as in NumPy. An error is raised if any
+				/// index is out of range
+				/// </summary>
+				template<typename I>
+				inline std::vector<int64> normalize(const Array<I> &indices, uint64 len)
+				{
+					static_assert(std::is_integral<I>::value, "Indices must have an integer type");
+
+					const auto src = indices.packed();
+					const long count = (long) math::prod(src.shape);
+					const I *data = src.dataStart;
+
+					std::vector<int64> res(count);
+					int64 *dst = res.data();
+					bool valid = true;
+
+					if (!tuning::parallel(tuning::Op::ARITHMETIC, count))
+					{
+						for (long i = 0; i < count; i++)
+						{
+							dst[i] = normalizeIndex(data[i], len, std::is_signed<I>());
+							valid &= dst[i] >= 0 && dst[i] < (int64) len;
+						}
+					}
+					else
+					{
+						long i = 0;
+
+					#pragma omp parallel for shared(count, data, dst, len) private(i) reduction(&&:valid) default(none)
+						for (i = 0; i < count; ++i)
+						{
+							dst[i] = normalizeIndex(data[i], len, std::is_signed<I>());
+							valid = valid && dst[i] >= 0 && dst[i] < (int64) len;
+						}
+					}
+
+					if (!valid)
+						message::RapidError("Index Error", "Index out of range for axis of length " + std::to_string(len)).display();
+
+					return res;
+				}
+
+				/// <summary>
+				/// The shape of the result of taking "indices" along "axis"
+				/// of an array with shape "shape"
+				/// </summary>
+				template<typename I>
+				inline std::vector<uint64> takeShape(const std::vector<uint64> &shape, const Array<I> &indices, uint64 axis)
+				{
+					std::vector<uint64> res(shape.begin(), shape.begin() + axis);
+					if (!indices.isZeroDim)
+						res.insert(res.end(), indices.shape.begin(), indices.shape.end());
+					res.insert(res.end(), shape.begin() + axis + 1, shape.end());
+					return res;
+				}
+
+				template<typename t>
+				inline void atomicAdd(t *dst, t val, std::true_type)
+				{
+				#pragma omp atomic
+					*dst += val;
+				}
+
+				template<typename t>
+				inline void atomicAdd(t *dst, t val, std::false_type)
+				{
+				#pragma omp critical(rapidAtomicAdd)
+					*dst += val;
+				}
+			}
+		}
+
+		/// <summary>
+		/// Select the elements at the given indices along an axis. The
+		/// result has the shape of the array with "axis" replaced by the
+		/// shape of "indices", so taking a batch of indices from an
+		/// embedding table of shape (vocab, dim) along axis 0 gives shape
+		/// (batch, dim). If no axis is given, the array is flattened first.
+		/// Negative indices count back from the end of the axis.
+		///
+		/// Whole rows are copied at a time, and the rows for upcoming indices
+		/// are prefetched. Single elements are loaded with SIMD gather
+		/// instructions where possible. Large gathers are split between
+		/// threads
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <typeparam name="I"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="indices"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t, typename I>
+		inline Array<t> take(const Array<t> &arr, const Array<I> &indices, uint64 axis = (uint64) -1)
+		{
+			if (axis == (uint64) -1)
+				return take(arr.packed().reshaped({math::prod(arr.shape)}), indices, 0);
+
+			rapidAssert(axis < arr.shape.size(), "Axis out of range for array take");
+
+			const auto src = arr.packed();
+			const uint64 len = arr.shape[axis];
+			const auto index = indexing::imp::normalize(indices, len);
+
+			const uint64 outer = math::prod(std::vector<uint64>(arr.shape.begin(), arr.shape.begin() + axis));
+			const uint64 inner = math::prod(std::vector<uint64>(arr.shape.begin() + axis + 1, arr.shape.end()));
+			const uint64 count = index.size();
+
+			Array<t> res(indexing::imp::takeShape(arr.shape, indices, axis));
+
+			const t *srcData = src.dataStart;
+			const int64 *indexData = index.data();
+			t *dstData = res.dataStart;
+			const bool parallel = tuning::parallel(tuning::Op::COPY, outer * count * inner);
+
+			if (inner == 1)
+			{
+				// Each index selects a single element, so the elements are
+				// gathered in blocks
+				const uint64 blocks = (count + indexing::blockSize - 1) / indexing::blockSize;
+				const long tasks = (long) (outer * blocks);
+
+				auto gatherBlock = [&](uint64 task)
+				{
+					const uint64 row = task / blocks;
+					const uint64 start = (task % blocks) * indexing::blockSize;
+					simd::gather(srcData + row * len, indexData + start, dstData + row * count + start,
+								 math::min(indexing::blockSize, count - start));
+				};
+
+				if (!parallel)
+				{
+					for (long task = 0; task < tasks; task++)
+						gatherBlock(task);
+				}
+				else
+				{
+					long task = 0;
+
+				#pragma omp parallel for shared(tasks, gatherBlock) private(task) default(none)
+					for (task = 0; task < tasks; ++task)
+						gatherBlock(task);
+				}
+
+				return res;
+			}
+
+			const long rows = (long) (outer * count);
+
+			auto copyRow = [&](uint64 row)
+			{
+				const uint64 o = row / count, k = row % count;
+
+				// Start loading a row that will be copied soon. Later parts of
+				// each row are found by the hardware prefetcher
+				if (k + indexing::prefetchDistance < count)
+					simd::prefetch(srcData + (o * len + indexData[k + indexing::prefetchDistance]) * inner);
+
+				const t *rowSrc = srcData + (o * len + indexData[k]) * inner;
+				std::copy(rowSrc, rowSrc + inner, dstData + row * inner);
+			};
+
+			if (!parallel)
+			{
+				for (long row = 0; row < rows; row++)
+					copyRow(row);
+			}
+			else
+			{
+				long row = 0;
+
+			#pragma omp parallel for shared(rows, copyRow) private(row) default(none)
+				for (row = 0; row < rows; ++row)
+					copyRow(row);
+			}
+
+			return res;
+		}
+
+		/// <summary>
+		/// Set the elements of an array at the given indices, which index
+		/// the flattened array, to the corresponding elements of "values".
+		/// "values" must have one element for every index, or a single
+		/// element, which is used for every index. If an index appears more
+		/// than once, any one of the values given for it may be stored
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <typeparam name="I"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="indices"></param>
+		/// <param name="values"></param>
+		template<typename t, typename I>
+		inline void put(const Array<t> &arr, const Array<I> &indices, const Array<t> &values)
+		{
+			rapidAssert(arr.isWritable(), "Cannot put values into a read-only array");
+
+			const auto index = indexing::imp::normalize(indices, math::prod(arr.shape));
+			const auto src = values.packed();
+			const uint64 valueCount = math::prod(values.shape);
+
+			if (valueCount != 1 && valueCount != index.size())
+				message::RapidError("Put Error", "Cannot put " + std::to_string(valueCount) + " values at " +
+									std::to_string(index.size()) + " indices").display();
+
+			// Strided arrays are updated through a contiguous copy
+			auto dst = arr.packed();
+
+			const long count = (long) index.size();
+			const int64 *indexData = index.data();
+			const t *srcData = src.dataStart;
+			t *dstData = dst.dataStart;
+			const uint64 step = valueCount == 1 ? 0 : 1;
+
+			if (!tuning::parallel(tuning::Op::COPY, count))
+			{
+				for (long i = 0; i < count; i++)
+					dstData[indexData[i]] = srcData[i * step];
+			}
+			else
+			{
+				long i = 0;
+
+			#pragma omp parallel for shared(count, indexData, srcData, dstData, step) private(i) default(none)
+				for (i = 0; i < count; ++i)
+					dstData[indexData[i]] = srcData[i * step];
+			}
+
+			if (dst.dataStart != arr.dataStart)
+				transpose::copy(dst.dataStart, dst.strides(), arr.dataStart, arr.strides(), arr.shape);
+		}
+
+		/// <summary>
+		/// Return a one dimensional array of the elements of "arr" where
+		/// "mask" is non-zero, in row-major order, which is arr[mask] in
+		/// NumPy. The mask must have the same number of elements as the
+		/// array, and may be an array of any type, such as the result of
+		/// less or greater. If no elements are selected, an uninitialized
+		/// array is returned.
+		///
+		/// The selected elements of each block are counted in parallel,
+		/// and then copied in parallel to their offsets in the result
+		/// </summary>
+		/// <typeparam name="M"></typeparam>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="mask"></param>
+		/// <param name="arr"></param>
+		/// <returns></returns>
+		template<typename M, typename t>
+		inline Array<t> extract(const Array<M> &mask, const Array<t> &arr)
+		{
+			rapidAssert(math::prod(mask.shape) == math::prod(arr.shape), "Mask must have one element for every element of the array");
+
+			const auto maskSrc = mask.packed();
+			const auto src = arr.packed();
+
+			const uint64 size = math::prod(arr.shape);
+			const long blocks = (long) ((size + indexing::blockSize - 1) / indexing::blockSize);
+			const bool parallel = tuning::parallel(tuning::Op::COPY, size);
+
+			const M *maskData = maskSrc.dataStart;
+			const t *srcData = src.dataStart;
+			std::vector<uint64> offsets(blocks + 1, 0);
+			uint64 *offsetData = offsets.data();
+
+			auto countBlock = [&](uint64 block)
+			{
+				const uint64 end = math::min(size, (block + 1) * indexing::blockSize);
+				uint64 res = 0;
+				for (uint64 i = block * indexing::blockSize; i < end; i++)
+					res += (bool) maskData[i];
+				offsetData[block + 1] = res;
+			};
+
+			if (!parallel)
+			{
+				for (long block = 0; block < blocks; block++)
+					countBlock(block);
+			}
+			else
+			{
+				long block = 0;
+
+			#pragma omp parallel for shared(blocks, countBlock) private(block) default(none)
+				for (block = 0; block < blocks; ++block)
+					countBlock(block);
+			}
+
+			for (long block = 0; block < blocks; block++)
+				offsets[block + 1] += offsets[block];
+
+			if (offsets[blocks] == 0)
+				return Array<t>();
+
+			Array<t> res({offsets[blocks]});
+			t *dstData = res.dataStart;
+
+			auto copyBlock = [&](uint64 block)
+			{
+				const uint64 end = math::min(size, (block + 1) * indexing::blockSize);
+				t *dst = dstData + offsetData[block];
+				for (uint64 i = block * indexing::blockSize; i < end; i++)
+				{
+					if ((bool) maskData[i])
+						*dst++ = srcData[i];
+				}
+			};
+
+			if (!parallel)
+			{
+				for (long block = 0; block < blocks; block++)
+					copyBlock(block);
+			}
+			else
+			{
+				long block = 0;
+
+			#pragma omp parallel for shared(blocks, copyBlock) private(block) default(none)
+				for (block = 0; block < blocks; ++block)
+					copyBlock(block);
+			}
+
+			return res;
+		}
+
+		/// <summary>
+		/// Add "values" into "out" at the given indices along an axis, so
+		/// that indices which appear more than once accumulate every value
+		/// given for them, as numpy.add.at does. "values" has the shape of
+		/// the result of take(out, indices, axis). This is the reverse of
+		/// take, used, for example, to accumulate the gradients of an
+		/// embedding table.
+		///
+		/// Large scatters are split between threads. If "out" is small
+		/// compared to the number of values, each thread accumulates into
+		/// its own copy of it, and the copies are summed in a fixed order.
+		/// Otherwise, the values are added with atomic operations
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <typeparam name="I"></typeparam>
+		/// <param name="out"></param>
+		/// <param name="indices"></param>
+		/// <param name="values"></param>
+		/// <param name="axis"></param>
+		template<typename t, typename I>
+		inline void scatterAdd(const Array<t> &out, const Array<I> &indices, const Array<t> &values, uint64 axis = 0)
+		{
+			rapidAssert(out.isWritable(), "Cannot scatter values into a read-only array");
+			rapidAssert(axis < out.shape.size(), "Axis out of range for array scatter");
+
+			const auto expected = indexing::imp::takeShape(out.shape, indices, axis);
+			if (math::prod(values.shape) != math::prod(expected))
+				message::RapidError("Scatter Error", "Values with shape (" + expr::shapeToString(values.shape) +
+									") cannot be scattered with indices of shape (" +
+									expr::shapeToString(indices.shape) + ") into shape (" +
+									expr::shapeToString(out.shape) + ")").display();
+
+			const uint64 len = out.shape[axis];
+			const auto index = indexing::imp::normalize(indices, len);
+			const auto src = values.packed();
+
+			// Strided arrays are updated through a contiguous copy
+			auto dst = out.packed();
+
+			const uint64 outer = math::prod(std::vector<uint64>(out.shape.begin(), out.shape.begin() + axis));
+			const uint64 inner = math::prod(std::vector<uint64>(out.shape.begin() + axis + 1, out.shape.end()));
+			const uint64 count = index.size();
+			const long rows = (long) (outer * count);
+
+			const int64 *indexData = index.data();
+			const t *srcData = src.dataStart;
+
+			auto addRow = [&](uint64 row, t *target)
+			{
+				const uint64 o = row / count, k = row % count;
+				simd::axpy((t) 1, srcData + row * inner, target + (o * len + indexData[k]) * inner, inner);
+			};
+
+		#ifdef _OPENMP
+			const long threads = omp_get_max_threads();
+			const uint64 size = math::prod(out.shape);
+		#else
+			const long threads = 1;
+		#endif
+
+			if (threads < 2 || !tuning::parallel(tuning::Op::ARITHMETIC, rows * inner))
+			{
+				for (long row = 0; row < rows; row++)
+					addRow(row, dst.dataStart);
+			}
+		#ifdef _OPENMP
+			else if (size * (uint64) threads <= rows * inner)
+			{
+				std::vector<t> buffers(size * threads, (t) 0);
+				t *bufferData = buffers.data();
+				t *dstData = dst.dataStart;
+
+			#pragma omp parallel shared(rows, addRow, bufferData, size) default(none)
+				{
+					t *own = bufferData + size * (uint64) omp_get_thread_num();
+
+				#pragma omp for schedule(static)
+					for (long row = 0; row < rows; ++row)
+						addRow(row, own);
+				}
+
+				long i = 0;
+
+			#pragma omp parallel for shared(size, threads, bufferData, dstData) private(i) default(none)
+				for (i = 0; i < (long) size; ++i)
+				{
+					for (long thread = 0; thread < threads; thread++)
+						dstData[i] += bufferData[thread * size + i];
+				}
+			}
+		#endif
+			else
+			{
+				t *dstData = dst.dataStart;
+				long row = 0;
+
+			#pragma omp parallel for shared(rows, count, inner, len, indexData, srcData, dstData) private(row) default(none)
+				for (row = 0; row < rows; ++row)
+				{
+					const uint64 o = row / count, k = row % count;
+					const t *rowSrc = srcData + row * inner;
+					t *rowDst = dstData + (o * len + indexData[k]) * inner;
+
+					for (uint64 j = 0; j < inner; j++)
+						indexing::imp::atomicAdd(rowDst + j, rowSrc[j], std::is_arithmetic<t>());
+				}
+			}
+
+			if (dst.dataStart != out.dataStart)
+				transpose::copy(dst.dataStart, dst.strides(), out.dataStart, out.strides(), out.shape);
+		}
+	}
+}
@@ -0,0 +1,309 @@
+#pragma once
+
+#include "../internal.h"
+
+#include "arrayCore.h"
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		namespace join
+		{
+			namespace imp
+			{
+				/// <summary>
+				/// The shape of an array, which is empty for a zero
+				/// dimensional array
+				/// </summary>
+				template<typename t>
+				inline std::vector<uint64> dims(const Array<t> &arr)
+				{
+					return arr.isZeroDim ? std::vector<uint64>() : arr.shape;
+				}
+
+				/// <summary>
+				/// Copy every element of "src" into the array of shape
+				/// "src.shape" that starts at "dst" with strides "dstStrides".
+				/// Runs that are contiguous in both are copied as blocks, and
+				/// large copies are split between threads, see transpose.h
+				/// </summary>
+				template<typename t>
+				inline void copyInto(const Array<t> &src, t *dst, const std::vector<uint64> &dstStrides)
+				{
+					transpose::copy(src.dataStart, src.strides(), dst, dstStrides, src.shape);
+				}
+			}
+		}
+
+		/// <summary>
+		/// Join a sequence of arrays along an existing axis. Every array
+		/// must have the same number of dimensions and the same shape,
+		/// except along "axis". The result is allocated once, and each
+		/// array is copied into its place in large contiguous runs
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arrays"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> concatenate(const std::vector<Array<t>> &arrays, uint64 axis = 0)
+		{
+			rapidAssert(!arrays.empty(), "Cannot concatenate an empty sequence of arrays");
+
+			auto resShape = arrays[0].shape;
+			rapidAssert(axis < resShape.size(), "Axis out of range for array concatenation");
+
+			resShape[axis] = 0;
+			for (const auto &arr : arrays)
+			{
+				auto check = arr.shape;
+				if (check.size() == resShape.size())
+					check[axis] = 0;
+
+				if (check != resShape)
+					message::RapidError("Concatenate Error", "Cannot concatenate arrays with shapes (" +
+										expr::shapeToString(arrays[0].shape) + ") and (" +
+										expr::shapeToString(arr.shape) + ") along axis " + std::to_string(axis)).display();
+			}
+
+			for (const auto &arr : arrays)
+				resShape[axis] += arr.shape[axis];
+
+			Array<t> res(resShape);
+			const auto resStrides = utils::contiguousStride(resShape);
+
+			uint64 offset = 0;
+			for (const auto &arr : arrays)
+			{
+				join::imp::copyInto(arr, res.dataStart + offset * resStrides[axis], resStrides);
+				offset += arr.shape[axis];
+			}
+
+			return res;
+		}
+
+		template<typename t>
+		inline Array<t> concatenate(const std::initializer_list<Array<t>> &arrays, uint64 axis = 0)
+		{
+			return concatenate(std::vector<Array<t>>(arrays), axis);
+		}
+
+		/// <summary>
+		/// Join a sequence of arrays with the same shape along a new axis,
+		/// which is inserted at position "axis" of the result. Stacking N
+		/// samples of shape (a, b) along axis 0 gives a batch of shape
+		/// (N, a, b)
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arrays"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> stack(const std::vector<Array<t>> &arrays, uint64 axis = 0)
+		{
+			rapidAssert(!arrays.empty(), "Cannot stack an empty sequence of arrays");
+
+			const auto dims = join::imp::dims(arrays[0]);
+			rapidAssert(axis <= dims.size(), "Axis out of range for array stack");
+
+			for (const auto &arr : arrays)
+			{
+				if (join::imp::dims(arr) != dims)
+					message::RapidError("Stack Error", "Cannot stack arrays with shapes (" +
+										expr::shapeToString(arrays[0].shape) + ") and (" +
+										expr::shapeToString(arr.shape) + ")").display();
+			}
+
+			auto resShape = dims;
+			resShape.insert(resShape.begin() + axis, arrays.size());
+
+			Array<t> res(resShape);
+			auto dstStrides = utils::contiguousStride(resShape);
+			const uint64 step = dstStrides[axis];
+			dstStrides.erase(dstStrides.begin() + axis);
+
+			// Zero dimensional arrays are stored with shape (1), which
+			// has one stride
+			if (dims.empty())
+				dstStrides = {1};
+
+			for (uint64 i = 0; i < arrays.size(); i++)
+				join::imp::copyInto(arrays[i], res.dataStart + i * step, dstStrides);
+
+			return res;
+		}
+
+		template<typename t>
+		inline Array<t> stack(const std::initializer_list<Array<t>> &arrays, uint64 axis = 0)
+		{
+			return stack(std::vector<Array<t>>(arrays), axis);
+		}
+
+		/// <summary>
+		/// Split an array into views at the given positions along an axis.
+		/// Splitting at {2, 5} gives the views [:2], [2:5] and [5:]. The
+		/// positions must be increasing, and each view must contain at
+		/// least one element. The views are linked to the array, so no
+		/// data is copied
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="indices"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline std::vector<Array<t>> split(const Array<t> &arr, const std::vector<uint64> &indices, uint64 axis = 0)
+		{
+			rapidAssert(axis < arr.shape.size(), "Axis out of range for array split");
+
+			std::vector<Array<t>> res;
+			res.reserve(indices.size() + 1);
+
+			uint64 start = 0;
+			for (uint64 i = 0; i <= indices.size(); i++)
+			{
+				const uint64 stop = i < indices.size() ? indices[i] : arr.shape[axis];
+				rapidAssert(start < stop && stop <= arr.shape[axis], "Invalid positions for array split");
+
+				res.emplace_back(arr.slice(start, stop, 1, axis));
+				start = stop;
+			}
+
+			return res;
+		}
+
+		/// <summary>
+		/// Split an array into "sections" views along an axis, which need
+		/// not divide the length of the axis. As in NumPy, the first
+		/// (length % sections) views have one more element than the rest.
+		/// The views are linked to the array, so no data is copied
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="sections"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline std::vector<Array<t>> arraySplit(const Array<t> &arr, uint64 sections, uint64 axis = 0)
+		{
+			rapidAssert(axis < arr.shape.size(), "Axis out of range for array split");
+			rapidAssert(sections > 0 && sections <= arr.shape[axis], "Invalid number of sections for array split");
+
+			const uint64 len = arr.shape[axis];
+			std::vector<uint64> indices;
+			indices.reserve(sections - 1);
+
+			uint64 pos = 0;
+			for (uint64 i = 0; i + 1 < sections; i++)
+			{
+				pos += len / sections + (i < len % sections ? 1 : 0);
+				indices.push_back(pos);
+			}
+
+			return split(arr, indices, axis);
+		}
+
+		/// <summary>
+		/// Split an array into "sections" views of equal length along an
+		/// axis, which must divide the length of the axis. The views are
+		/// linked to the array, so no data is copied
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="sections"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline std::vector<Array<t>> split(const Array<t> &arr, uint64 sections, uint64 axis = 0)
+		{
+			rapidAssert(axis < arr.shape.size(), "Axis out of range for array split");
+
+			if (sections == 0 || arr.shape[axis] % sections != 0)
+				message::RapidError("Split Error", "Array with shape (" + expr::shapeToString(arr.shape) +
+									") cannot be split into " + std::to_string(sections) +
+									" equal sections along axis " + std::to_string(axis)).display();
+
+			return arraySplit(arr, sections, axis);
+		}
+
+		/// <summary>
+		/// Repeat each element of an array "repeats" times along an axis.
+		/// If no axis is given, the array is flattened first, as in NumPy.
+		/// The result is filled with a single strided copy, which reads
+		/// each element once for every repeat without any intermediate
+		/// arrays
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="repeats"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> repeat(const Array<t> &arr, uint64 repeats, uint64 axis = (uint64) -1)
+		{
+			rapidAssert(repeats > 0, "Number of repeats must be greater than zero");
+
+			if (axis == (uint64) -1)
+				return repeat(arr.reshaped({math::prod(arr.shape)}), repeats, 0);
+
+			rapidAssert(axis < arr.shape.size(), "Axis out of range for array repeat");
+
+			// The source is read as if it had an extra dimension of length
+			// "repeats" after "axis", which does not step through memory
+			auto srcShape = arr.shape;
+			auto srcStrides = arr.strides();
+			srcShape.insert(srcShape.begin() + axis + 1, repeats);
+			srcStrides.insert(srcStrides.begin() + axis + 1, 0);
+
+			auto resShape = arr.shape;
+			resShape[axis] *= repeats;
+
+			Array<t> res(resShape);
+			transpose::copy(arr.dataStart, srcStrides, res.dataStart, utils::contiguousStride(srcShape), srcShape);
+			return res;
+		}
+
+		/// <summary>
+		/// Construct an array by repeating "arr" the number of times given
+		/// by "reps" along each axis. If "reps" has more dimensions than
+		/// the array, dimensions of length one are added to the front of
+		/// the array's shape, and if it has fewer, ones are added to the
+		/// front of "reps", as in NumPy
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="reps"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> tile(const Array<t> &arr, const std::vector<uint64> &reps)
+		{
+			const uint64 dims = math::max(arr.shape.size(), reps.size());
+			const uint64 shapeLead = dims - arr.shape.size();
+			const uint64 repsLead = dims - reps.size();
+
+			const auto arrStrides = arr.strides();
+
+			// The source is read as if every dimension were preceded by a
+			// dimension of length reps[i] that does not step through memory
+			std::vector<uint64> srcShape, srcStrides, resShape;
+			for (uint64 i = 0; i < dims; i++)
+			{
+				const uint64 len = i < shapeLead ? 1 : arr.shape[i - shapeLead];
+				const uint64 rep = i < repsLead ? 1 : reps[i - repsLead];
+				rapidAssert(rep > 0, "Number of repeats must be greater than zero");
+
+				srcShape.push_back(rep);
+				srcShape.push_back(len);
+				srcStrides.push_back(0);
+				srcStrides.push_back(i < shapeLead ? 0 : arrStrides[i - shapeLead]);
+				resShape.push_back(rep * len);
+			}
+
+			Array<t> res(resShape);
+			transpose::copy(arr.dataStart, srcStrides, res.dataStart, utils::contiguousStride(srcShape), srcShape);
+			res.isZeroDim = arr.isZeroDim && math::prod(resShape) == 1;
+			return res;
+		}
+	}
+}
@@ -0,0 +1,697 @@
+#pragma once
+
+#include "../internal.h"
+
+#include "arrayCore.h"
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		namespace npy
+		{
+			namespace imp
+			{
+				/// <summary>
+				/// The NumPy type description of each element type, as written
+				/// in the header of a .npy file. Only little endian processors
+				/// are supported, so multi-byte types are written as little
+				/// endian
+				/// </summary>
+				template<typename t>
+				struct Descr
+				{
+					static inline const char *name() { return nullptr; }
+				};
+
+				template<> struct Descr<bool> { static inline const char *name() { return "|b1"; } };
+				template<> struct Descr<int8_t> { static inline const char *name() { return "|i1"; } };
+				template<> struct Descr<uint8_t> { static inline const char *name() { return "|u1"; } };
+				template<> struct Descr<int16_t> { static inline const char *name() { return "<i2"; } };
+				template<> struct Descr<uint16_t> { static inline const char *name() { return "<u2"; } };
+				template<> struct Descr<int32_t> { static inline const char *name() { return "<i4"; } };
+				template<> struct Descr<uint32_t> { static inline const char *name() { return "<u4"; } };
+				template<> struct Descr<int64> { static inline const char *name() { return "<i8"; } };
+				template<> struct Descr<uint64> { static inline const char *name() { return "<u8"; } };
+				template<> struct Descr<float16> { static inline const char *name() { return "<f2"; } };
+				template<> struct Descr<float32> { static inline const char *name() { return "<f4"; } };
+				template<> struct Descr<float64> { static inline const char *name() { return "<f8"; } };
+
+				// "long" is a distinct type from int32 or int64 on some platforms
+				template<> struct Descr<long> { static inline const char *name() { return sizeof(long) == 8 ? "<i8" : "<i4"; } };
+				template<> struct Descr<unsigned long> { static inline const char *name() { return sizeof(long) == 8 ? "<u8" : "<u4"; } };
+
+				/// <summary>
+				/// The contents of the header of a .npy file. "dataOffset" is
+				/// the number of bytes from the start of the file to the data
+				/// </summary>
+				struct Header
+				{
+					std::string descr;
+					bool fortranOrder = false;
+					std::vector<uint64> shape;
+					uint64 dataOffset = 0;
+				};
+
+				/// <summary>
+				/// Build the header of a .npy file holding values with the
+				/// given type and shape. Version 1.0 is used unless the header
+				/// is too long for it. The header is padded so that the data
+				/// starts on a multiple of 64 bytes
+				/// </summary>
+				inline std::string makeHeader(const std::string &descr, const std::vector<uint64> &shape, bool isZeroDim)
+				{
+					std::string dims;
+					if (!isZeroDim)
+					{
+						for (uint64 i = 0; i < shape.size(); i++)
+							dims += (i > 0 ? ", " : "") + std::to_string(shape[i]);
+						if (shape.size() == 1)
+							dims += ",";
+					}
+
+					std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (" + dims + "), }";
+
+					const bool large = dict.size() + 11 > 65535;
+					const uint64 prefix = large ? 12 : 10;
+					const uint64 total = ((prefix + dict.size() + 1 + 63) / 64) * 64;
+					dict.append(total - prefix - dict.size() - 1, ' ');
+					dict += '\n';
+
+					std::string res("\x93NUMPY", 6);
+					res += (char) (large ? 2 : 1);
+					res += (char) 0;
+
+					const uint64 len = dict.size();
+					for (uint64 i = 0; i < (large ? 4u : 2u); i++)
+						res += (char) ((len >> (8 * i)) & 0xFF);
+
+					return res + dict;
+				}
+
+				/// <summary>
+				/// Find the value of "key" in the dictionary of a .npy header
+				/// </summary>
+				inline std::string dictValue(const std::string &dict, const std::string &key)
+				{
+					const auto pos = dict.find("'" + key + "'");
+					if (pos == std::string::npos)
+						return "";
+
+					auto start = dict.find(':', pos);
+					if (start == std::string::npos)
+						return "";
+					start = dict.find_first_not_of(' ', start + 1);
+
+					if (dict[start] == '(')
+						return dict.substr(start + 1, dict.find(')', start) - start - 1);
+					if (dict[start] == '\'')
+						return dict.substr(start + 1, dict.find('\'', start + 1) - start - 1);
+					return dict.substr(start, dict.find_first_of(",}", start) - start);
+				}
+
+				/// <summary>
+				/// Read the header of a .npy file starting at the current
+				/// position of "file", which is "base" bytes into the file
+				/// </summary>
+				inline bool readHeader(std::istream &file, uint64 base, Header &header, std::string &error)
+				{
+					char prefix[8];
+					if (!file.read(prefix, 8) || std::string(prefix, 6) != std::string("\x93NUMPY", 6))
+					{
+						error = "Not a .npy file";
+						return false;
+					}
+
+					const int version = (unsigned char) prefix[6];
+					const uint64 lenBytes = version == 1 ? 2 : 4;
+					unsigned char lenData[4] = {0, 0, 0, 0};
+					if (version < 1 || version > 3 || !file.read((char *) lenData, lenBytes))
+					{
+						error = "Unsupported .npy version";
+						return false;
+					}
+
+					const uint64 len = lenData[0] | (lenData[1] << 8) | ((uint64) lenData[2] << 16) | ((uint64) lenData[3] << 24);
+					std::string dict(len, ' ');
+					if (!file.read(&dict[0], len))
+					{
+						error = "Truncated .npy header";
+						return false;
+					}
+
+					header.descr = dictValue(dict, "descr");
+					header.fortranOrder = dictValue(dict, "fortran_order") == "True";
+					header.shape.clear();
+					header.dataOffset = base + 8 + lenBytes + len;
+
+					std::stringstream dims(dictValue(dict, "shape"));
+					std::string dim;
+					while (std::getline(dims, dim, ','))
+					{
+						if (dim.find_first_of("0123456789") != std::string::npos)
+							header.shape.push_back(std::stoull(dim));
+					}
+
+					if (header.descr.size() < 3)
+					{
+						error = "Invalid .npy header";
+						return false;
+					}
+
+					return true;
+				}
+
+				/// <summary>
+				/// The number of bytes in each value of a NumPy type
+				/// </summary>
+				inline uint64 itemSize(const std::string &descr)
+				{
+					return std::stoull(descr.substr(2));
+				}
+
+				template<typename s, typename t>
+				inline void castValues(const char *raw, t *dst, uint64 len)
+				{
+					for (uint64 i = 0; i < len; i++)
+					{
+						s val;
+						memcpy(&val, raw + i * sizeof(s), sizeof(s));
+						dst[i] = (t) val;
+					}
+				}
+
+				/// <summary>
+				/// Convert "len" values of the NumPy type "descr" into values of
+				/// type "t". Big endian values are swapped first
+				/// </summary>
+				template<typename t>
+				inline bool convert(const std::string &descr, char *raw, t *dst, uint64 len)
+				{
+					const char kind = descr[1];
+					const uint64 size = itemSize(descr);
+
+					if (descr[0] == '>' && size > 1)
+					{
+						for (uint64 i = 0; i < len; i++)
+							std::reverse(raw + i * size, raw + (i + 1) * size);
+					}
+
+					if (kind == 'f' && size == 2) castValues<float16>(raw, dst, len);
+					else if (kind == 'f' && size == 4) castValues<float32>(raw, dst, len);
+					else if (kind == 'f' && size == 8) castValues<float64>(raw, dst, len);
+					else if (kind == 'i' && size == 1) castValues<int8_t>(raw, dst, len);
+					else if (kind == 'i' && size == 2) castValues<int16_t>(raw, dst, len);
+					else if (kind == 'i' && size == 4) castValues<int32_t>(raw, dst, len);
+					else if (kind == 'i' && size == 8) castValues<int64>(raw, dst, len);
+					else if (kind == 'u' && size == 1) castValues<uint8_t>(raw, dst, len);
+					else if (kind == 'u' && size == 2) castValues<uint16_t>(raw, dst, len);
+					else if (kind == 'u' && size == 4) castValues<uint32_t>(raw, dst, len);
+					else if (kind == 'u' && size == 8) castValues<uint64>(raw, dst, len);
+					else if (kind == 'b' && size == 1) castValues<bool>(raw, dst, len);
+					else return false;
+
+					return true;
+				}
+
+				/// <summary>
+				/// Returns true if values of the NumPy type "descr" have exactly
+				/// the layout of "t" in memory
+				/// </summary>
+				template<typename t>
+				inline bool sameType(const std::string &descr)
+				{
+					const char *name = Descr<t>::name();
+					if (name == nullptr)
+						return false;
+					if (descr == name)
+						return true;
+
+					// Single bytes and native order values have no byte order
+					return (descr[0] == '|' || descr[0] == '=' || descr[0] == '<') && descr.substr(1) == name + 1;
+				}
+
+				/// <summary>
+				/// Create an array from the data of a .npy file that starts
+				/// "base" bytes into the file at "path". If the values have the
+				/// layout of "t" and are suitably aligned, the file is mapped
+				/// with "mode" instead of being read
+				/// </summary>
+				template<typename t>
+				inline Array<t> loadFrom(const std::string &path, std::ifstream &file, uint64 base, MapMode mode, bool canMap)
+				{
+					Header header;
+					std::string error;
+
+					if (!readHeader(file, base, header, error))
+					{
+						message::RapidError("Load Error", error + " \"" + path + "\"").display();
+						return Array<t>();
+					}
+
+					const bool isZeroDim = header.shape.empty();
+					const uint64 count = math::prod(header.shape);
+
+					// Fortran order arrays are loaded with their dimensions
+					// reversed, and returned as a transposed view
+					std::vector<uint64> shape = isZeroDim ? std::vector<uint64>{1} : header.shape;
+					if (header.fortranOrder)
+						std::reverse(shape.begin(), shape.end());
+
+					Array<t> res;
+					if (canMap && count > 0 && sameType<t>(header.descr) && header.dataOffset % alignof(t) == 0)
+						res = Array<t>::mapFile(path, shape, mode, MapAccess::NORMAL, header.dataOffset);
+
+					if (!res.isInitialized())
+					{
+						res = Array<t>(shape);
+
+						std::vector<char> raw(count * itemSize(header.descr));
+						file.seekg((std::streamoff) header.dataOffset);
+
+						if (!file.read(raw.data(), (std::streamsize) raw.size()))
+						{
+							message::RapidError("Load Error", "Truncated .npy data \"" + path + "\"").display();
+							return Array<t>();
+						}
+
+						if (!convert(header.descr, raw.data(), res.dataStart, count))
+						{
+							message::RapidError("Load Error", "Unsupported .npy type " + header.descr + " \"" + path + "\"").display();
+							return Array<t>();
+						}
+					}
+
+					res.isZeroDim = isZeroDim;
+					return header.fortranOrder ? res.transposed() : res;
+				}
+
+				/// <summary>
+				/// Return the header and data of an array in .npy format
+				/// </summary>
+				template<typename t>
+				inline std::string serialize(const Array<t> &arr)
+				{
+					if (Descr<t>::name() == nullptr)
+					{
+						message::RapidError("Save Error", "Type cannot be saved in .npy format").display();
+						return std::string();
+					}
+
+					std::string res = makeHeader(Descr<t>::name(), arr.shape, arr.isZeroDim);
+					const auto data = arr.isContiguous() ? arr : arr.copy();
+					res.append((const char *) data.dataStart, math::prod(arr.shape) * sizeof(t));
+					return res;
+				}
+
+				/*****************/
+				/* Zip archives  */
+				/*****************/
+
+				inline uint32 crc32(const char *data, uint64 len)
+				{
+					static const auto table = []()
+					{
+						std::array<uint32, 256> res;
+						for (uint32 i = 0; i < 256; i++)
+						{
+							uint32 c = i;
+							for (int k = 0; k < 8; k++)
+								c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+							res[i] = c;
+						}
+						return res;
+					}();
+
+					uint32 crc = 0xFFFFFFFFu;
+					for (uint64 i = 0; i < len; i++)
+						crc = table[(crc ^ (unsigned char) data[i]) & 0xFF] ^ (crc >> 8);
+					return crc ^ 0xFFFFFFFFu;
+				}
+
+				inline void put(std::string &out, uint64 val, int bytes)
+				{
+					for (int i = 0; i < bytes; i++)
+						out += (char) ((val >> (8 * i)) & 0xFF);
+				}
+
+				inline uint64 get(const char *data, int bytes)
+				{
+					uint64 res = 0;
+					for (int i = 0; i < bytes; i++)
+						res |= (uint64) (unsigned char) data[i] << (8 * i);
+					return res;
+				}
+
+				/// <summary>
+				/// An entry of a zip archive. "offset" is the position of the
+				/// entry's local header in the archive
+				/// </summary>
+				struct ZipEntry
+				{
+					std::string name;
+					uint64 method;
+					uint64 size;
+					uint64 offset;
+				};
+
+				/// <summary>
+				/// Read the central directory of a zip archive, including the
+				/// zip64 extensions written by NumPy
+				/// </summary>
+				inline bool readZipDirectory(std::ifstream &file, std::vector<ZipEntry> &entries, std::string &error)
+				{
+					file.seekg(0, std::ios::end);
+					const uint64 fileSize = (uint64) file.tellg();
+
+					// The end of central directory record is in the last 64 KiB
+					const uint64 tail = math::min(fileSize, (uint64) 65557);
+					std::vector<char> buffer(tail);
+					file.seekg((std::streamoff) (fileSize - tail));
+					file.read(buffer.data(), (std::streamsize) tail);
+
+					int64 eocd = -1;
+					for (int64 i = (int64) tail - 22; i >= 0; i--)
+					{
+						if (get(buffer.data() + i, 4) == 0x06054b50)
+						{
+							eocd = i;
+							break;
+						}
+					}
+
+					if (eocd < 0)
+					{
+						error = "Not a zip archive";
+						return false;
+					}
+
+					uint64 count = get(buffer.data() + eocd + 10, 2);
+					uint64 dirSize = get(buffer.data() + eocd + 12, 4);
+					uint64 dirOffset = get(buffer.data() + eocd + 16, 4);
+
+					// A zip64 end of central directory locator precedes the record
+					if (eocd >= 20 && get(buffer.data() + eocd - 20, 4) == 0x07064b50)
+					{
+						char record[56];
+						file.seekg((std::streamoff) get(buffer.data() + eocd - 12, 8));
+						if (file.read(record, 56) && get(record, 4) == 0x06064b50)
+						{
+							count = get(record + 32, 8);
+							dirSize = get(record + 40, 8);
+							dirOffset = get(record + 48, 8);
+						}
+					}
+
+					std::vector<char> dir(dirSize);
+					file.seekg((std::streamoff) dirOffset);
+					if (!file.read(dir.data(), (std::streamsize) dirSize))
+					{
+						error = "Truncated zip archive";
+						return false;
+					}
+
+					uint64 pos = 0;
+					for (uint64 i = 0; i < count; i++)
+					{
+						if (pos + 46 > dirSize || get(dir.data() + pos, 4) != 0x02014b50)
+						{
+							error = "Invalid zip directory";
+							return false;
+						}
+
+						const char *entry = dir.data() + pos;
+						const uint64 nameLen = get(entry + 28, 2);
+						const uint64 extraLen = get(entry + 30, 2);
+						const uint64 commentLen = get(entry + 32, 2);
+
+						ZipEntry res;
+						res.method = get(entry + 10, 2);
+						res.size = get(entry + 24, 4);
+						res.offset = get(entry + 42, 4);
+						res.name = std::string(entry + 46, nameLen);
+
+						// Values too large for the header are in the zip64 field,
+						// in a fixed order
+						const char *extra = entry + 46 + nameLen;
+						for (uint64 e = 0; e + 4 <= extraLen;)
+						{
+							const uint64 id = get(extra + e, 2), len = get(extra + e + 2, 2);
+
+							if (id == 0x0001)
+							{
+								const char *field = extra + e + 4;
+								if (res.size == 0xFFFFFFFF)
+									field += 8;		// The uncompressed size comes first
+								if (get(entry + 20, 4) == 0xFFFFFFFF)
+								{
+									res.size = get(field, 8);
+									field += 8;
+								}
+								if (res.offset == 0xFFFFFFFF)
+									res.offset = get(field, 8);
+							}
+
+							e += 4 + len;
+						}
+
+						entries.push_back(res);
+						pos += 46 + nameLen + extraLen + commentLen;
+					}
+
+					return true;
+				}
+			}
+		}
+
+		/// <summary>
+		/// Save an array to a file in NumPy's .npy format, which can be
+		/// loaded with numpy.load. Returns false if the file could not be
+		/// written
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="path"></param>
+		/// <param name="arr"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline bool save(const std::string &path, const Array<t> &arr)
+		{
+			if (npy::imp::Descr<t>::name() == nullptr)
+			{
+				message::RapidError("Save Error", "Type cannot be saved in .npy format").display();
+				return false;
+			}
+
+			std::ofstream file(path, std::ios::binary);
+			if (!file.is_open())
+			{
+				message::RapidError("Save Error", "Unable to open file \"" + path + "\"").display();
+				return false;
+			}
+
+			const auto header = npy::imp::makeHeader(npy::imp::Descr<t>::name(), arr.shape, arr.isZeroDim);
+			file.write(header.data(), (std::streamsize) header.size());
+
+			const auto data = arr.isContiguous() ? arr : arr.copy();
+			file.write((const char *) data.dataStart, (std::streamsize) (math::prod(arr.shape) * sizeof(t)));
+
+			return file.good();
+		}
+
+		/// <summary>
+		/// Load an array from a file in NumPy's .npy format. If the file
+		/// holds values of type "t", it is mapped into memory with "mode"
+		/// rather than read, so nothing is copied and large files load
+		/// immediately. Otherwise, the values are read and converted to "t".
+		/// Arrays stored in Fortran order are returned as transposed views
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="path"></param>
+		/// <param name="mode"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> load(const std::string &path, MapMode mode = MapMode::COPY_ON_WRITE)
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (!file.is_open())
+			{
+				message::RapidError("Load Error", "Unable to open file \"" + path + "\"").display();
+				return Array<t>();
+			}
+
+			return npy::imp::loadFrom<t>(path, file, 0, mode, true);
+		}
+
+		/// <summary>
+		/// Save several arrays to an uncompressed .npz archive, which can be
+		/// loaded with numpy.load. Each array is stored as "name.npy".
+		/// Returns false if the file could not be written
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="path"></param>
+		/// <param name="arrays"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline bool savez(const std::string &path, const std::vector<std::pair<std::string, Array<t>>> &arrays)
+		{
+			using namespace npy::imp;
+
+			if (Descr<t>::name() == nullptr)
+			{
+				message::RapidError("Save Error", "Type cannot be saved in .npz format").display();
+				return false;
+			}
+
+			std::ofstream file(path, std::ios::binary);
+			if (!file.is_open())
+			{
+				message::RapidError("Save Error", "Unable to open file \"" + path + "\"").display();
+				return false;
+			}
+
+			// Every entry has a zip64 extra field, as NumPy writes, so the
+			// archive can hold arrays of any size
+			std::string directory;
+			uint64 offset = 0;
+
+			for (const auto &named : arrays)
+			{
+				const std::string name = named.first + ".npy";
+				const std::string data = serialize(named.second);
+				const uint32 crc = crc32(data.data(), data.size());
+
+				std::string extra;
+				put(extra, 0x0001, 2);
+				put(extra, 24, 2);
+				put(extra, data.size(), 8);
+				put(extra, data.size(), 8);
+				put(extra, offset, 8);
+
+				std::string local;
+				put(local, 0x04034b50, 4);
+				put(local, 45, 2);					// Version needed (zip64)
+				put(local, 0, 2);					// Flags
+				put(local, 0, 2);					// Stored
+				put(local, 0, 4);					// Time and date
+				put(local, crc, 4);
+				put(local, 0xFFFFFFFF, 4);
+				put(local, 0xFFFFFFFF, 4);
+				put(local, name.size(), 2);
+				put(local, 20, 2);
+				local += name;
+				put(local, 0x0001, 2);
+				put(local, 16, 2);
+				put(local, data.size(), 8);
+				put(local, data.size(), 8);
+
+				put(directory, 0x02014b50, 4);
+				put(directory, 45, 2);				// Version made by
+				put(directory, 45, 2);				// Version needed
+				put(directory, 0, 2);
+				put(directory, 0, 2);
+				put(directory, 0, 4);
+				put(directory, crc, 4);
+				put(directory, 0xFFFFFFFF, 4);
+				put(directory, 0xFFFFFFFF, 4);
+				put(directory, name.size(), 2);
+				put(directory, extra.size(), 2);
+				put(directory, 0, 2);				// Comment length
+				put(directory, 0, 2);				// Disk number
+				put(directory, 0, 2);				// Internal attributes
+				put(directory, 0, 4);				// External attributes
+				put(directory, 0xFFFFFFFF, 4);
+				directory += name + extra;
+
+				file.write(local.data(), (std::streamsize) local.size());
+				file.write(data.data(), (std::streamsize) data.size());
+				offset += local.size() + data.size();
+			}
+
+			std::string end;
+			put(end, 0x06064b50, 4);				// Zip64 end of central directory
+			put(end, 44, 8);
+			put(end, 45, 2);
+			put(end, 45, 2);
+			put(end, 0, 4);
+			put(end, 0, 4);
+			put(end, arrays.size(), 8);
+			put(end, arrays.size(), 8);
+			put(end, directory.size(), 8);
+			put(end, offset, 8);
+
+			put(end, 0x07064b50, 4);				// Zip64 locator
+			put(end, 0, 4);
+			put(end, offset + directory.size(), 8);
+			put(end, 1, 4);
+
+			put(end, 0x06054b50, 4);				// End of central directory
+			put(end, 0, 2);
+			put(end, 0, 2);
+			put(end, 0xFFFF, 2);
+			put(end, 0xFFFF, 2);
+			put(end, 0xFFFFFFFF, 4);
+			put(end, 0xFFFFFFFF, 4);
+			put(end, 0, 2);
+
+			file.write(directory.data(), (std::streamsize) directory.size());
+			file.write(end.data(), (std::streamsize) end.size());
+
+			return file.good();
+		}
+
+		/// <summary>
+		/// Load every array in an uncompressed .npz archive, such as one
+		/// written by numpy.savez, keyed by name without the ".npy"
+		/// extension. Arrays are mapped into memory with "mode" where
+		/// their type and alignment allow, in the same way as load.
+		/// Compressed archives are not supported
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="path"></param>
+		/// <param name="mode"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline std::unordered_map<std::string, Array<t>> loadz(const std::string &path, MapMode mode = MapMode::COPY_ON_WRITE)
+		{
+			using namespace npy::imp;
+
+			std::unordered_map<std::string, Array<t>> res;
+			std::vector<ZipEntry> entries;
+			std::string error;
+
+			std::ifstream file(path, std::ios::binary);
+			if (!file.is_open() || !readZipDirectory(file, entries, error))
+			{
+				message::RapidError("Load Error", (error.empty() ? "Unable to open file" : error) + " \"" + path + "\"").display();
+				return res;
+			}
+
+			for (const auto &entry : entries)
+			{
+				if (entry.method != 0)
+				{
+					message::RapidError("Load Error", "Compressed .npz archives are not supported \"" + path + "\"").display();
+					return res;
+				}
+
+				// The data follows the local header, whose extra field may
+				// differ from the one in the central directory
+				char local[30];
+				file.seekg((std::streamoff) entry.offset);
+				file.read(local, 30);
+				const uint64 start = entry.offset + 30 + get(local + 26, 2) + get(local + 28, 2);
+
+				file.seekg((std::streamoff) start);
+				std::string name = entry.name;
+				if (name.size() > 4 && name.substr(name.size() - 4) == ".npy")
+					name = name.substr(0, name.size() - 4);
+
+				auto arr = loadFrom<t>(path, file, start, mode, true);
+				if (arr.isInitialized())
+					res.emplace(name, std::move(arr));
+			}
+
+			return res;
+		}
+	}
+}
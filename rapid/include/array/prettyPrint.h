@@ -31,7 +31,7 @@ namespace rapid
 
 				auto lastDecimal = stream.str().find_last_of('.');
 
-				if (std::is_floating_point<t>::value && lastDecimal == std::string::npos)
+				if ((std::is_floating_point<t>::value || isHalf<t>::value) && lastDecimal == std::string::npos)
 				{
 					stream << ".";
 					lastDecimal = stream.str().length() - 1;
@@ -202,7 +202,8 @@ namespace rapid
 			std::vector<uint64> currentIndex(shape.size(), 0);
 			currentIndex[currentIndex.size() - 1] = (uint64) -1;
 
-			auto arrayData = dataStart;
+			const auto data = packed();
+			auto arrayData = data.dataStart;
 
 			if (arrayData == nullptr)
 				message::RapidError("Printing Error", "Unable to print array due to invalid location or nullptr data").display();
@@ -0,0 +1,396 @@
+#pragma once
+
+#include "../internal.h"
+#include "../tuning.h"
+
+#include "expression.h"
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		namespace rng
+		{
+			/// <summary>
+			/// The number of values generated by a single thread at a time.
+			/// The result does not depend on how these blocks are shared
+			/// between threads
+			/// </summary>
+			constexpr uint64 blockSize = 1024;
+
+			/// <summary>
+			/// Values further than this many standard deviations from the
+			/// mean are redrawn by the truncated normal distribution
+			/// </summary>
+			constexpr float64 truncation = 2;
+
+			namespace imp
+			{
+				// The constants of Philox4x32, from Salmon et al., "Parallel
+				// Random Numbers: As Easy as 1, 2, 3" (2011)
+				constexpr uint32 mulA = 0xD2511F53u;
+				constexpr uint32 mulB = 0xCD9E8D57u;
+				constexpr uint32 weylA = 0x9E3779B9u;
+				constexpr uint32 weylB = 0xBB67AE85u;
+				constexpr int rounds = 10;
+
+				// Counters encrypted together, written so each step is a
+				// plain loop over the lanes that the compiler can vectorize
+				constexpr uint64 lanes = 16;
+
+				/// <summary>
+				/// Encrypt the L counters first, first + 1, ... with
+				/// Philox4x32-10, using "seed" as the key, and store the 4
+				/// random words of each counter in order in "out". "stream"
+				/// selects an independent sequence for the same counters
+				/// </summary>
+				template<uint64 L>
+				inline void philox(uint64 seed, uint64 first, uint32 stream, uint32 *out)
+				{
+					uint32 c0[L], c1[L], c2[L], c3[L];
+
+					for (uint64 l = 0; l < L; l++)
+					{
+						c0[l] = (uint32) (first + l);
+						c1[l] = (uint32) ((first + l) >> 32);
+						c2[l] = stream;
+						c3[l] = 0;
+					}
+
+					uint32 k0 = (uint32) seed, k1 = (uint32) (seed >> 32);
+
+					for (int r = 0; r < rounds; r++)
+					{
+						for (uint64 l = 0; l < L; l++)
+						{
+							const uint64 p0 = (uint64) mulA * c0[l];
+							const uint64 p1 = (uint64) mulB * c2[l];
+
+							const uint32 n0 = (uint32) (p1 >> 32) ^ c1[l] ^ k0;
+							const uint32 n2 = (uint32) (p0 >> 32) ^ c3[l] ^ k1;
+
+							c0[l] = n0;
+							c1[l] = (uint32) p1;
+							c2[l] = n2;
+							c3[l] = (uint32) p0;
+						}
+
+						k0 += weylA;
+						k1 += weylB;
+					}
+
+					for (uint64 l = 0; l < L; l++)
+					{
+						out[l * 4 + 0] = c0[l];
+						out[l * 4 + 1] = c1[l];
+						out[l * 4 + 2] = c2[l];
+						out[l * 4 + 3] = c3[l];
+					}
+				}
+
+				/// <summary>
+				/// The type values of type "t" are generated in. Half
+				/// precision and single precision values use 32 random bits
+				/// each, and everything else uses 64
+				/// </summary>
+				template<typename t>
+				struct real
+				{
+					using type = typename std::conditional<std::is_same<t, float32>::value || isHalf<t>::value, float32, float64>::type;
+				};
+
+				template<typename t>
+				constexpr uint64 words()
+				{
+					return std::is_same<typename real<t>::type, float32>::value ? 1 : 2;
+				}
+
+				// A value in [0, 1) from the random words at "w"
+				inline float32 unit(const uint32 *w, float32)
+				{
+					return (float32) (w[0] >> 8) * (1.0f / 16777216.0f);
+				}
+
+				inline float64 unit(const uint32 *w, float64)
+				{
+					return (float64) ((((uint64) w[0] << 32) | w[1]) >> 11) * (1.0 / 9007199254740992.0);
+				}
+
+				/// <summary>
+				/// Fill "out" with the uniform values in [0, 1) starting
+				/// at random block "first"
+				/// </summary>
+				template<typename r>
+				inline void units(uint64 seed, uint64 first, uint32 stream, r *out, uint64 len)
+				{
+					constexpr uint64 w = std::is_same<r, float32>::value ? 1 : 2;
+					uint32 bits[blockSize * 2 + lanes * 4];
+
+					const uint64 counters = (len * w + 3) / 4;
+					for (uint64 c = 0; c < counters; c += lanes)
+						philox<lanes>(seed, first + c, stream, bits + c * 4);
+
+					for (uint64 i = 0; i < len; i++)
+						out[i] = unit(bits + i * w, r());
+				}
+
+				/// <summary>
+				/// Transform pairs of uniform values in place into pairs of
+				/// independent standard normal values with the Box-Muller
+				/// transform. Element 2i holds r cos(theta), and element
+				/// 2i + 1 holds r sin(theta). "len" must be even
+				/// </summary>
+				template<typename r>
+				inline void boxMuller(r *vals, uint64 len)
+				{
+					constexpr auto mode = simd::Accuracy::PRECISE;
+					const uint64 pairs = len / 2;
+
+					// Zeroed so the compiler can see the inputs to the vector
+					// kernels are initialized, which it cannot prove from the
+					// loop bounds
+					r radius[blockSize / 2] = {}, angle[blockSize / 2] = {}, sin[blockSize / 2];
+
+					for (uint64 i = 0; i < pairs; i++)
+					{
+						// 1 - u is in (0, 1], so its logarithm is finite
+						radius[i] = (r) 1 - vals[i * 2];
+						angle[i] = (r) math::twoPi * vals[i * 2 + 1];
+					}
+
+					simd::unary<expr::Log<mode>>(radius, radius, pairs);
+					for (uint64 i = 0; i < pairs; i++)
+						radius[i] *= (r) -2;
+					simd::unary<expr::Sqrt<mode>>(radius, radius, pairs);
+					simd::unary<expr::Sin<mode>>(angle, sin, pairs);
+					simd::unary<expr::Cos<mode>>(angle, angle, pairs);
+
+					for (uint64 i = 0; i < pairs; i++)
+					{
+						vals[i * 2] = radius[i] * angle[i];
+						vals[i * 2 + 1] = radius[i] * sin[i];
+					}
+				}
+
+				/// <summary>
+				/// Calculate the standard normal value at element "index"
+				/// of a sequence starting at random block "first", drawn from
+				/// "stream". The pair it belongs to always lies in one block
+				/// </summary>
+				template<typename r>
+				inline r normalAt(uint64 seed, uint64 first, uint32 stream, uint64 index)
+				{
+					constexpr uint64 w = std::is_same<r, float32>::value ? 1 : 2;
+					const uint64 word = (index & ~1ull) * w;
+
+					uint32 bits[4];
+					philox<1>(seed, first + word / 4, stream, bits);
+
+					const r u1 = (r) 1 - unit(bits + word % 4, r());
+					const r u2 = unit(bits + word % 4 + w, r());
+					const r radius = std::sqrt((r) -2 * std::log(u1));
+					const r angle = (r) math::twoPi * u2;
+					return radius * ((index & 1) ? std::sin(angle) : std::cos(angle));
+				}
+
+				template<typename t, typename r>
+				inline void store(const r *src, t *dst, uint64 len)
+				{
+					simd::convert(src, dst, len);
+				}
+			}
+
+			/// <summary>
+			/// A counter-based random number generator, using Philox4x32-10.
+			/// The value at each position of a sequence is calculated from
+			/// the seed and the position alone, so arrays are filled in
+			/// parallel, and the result depends only on the seed and on the
+			/// values already drawn, never on the number of threads.
+			///
+			/// Every fill reserves the positions it uses with a single atomic
+			/// operation, so a generator can be shared between threads
+			/// </summary>
+			class Generator
+			{
+			public:
+				explicit Generator(uint64 seed = 0) : m_Seed(seed), m_Position(0)
+				{}
+
+				Generator(const Generator &other) : m_Seed(other.m_Seed), m_Position(other.m_Position.load())
+				{}
+
+				/// <summary>
+				/// Restart the generator from a new seed
+				/// </summary>
+				/// <param name="seed"></param>
+				inline void seed(uint64 seed)
+				{
+					m_Seed = seed;
+					m_Position = 0;
+				}
+
+				inline uint64 seed() const
+				{
+					return m_Seed;
+				}
+
+				/// <summary>
+				/// Fill "len" values with random values, uniformly distributed
+				/// in [min, max) for floating point types, and in [min, max]
+				/// for integral types
+				/// </summary>
+				/// <typeparam name="t"></typeparam>
+				/// <param name="dst"></param>
+				/// <param name="len"></param>
+				/// <param name="min"></param>
+				/// <param name="max"></param>
+				template<typename t>
+				inline void uniform(t *dst, uint64 len, t min, t max)
+				{
+					using r = typename imp::real<t>::type;
+					const r lo = (r) min;
+					const r range = std::is_integral<t>::value ? (r) max - lo + 1 : (r) max - lo;
+
+					generate(dst, len, [=](r *vals, uint64 count, uint64 /*seed*/, uint64 /*first*/, uint64 /*start*/)
+					{
+						for (uint64 i = 0; i < count; i++)
+							vals[i] = lo + range * vals[i];
+
+						if (std::is_integral<t>::value)
+						{
+							for (uint64 i = 0; i < count; i++)
+								vals[i] = math::min(std::floor(vals[i]), (r) max);
+						}
+					});
+				}
+
+				/// <summary>
+				/// Fill "len" values with normally distributed random values,
+				/// using the Box-Muller transform
+				/// </summary>
+				/// <typeparam name="t"></typeparam>
+				/// <param name="dst"></param>
+				/// <param name="len"></param>
+				/// <param name="mean"></param>
+				/// <param name="std"></param>
+				template<typename t>
+				inline void normal(t *dst, uint64 len, t mean, t std)
+				{
+					using r = typename imp::real<t>::type;
+					const r mu = (r) mean, sigma = (r) std;
+
+					generate(dst, len, [=](r *vals, uint64 count, uint64 /*seed*/, uint64 /*first*/, uint64 /*start*/)
+					{
+						imp::boxMuller(vals, (count + 1) & ~1ull);
+
+						for (uint64 i = 0; i < count; i++)
+							vals[i] = mu + sigma * vals[i];
+					});
+				}
+
+				/// <summary>
+				/// Fill "len" values with normally distributed random values,
+				/// where values more than "truncation" standard deviations
+				/// from the mean are redrawn
+				/// </summary>
+				/// <typeparam name="t"></typeparam>
+				/// <param name="dst"></param>
+				/// <param name="len"></param>
+				/// <param name="mean"></param>
+				/// <param name="std"></param>
+				template<typename t>
+				inline void truncatedNormal(t *dst, uint64 len, t mean, t std)
+				{
+					using r = typename imp::real<t>::type;
+					const r mu = (r) mean, sigma = (r) std;
+
+					generate(dst, len, [=](r *vals, uint64 count, uint64 seed, uint64 first, uint64 start)
+					{
+						imp::boxMuller(vals, (count + 1) & ~1ull);
+
+						// Each redraw of an element comes from a separate
+						// stream, so it only depends on the element's position
+						for (uint64 i = 0; i < count; i++)
+						{
+							for (uint32 stream = 1; std::abs(vals[i]) > (r) truncation && stream < 64; stream++)
+								vals[i] = imp::normalAt<r>(seed, first, stream, start + i);
+
+							vals[i] = mu + sigma * math::clamp(vals[i], (r) truncation);
+						}
+					});
+				}
+
+			private:
+				/// <summary>
+				/// Reserve the random blocks needed for "len" values, and fill
+				/// "dst" in blocks of blockSize values, in parallel for large
+				/// arrays. "transform" is given uniform values in [0, 1) and
+				/// replaces them with values of the required distribution
+				/// </summary>
+				template<typename t, typename Transform>
+				inline void generate(t *dst, uint64 len, const Transform &transform)
+				{
+					using r = typename imp::real<t>::type;
+					constexpr uint64 w = imp::words<t>();
+
+					// One value is added, so every Box-Muller pair is whole
+					const uint64 first = m_Position.fetch_add(((len + 1) * w + 3) / 4);
+					const uint64 seed = m_Seed;
+
+					auto fill = [&](uint64 block)
+					{
+						const uint64 start = block * blockSize;
+						const uint64 count = math::min(blockSize, len - start);
+
+						// Space for one more value, to complete the last pair
+						r vals[blockSize + 1];
+						imp::units(seed, first + start * w / 4, 0, vals, count + 1);
+						transform(vals, count, seed, first, start);
+						imp::store(vals, dst + start, count);
+					};
+
+					const long blocks = (long) ((len + blockSize - 1) / blockSize);
+
+					if (!tuning::parallel(tuning::Op::MAP, len))
+					{
+						for (long block = 0; block < blocks; block++)
+							fill(block);
+					}
+					else
+					{
+						long block = 0;
+
+					#pragma omp parallel for shared(blocks, fill) private(block) default(none)
+						for (block = 0; block < blocks; ++block)
+							fill(block);
+					}
+				}
+
+				uint64 m_Seed;
+				std::atomic<uint64> m_Position;
+			};
+
+			/// <summary>
+			/// Return the generator used by Array::fillRandom and the other
+			/// random array functions. It is seeded from the clock, unless
+			/// seeded with rng::seed
+			/// </summary>
+			/// <returns></returns>
+			inline Generator &global()
+			{
+				static Generator generator((uint64) (TIME * 1000000));
+				return generator;
+			}
+
+			/// <summary>
+			/// Restart the global generator from a given seed, so the random
+			/// arrays created afterwards are the same on every run
+			/// </summary>
+			/// <param name="seed"></param>
+			inline void seed(uint64 seed)
+			{
+				global().seed(seed);
+			}
+		}
+	}
+}
@@ -0,0 +1,772 @@
+#pragma once
+
+#include "../internal.h"
+#include "../tuning.h"
+
+#include "expression.h"
+
+#include <limits>
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		namespace reduce
+		{
+			/// <summary>
+			/// The algorithms available for summing floating point values.
+			/// Both split the input into fixed size blocks and combine the
+			/// sums of the blocks, but PAIRWISE sums each block with plain
+			/// additions and combines the blocks as a binary tree, while
+			/// KAHAN uses compensated summation throughout. KAHAN is more
+			/// accurate, but slower
+			/// </summary>
+			enum class Summation
+			{
+				PAIRWISE = 0,
+				KAHAN = 1
+			};
+
+			/// <summary>
+			/// The number of elements reduced by a single thread before
+			/// the partial results are combined
+			/// </summary>
+			constexpr uint64 blockSize = 4096;
+
+			namespace imp
+			{
+				inline std::atomic<int> &summationMode()
+				{
+					static std::atomic<int> mode((int) Summation::PAIRWISE);
+					return mode;
+				}
+
+				inline std::atomic<bool> &deterministicMode()
+				{
+					static std::atomic<bool> mode(false);
+					return mode;
+				}
+			}
+
+			/// <summary>
+			/// Return the summation algorithm used by sum, mean and var
+			/// </summary>
+			/// <returns></returns>
+			inline Summation summation()
+			{
+				return (Summation) imp::summationMode().load(std::memory_order_relaxed);
+			}
+
+			/// <summary>
+			/// Set the summation algorithm used by sum, mean and var
+			/// </summary>
+			/// <param name="mode"></param>
+			inline void setSummation(Summation mode)
+			{
+				imp::summationMode().store((int) mode, std::memory_order_relaxed);
+			}
+
+			/// <summary>
+			/// Returns true if reductions are deterministic.
+			///
+			/// The input of a reduction is always split into the same
+			/// blocks, and the blocks are always combined in the same
+			/// order, so the result never depends on the number of threads.
+			/// In deterministic mode, each block is also reduced with the
+			/// same layout of accumulators for every instruction set, so
+			/// the result is bit-identical on every computer
+			/// </summary>
+			/// <returns></returns>
+			inline bool deterministic()
+			{
+				return imp::deterministicMode().load(std::memory_order_relaxed);
+			}
+
+			/// <summary>
+			/// Enable or disable deterministic reductions
+			/// </summary>
+			/// <param name="mode"></param>
+			inline void setDeterministic(bool mode)
+			{
+				imp::deterministicMode().store(mode, std::memory_order_relaxed);
+			}
+
+			/// <summary>
+			/// The value that leaves every other value unchanged when
+			/// reduced with an operation
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			template<typename Op, typename t>
+			struct Identity;
+
+			template<typename t>
+			struct Identity<expr::Add, t>
+			{
+				static inline t value() { return (t) 0; }
+			};
+
+			template<typename t>
+			struct Identity<expr::Mul, t>
+			{
+				static inline t value() { return (t) 1; }
+			};
+
+			template<typename t>
+			struct Identity<expr::Minimum, t>
+			{
+				static inline t value()
+				{
+					return std::numeric_limits<t>::has_infinity ? std::numeric_limits<t>::infinity() : std::numeric_limits<t>::max();
+				}
+			};
+
+			template<typename t>
+			struct Identity<expr::Maximum, t>
+			{
+				static inline t value()
+				{
+					return std::numeric_limits<t>::has_infinity ? -std::numeric_limits<t>::infinity() : std::numeric_limits<t>::lowest();
+				}
+			};
+
+			/// <summary>
+			/// Returns true if "x" should replace "best" when searching
+			/// for the position of the minimum or maximum value
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			template<typename Op>
+			struct Better;
+
+			template<>
+			struct Better<expr::Minimum>
+			{
+				template<typename t> static inline bool apply(const t &x, const t &best) { return x < best; }
+			};
+
+			template<>
+			struct Better<expr::Maximum>
+			{
+				template<typename t> static inline bool apply(const t &x, const t &best) { return x > best; }
+			};
+
+			namespace imp
+			{
+				/// <summary>
+				/// Combine partial results as a binary tree
+				/// </summary>
+				template<typename Op, typename t>
+				inline t pairwise(const t *partials, uint64 count)
+				{
+					if (count == 1)
+						return partials[0];
+
+					const uint64 half = count / 2;
+					return Op::apply(pairwise<Op>(partials, half), pairwise<Op>(partials + half, count - half));
+				}
+
+				template<typename Op>
+				struct Block
+				{
+					template<typename t>
+					static inline t apply(const t *src, uint64 len, Summation mode, bool det)
+					{
+						return simd::reduce<Op>(src, len, Identity<Op, t>::value(), det);
+					}
+
+					template<typename t>
+					static inline t combine(const t *partials, uint64 count, Summation mode)
+					{
+						return pairwise<Op>(partials, count);
+					}
+				};
+
+				template<>
+				struct Block<expr::Add>
+				{
+					template<typename t, typename std::enable_if<std::is_floating_point<t>::value, int>::type = 0>
+					static inline t apply(const t *src, uint64 len, Summation mode, bool det)
+					{
+						if (mode == Summation::KAHAN)
+							return simd::kahan(src, len, det);
+						return simd::reduce<expr::Add>(src, len, (t) 0, det);
+					}
+
+					template<typename t, typename std::enable_if<!std::is_floating_point<t>::value, int>::type = 0>
+					static inline t apply(const t *src, uint64 len, Summation mode, bool det)
+					{
+						return simd::reduce<expr::Add>(src, len, (t) 0, det);
+					}
+
+					template<typename t>
+					static inline t combine(const t *partials, uint64 count, Summation mode)
+					{
+						if (mode == Summation::KAHAN)
+						{
+							t res = 0, err = 0;
+
+							for (uint64 i = 0; i < count; i++)
+							{
+								const t y = partials[i] - err;
+								const t tmp = res + y;
+								err = (tmp - res) - y;
+								res = tmp;
+							}
+
+							return res;
+						}
+
+						return pairwise<expr::Add>(partials, count);
+					}
+				};
+
+				template<typename Op, typename t>
+				inline t reduceBlock(const t *src, uint64 len, Summation mode, bool det, std::true_type)
+				{
+					return Block<Op>::apply(src, len, mode, det);
+				}
+
+				template<typename Op, typename t>
+				inline typename accumulator<t>::type reduceBlock(const t *src, uint64 len, Summation mode, bool det,
+																 std::false_type)
+				{
+					typename accumulator<t>::type buffer[blockSize];
+					simd::convert(src, buffer, len);
+					return Block<Op>::apply(buffer, len, mode, det);
+				}
+
+				/// <summary>
+				/// Reduce a block of at most blockSize values in the type they
+				/// are accumulated in. Half precision values are widened to
+				/// single precision first
+				/// </summary>
+				template<typename Op, typename t>
+				inline typename accumulator<t>::type reduceBlock(const t *src, uint64 len, Summation mode, bool det)
+				{
+					return reduceBlock<Op>(src, len, mode, det, std::is_same<t, typename accumulator<t>::type>());
+				}
+
+				/// <summary>
+				/// Returns true if two values are equal, treating NaN as
+				/// equal to itself
+				/// </summary>
+				template<typename t>
+				inline bool same(const t &x, const t &y)
+				{
+					return x == y || (x != x && y != y);
+				}
+
+				/// <summary>
+				/// Find the position of the first minimum or maximum value
+				/// in a block. The value is found with a vectorized reduction,
+				/// and then searched for, which is faster than tracking the
+				/// position in the reduction itself
+				/// </summary>
+				template<typename Op, typename t>
+				inline uint64 argBlock(const t *src, uint64 len, bool det)
+				{
+					const t best = simd::reduce<Op>(src, len, Identity<Op, t>::value(), det);
+
+					for (uint64 i = 0; i < len; i++)
+						if (same(src[i], best))
+							return i;
+
+					return 0;
+				}
+			}
+
+			/// <summary>
+			/// Reduce "len" contiguous values with a binary operation (Add,
+			/// Mul, Minimum or Maximum). The values are split into blocks of
+			/// blockSize elements, which are reduced with vectorized kernels,
+			/// in parallel for large inputs, and then combined in a fixed order.
+			/// Half precision values are reduced in single precision
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="len"></param>
+			/// <returns></returns>
+			template<typename Op, typename t>
+			inline typename accumulator<t>::type reduce(const t *src, uint64 len)
+			{
+				using acc = typename accumulator<t>::type;
+				const auto mode = summation();
+				const bool det = deterministic();
+
+				if (len <= blockSize)
+					return imp::reduceBlock<Op>(src, len, mode, det);
+
+				const long blocks = (long) ((len + blockSize - 1) / blockSize);
+				std::vector<acc> partials(blocks);
+				acc *res = partials.data();
+
+				if (!tuning::parallel(tuning::Op::REDUCE, len))
+				{
+					for (long block = 0; block < blocks; block++)
+					{
+						const uint64 start = (uint64) block * blockSize;
+						res[block] = imp::reduceBlock<Op>(src + start, (len - start < blockSize ? len - start : blockSize), mode, det);
+					}
+				}
+				else
+				{
+					long block = 0;
+
+				#pragma omp parallel for shared(src, len, blocks, res, mode, det) private(block) default(none)
+					for (block = 0; block < blocks; ++block)
+					{
+						const uint64 start = (uint64) block * blockSize;
+						res[block] = imp::reduceBlock<Op>(src + start, (len - start < blockSize ? len - start : blockSize), mode, det);
+					}
+				}
+
+				return imp::Block<Op>::combine(res, (uint64) blocks, mode);
+			}
+
+			/// <summary>
+			/// Find the position of the first minimum (Op = Minimum) or
+			/// maximum (Op = Maximum) of "len" contiguous values, in the
+			/// same way as reduce. If any value is NaN, the result is not
+			/// specified
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="len"></param>
+			/// <returns></returns>
+			template<typename Op, typename t>
+			inline uint64 arg(const t *src, uint64 len)
+			{
+				const bool det = deterministic();
+
+				if (len <= blockSize)
+					return imp::argBlock<Op>(src, len, det);
+
+				const long blocks = (long) ((len + blockSize - 1) / blockSize);
+				std::vector<uint64> partials(blocks);
+				uint64 *res = partials.data();
+
+				if (!tuning::parallel(tuning::Op::REDUCE, len))
+				{
+					for (long block = 0; block < blocks; block++)
+					{
+						const uint64 start = (uint64) block * blockSize;
+						res[block] = start + imp::argBlock<Op>(src + start, (len - start < blockSize ? len - start : blockSize), det);
+					}
+				}
+				else
+				{
+					long block = 0;
+
+				#pragma omp parallel for shared(src, len, blocks, res, det) private(block) default(none)
+					for (block = 0; block < blocks; ++block)
+					{
+						const uint64 start = (uint64) block * blockSize;
+						res[block] = start + imp::argBlock<Op>(src + start, (len - start < blockSize ? len - start : blockSize), det);
+					}
+				}
+
+				// Earlier blocks win ties, so the first position is found
+				uint64 best = res[0];
+				for (long block = 1; block < blocks; block++)
+					if (Better<Op>::apply(src[res[block]], src[best]))
+						best = res[block];
+
+				return best;
+			}
+
+			/// <summary>
+			/// Reductions along an axis split the outermost reduced dimension
+			/// into pieces of at least this many elements, so that they can be
+			/// run in parallel
+			/// </summary>
+			constexpr uint64 axisChunkSize = 65536;
+
+			/// <summary>
+			/// The largest number of pieces an axis reduction is split into,
+			/// and the largest output for which it is split at all. This
+			/// limits the memory used for partial results
+			/// </summary>
+			constexpr uint64 axisMaxChunks = 64;
+			constexpr uint64 axisMaxOutput = 4096;
+
+			namespace imp
+			{
+				/// <summary>
+				/// A dimension of an axis reduction, with the number of
+				/// elements to step over in the input and in the output
+				/// for each position along it. Reduced dimensions have an
+				/// output stride of zero
+				/// </summary>
+				struct Dim
+				{
+					uint64 len;
+					uint64 src;
+					uint64 out;
+				};
+
+				/// <summary>
+				/// Sort the dimensions of an axis reduction into the order
+				/// they are laid out in memory, and merge dimensions that
+				/// can be walked as one
+				/// </summary>
+				inline std::vector<Dim> simplify(const std::vector<uint64> &shape, const std::vector<uint64> &strides,
+												 const std::vector<bool> &reduced)
+				{
+					std::vector<uint64> outStrides(shape.size(), 0);
+					uint64 outStride = 1;
+
+					for (uint64 i = shape.size(); i > 0; i--)
+					{
+						if (!reduced[i - 1])
+						{
+							outStrides[i - 1] = outStride;
+							outStride *= shape[i - 1];
+						}
+					}
+
+					std::vector<Dim> dims;
+					for (uint64 i = 0; i < shape.size(); i++)
+						if (shape[i] != 1)
+							dims.push_back({shape[i], strides[i], outStrides[i]});
+
+					std::stable_sort(dims.begin(), dims.end(), [](const Dim &a, const Dim &b)
+					{
+						return a.src > b.src;
+					});
+
+					std::vector<Dim> res;
+					for (const auto &dim : dims)
+					{
+						if (!res.empty() && res.back().src == dim.src * dim.len && res.back().out == dim.out * dim.len)
+						{
+							res.back().len *= dim.len;
+							res.back().src = dim.src;
+							res.back().out = dim.out;
+						}
+						else
+						{
+							res.push_back(dim);
+						}
+					}
+
+					if (res.empty())
+						res.push_back({1, 1, 0});
+
+					return res;
+				}
+
+				template<typename Op, typename t>
+				inline void combine(const t *src, t *out, uint64 len)
+				{
+					simd::binary<Op>(out, true, src, true, out, len);
+				}
+
+				/// <summary>
+				/// Combine a row of values elementwise with a row of the output,
+				/// which has the type the values are accumulated in
+				/// </summary>
+				template<typename Op, typename t, typename o>
+				inline void combine(const t *src, o *out, uint64 len)
+				{
+					o buffer[expr::blockSize];
+
+					for (uint64 i = 0; i < len; i += expr::blockSize)
+					{
+						const uint64 count = len - i < expr::blockSize ? len - i : expr::blockSize;
+						simd::convert(src + i, buffer, count);
+						simd::binary<Op>(out + i, true, buffer, true, out + i, count);
+					}
+				}
+
+				/// <summary>
+				/// Accumulate every element covered by "dims" into the output,
+				/// walking the input in memory order. The innermost dimension
+				/// is either reduced into a single value, or combined
+				/// elementwise with a row of the output
+				/// </summary>
+				template<typename Op, typename t, typename o>
+				inline void walk(const Dim *dims, uint64 count, const t *src, o *out)
+				{
+					const Dim &dim = dims[0];
+
+					if (count > 1)
+					{
+						for (uint64 i = 0; i < dim.len; i++)
+							walk<Op>(dims + 1, count - 1, src + i * dim.src, out + i * dim.out);
+						return;
+					}
+
+					if (dim.out == 0)
+					{
+						if (dim.src == 1)
+						{
+							*out = Op::apply(*out, reduce<Op>(src, dim.len));
+						}
+						else
+						{
+							o res = *out;
+							for (uint64 i = 0; i < dim.len; i++)
+								res = Op::apply(res, (o) src[i * dim.src]);
+							*out = res;
+						}
+					}
+					else if (dim.src == 1 && dim.out == 1)
+					{
+						combine<Op>(src, out, dim.len);
+					}
+					else
+					{
+						for (uint64 i = 0; i < dim.len; i++)
+							out[i * dim.out] = Op::apply(out[i * dim.out], (o) src[i * dim.src]);
+					}
+				}
+
+				/// <summary>
+				/// Walk part of the outermost dimension, or of the dimension
+				/// "split", only
+				/// </summary>
+				template<typename Op, typename t, typename o>
+				inline void walkRange(std::vector<Dim> dims, uint64 split, uint64 start, uint64 end, const t *src, o *out)
+				{
+					src += start * dims[split].src;
+					out += start * dims[split].out;
+					dims[split].len = end - start;
+					walk<Op>(dims.data(), dims.size(), src, out);
+				}
+			}
+
+			namespace imp
+			{
+				/// <summary>
+				/// Reduce an array as described for reduce::reduceAxes, into
+				/// an output of the type the values are accumulated in
+				/// </summary>
+				template<typename Op, typename t, typename o>
+				inline void reduceInto(const t *src, const std::vector<uint64> &shape, const std::vector<uint64> &strides,
+									   const std::vector<bool> &reduced, o *out)
+				{
+					const auto dims = imp::simplify(shape, strides, reduced);
+					const o identity = Identity<Op, o>::value();
+
+					uint64 total = 1, outSize = 1;
+					for (const auto &dim : dims)
+					{
+						total *= dim.len;
+						if (dim.out != 0)
+							outSize *= dim.len;
+					}
+
+					for (uint64 i = 0; i < outSize; i++)
+						out[i] = identity;
+
+					if (total == 0)
+						return;
+
+					const bool parallel = tuning::parallel(tuning::Op::REDUCE, total);
+					const uint64 outer = dims[0].len;
+
+					if (dims[0].out == 0 && outSize <= axisMaxOutput)
+					{
+						// Split the reduced outer dimension into pieces with
+						// their own partial outputs
+						const uint64 inner = total / outer;
+						uint64 pieceLen = (axisChunkSize + inner - 1) / inner;
+						pieceLen = math::max(pieceLen, (outer + axisMaxChunks - 1) / axisMaxChunks);
+						const long pieces = (long) ((outer + pieceLen - 1) / pieceLen);
+
+						if (pieces <= 1)
+						{
+							walk<Op>(dims.data(), dims.size(), src, out);
+							return;
+						}
+
+						std::vector<o> partials(pieces * outSize, identity);
+						o *res = partials.data();
+
+						if (!parallel)
+						{
+							for (long piece = 0; piece < pieces; piece++)
+							{
+								const uint64 start = (uint64) piece * pieceLen;
+								const uint64 end = math::min(start + pieceLen, outer);
+								walkRange<Op>(dims, 0, start, end, src, res + piece * outSize);
+							}
+						}
+						else
+						{
+							long piece = 0;
+
+						#pragma omp parallel for shared(dims, pieces, pieceLen, outer, outSize, src, res) private(piece) default(none)
+							for (piece = 0; piece < pieces; ++piece)
+							{
+								const uint64 start = (uint64) piece * pieceLen;
+								const uint64 end = math::min(start + pieceLen, outer);
+								walkRange<Op>(dims, 0, start, end, src, res + piece * outSize);
+							}
+						}
+
+						for (uint64 width = 1; width < (uint64) pieces; width *= 2)
+							for (uint64 piece = 0; piece + width < (uint64) pieces; piece += 2 * width)
+								simd::binary<Op>(res + piece * outSize, true, res + (piece + width) * outSize, true,
+												 res + piece * outSize, outSize);
+
+						simd::binary<Op>(out, true, res, true, out, outSize);
+						return;
+					}
+
+					// Split the outermost kept dimension. Every output is reduced
+					// in the same order as in serial, so the pieces can be any size
+					uint64 split = 0;
+					while (dims[split].out == 0 && split + 1 < dims.size())
+						split++;
+
+					const uint64 splitLen = dims[split].len;
+
+					if (!parallel || splitLen < 2)
+					{
+						walk<Op>(dims.data(), dims.size(), src, out);
+						return;
+					}
+
+					const uint64 pieceLen = (splitLen + 255) / 256;
+					const long pieces = (long) ((splitLen + pieceLen - 1) / pieceLen);
+					long piece = 0;
+
+				#pragma omp parallel for shared(dims, split, pieces, pieceLen, splitLen, src, out) private(piece) default(none)
+					for (piece = 0; piece < pieces; ++piece)
+					{
+						const uint64 start = (uint64) piece * pieceLen;
+						const uint64 end = math::min(start + pieceLen, splitLen);
+						walkRange<Op>(dims, split, start, end, src, out);
+					}
+				}
+
+				template<typename Op, typename t>
+				inline void reduceAxes(const t *src, const std::vector<uint64> &shape, const std::vector<uint64> &strides,
+									   const std::vector<bool> &reduced, t *out, std::true_type)
+				{
+					reduceInto<Op>(src, shape, strides, reduced, out);
+				}
+
+				template<typename Op, typename t>
+				inline void reduceAxes(const t *src, const std::vector<uint64> &shape, const std::vector<uint64> &strides,
+									   const std::vector<bool> &reduced, t *out, std::false_type)
+				{
+					uint64 outSize = 1;
+					for (uint64 i = 0; i < shape.size(); i++)
+						if (!reduced[i])
+							outSize *= shape[i];
+
+					std::vector<typename accumulator<t>::type> res(outSize);
+					reduceInto<Op>(src, shape, strides, reduced, res.data());
+					simd::convert(res.data(), out, outSize);
+				}
+			}
+
+			/// <summary>
+			/// Reduce the dimensions of an N-D array marked in "reduced",
+			/// writing the result to "out", which is contiguous and has the
+			/// remaining dimensions in their original order.
+			///
+			/// The input is walked in memory order, without being copied.
+			/// If the outermost dimension in memory is reduced, and the output
+			/// is small, that dimension is split into a fixed number of pieces,
+			/// each reduced into its own partial output, and the partial outputs
+			/// are combined pairwise. Otherwise, the work is split along a
+			/// dimension that is kept. The pieces depend only on the shape, so
+			/// the result does not depend on the number of threads. Half
+			/// precision values are accumulated in single precision, and
+			/// only rounded once the reduction is complete
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="shape"></param>
+			/// <param name="strides"></param>
+			/// <param name="reduced"></param>
+			/// <param name="out"></param>
+			template<typename Op, typename t>
+			inline void reduceAxes(const t *src, const std::vector<uint64> &shape, const std::vector<uint64> &strides,
+								   const std::vector<bool> &reduced, t *out)
+			{
+				imp::reduceAxes<Op>(src, shape, strides, reduced, out, std::is_same<t, typename accumulator<t>::type>());
+			}
+
+			/// <summary>
+			/// Find the position of the first minimum (Op = Minimum) or
+			/// maximum (Op = Maximum) along one axis of a contiguous array
+			/// with the shape [outer, len, inner], writing outer * inner
+			/// positions to "out"
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="outer"></param>
+			/// <param name="len"></param>
+			/// <param name="inner"></param>
+			/// <param name="out"></param>
+			template<typename Op, typename t>
+			inline void argAxis(const t *src, uint64 outer, uint64 len, uint64 inner, uint64 *out)
+			{
+				if (inner == 1)
+				{
+					long index = 0;
+
+					if (!tuning::parallel(tuning::Op::REDUCE, outer * len))
+					{
+						for (uint64 i = 0; i < outer; i++)
+							out[i] = arg<Op>(src + i * len, len);
+					}
+					else
+					{
+					#pragma omp parallel for shared(src, outer, len, out) private(index) default(none)
+						for (index = 0; index < (long) outer; ++index)
+							out[index] = arg<Op>(src + index * len, len);
+					}
+
+					return;
+				}
+
+				// Compare whole rows, so memory is read in order
+				auto row = [&](uint64 i)
+				{
+					const t *block = src + i * len * inner;
+					uint64 *res = out + i * inner;
+					std::vector<t> best(block, block + inner);
+
+					for (uint64 j = 0; j < inner; j++)
+						res[j] = 0;
+
+					for (uint64 k = 1; k < len; k++)
+					{
+						const t *cur = block + k * inner;
+						for (uint64 j = 0; j < inner; j++)
+						{
+							if (Better<Op>::apply(cur[j], best[j]))
+							{
+								best[j] = cur[j];
+								res[j] = k;
+							}
+						}
+					}
+				};
+
+				long index = 0;
+
+				if (!tuning::parallel(tuning::Op::REDUCE, outer * len * inner) || outer < 2)
+				{
+					for (uint64 i = 0; i < outer; i++)
+						row(i);
+				}
+				else
+				{
+				#pragma omp parallel for shared(outer, row) private(index) default(none)
+					for (index = 0; index < (long) outer; ++index)
+						row(index);
+				}
+			}
+		}
+	}
+}
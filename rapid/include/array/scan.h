@@ -0,0 +1,479 @@
+#pragma once
+
+#include "../internal.h"
+#include "../tuning.h"
+
+#include "arrayCore.h"
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		namespace scan
+		{
+			/// <summary>
+			/// The number of elements of a contiguous line scanned by a
+			/// single thread. Long lines are always split into blocks of
+			/// this size, whatever the number of threads, so the result of
+			/// a scan never depends on the number of threads
+			/// </summary>
+			constexpr uint64 blockSize = 65536;
+
+			/// <summary>
+			/// The number of columns scanned together when scanning along
+			/// an axis that is not the last one
+			/// </summary>
+			constexpr uint64 columnBlock = 1024;
+
+			/// <summary>
+			/// When scanning along an axis that is not the last one gives
+			/// fewer than this many blocks of columns, the axis is also split
+			/// into blocks of about blockSize elements, so tall, narrow
+			/// arrays are still scanned in parallel. This depends only on the
+			/// shape, so the result never depends on the number of threads
+			/// </summary>
+			constexpr uint64 minColumnTasks = 64;
+
+			namespace imp
+			{
+				/// <summary>
+				/// Scan "len" contiguous elements, starting again at every
+				/// element whose flag in "heads" is set. "heads" may be null.
+				/// Returns the position of the first head, or "len" if there
+				/// is none
+				/// </summary>
+				template<typename Op, typename t, typename F>
+				inline uint64 scanSegments(const t *src, t *dst, uint64 len, const F *heads)
+				{
+					const t identity = reduce::Identity<Op, t>::value();
+
+					if (heads == nullptr)
+					{
+						simd::scan<Op>(src, dst, len, identity);
+						return len;
+					}
+
+					uint64 first = len;
+					uint64 start = 0;
+
+					for (uint64 i = 1; i <= len; i++)
+					{
+						if (i == len || (bool) heads[i])
+						{
+							simd::scan<Op>(src + start, dst + start, i - start, identity);
+							start = i;
+							first = math::min(first, i);
+						}
+					}
+
+					return (bool) heads[0] ? 0 : first;
+				}
+
+				/// <summary>
+				/// Scan "outer" contiguous lines of "len" elements each.
+				///
+				/// Each line is split into blocks, which are scanned
+				/// independently in parallel. The last element of each block
+				/// is then combined, in order, into the first element of the
+				/// next, and the running value is applied to the elements of
+				/// each block before its first head, again in parallel
+				/// </summary>
+				template<typename Op, typename t, typename F>
+				inline void scanLines(const t *src, t *dst, uint64 outer, uint64 len, const F *heads)
+				{
+					const uint64 blocks = (len + blockSize - 1) / blockSize;
+					const long tasks = (long) (outer * blocks);
+					const bool parallel = tuning::parallel(tuning::Op::ARITHMETIC, outer * len);
+
+					// The position of the first head in each block
+					std::vector<uint64> firstHead(tasks);
+					uint64 *firstData = firstHead.data();
+
+					auto scanBlock = [&](uint64 task)
+					{
+						const uint64 line = task / blocks, start = (task % blocks) * blockSize;
+						const uint64 offset = line * len + start;
+						firstData[task] = scanSegments<Op>(src + offset, dst + offset, math::min(blockSize, len - start),
+														   heads == nullptr ? heads : heads + start);
+					};
+
+					if (!parallel)
+					{
+						for (long task = 0; task < tasks; task++)
+							scanBlock(task);
+					}
+					else
+					{
+						long task = 0;
+
+					#pragma omp parallel for shared(tasks, scanBlock) private(task) default(none)
+						for (task = 0; task < tasks; ++task)
+							scanBlock(task);
+					}
+
+					if (blocks == 1)
+						return;
+
+					// The value carried into each block, from the blocks before it
+					std::vector<t> carries(tasks);
+					t *carryData = carries.data();
+
+					for (uint64 line = 0; line < outer; line++)
+					{
+						for (uint64 block = 1; block < blocks; block++)
+						{
+							const uint64 task = line * blocks + block;
+							const t last = dst[line * len + block * blockSize - 1];
+
+							if (block == 1 || firstHead[task - 1] < blockSize)
+								carries[task] = last;
+							else
+								carries[task] = Op::apply(carries[task - 1], last);
+						}
+					}
+
+					auto applyCarry = [&](uint64 task)
+					{
+						const uint64 line = task / blocks, block = task % blocks;
+						if (block == 0)
+							return;
+
+						t *blockDst = dst + line * len + block * blockSize;
+						simd::binary<Op>(carryData + task, false, blockDst, true, blockDst, firstData[task]);
+					};
+
+					if (!parallel)
+					{
+						for (long task = 0; task < tasks; task++)
+							applyCarry(task);
+					}
+					else
+					{
+						long task = 0;
+
+					#pragma omp parallel for shared(tasks, applyCarry) private(task) default(none)
+						for (task = 0; task < tasks; ++task)
+							applyCarry(task);
+					}
+				}
+
+				/// <summary>
+				/// Scan "outer" blocks of "len" rows of "inner" contiguous
+				/// elements each along the rows, starting again at every row
+				/// whose flag in "heads" is set. Each row is combined with the
+				/// previous one with vector instructions, and blocks of
+				/// columns are scanned in parallel.
+				///
+				/// If there are too few blocks of columns to keep every thread
+				/// busy, the rows are also split into blocks, which are
+				/// combined in the same way as the blocks of scanLines: the
+				/// last row of each block is carried into the next, in order,
+				/// and applied to the rows of each block before its first head
+				/// </summary>
+				template<typename Op, typename t, typename F>
+				inline void scanRows(const t *src, t *dst, uint64 outer, uint64 len, uint64 inner, const F *heads)
+				{
+					const uint64 columns = (inner + columnBlock - 1) / columnBlock;
+					const uint64 maxWidth = math::min(inner, columnBlock);
+					const uint64 blockRows = math::max(blockSize / maxWidth, (uint64) 1);
+					const uint64 rowBlocks = outer * columns < minColumnTasks ? (len + blockRows - 1) / blockRows : 1;
+					const uint64 rowsPerBlock = rowBlocks == 1 ? len : blockRows;
+					const long tasks = (long) (outer * columns * rowBlocks);
+					const bool parallel = tuning::parallel(tuning::Op::ARITHMETIC, outer * len * inner);
+
+					// The position of the first head in each block of rows,
+					// relative to the start of the block
+					std::vector<uint64> firstHead(tasks);
+					uint64 *firstData = firstHead.data();
+
+					auto scanColumns = [&](uint64 task)
+					{
+						const uint64 chain = task / rowBlocks, first = (task % rowBlocks) * rowsPerBlock;
+						const uint64 last = math::min(first + rowsPerBlock, len);
+						const uint64 start = (chain % columns) * columnBlock;
+						const uint64 width = math::min(columnBlock, inner - start);
+						const uint64 offset = (chain / columns) * len * inner + start;
+
+						firstData[task] = last - first;
+
+						for (uint64 row = first; row < last; row++)
+						{
+							const t *rowSrc = src + offset + row * inner;
+							t *rowDst = dst + offset + row * inner;
+							const bool head = heads != nullptr && (bool) heads[row];
+
+							if (head && firstData[task] == last - first)
+								firstData[task] = row - first;
+
+							if (row == first || head)
+								std::copy(rowSrc, rowSrc + width, rowDst);
+							else
+								simd::binary<Op>(rowDst - inner, true, rowSrc, true, rowDst, width);
+						}
+					};
+
+					if (!parallel)
+					{
+						for (long task = 0; task < tasks; task++)
+							scanColumns(task);
+					}
+					else
+					{
+						long task = 0;
+
+					#pragma omp parallel for shared(tasks, scanColumns) private(task) default(none)
+						for (task = 0; task < tasks; ++task)
+							scanColumns(task);
+					}
+
+					if (rowBlocks == 1)
+						return;
+
+					// The row carried into each block of rows, from the blocks
+					// before it
+					std::vector<t> carries(tasks * maxWidth);
+					t *carryData = carries.data();
+
+					for (uint64 chain = 0; chain < outer * columns; chain++)
+					{
+						const uint64 start = (chain % columns) * columnBlock;
+						const uint64 width = math::min(columnBlock, inner - start);
+						const uint64 offset = (chain / columns) * len * inner + start;
+
+						for (uint64 block = 1; block < rowBlocks; block++)
+						{
+							const uint64 task = chain * rowBlocks + block;
+							const t *lastRow = dst + offset + (block * rowsPerBlock - 1) * inner;
+							t *carry = carryData + task * maxWidth;
+
+							if (block == 1 || firstHead[task - 1] < rowsPerBlock)
+								std::copy(lastRow, lastRow + width, carry);
+							else
+								simd::binary<Op>(carry - maxWidth, true, lastRow, true, carry, width);
+						}
+					}
+
+					auto applyCarry = [&](uint64 task)
+					{
+						const uint64 chain = task / rowBlocks, block = task % rowBlocks;
+						if (block == 0)
+							return;
+
+						const uint64 start = (chain % columns) * columnBlock;
+						const uint64 width = math::min(columnBlock, inner - start);
+						const uint64 offset = (chain / columns) * len * inner + start;
+						const t *carry = carryData + task * maxWidth;
+
+						for (uint64 row = 0; row < firstData[task]; row++)
+						{
+							t *rowDst = dst + offset + (block * rowsPerBlock + row) * inner;
+							simd::binary<Op>(carry, true, rowDst, true, rowDst, width);
+						}
+					};
+
+					if (!parallel)
+					{
+						for (long task = 0; task < tasks; task++)
+							applyCarry(task);
+					}
+					else
+					{
+						long task = 0;
+
+					#pragma omp parallel for shared(tasks, applyCarry) private(task) default(none)
+						for (task = 0; task < tasks; ++task)
+							applyCarry(task);
+					}
+				}
+
+				/// <summary>
+				/// Scan an array along an axis, or the flattened array for an
+				/// axis of -1, starting again at every position along the axis
+				/// whose flag in "heads" is set. "heads" may be null
+				/// </summary>
+				template<typename Op, typename t, typename F>
+				inline Array<t> scanAxis(const Array<t> &arr, uint64 axis, const F *heads)
+				{
+					if (axis == (uint64) -1)
+						return scanAxis<Op>(arr.packed().reshaped({math::prod(arr.shape)}), 0, heads);
+
+					rapidAssert(axis < arr.shape.size(), "Axis '" + std::to_string(axis) +
+								"' is out of bounds for array with '" + std::to_string(arr.shape.size()) +
+								"' dimensions");
+
+					const auto src = arr.packed();
+					const uint64 outer = math::prod(std::vector<uint64>(arr.shape.begin(), arr.shape.begin() + axis));
+					const uint64 inner = math::prod(std::vector<uint64>(arr.shape.begin() + axis + 1, arr.shape.end()));
+
+					Array<t> res(arr.shape);
+					res.isZeroDim = arr.isZeroDim;
+
+					if (inner == 1)
+						scanLines<Op>(src.dataStart, res.dataStart, outer, arr.shape[axis], heads);
+					else
+						scanRows<Op>(src.dataStart, res.dataStart, outer, arr.shape[axis], inner, heads);
+
+					return res;
+				}
+
+				/// <summary>
+				/// Scan an array along an axis in segments, which start at
+				/// every position along the axis where "heads" is non-zero
+				/// </summary>
+				template<typename Op, typename t, typename F>
+				inline Array<t> scanSegmented(const Array<t> &arr, const Array<F> &heads, uint64 axis)
+				{
+					const uint64 len = axis == (uint64) -1 ? math::prod(arr.shape) : arr.shape[axis];
+					rapidAssert(math::prod(heads.shape) == len, "Segment heads must have one element for every position along the axis");
+
+					const auto flags = heads.packed();
+					return scanAxis<Op>(arr, axis, flags.dataStart);
+				}
+			}
+		}
+
+		/// <summary>
+		/// Return the cumulative sum of the elements along an axis, or of
+		/// the flattened array for an axis of -1. Long lines are scanned
+		/// in parallel in fixed blocks, so the result does not depend on the
+		/// number of threads, but sums are associated differently to a
+		/// sequential loop. See scan.h
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> cumsum(const Array<t> &arr, uint64 axis = (uint64) -1)
+		{
+			return scan::imp::scanAxis<expr::Add>(arr, axis, (const bool *) nullptr);
+		}
+
+		/// <summary>
+		/// Return the cumulative product of the elements along an axis, or
+		/// of the flattened array for an axis of -1
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> cumprod(const Array<t> &arr, uint64 axis = (uint64) -1)
+		{
+			return scan::imp::scanAxis<expr::Mul>(arr, axis, (const bool *) nullptr);
+		}
+
+		/// <summary>
+		/// Return the running maximum of the elements along an axis, or of
+		/// the flattened array for an axis of -1
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> cummax(const Array<t> &arr, uint64 axis = (uint64) -1)
+		{
+			return scan::imp::scanAxis<expr::Maximum>(arr, axis, (const bool *) nullptr);
+		}
+
+		/// <summary>
+		/// Return the running minimum of the elements along an axis, or of
+		/// the flattened array for an axis of -1
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline Array<t> cummin(const Array<t> &arr, uint64 axis = (uint64) -1)
+		{
+			return scan::imp::scanAxis<expr::Minimum>(arr, axis, (const bool *) nullptr);
+		}
+
+		/// <summary>
+		/// Return the cumulative sum along an axis in segments. "heads" has
+		/// one element for every position along the axis, and the sum
+		/// starts again at every position where it is non-zero, so heads
+		/// of {1, 0, 0, 1, 0} give the running totals of two segments of
+		/// lengths 3 and 2. The same segments are used for every line along
+		/// the axis
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <typeparam name="F"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="heads"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t, typename F>
+		inline Array<t> cumsum(const Array<t> &arr, const Array<F> &heads, uint64 axis = (uint64) -1)
+		{
+			return scan::imp::scanSegmented<expr::Add>(arr, heads, axis);
+		}
+
+		/// <summary>
+		/// Return the cumulative product along an axis in segments, in the
+		/// same way as the segmented cumsum
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <typeparam name="F"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="heads"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t, typename F>
+		inline Array<t> cumprod(const Array<t> &arr, const Array<F> &heads, uint64 axis = (uint64) -1)
+		{
+			return scan::imp::scanSegmented<expr::Mul>(arr, heads, axis);
+		}
+
+		/// <summary>
+		/// Return the running maximum along an axis in segments, in the
+		/// same way as the segmented cumsum
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <typeparam name="F"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="heads"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t, typename F>
+		inline Array<t> cummax(const Array<t> &arr, const Array<F> &heads, uint64 axis = (uint64) -1)
+		{
+			return scan::imp::scanSegmented<expr::Maximum>(arr, heads, axis);
+		}
+
+		/// <summary>
+		/// Return the running minimum along an axis in segments, in the
+		/// same way as the segmented cumsum
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <typeparam name="F"></typeparam>
+		/// <param name="arr"></param>
+		/// <param name="heads"></param>
+		/// <param name="axis"></param>
+		/// <returns></returns>
+		template<typename t, typename F>
+		inline Array<t> cummin(const Array<t> &arr, const Array<F> &heads, uint64 axis = (uint64) -1)
+		{
+			return scan::imp::scanSegmented<expr::Minimum>(arr, heads, axis);
+		}
+
+		// Scans of expressions evaluate the expression once and then scan
+		// the result
+
+	#define imp_scan_expr(name)																					\
+		template<typename E, typename std::enable_if<expr::traits<E>::isNode, int>::type = 0>					\
+		inline Array<typename E::storageType> name(const E &expr, uint64 axis = (uint64) -1)					\
+		{																										\
+			return name(expr.eval(), axis);																		\
+		}
+
+		imp_scan_expr(cumsum)
+		imp_scan_expr(cumprod)
+		imp_scan_expr(cummax)
+		imp_scan_expr(cummin)
+
+	#undef imp_scan_expr
+	}
+}
@@ -0,0 +1,1610 @@
+#pragma once
+
+#include "../internal.h"
+
+#include "half.h"
+
+#if !defined(RAPID_NO_SIMD) && (defined(RAPID_X86) || defined(RAPID_X64))
+#define RAPID_SIMD
+#endif
+
+#ifdef RAPID_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Functions defined between RAPID_SIMD_TARGET_BEGIN and RAPID_SIMD_TARGET_END
+// are compiled for the given instruction set, regardless of the flags used
+// to compile the rest of the program. MSVC allows any intrinsic to be used
+// without this, so nothing needs to be done
+#if defined(__clang__)
+#define RAPID_SIMD_TARGET_BEGIN(isa) _Pragma(TOSTRING(clang attribute push(__attribute__((target(isa))), apply_to = function)))
+#define RAPID_SIMD_TARGET_END _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define RAPID_SIMD_TARGET_BEGIN(isa) _Pragma("GCC push_options") _Pragma(TOSTRING(GCC target(isa)))
+#define RAPID_SIMD_TARGET_END _Pragma("GCC pop_options")
+#else
+#define RAPID_SIMD_TARGET_BEGIN(isa)
+#define RAPID_SIMD_TARGET_END
+#endif
+
+// Conversions to bfloat16 use AVX-512 BF16 instructions where the processor
+// has them. Only GCC and Clang allow the result to be stored directly
+#if defined(RAPID_SIMD) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 10))
+#define RAPID_SIMD_BF16
+#endif
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		namespace simd
+		{
+			/// <summary>
+			/// The accuracy of the vectorized elementary functions, such as
+			/// exp, log, tanh and sin. PRECISE kernels are within a few ulp
+			/// of the correctly rounded result, while FAST kernels use
+			/// shorter polynomials and approximate reciprocals, with a
+			/// relative error of a few parts per million in single
+			/// precision. DEFAULT follows the setting made with setAccuracy
+			/// </summary>
+			enum class Accuracy
+			{
+				DEFAULT = 0,
+				PRECISE = 1,
+				FAST = 2
+			};
+		}
+
+		namespace expr
+		{
+			struct Add;
+			struct Sub;
+			struct Mul;
+			struct Div;
+			struct Minimum;
+			struct Maximum;
+			struct Less;
+			struct Greater;
+			struct Negate;
+			struct Abs;
+			struct Square;
+
+			template<simd::Accuracy mode> struct Pow;
+			template<simd::Accuracy mode> struct Sqrt;
+			template<simd::Accuracy mode> struct Rsqrt;
+			template<simd::Accuracy mode> struct Exp;
+			template<simd::Accuracy mode> struct Log;
+			template<simd::Accuracy mode> struct Sin;
+			template<simd::Accuracy mode> struct Cos;
+			template<simd::Accuracy mode> struct Tanh;
+			template<simd::Accuracy mode> struct Sigmoid;
+		}
+
+		namespace simd
+		{
+			/// <summary>
+			/// The instruction sets that elementwise kernels can be
+			/// compiled for, in order of increasing vector width
+			/// </summary>
+			enum class Level
+			{
+				SCALAR = 0,
+				SSE2 = 1,
+				AVX2 = 2,
+				AVX512 = 3
+			};
+
+			/// <summary>
+			/// Operations with a vectorized kernel. Any other operation
+			/// is calculated with the scalar fallback
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			template<typename Op>
+			struct isVectorOp : std::false_type
+			{};
+
+			template<> struct isVectorOp<expr::Add> : std::true_type {};
+			template<> struct isVectorOp<expr::Sub> : std::true_type {};
+			template<> struct isVectorOp<expr::Mul> : std::true_type {};
+			template<> struct isVectorOp<expr::Div> : std::true_type {};
+			template<> struct isVectorOp<expr::Minimum> : std::true_type {};
+			template<> struct isVectorOp<expr::Maximum> : std::true_type {};
+			template<> struct isVectorOp<expr::Less> : std::true_type {};
+			template<> struct isVectorOp<expr::Greater> : std::true_type {};
+			template<> struct isVectorOp<expr::Negate> : std::true_type {};
+			template<> struct isVectorOp<expr::Abs> : std::true_type {};
+			template<> struct isVectorOp<expr::Square> : std::true_type {};
+			template<Accuracy mode> struct isVectorOp<expr::Pow<mode>> : std::true_type {};
+			template<Accuracy mode> struct isVectorOp<expr::Sqrt<mode>> : std::true_type {};
+			template<Accuracy mode> struct isVectorOp<expr::Rsqrt<mode>> : std::true_type {};
+			template<Accuracy mode> struct isVectorOp<expr::Exp<mode>> : std::true_type {};
+			template<Accuracy mode> struct isVectorOp<expr::Log<mode>> : std::true_type {};
+			template<Accuracy mode> struct isVectorOp<expr::Sin<mode>> : std::true_type {};
+			template<Accuracy mode> struct isVectorOp<expr::Cos<mode>> : std::true_type {};
+			template<Accuracy mode> struct isVectorOp<expr::Tanh<mode>> : std::true_type {};
+			template<Accuracy mode> struct isVectorOp<expr::Sigmoid<mode>> : std::true_type {};
+
+			/// <summary>
+			/// Types with vectorized kernels. Without SIMD support, nothing
+			/// is vectorized, so expressions are evaluated with fused loops
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			template<typename t>
+			struct isVectorType : std::integral_constant<bool,
+			#ifdef RAPID_SIMD
+				std::is_same<t, float>::value || std::is_same<t, double>::value
+			#else
+				false
+			#endif
+			>
+			{};
+
+			template<typename Op, typename t>
+			struct vectorizable : std::integral_constant<bool, isVectorOp<Op>::value && isVectorType<t>::value>
+			{};
+
+			namespace imp
+			{
+			#ifdef RAPID_SIMD
+				inline void cpuid(int leaf, int subLeaf, int regs[4])
+				{
+				#ifdef _MSC_VER
+					__cpuidex(regs, leaf, subLeaf);
+				#else
+					unsigned int a, b, c, d;
+					__cpuid_count(leaf, subLeaf, a, b, c, d);
+					regs[0] = (int) a;
+					regs[1] = (int) b;
+					regs[2] = (int) c;
+					regs[3] = (int) d;
+				#endif
+				}
+
+				/// <summary>
+				/// Return the register state enabled by the operating system.
+				/// Only valid if CPUID reports OSXSAVE
+				/// </summary>
+				/// <returns></returns>
+				inline uint64 xgetbv()
+				{
+				#ifdef _MSC_VER
+					return _xgetbv(0);
+				#else
+					unsigned int lo, hi;
+					__asm__ __volatile__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+					return ((uint64) hi << 32) | lo;
+				#endif
+				}
+			#endif
+			}
+
+			/// <summary>
+			/// Detect the widest instruction set supported by both the
+			/// processor and the operating system
+			/// </summary>
+			/// <returns></returns>
+			inline Level detectLevel()
+			{
+			#ifdef RAPID_SIMD
+				int regs[4];
+
+				imp::cpuid(0, 0, regs);
+				const int maxLeaf = regs[0];
+
+				imp::cpuid(1, 0, regs);
+				const bool sse2 = (regs[3] & (1 << 26)) != 0;
+				const bool osxsave = (regs[2] & (1 << 27)) != 0;
+				const bool avx = (regs[2] & (1 << 28)) != 0;
+				const bool fma = (regs[2] & (1 << 12)) != 0;
+				const bool f16c = (regs[2] & (1 << 29)) != 0;
+
+				if (!sse2)
+					return Level::SCALAR;
+
+				// The operating system must save the YMM (and ZMM) registers
+				// when switching threads for AVX2 (and AVX-512) to be usable
+				if (!osxsave || !avx || maxLeaf < 7)
+					return Level::SSE2;
+
+				const uint64 xcr0 = imp::xgetbv();
+				if ((xcr0 & 0x6) != 0x6)
+					return Level::SSE2;
+
+				imp::cpuid(7, 0, regs);
+				const bool avx2 = (regs[1] & (1 << 5)) != 0;
+				const bool avx512 = (regs[1] & (1 << 16)) != 0;
+
+				if (avx512 && (xcr0 & 0xe6) == 0xe6)
+					return Level::AVX512;
+
+				// The AVX2 kernels also use FMA and F16C, which every AVX2
+				// processor has in practice, but which are reported separately
+				if (avx2 && fma && f16c)
+					return Level::AVX2;
+
+				return Level::SSE2;
+			#else
+				return Level::SCALAR;
+			#endif
+			}
+
+			/// <summary>
+			/// Returns true if the processor can convert single precision
+			/// values to bfloat16 with AVX-512 BF16 instructions
+			/// </summary>
+			/// <returns></returns>
+			inline bool detectBF16()
+			{
+			#ifdef RAPID_SIMD_BF16
+				int regs[4];
+
+				imp::cpuid(0, 0, regs);
+				if (regs[0] < 7 || detectLevel() != Level::AVX512)
+					return false;
+
+				imp::cpuid(7, 1, regs);
+				return (regs[0] & (1 << 5)) != 0;
+			#else
+				return false;
+			#endif
+			}
+
+			inline Level &currentLevel()
+			{
+				static Level level = detectLevel();
+				return level;
+			}
+
+			/// <summary>
+			/// Return the instruction set used by the elementwise kernels
+			/// </summary>
+			/// <returns></returns>
+			inline Level level()
+			{
+				return currentLevel();
+			}
+
+			/// <summary>
+			/// Set the instruction set used by the elementwise kernels. The
+			/// level cannot be raised above what the processor supports. This
+			/// is intended for testing and benchmarking, and must not be called
+			/// while an expression is being evaluated on another thread
+			/// </summary>
+			/// <param name="newLevel"></param>
+			inline void setLevel(Level newLevel)
+			{
+				currentLevel() = (int) newLevel < (int) detectLevel() ? newLevel : detectLevel();
+			}
+
+			namespace imp
+			{
+				inline std::atomic<int> &accuracyMode()
+				{
+					static std::atomic<int> mode((int) Accuracy::PRECISE);
+					return mode;
+				}
+
+				// Reinterpret the bits of an integer as a floating point value
+				template<typename s, typename u>
+				inline s fromBits(u bits)
+				{
+					s res;
+					memcpy(&res, &bits, sizeof(res));
+					return res;
+				}
+			}
+
+			/// <summary>
+			/// Return the accuracy of the elementary functions called
+			/// without an explicit accuracy
+			/// </summary>
+			/// <returns></returns>
+			inline Accuracy accuracy()
+			{
+				return (Accuracy) imp::accuracyMode().load(std::memory_order_relaxed);
+			}
+
+			/// <summary>
+			/// Set the accuracy of the elementary functions called without
+			/// an explicit accuracy, as in exp(x) rather than
+			/// exp<simd::Accuracy::FAST>(x). Setting DEFAULT restores
+			/// PRECISE
+			/// </summary>
+			/// <param name="mode"></param>
+			inline void setAccuracy(Accuracy mode)
+			{
+				imp::accuracyMode().store((int) (mode == Accuracy::DEFAULT ? Accuracy::PRECISE : mode),
+										  std::memory_order_relaxed);
+			}
+
+			/// <summary>
+			/// Returns true if an elementary function called with "mode"
+			/// uses the fast kernels
+			/// </summary>
+			/// <param name="mode"></param>
+			/// <returns></returns>
+			inline bool isFast(Accuracy mode)
+			{
+				return mode == Accuracy::FAST || (mode == Accuracy::DEFAULT && accuracy() == Accuracy::FAST);
+			}
+
+			/// <summary>
+			/// Reductions split their input between this many independent
+			/// accumulators, where element i goes to accumulator i % reduceLanes.
+			/// Deterministic reductions always use this layout, whatever the
+			/// vector width, so their result does not depend on the instruction
+			/// set. Otherwise, each instruction set uses four vectors
+			/// </summary>
+			constexpr uint64 reduceLanes = 16;
+
+			namespace imp
+			{
+				/// <summary>
+				/// Combine "L" accumulators in a fixed, pairwise order
+				/// </summary>
+				template<typename Op, uint64 L, typename t>
+				inline t combineLanes(t *lanes)
+				{
+					for (uint64 width = L / 2; width > 0; width /= 2)
+						for (uint64 i = 0; i < width; i++)
+							lanes[i] = Op::apply(lanes[i], lanes[i + width]);
+
+					return lanes[0];
+				}
+
+				/// <summary>
+				/// Combine "L" compensated sums in a fixed order
+				/// </summary>
+				template<uint64 L, typename t>
+				inline t combineKahan(const t *sum, const t *comp)
+				{
+					t res = 0, err = 0;
+
+					for (uint64 i = 0; i < L; i++)
+					{
+						const t y = (sum[i] - comp[i]) - err;
+						const t tmp = res + y;
+						err = (tmp - res) - y;
+						res = tmp;
+					}
+
+					return res;
+				}
+			}
+
+			namespace scalar
+			{
+				template<typename Op, typename t>
+				inline void binary(const t *lhs, bool lhsStep, const t *rhs, bool rhsStep, t *out, uint64 len)
+				{
+					if (lhsStep && rhsStep)
+					{
+						for (uint64 i = 0; i < len; i++)
+							out[i] = Op::apply(lhs[i], rhs[i]);
+					}
+					else if (lhsStep)
+					{
+						const t val = rhs[0];
+						for (uint64 i = 0; i < len; i++)
+							out[i] = Op::apply(lhs[i], val);
+					}
+					else
+					{
+						const t val = lhs[0];
+						for (uint64 i = 0; i < len; i++)
+							out[i] = Op::apply(val, rhs[i]);
+					}
+				}
+
+				template<typename Op, typename t>
+				inline void unary(const t *src, t *out, uint64 len)
+				{
+					for (uint64 i = 0; i < len; i++)
+						out[i] = Op::apply(src[i]);
+				}
+
+				// The scalar reductions always use reduceLanes accumulators,
+				// which is the order of a deterministic reduction, so they
+				// need no flag to select it
+
+				template<typename Op, typename t>
+				inline t reduce(const t *src, uint64 len, t init)
+				{
+					t lanes[reduceLanes];
+					for (uint64 j = 0; j < reduceLanes; j++)
+						lanes[j] = init;
+
+					uint64 i = 0;
+					for (; i + reduceLanes <= len; i += reduceLanes)
+						for (uint64 j = 0; j < reduceLanes; j++)
+							lanes[j] = Op::apply(lanes[j], src[i + j]);
+
+					for (uint64 j = 0; i < len; i++, j++)
+						lanes[j] = Op::apply(lanes[j], src[i]);
+
+					return imp::combineLanes<Op, reduceLanes>(lanes);
+				}
+
+				template<typename t>
+				inline t kahan(const t *src, uint64 len)
+				{
+					t sum[reduceLanes] = {0}, comp[reduceLanes] = {0};
+
+					for (uint64 i = 0; i < len; i++)
+					{
+						const uint64 j = i % reduceLanes;
+						const t y = src[i] - comp[j];
+						const t tmp = sum[j] + y;
+						comp[j] = (tmp - sum[j]) - y;
+						sum[j] = tmp;
+					}
+
+					return imp::combineKahan<reduceLanes>(sum, comp);
+				}
+
+				template<typename t>
+				inline void transposeBlock(const t *src, uint64 srcStride, t *dst, uint64 dstStride, uint64 rows, uint64 cols)
+				{
+					for (uint64 i = 0; i < rows; i++)
+						for (uint64 j = 0; j < cols; j++)
+							dst[j * dstStride + i] = src[i * srcStride + j];
+				}
+
+				template<typename t>
+				inline typename accumulator<t>::type dot(const t *a, const t *b, uint64 len)
+				{
+					typename accumulator<t>::type res = 0;
+					for (uint64 i = 0; i < len; i++)
+						res += a[i] * b[i];
+					return res;
+				}
+
+				template<typename t>
+				inline void axpy(t alpha, const t *x, t *y, uint64 len)
+				{
+					for (uint64 i = 0; i < len; i++)
+						y[i] += alpha * x[i];
+				}
+
+				template<typename t>
+				inline void gather(const t *src, const int64 *index, t *dst, uint64 len)
+				{
+					for (uint64 i = 0; i < len; i++)
+						dst[i] = src[index[i]];
+				}
+
+				template<typename Op, typename t>
+				inline void scan(const t *src, t *out, uint64 len, t identity)
+				{
+					t acc = identity;
+					for (uint64 i = 0; i < len; i++)
+						out[i] = acc = Op::apply(acc, src[i]);
+				}
+
+				template<typename s, typename d>
+				inline void convert(const s *src, d *dst, uint64 len)
+				{
+					for (uint64 i = 0; i < len; i++)
+						dst[i] = (d) src[i];
+				}
+
+				constexpr uint64 gemmRows = 4;
+				constexpr uint64 gemmCols = 4;
+
+				template<typename t>
+				inline void gemmKernel(uint64 depth, const t *a, const t *b, t *c, uint64 ldc, bool accumulate)
+				{
+					t acc[gemmRows][gemmCols];
+					for (uint64 r = 0; r < gemmRows; r++)
+						for (uint64 col = 0; col < gemmCols; col++)
+							acc[r][col] = 0;
+
+					for (uint64 p = 0; p < depth; p++)
+					{
+						for (uint64 r = 0; r < gemmRows; r++)
+							for (uint64 col = 0; col < gemmCols; col++)
+								acc[r][col] += a[r] * b[col];
+
+						a += gemmRows;
+						b += gemmCols;
+					}
+
+					for (uint64 r = 0; r < gemmRows; r++)
+						for (uint64 col = 0; col < gemmCols; col++)
+							c[r * ldc + col] = accumulate ? c[r * ldc + col] + acc[r][col] : acc[r][col];
+				}
+			}
+
+		#ifdef RAPID_SIMD
+			RAPID_SIMD_TARGET_BEGIN("sse2")
+			namespace sse2
+			{
+				template<typename t>
+				struct Vec;
+
+				template<>
+				struct Vec<float>
+				{
+					using type = __m128;
+					using scalar = float;
+					static constexpr uint64 width = 4;
+
+					static inline type load(const float *p) { return _mm_loadu_ps(p); }
+					static inline void store(float *p, type x) { _mm_storeu_ps(p, x); }
+					static inline type set1(float x) { return _mm_set1_ps(x); }
+
+					static inline type add(type x, type y) { return _mm_add_ps(x, y); }
+					static inline type sub(type x, type y) { return _mm_sub_ps(x, y); }
+					static inline type mul(type x, type y) { return _mm_mul_ps(x, y); }
+					static inline type div(type x, type y) { return _mm_div_ps(x, y); }
+					static inline type min(type x, type y) { return _mm_min_ps(x, y); }
+					static inline type max(type x, type y) { return _mm_max_ps(x, y); }
+					static inline type less(type x, type y) { return _mm_and_ps(_mm_cmplt_ps(x, y), set1(1)); }
+					static inline type greater(type x, type y) { return _mm_and_ps(_mm_cmpgt_ps(x, y), set1(1)); }
+					static inline type neg(type x) { return _mm_xor_ps(x, set1(-0.0f)); }
+					static inline type abs(type x) { return _mm_andnot_ps(set1(-0.0f), x); }
+					static inline type fma(type x, type y, type z) { return _mm_add_ps(_mm_mul_ps(x, y), z); }
+
+					// Operations used by the polynomial approximations of the
+					// elementary functions. Comparisons return a mask, which
+					// selects between two vectors, and the shifts act on the
+					// bits of each element
+					static inline type sqrt(type x) { return _mm_sqrt_ps(x); }
+					static inline type rcp(type x) { const type y = _mm_rcp_ps(x); return _mm_mul_ps(y, _mm_sub_ps(set1(2), _mm_mul_ps(x, y))); }
+					static inline type rsqrt(type x)
+					{
+						const type y = _mm_rsqrt_ps(x);
+						const type res = _mm_mul_ps(y, _mm_sub_ps(set1(1.5f), _mm_mul_ps(_mm_mul_ps(set1(0.5f), x), _mm_mul_ps(y, y))));
+
+						// The estimate is exact for zero and infinity, where the
+						// refinement gives NaN
+						return select(nanMask(res), y, res);
+					}
+					static inline type bitAnd(type x, type y) { return _mm_and_ps(x, y); }
+					static inline type bitOr(type x, type y) { return _mm_or_ps(x, y); }
+					static inline type bitXor(type x, type y) { return _mm_xor_ps(x, y); }
+					template<int n> static inline type shiftLeft(type x) { return _mm_castsi128_ps(_mm_slli_epi32(_mm_castps_si128(x), n)); }
+					template<int n> static inline type shiftRight(type x) { return _mm_castsi128_ps(_mm_srli_epi32(_mm_castps_si128(x), n)); }
+
+					using mask = type;
+					static inline mask lessMask(type x, type y) { return _mm_cmplt_ps(x, y); }
+					static inline mask greaterMask(type x, type y) { return _mm_cmpgt_ps(x, y); }
+					static inline mask equalMask(type x, type y) { return _mm_cmpeq_ps(x, y); }
+					static inline mask nanMask(type x) { return _mm_cmpunord_ps(x, x); }
+					static inline type select(mask m, type x, type y) { return _mm_or_ps(_mm_and_ps(m, x), _mm_andnot_ps(m, y)); }
+					static inline bool any(mask m) { return _mm_movemask_ps(m) != 0; }
+
+					// Move each element "n" lanes up, filling the lowest lanes
+					// from "fill", and copy the highest lane to every lane
+					template<int n> static inline type shiftLanes(type x, type fill)
+					{
+						const type low = _mm_castsi128_ps(_mm_srli_si128(_mm_set1_epi32(-1), 16 - 4 * n));
+						return _mm_or_ps(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4 * n)), _mm_and_ps(low, fill));
+					}
+					static inline type broadcastLast(type x) { return _mm_shuffle_ps(x, x, 0xFF); }
+
+					// Transpose a square tile held in "width" registers
+					static inline void transpose(type *r)
+					{
+						const type t0 = _mm_unpacklo_ps(r[0], r[1]), t1 = _mm_unpacklo_ps(r[2], r[3]);
+						const type t2 = _mm_unpackhi_ps(r[0], r[1]), t3 = _mm_unpackhi_ps(r[2], r[3]);
+						r[0] = _mm_movelh_ps(t0, t1);
+						r[1] = _mm_movehl_ps(t1, t0);
+						r[2] = _mm_movelh_ps(t2, t3);
+						r[3] = _mm_movehl_ps(t3, t2);
+					}
+				};
+
+				template<>
+				struct Vec<double>
+				{
+					using type = __m128d;
+					using scalar = double;
+					static constexpr uint64 width = 2;
+
+					static inline type load(const double *p) { return _mm_loadu_pd(p); }
+					static inline void store(double *p, type x) { _mm_storeu_pd(p, x); }
+					static inline type set1(double x) { return _mm_set1_pd(x); }
+
+					static inline type add(type x, type y) { return _mm_add_pd(x, y); }
+					static inline type sub(type x, type y) { return _mm_sub_pd(x, y); }
+					static inline type mul(type x, type y) { return _mm_mul_pd(x, y); }
+					static inline type div(type x, type y) { return _mm_div_pd(x, y); }
+					static inline type min(type x, type y) { return _mm_min_pd(x, y); }
+					static inline type max(type x, type y) { return _mm_max_pd(x, y); }
+					static inline type less(type x, type y) { return _mm_and_pd(_mm_cmplt_pd(x, y), set1(1)); }
+					static inline type greater(type x, type y) { return _mm_and_pd(_mm_cmpgt_pd(x, y), set1(1)); }
+					static inline type neg(type x) { return _mm_xor_pd(x, set1(-0.0)); }
+					static inline type abs(type x) { return _mm_andnot_pd(set1(-0.0), x); }
+					static inline type fma(type x, type y, type z) { return _mm_add_pd(_mm_mul_pd(x, y), z); }
+
+					static inline type sqrt(type x) { return _mm_sqrt_pd(x); }
+					static inline type rcp(type x) { return _mm_div_pd(set1(1), x); }
+					static inline type rsqrt(type x) { return _mm_div_pd(set1(1), _mm_sqrt_pd(x)); }
+					static inline type bitAnd(type x, type y) { return _mm_and_pd(x, y); }
+					static inline type bitOr(type x, type y) { return _mm_or_pd(x, y); }
+					static inline type bitXor(type x, type y) { return _mm_xor_pd(x, y); }
+					template<int n> static inline type shiftLeft(type x) { return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(x), n)); }
+					template<int n> static inline type shiftRight(type x) { return _mm_castsi128_pd(_mm_srli_epi64(_mm_castpd_si128(x), n)); }
+
+					using mask = type;
+					static inline mask lessMask(type x, type y) { return _mm_cmplt_pd(x, y); }
+					static inline mask greaterMask(type x, type y) { return _mm_cmpgt_pd(x, y); }
+					static inline mask equalMask(type x, type y) { return _mm_cmpeq_pd(x, y); }
+					static inline mask nanMask(type x) { return _mm_cmpunord_pd(x, x); }
+					static inline type select(mask m, type x, type y) { return _mm_or_pd(_mm_and_pd(m, x), _mm_andnot_pd(m, y)); }
+					static inline bool any(mask m) { return _mm_movemask_pd(m) != 0; }
+
+					// Move each element "n" lanes up, filling the lowest lanes
+					// from "fill", and copy the highest lane to every lane
+					template<int n> static inline type shiftLanes(type x, type fill)
+					{
+						const type low = _mm_castsi128_pd(_mm_srli_si128(_mm_set1_epi32(-1), 16 - 8 * n));
+						return _mm_or_pd(_mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(x), 8 * n)), _mm_and_pd(low, fill));
+					}
+					static inline type broadcastLast(type x) { return _mm_unpackhi_pd(x, x); }
+
+					static inline void transpose(type *r)
+					{
+						const type t0 = _mm_unpacklo_pd(r[0], r[1]);
+						r[1] = _mm_unpackhi_pd(r[0], r[1]);
+						r[0] = t0;
+					}
+				};
+
+			#include "simdKernels.h"
+			}
+			RAPID_SIMD_TARGET_END
+
+			RAPID_SIMD_TARGET_BEGIN("avx2,fma,f16c")
+			namespace avx2
+			{
+				template<typename t>
+				struct Vec;
+
+				template<>
+				struct Vec<float>
+				{
+					using type = __m256;
+					using scalar = float;
+					static constexpr uint64 width = 8;
+
+					static inline type load(const float *p) { return _mm256_loadu_ps(p); }
+					static inline void store(float *p, type x) { _mm256_storeu_ps(p, x); }
+					static inline type set1(float x) { return _mm256_set1_ps(x); }
+					static inline type gather(const float *p, const int64 *index)
+					{
+						const __m128 lo = _mm256_i64gather_ps(p, _mm256_loadu_si256((const __m256i *) index), 4);
+						const __m128 hi = _mm256_i64gather_ps(p, _mm256_loadu_si256((const __m256i *) (index + 4)), 4);
+						return _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+					}
+
+					static inline type add(type x, type y) { return _mm256_add_ps(x, y); }
+					static inline type sub(type x, type y) { return _mm256_sub_ps(x, y); }
+					static inline type mul(type x, type y) { return _mm256_mul_ps(x, y); }
+					static inline type div(type x, type y) { return _mm256_div_ps(x, y); }
+					static inline type min(type x, type y) { return _mm256_min_ps(x, y); }
+					static inline type max(type x, type y) { return _mm256_max_ps(x, y); }
+					static inline type less(type x, type y) { return _mm256_and_ps(_mm256_cmp_ps(x, y, _CMP_LT_OQ), set1(1)); }
+					static inline type greater(type x, type y) { return _mm256_and_ps(_mm256_cmp_ps(x, y, _CMP_GT_OQ), set1(1)); }
+					static inline type neg(type x) { return _mm256_xor_ps(x, set1(-0.0f)); }
+					static inline type abs(type x) { return _mm256_andnot_ps(set1(-0.0f), x); }
+					static inline type fma(type x, type y, type z) { return _mm256_fmadd_ps(x, y, z); }
+
+					static inline type sqrt(type x) { return _mm256_sqrt_ps(x); }
+					static inline type rcp(type x) { const type y = _mm256_rcp_ps(x); return _mm256_mul_ps(y, _mm256_fnmadd_ps(x, y, set1(2))); }
+					static inline type rsqrt(type x)
+					{
+						const type y = _mm256_rsqrt_ps(x);
+						const type res = _mm256_mul_ps(y, _mm256_fnmadd_ps(_mm256_mul_ps(set1(0.5f), x), _mm256_mul_ps(y, y), set1(1.5f)));
+
+						// The estimate is exact for zero and infinity, where the
+						// refinement gives NaN
+						return select(nanMask(res), y, res);
+					}
+					static inline type bitAnd(type x, type y) { return _mm256_and_ps(x, y); }
+					static inline type bitOr(type x, type y) { return _mm256_or_ps(x, y); }
+					static inline type bitXor(type x, type y) { return _mm256_xor_ps(x, y); }
+					template<int n> static inline type shiftLeft(type x) { return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_castps_si256(x), n)); }
+					template<int n> static inline type shiftRight(type x) { return _mm256_castsi256_ps(_mm256_srli_epi32(_mm256_castps_si256(x), n)); }
+
+					using mask = type;
+					static inline mask lessMask(type x, type y) { return _mm256_cmp_ps(x, y, _CMP_LT_OQ); }
+					static inline mask greaterMask(type x, type y) { return _mm256_cmp_ps(x, y, _CMP_GT_OQ); }
+					static inline mask equalMask(type x, type y) { return _mm256_cmp_ps(x, y, _CMP_EQ_OQ); }
+					static inline mask nanMask(type x) { return _mm256_cmp_ps(x, x, _CMP_UNORD_Q); }
+					static inline type select(mask m, type x, type y) { return _mm256_blendv_ps(y, x, m); }
+					static inline bool any(mask m) { return _mm256_movemask_ps(m) != 0; }
+
+					// Move each element "n" lanes up, filling the lowest lanes
+					// from "fill", and copy the highest lane to every lane
+					template<int n> static inline type shiftLanes(type x, type fill)
+					{
+						const type res = _mm256_permutevar8x32_ps(x, _mm256_setr_epi32(-n, 1 - n, 2 - n, 3 - n, 4 - n, 5 - n, 6 - n, 7 - n));
+						return _mm256_blend_ps(res, fill, (1 << n) - 1);
+					}
+					static inline type broadcastLast(type x) { return _mm256_permutevar8x32_ps(x, _mm256_set1_epi32(7)); }
+
+					// Half precision values are widened when loaded and rounded
+					// to nearest even when stored
+					static inline type load(const float16 *p) { return _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) p)); }
+					static inline void store(float16 *p, type x) { _mm_storeu_si128((__m128i *) p, _mm256_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT)); }
+
+					static inline type load(const bfloat16 *p)
+					{
+						return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) p)), 16));
+					}
+
+					static inline void store(bfloat16 *p, type x)
+					{
+						const __m256i bits = _mm256_castps_si256(x);
+						const __m256i odd = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+						__m256i res = _mm256_srli_epi32(_mm256_add_epi32(bits, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7FFF))), 16);
+
+						// Keep NaN quiet rather than rounding it to infinity
+						const __m256i nan = _mm256_or_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(0x40));
+						res = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(res), _mm256_castsi256_ps(nan),
+																   _mm256_cmp_ps(x, x, _CMP_UNORD_Q)));
+
+						res = _mm256_permute4x64_epi64(_mm256_packus_epi32(res, res), 0x08);
+						_mm_storeu_si128((__m128i *) p, _mm256_castsi256_si128(res));
+					}
+
+					static inline void transpose(type *r)
+					{
+						type t[8], u[8];
+
+						for (int i = 0; i < 4; i++)
+						{
+							t[2 * i] = _mm256_unpacklo_ps(r[2 * i], r[2 * i + 1]);
+							t[2 * i + 1] = _mm256_unpackhi_ps(r[2 * i], r[2 * i + 1]);
+						}
+
+						for (int i = 0; i < 2; i++)
+						{
+							u[4 * i + 0] = _mm256_shuffle_ps(t[4 * i], t[4 * i + 2], _MM_SHUFFLE(1, 0, 1, 0));
+							u[4 * i + 1] = _mm256_shuffle_ps(t[4 * i], t[4 * i + 2], _MM_SHUFFLE(3, 2, 3, 2));
+							u[4 * i + 2] = _mm256_shuffle_ps(t[4 * i + 1], t[4 * i + 3], _MM_SHUFFLE(1, 0, 1, 0));
+							u[4 * i + 3] = _mm256_shuffle_ps(t[4 * i + 1], t[4 * i + 3], _MM_SHUFFLE(3, 2, 3, 2));
+						}
+
+						for (int i = 0; i < 4; i++)
+						{
+							r[i] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x20);
+							r[i + 4] = _mm256_permute2f128_ps(u[i], u[i + 4], 0x31);
+						}
+					}
+				};
+
+				template<>
+				struct Vec<double>
+				{
+					using type = __m256d;
+					using scalar = double;
+					static constexpr uint64 width = 4;
+
+					static inline type load(const double *p) { return _mm256_loadu_pd(p); }
+					static inline void store(double *p, type x) { _mm256_storeu_pd(p, x); }
+					static inline type set1(double x) { return _mm256_set1_pd(x); }
+					static inline type gather(const double *p, const int64 *index) { return _mm256_i64gather_pd(p, _mm256_loadu_si256((const __m256i *) index), 8); }
+
+					static inline type add(type x, type y) { return _mm256_add_pd(x, y); }
+					static inline type sub(type x, type y) { return _mm256_sub_pd(x, y); }
+					static inline type mul(type x, type y) { return _mm256_mul_pd(x, y); }
+					static inline type div(type x, type y) { return _mm256_div_pd(x, y); }
+					static inline type min(type x, type y) { return _mm256_min_pd(x, y); }
+					static inline type max(type x, type y) { return _mm256_max_pd(x, y); }
+					static inline type less(type x, type y) { return _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_LT_OQ), set1(1)); }
+					static inline type greater(type x, type y) { return _mm256_and_pd(_mm256_cmp_pd(x, y, _CMP_GT_OQ), set1(1)); }
+					static inline type neg(type x) { return _mm256_xor_pd(x, set1(-0.0)); }
+					static inline type abs(type x) { return _mm256_andnot_pd(set1(-0.0), x); }
+					static inline type fma(type x, type y, type z) { return _mm256_fmadd_pd(x, y, z); }
+
+					static inline type sqrt(type x) { return _mm256_sqrt_pd(x); }
+					static inline type rcp(type x) { return _mm256_div_pd(set1(1), x); }
+					static inline type rsqrt(type x) { return _mm256_div_pd(set1(1), _mm256_sqrt_pd(x)); }
+					static inline type bitAnd(type x, type y) { return _mm256_and_pd(x, y); }
+					static inline type bitOr(type x, type y) { return _mm256_or_pd(x, y); }
+					static inline type bitXor(type x, type y) { return _mm256_xor_pd(x, y); }
+					template<int n> static inline type shiftLeft(type x) { return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(x), n)); }
+					template<int n> static inline type shiftRight(type x) { return _mm256_castsi256_pd(_mm256_srli_epi64(_mm256_castpd_si256(x), n)); }
+
+					using mask = type;
+					static inline mask lessMask(type x, type y) { return _mm256_cmp_pd(x, y, _CMP_LT_OQ); }
+					static inline mask greaterMask(type x, type y) { return _mm256_cmp_pd(x, y, _CMP_GT_OQ); }
+					static inline mask equalMask(type x, type y) { return _mm256_cmp_pd(x, y, _CMP_EQ_OQ); }
+					static inline mask nanMask(type x) { return _mm256_cmp_pd(x, x, _CMP_UNORD_Q); }
+					static inline type select(mask m, type x, type y) { return _mm256_blendv_pd(y, x, m); }
+					static inline bool any(mask m) { return _mm256_movemask_pd(m) != 0; }
+
+					// Move each element "n" lanes up, filling the lowest lanes
+					// from "fill", and copy the highest lane to every lane
+					template<int n> static inline type shiftLanes(type x, type fill)
+					{
+						const type res = _mm256_permute4x64_pd(x, ((-n) & 3) | (((1 - n) & 3) << 2) | (((2 - n) & 3) << 4) | (((3 - n) & 3) << 6));
+						return _mm256_blend_pd(res, fill, (1 << n) - 1);
+					}
+					static inline type broadcastLast(type x) { return _mm256_permute4x64_pd(x, 0xFF); }
+
+					static inline void transpose(type *r)
+					{
+						const type t0 = _mm256_unpacklo_pd(r[0], r[1]), t1 = _mm256_unpackhi_pd(r[0], r[1]);
+						const type t2 = _mm256_unpacklo_pd(r[2], r[3]), t3 = _mm256_unpackhi_pd(r[2], r[3]);
+						r[0] = _mm256_permute2f128_pd(t0, t2, 0x20);
+						r[1] = _mm256_permute2f128_pd(t1, t3, 0x20);
+						r[2] = _mm256_permute2f128_pd(t0, t2, 0x31);
+						r[3] = _mm256_permute2f128_pd(t1, t3, 0x31);
+					}
+				};
+
+			#include "simdKernels.h"
+			}
+			RAPID_SIMD_TARGET_END
+
+			RAPID_SIMD_TARGET_BEGIN("avx512f")
+			// GCC's unmasked AVX-512 intrinsics start from an undefined
+			// register, which it reports as possibly uninitialized once
+			// they are inlined
+			#if defined(__GNUC__) && !defined(__clang__)
+			#pragma GCC diagnostic push
+			#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+			#endif
+			namespace avx512
+			{
+				template<typename t>
+				struct Vec;
+
+				// AVX-512F has no floating point bitwise operations, so the
+				// sign bit is manipulated through the integer registers
+
+				template<>
+				struct Vec<float>
+				{
+					using type = __m512;
+					using scalar = float;
+					static constexpr uint64 width = 16;
+
+					static inline type load(const float *p) { return _mm512_loadu_ps(p); }
+					static inline void store(float *p, type x) { _mm512_storeu_ps(p, x); }
+					static inline type set1(float x) { return _mm512_set1_ps(x); }
+					static inline type gather(const float *p, const int64 *index)
+					{
+						const __m256 lo = _mm512_i64gather_ps(_mm512_loadu_si512(index), p, 4);
+						const __m256 hi = _mm512_i64gather_ps(_mm512_loadu_si512(index + 8), p, 4);
+						return _mm512_castpd_ps(_mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(lo)), _mm256_castps_pd(hi), 1));
+					}
+
+					static inline type add(type x, type y) { return _mm512_add_ps(x, y); }
+					static inline type sub(type x, type y) { return _mm512_sub_ps(x, y); }
+					static inline type mul(type x, type y) { return _mm512_mul_ps(x, y); }
+					static inline type div(type x, type y) { return _mm512_div_ps(x, y); }
+					static inline type min(type x, type y) { return _mm512_min_ps(x, y); }
+					static inline type max(type x, type y) { return _mm512_max_ps(x, y); }
+					static inline type less(type x, type y) { return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(x, y, _CMP_LT_OQ), set1(1)); }
+					static inline type greater(type x, type y) { return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(x, y, _CMP_GT_OQ), set1(1)); }
+					static inline type neg(type x) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(x), _mm512_set1_epi32(INT32_MIN))); }
+					static inline type abs(type x) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(x), _mm512_set1_epi32(INT32_MAX))); }
+					static inline type fma(type x, type y, type z) { return _mm512_fmadd_ps(x, y, z); }
+
+					static inline type sqrt(type x) { return _mm512_sqrt_ps(x); }
+					static inline type rcp(type x) { const type y = _mm512_rcp14_ps(x); return _mm512_mul_ps(y, _mm512_fnmadd_ps(x, y, set1(2))); }
+					static inline type rsqrt(type x)
+					{
+						const type y = _mm512_rsqrt14_ps(x);
+						const type res = _mm512_mul_ps(y, _mm512_fnmadd_ps(_mm512_mul_ps(set1(0.5f), x), _mm512_mul_ps(y, y), set1(1.5f)));
+
+						// The estimate is exact for zero and infinity, where the
+						// refinement gives NaN
+						return select(nanMask(res), y, res);
+					}
+					static inline type bitAnd(type x, type y) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(x), _mm512_castps_si512(y))); }
+					static inline type bitOr(type x, type y) { return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(x), _mm512_castps_si512(y))); }
+					static inline type bitXor(type x, type y) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(x), _mm512_castps_si512(y))); }
+					template<int n> static inline type shiftLeft(type x) { return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_castps_si512(x), n)); }
+					template<int n> static inline type shiftRight(type x) { return _mm512_castsi512_ps(_mm512_srli_epi32(_mm512_castps_si512(x), n)); }
+
+					using mask = __mmask16;
+					static inline mask lessMask(type x, type y) { return _mm512_cmp_ps_mask(x, y, _CMP_LT_OQ); }
+					static inline mask greaterMask(type x, type y) { return _mm512_cmp_ps_mask(x, y, _CMP_GT_OQ); }
+					static inline mask equalMask(type x, type y) { return _mm512_cmp_ps_mask(x, y, _CMP_EQ_OQ); }
+					static inline mask nanMask(type x) { return _mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q); }
+					static inline type select(mask m, type x, type y) { return _mm512_mask_blend_ps(m, y, x); }
+					static inline bool any(mask m) { return m != 0; }
+
+					// Move each element "n" lanes up, filling the lowest lanes
+					// from "fill", and copy the highest lane to every lane
+					template<int n> static inline type shiftLanes(type x, type fill)
+					{
+						const __m512i index = _mm512_sub_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32(n));
+						return _mm512_mask_mov_ps(_mm512_permutexvar_ps(index, x), (__mmask16) ((1 << n) - 1), fill);
+					}
+					static inline type broadcastLast(type x) { return _mm512_permutexvar_ps(_mm512_set1_epi32(15), x); }
+
+					static inline type load(const float16 *p) { return _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *) p)); }
+					static inline void store(float16 *p, type x) { _mm256_storeu_si256((__m256i *) p, _mm512_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT)); }
+
+					static inline type load(const bfloat16 *p)
+					{
+						return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) p)), 16));
+					}
+
+					static inline void store(bfloat16 *p, type x)
+					{
+						const __m512i bits = _mm512_castps_si512(x);
+						const __m512i odd = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+						__m512i res = _mm512_srli_epi32(_mm512_add_epi32(bits, _mm512_add_epi32(odd, _mm512_set1_epi32(0x7FFF))), 16);
+
+						const __m512i nan = _mm512_or_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(0x40));
+						res = _mm512_mask_mov_epi32(res, _mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q), nan);
+
+						_mm256_storeu_si256((__m256i *) p, _mm512_cvtepi32_epi16(res));
+					}
+				};
+
+				template<>
+				struct Vec<double>
+				{
+					using type = __m512d;
+					using scalar = double;
+					static constexpr uint64 width = 8;
+
+					static inline type load(const double *p) { return _mm512_loadu_pd(p); }
+					static inline void store(double *p, type x) { _mm512_storeu_pd(p, x); }
+					static inline type set1(double x) { return _mm512_set1_pd(x); }
+					static inline type gather(const double *p, const int64 *index) { return _mm512_i64gather_pd(_mm512_loadu_si512(index), p, 8); }
+
+					static inline type add(type x, type y) { return _mm512_add_pd(x, y); }
+					static inline type sub(type x, type y) { return _mm512_sub_pd(x, y); }
+					static inline type mul(type x, type y) { return _mm512_mul_pd(x, y); }
+					static inline type div(type x, type y) { return _mm512_div_pd(x, y); }
+					static inline type min(type x, type y) { return _mm512_min_pd(x, y); }
+					static inline type max(type x, type y) { return _mm512_max_pd(x, y); }
+					static inline type less(type x, type y) { return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(x, y, _CMP_LT_OQ), set1(1)); }
+					static inline type greater(type x, type y) { return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(x, y, _CMP_GT_OQ), set1(1)); }
+					static inline type neg(type x) { return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(x), _mm512_set1_epi64(INT64_MIN))); }
+					static inline type abs(type x) { return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(x), _mm512_set1_epi64(INT64_MAX))); }
+					static inline type fma(type x, type y, type z) { return _mm512_fmadd_pd(x, y, z); }
+
+					static inline type sqrt(type x) { return _mm512_sqrt_pd(x); }
+					static inline type rcp(type x) { return _mm512_div_pd(set1(1), x); }
+					static inline type rsqrt(type x) { return _mm512_div_pd(set1(1), _mm512_sqrt_pd(x)); }
+					static inline type bitAnd(type x, type y) { return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(x), _mm512_castpd_si512(y))); }
+					static inline type bitOr(type x, type y) { return _mm512_castsi512_pd(_mm512_or_si512(_mm512_castpd_si512(x), _mm512_castpd_si512(y))); }
+					static inline type bitXor(type x, type y) { return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(x), _mm512_castpd_si512(y))); }
+					template<int n> static inline type shiftLeft(type x) { return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_castpd_si512(x), n)); }
+					template<int n> static inline type shiftRight(type x) { return _mm512_castsi512_pd(_mm512_srli_epi64(_mm512_castpd_si512(x), n)); }
+
+					using mask = __mmask8;
+					static inline mask lessMask(type x, type y) { return _mm512_cmp_pd_mask(x, y, _CMP_LT_OQ); }
+					static inline mask greaterMask(type x, type y) { return _mm512_cmp_pd_mask(x, y, _CMP_GT_OQ); }
+					static inline mask equalMask(type x, type y) { return _mm512_cmp_pd_mask(x, y, _CMP_EQ_OQ); }
+					static inline mask nanMask(type x) { return _mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q); }
+					static inline type select(mask m, type x, type y) { return _mm512_mask_blend_pd(m, y, x); }
+					static inline bool any(mask m) { return m != 0; }
+
+					// Move each element "n" lanes up, filling the lowest lanes
+					// from "fill", and copy the highest lane to every lane
+					template<int n> static inline type shiftLanes(type x, type fill)
+					{
+						const __m512i index = _mm512_sub_epi64(_mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7), _mm512_set1_epi64(n));
+						return _mm512_mask_mov_pd(_mm512_permutexvar_pd(index, x), (__mmask8) ((1 << n) - 1), fill);
+					}
+					static inline type broadcastLast(type x) { return _mm512_permutexvar_pd(_mm512_set1_epi64(7), x); }
+				};
+
+			#include "simdKernels.h"
+			}
+			#if defined(__GNUC__) && !defined(__clang__)
+			#pragma GCC diagnostic pop
+			#endif
+			RAPID_SIMD_TARGET_END
+
+		#ifdef RAPID_SIMD_BF16
+			RAPID_SIMD_TARGET_BEGIN("avx512f,avx512bf16")
+			namespace avx512bf16
+			{
+				inline void convert(const float *src, bfloat16 *dst, uint64 len)
+				{
+					uint64 i = 0;
+					for (; i + 16 <= len; i += 16)
+						_mm256_storeu_si256((__m256i *) (dst + i), (__m256i) _mm512_cvtneps_pbh(_mm512_loadu_ps(src + i)));
+
+					for (; i < len; i++)
+						dst[i] = src[i];
+				}
+			}
+			RAPID_SIMD_TARGET_END
+		#endif
+		#endif
+
+			/// <summary>
+			/// A matrix product micro-kernel, which multiplies a packed panel
+			/// of "rows" rows of A by a packed panel of "cols" columns of B,
+			/// over "depth" steps, and stores (or, if "accumulate" is set,
+			/// adds) the result in a tile of C with rows "ldc" elements apart.
+			/// The A panel holds "rows" elements for each step and the B
+			/// panel holds "cols" elements for each step
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			template<typename t>
+			struct GemmKernel
+			{
+				using Func = void (*)(uint64 depth, const t *a, const t *b, t *c, uint64 ldc, bool accumulate);
+
+				uint64 rows;
+				uint64 cols;
+				Func func;
+			};
+
+			namespace imp
+			{
+				template<typename Op, typename t>
+				inline void binary(const t *lhs, bool lhsStep, const t *rhs, bool rhsStep, t *out, uint64 len, std::false_type)
+				{
+					scalar::binary<Op>(lhs, lhsStep, rhs, rhsStep, out, len);
+				}
+
+				template<typename Op, typename t>
+				inline void binary(const t *lhs, bool lhsStep, const t *rhs, bool rhsStep, t *out, uint64 len, std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					switch (level())
+					{
+						case Level::AVX512:
+							avx512::binary<Op>(lhs, lhsStep, rhs, rhsStep, out, len);
+							return;
+						case Level::AVX2:
+							avx2::binary<Op>(lhs, lhsStep, rhs, rhsStep, out, len);
+							return;
+						case Level::SSE2:
+							sse2::binary<Op>(lhs, lhsStep, rhs, rhsStep, out, len);
+							return;
+						default:
+							break;
+					}
+				#endif
+
+					scalar::binary<Op>(lhs, lhsStep, rhs, rhsStep, out, len);
+				}
+
+				template<typename Op, typename t>
+				inline void unary(const t *src, t *out, uint64 len, std::false_type)
+				{
+					scalar::unary<Op>(src, out, len);
+				}
+
+				template<typename Op, typename t>
+				inline void unary(const t *src, t *out, uint64 len, std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					switch (level())
+					{
+						case Level::AVX512:
+							avx512::unary<Op>(src, out, len);
+							return;
+						case Level::AVX2:
+							avx2::unary<Op>(src, out, len);
+							return;
+						case Level::SSE2:
+							sse2::unary<Op>(src, out, len);
+							return;
+						default:
+							break;
+					}
+				#endif
+
+					scalar::unary<Op>(src, out, len);
+				}
+
+				template<typename Op, typename t>
+				inline t reduce(const t *src, uint64 len, t init, bool /*deterministic*/, std::false_type)
+				{
+					return scalar::reduce<Op>(src, len, init);
+				}
+
+				template<typename Op, typename t>
+				inline t reduce(const t *src, uint64 len, t init, bool deterministic, std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					switch (level())
+					{
+						case Level::AVX512:
+							return avx512::reduce<Op>(src, len, init, deterministic);
+						case Level::AVX2:
+							return avx2::reduce<Op>(src, len, init, deterministic);
+						case Level::SSE2:
+							return sse2::reduce<Op>(src, len, init, deterministic);
+						default:
+							break;
+					}
+				#endif
+
+					return scalar::reduce<Op>(src, len, init);
+				}
+
+				template<typename t>
+				inline t kahan(const t *src, uint64 len, bool /*deterministic*/, std::false_type)
+				{
+					return scalar::kahan(src, len);
+				}
+
+				template<typename t>
+				inline t kahan(const t *src, uint64 len, bool deterministic, std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					switch (level())
+					{
+						case Level::AVX512:
+							return avx512::kahan(src, len, deterministic);
+						case Level::AVX2:
+							return avx2::kahan(src, len, deterministic);
+						case Level::SSE2:
+							return sse2::kahan(src, len, deterministic);
+						default:
+							break;
+					}
+				#endif
+
+					return scalar::kahan(src, len);
+				}
+
+				template<typename t>
+				inline typename accumulator<t>::type dot(const t *a, const t *b, uint64 len, std::false_type)
+				{
+					return scalar::dot(a, b, len);
+				}
+
+				template<typename t>
+				inline t dot(const t *a, const t *b, uint64 len, std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					switch (level())
+					{
+						case Level::AVX512:
+							return avx512::dot(a, b, len);
+						case Level::AVX2:
+							return avx2::dot(a, b, len);
+						case Level::SSE2:
+							return sse2::dot(a, b, len);
+						default:
+							break;
+					}
+				#endif
+
+					return scalar::dot(a, b, len);
+				}
+
+				template<typename t>
+				inline void axpy(t alpha, const t *x, t *y, uint64 len, std::false_type)
+				{
+					scalar::axpy(alpha, x, y, len);
+				}
+
+				template<typename t>
+				inline void axpy(t alpha, const t *x, t *y, uint64 len, std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					switch (level())
+					{
+						case Level::AVX512:
+							avx512::axpy(alpha, x, y, len);
+							return;
+						case Level::AVX2:
+							avx2::axpy(alpha, x, y, len);
+							return;
+						case Level::SSE2:
+							sse2::axpy(alpha, x, y, len);
+							return;
+						default:
+							break;
+					}
+				#endif
+
+					scalar::axpy(alpha, x, y, len);
+				}
+
+				template<typename t>
+				inline void gather(const t *src, const int64 *index, t *dst, uint64 len, std::false_type)
+				{
+					scalar::gather(src, index, dst, len);
+				}
+
+				template<typename t>
+				inline void gather(const t *src, const int64 *index, t *dst, uint64 len, std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					// SSE2 has no gather instructions
+					switch (level())
+					{
+						case Level::AVX512:
+							avx512::gather(src, index, dst, len);
+							return;
+						case Level::AVX2:
+							avx2::gather(src, index, dst, len);
+							return;
+						default:
+							break;
+					}
+				#endif
+
+					scalar::gather(src, index, dst, len);
+				}
+
+				template<typename Op, typename t>
+				inline void scan(const t *src, t *out, uint64 len, t identity, std::false_type)
+				{
+					scalar::scan<Op>(src, out, len, identity);
+				}
+
+				template<typename Op, typename t>
+				inline void scan(const t *src, t *out, uint64 len, t identity, std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					switch (level())
+					{
+						case Level::AVX512:
+							avx512::scan<Op>(src, out, len, identity);
+							return;
+						case Level::AVX2:
+							avx2::scan<Op>(src, out, len, identity);
+							return;
+						case Level::SSE2:
+							sse2::scan<Op>(src, out, len, identity);
+							return;
+						default:
+							break;
+					}
+				#endif
+
+					scalar::scan<Op>(src, out, len, identity);
+				}
+
+				inline bool hasBF16()
+				{
+					static const bool res = detectBF16();
+					return res;
+				}
+
+				template<typename s, typename d>
+				inline void convert(const s *src, d *dst, uint64 len, std::false_type)
+				{
+					scalar::convert(src, dst, len);
+				}
+
+			#ifdef RAPID_SIMD
+				template<typename s, typename d>
+				inline void convertAVX512(const s *src, d *dst, uint64 len)
+				{
+					avx512::convert(src, dst, len);
+				}
+
+				inline void convertAVX512(const float *src, bfloat16 *dst, uint64 len)
+				{
+				#ifdef RAPID_SIMD_BF16
+					if (hasBF16())
+					{
+						avx512bf16::convert(src, dst, len);
+						return;
+					}
+				#endif
+
+					avx512::convert(src, dst, len);
+				}
+			#endif
+
+				template<typename s, typename d>
+				inline void convert(const s *src, d *dst, uint64 len, std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					// Half precision needs F16C, so SSE2 uses the scalar conversion
+					switch (level())
+					{
+						case Level::AVX512:
+							convertAVX512(src, dst, len);
+							return;
+						case Level::AVX2:
+							avx2::convert(src, dst, len);
+							return;
+						default:
+							break;
+					}
+				#endif
+
+					scalar::convert(src, dst, len);
+				}
+
+				template<typename t>
+				inline GemmKernel<t> gemmKernel(std::false_type)
+				{
+					return {scalar::gemmRows, scalar::gemmCols, scalar::gemmKernel<t>};
+				}
+
+				template<typename t>
+				inline GemmKernel<t> gemmKernel(std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					switch (level())
+					{
+						case Level::AVX512:
+							return {avx512::gemmRows, 2 * avx512::Vec<t>::width, avx512::gemmKernel<t>};
+						case Level::AVX2:
+							return {avx2::gemmRows, 2 * avx2::Vec<t>::width, avx2::gemmKernel<t>};
+						case Level::SSE2:
+							return {sse2::gemmRows, 2 * sse2::Vec<t>::width, sse2::gemmKernel<t>};
+						default:
+							break;
+					}
+				#endif
+
+					return gemmKernel<t>(std::false_type());
+				}
+
+				template<typename t>
+				inline void transposeBlock(const t *src, uint64 srcStride, t *dst, uint64 dstStride,
+										   uint64 rows, uint64 cols, std::false_type)
+				{
+					scalar::transposeBlock(src, srcStride, dst, dstStride, rows, cols);
+				}
+
+				template<typename t>
+				inline void transposeBlock(const t *src, uint64 srcStride, t *dst, uint64 dstStride,
+										   uint64 rows, uint64 cols, std::true_type)
+				{
+				#ifdef RAPID_SIMD
+					// AVX-512 has no faster way to transpose in registers
+					switch (level())
+					{
+						case Level::AVX512:
+						case Level::AVX2:
+							avx2::transposeBlock(src, srcStride, dst, dstStride, rows, cols);
+							return;
+						case Level::SSE2:
+							sse2::transposeBlock(src, srcStride, dst, dstStride, rows, cols);
+							return;
+						default:
+							break;
+					}
+				#endif
+
+					scalar::transposeBlock(src, srcStride, dst, dstStride, rows, cols);
+				}
+			}
+
+			/// <summary>
+			/// Apply a binary operation to "len" elements. An operand with
+			/// "step" set to false is a single value that is used for every
+			/// element. At least one operand must have "step" set. The
+			/// widest available instruction set is used, falling back to a
+			/// scalar loop for other operations and types. "out" may be
+			/// the same as either operand
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="lhs"></param>
+			/// <param name="lhsStep"></param>
+			/// <param name="rhs"></param>
+			/// <param name="rhsStep"></param>
+			/// <param name="out"></param>
+			/// <param name="len"></param>
+			template<typename Op, typename t>
+			inline void binary(const t *lhs, bool lhsStep, const t *rhs, bool rhsStep, t *out, uint64 len)
+			{
+				imp::binary<Op>(lhs, lhsStep, rhs, rhsStep, out, len, vectorizable<Op, t>());
+			}
+
+			/// <summary>
+			/// Apply a unary operation to "len" elements, in the same way
+			/// as simd::binary. "out" may be the same as "src"
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="out"></param>
+			/// <param name="len"></param>
+			template<typename Op, typename t>
+			inline void unary(const t *src, t *out, uint64 len)
+			{
+				imp::unary<Op>(src, out, len, vectorizable<Op, t>());
+			}
+
+			/// <summary>
+			/// Reduce "len" elements with a binary operation, starting every
+			/// accumulator at "init", which must be the identity of the
+			/// operation. The accumulators are always combined in the same
+			/// order, so the result depends only on the input and, unless
+			/// "deterministic" is set, on the instruction set
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="len"></param>
+			/// <param name="init"></param>
+			/// <param name="deterministic"></param>
+			/// <returns></returns>
+			template<typename Op, typename t>
+			inline t reduce(const t *src, uint64 len, t init, bool deterministic)
+			{
+				return imp::reduce<Op>(src, len, init, deterministic, vectorizable<Op, t>());
+			}
+
+			/// <summary>
+			/// Sum "len" floating point elements with Kahan (compensated)
+			/// summation, in the same way as simd::reduce
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="len"></param>
+			/// <param name="deterministic"></param>
+			/// <returns></returns>
+			template<typename t>
+			inline t kahan(const t *src, uint64 len, bool deterministic)
+			{
+				return imp::kahan(src, len, deterministic, isVectorType<t>());
+			}
+
+			/// <summary>
+			/// Return the sum of the products of "len" pairs of contiguous
+			/// elements. The order of the additions depends on the
+			/// instruction set. Half precision products are summed in
+			/// single precision
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="a"></param>
+			/// <param name="b"></param>
+			/// <param name="len"></param>
+			/// <returns></returns>
+			template<typename t>
+			inline typename accumulator<t>::type dot(const t *a, const t *b, uint64 len)
+			{
+				return imp::dot(a, b, len, isVectorType<t>());
+			}
+
+			/// <summary>
+			/// Add "alpha" times each of "len" contiguous elements of "x" to
+			/// the corresponding element of "y"
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="alpha"></param>
+			/// <param name="x"></param>
+			/// <param name="y"></param>
+			/// <param name="len"></param>
+			template<typename t>
+			inline void axpy(t alpha, const t *x, t *y, uint64 len)
+			{
+				imp::axpy(alpha, x, y, len, isVectorType<t>());
+			}
+
+			/// <summary>
+			/// Copy "len" elements of "src" into contiguous memory, so that
+			/// dst[i] = src[index[i]]. Single and double precision values are
+			/// loaded with gather instructions where the processor has them
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="index"></param>
+			/// <param name="dst"></param>
+			/// <param name="len"></param>
+			template<typename t>
+			inline void gather(const t *src, const int64 *index, t *dst, uint64 len)
+			{
+				imp::gather(src, index, dst, len, isVectorType<t>());
+			}
+
+			/// <summary>
+			/// Store the inclusive prefix of "len" contiguous elements under
+			/// a binary operation, so that out[i] = src[0] op ... op src[i].
+			/// "identity" must be the identity of the operation. Each vector
+			/// is scanned in registers, in log2(width) shift and combine
+			/// steps, and then combined with the last element of the
+			/// previous vector, so sums are associated differently to a
+			/// sequential loop. "out" may be the same as "src"
+			/// </summary>
+			/// <typeparam name="Op"></typeparam>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="out"></param>
+			/// <param name="len"></param>
+			/// <param name="identity"></param>
+			template<typename Op, typename t>
+			inline void scan(const t *src, t *out, uint64 len, t identity)
+			{
+				imp::scan<Op>(src, out, len, identity, vectorizable<Op, t>());
+			}
+
+			/// <summary>
+			/// Ask the processor to start loading the cache line containing
+			/// "p", which will be read soon. This has no effect without SIMD
+			/// </summary>
+			/// <param name="p"></param>
+			inline void prefetch(const void *p)
+			{
+			#ifdef RAPID_SIMD
+				_mm_prefetch((const char *) p, _MM_HINT_T0);
+			#endif
+			}
+
+			/// <summary>
+			/// Pairs of types with vectorized conversions, which are half
+			/// precision types to and from single precision
+			/// </summary>
+			/// <typeparam name="s"></typeparam>
+			/// <typeparam name="d"></typeparam>
+			template<typename s, typename d>
+			struct isVectorConversion : std::integral_constant<bool, isVectorType<float>::value &&
+				((isHalf<s>::value && std::is_same<d, float>::value) || (std::is_same<s, float>::value && isHalf<d>::value))>
+			{};
+
+			/// <summary>
+			/// Convert "len" contiguous elements of one type to another.
+			/// Half precision values are converted to and from single
+			/// precision with F16C or AVX-512 instructions, and rounded to
+			/// nearest even. Values of the same type are copied, and other
+			/// types are converted one element at a time
+			/// </summary>
+			/// <typeparam name="s"></typeparam>
+			/// <typeparam name="d"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="dst"></param>
+			/// <param name="len"></param>
+			template<typename s, typename d>
+			inline void convert(const s *src, d *dst, uint64 len)
+			{
+				imp::convert(src, dst, len, isVectorConversion<s, d>());
+			}
+
+			template<typename t>
+			inline void convert(const t *src, t *dst, uint64 len)
+			{
+				std::copy(src, src + len, dst);
+			}
+
+			/// <summary>
+			/// Types whose tiles can be transposed in registers. Only the bits
+			/// of each element are moved, so any 4 or 8 byte arithmetic type
+			/// is handled as a float or a double
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			template<typename t>
+			struct isTransposable : std::integral_constant<bool, isVectorType<float>::value &&
+				std::is_arithmetic<t>::value && (sizeof(t) == 4 || sizeof(t) == 8)>
+			{};
+
+			/// <summary>
+			/// Transpose a block of "rows" by "cols" elements, where each row
+			/// of "src" and each row of "dst" is contiguous, so that
+			/// dst[j * dstStride + i] = src[i * srcStride + j]. The block
+			/// is transposed in square tiles held in vector registers
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="srcStride"></param>
+			/// <param name="dst"></param>
+			/// <param name="dstStride"></param>
+			/// <param name="rows"></param>
+			/// <param name="cols"></param>
+			template<typename t>
+			inline void transposeBlock(const t *src, uint64 srcStride, t *dst, uint64 dstStride, uint64 rows, uint64 cols)
+			{
+				imp::transposeBlock(src, srcStride, dst, dstStride, rows, cols, isTransposable<t>());
+			}
+
+			/// <summary>
+			/// Return the matrix product micro-kernel for the widest available
+			/// instruction set. Types without vectorized kernels use a scalar
+			/// kernel, which works for any arithmetic type
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <returns></returns>
+			template<typename t>
+			inline GemmKernel<t> gemmKernel()
+			{
+				return imp::gemmKernel<t>(isVectorType<t>());
+			}
+		}
+	}
+}
@@ -0,0 +1,925 @@
+// Elementwise kernels written in terms of a vector type "Vec". This file
+// has no include guard, as it is included by simd.h inside the namespace
+// of every instruction set, so the same kernels are compiled for each one
+
+template<typename Op>
+struct Apply;
+
+template<>
+struct Apply<expr::Add>
+{
+	template<typename V> static inline typename V::type binary(typename V::type x, typename V::type y) { return V::add(x, y); }
+};
+
+template<>
+struct Apply<expr::Sub>
+{
+	template<typename V> static inline typename V::type binary(typename V::type x, typename V::type y) { return V::sub(x, y); }
+};
+
+template<>
+struct Apply<expr::Mul>
+{
+	template<typename V> static inline typename V::type binary(typename V::type x, typename V::type y) { return V::mul(x, y); }
+};
+
+template<>
+struct Apply<expr::Div>
+{
+	template<typename V> static inline typename V::type binary(typename V::type x, typename V::type y) { return V::div(x, y); }
+};
+
+template<>
+struct Apply<expr::Minimum>
+{
+	template<typename V> static inline typename V::type binary(typename V::type x, typename V::type y) { return V::min(x, y); }
+};
+
+template<>
+struct Apply<expr::Maximum>
+{
+	template<typename V> static inline typename V::type binary(typename V::type x, typename V::type y) { return V::max(x, y); }
+};
+
+template<>
+struct Apply<expr::Less>
+{
+	template<typename V> static inline typename V::type binary(typename V::type x, typename V::type y) { return V::less(x, y); }
+};
+
+template<>
+struct Apply<expr::Greater>
+{
+	template<typename V> static inline typename V::type binary(typename V::type x, typename V::type y) { return V::greater(x, y); }
+};
+
+template<>
+struct Apply<expr::Negate>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x) { return V::neg(x); }
+};
+
+template<>
+struct Apply<expr::Abs>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x) { return V::abs(x); }
+};
+
+template<>
+struct Apply<expr::Square>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x) { return V::mul(x, x); }
+};
+
+// Polynomial approximations of the elementary functions, based on the
+// Cephes library. Each argument is reduced to a small interval, where
+// a polynomial is accurate. Integers are rounded and manipulated as
+// floating point values: adding 1.5 * 2^(mantissa bits) leaves the
+// nearest integer in the low bits of the mantissa, where it can be
+// shifted into the exponent.
+//
+// Errors are upper bounds, measured against a long double reference
+// over 10^7 arguments spread over the whole domain of each function, at
+// every instruction set. tests/Array Checks/elementaryAccuracy.cpp
+// repeats the sweep and checks the table:
+//
+//                  PRECISE float   FAST float   double
+//     exp              2 ulp          3 ulp      2 ulp
+//     log              1 ulp         26 ulp      1 ulp
+//     sin, cos         3 ulp         27 ulp      2 ulp
+//     tanh             2 ulp         52 ulp      2 ulp
+//     sigmoid          3 ulp          6 ulp      3 ulp
+//     rsqrt            2 ulp          4 ulp      2 ulp
+//
+// Double precision has no separate fast kernels, except for pow.
+// Subnormal arguments to log and rsqrt are only handled by the PRECISE
+// kernels
+template<typename V, typename s = typename V::scalar>
+struct Elementary;
+
+template<typename V>
+struct Elementary<V, float>
+{
+	using type = typename V::type;
+
+	static constexpr float magic = 12582912.0f;
+
+	// Arguments to sin and cos larger than this are reduced with the
+	// standard library instead
+	static constexpr float trigLimit = 8192.0f;
+
+	static inline type round(type x)
+	{
+		return V::sub(V::add(x, V::set1(magic)), V::set1(magic));
+	}
+
+	// 2^n, for an integer n from -126 to 127
+	static inline type pow2(type n)
+	{
+		return V::template shiftLeft<23>(V::add(n, V::set1(magic + 127)));
+	}
+
+	static inline type exp(type x, bool fast)
+	{
+		// The result overflows above 88.7 and underflows below -103.9, so
+		// clamping the argument just outside that range does not change
+		// the result. NaN is kept, as the second operand of min and max
+		x = V::min(V::set1(89.0f), V::max(V::set1(-104.0f), x));
+
+		// x = n * log(2) + r, where |r| <= log(2) / 2
+		const type n = round(V::mul(x, V::set1(1.44269504088896341f)));
+		type r = V::fma(n, V::set1(-0.693359375f), x);
+		r = V::fma(n, V::set1(2.12194440e-4f), r);
+		type p;
+
+		if (fast)
+		{
+			p = V::fma(V::set1(8.3125269691e-3f), r, V::set1(4.1890116253e-2f));
+			p = V::fma(p, r, V::set1(1.6667114452e-1f));
+			p = V::fma(p, r, V::set1(4.9999231762e-1f));
+		}
+		else
+		{
+			p = V::fma(V::set1(1.9875691500e-4f), r, V::set1(1.3981999507e-3f));
+			p = V::fma(p, r, V::set1(8.3334519073e-3f));
+			p = V::fma(p, r, V::set1(4.1665795894e-2f));
+			p = V::fma(p, r, V::set1(1.6666665459e-1f));
+			p = V::fma(p, r, V::set1(5.0000001201e-1f));
+		}
+
+		p = V::fma(V::mul(p, r), r, V::add(r, V::set1(1)));
+
+		// 2^n is applied in two steps, so both factors are normal numbers
+		// even when the result overflows or is subnormal
+		const type half = round(V::mul(n, V::set1(0.5f)));
+		return V::mul(V::mul(p, pow2(half)), pow2(V::sub(n, half)));
+	}
+
+	static inline type log(type x, bool fast)
+	{
+		type m = x;
+		type e = V::set1(0);
+
+		if (!fast)
+		{
+			const auto subnormal = V::lessMask(x, V::set1(std::numeric_limits<float>::min()));
+			m = V::select(subnormal, V::mul(x, V::set1(8388608.0f)), x);
+			e = V::select(subnormal, V::set1(-23.0f), e);
+		}
+
+		// x = m * 2^e, where 0.5 <= m < 1
+		const type field = V::template shiftRight<23>(V::bitAnd(m, V::set1(std::numeric_limits<float>::infinity())));
+		e = V::add(e, V::sub(V::bitOr(field, V::set1(8388608.0f)), V::set1(8388608.0f + 126)));
+		m = V::bitOr(V::bitAnd(m, V::set1(imp::fromBits<float>(0x007FFFFFu))), V::set1(0.5f));
+
+		// Reduce m to [sqrt(0.5), sqrt(2)), and calculate log(1 + m)
+		const auto low = V::lessMask(m, V::set1(0.707106781186547524f));
+		e = V::select(low, V::sub(e, V::set1(1)), e);
+		m = V::sub(V::select(low, V::add(m, m), m), V::set1(1));
+
+		const type z = V::mul(m, m);
+		type p;
+
+		if (fast)
+		{
+			p = V::fma(V::set1(1.1781789094e-1f), m, V::set1(-1.8407180672e-1f));
+			p = V::fma(p, m, V::set1(2.0442207051e-1f));
+			p = V::fma(p, m, V::set1(-2.4943833155e-1f));
+			p = V::fma(p, m, V::set1(3.3320860132e-1f));
+		}
+		else
+		{
+			p = V::fma(V::set1(7.0376836292e-2f), m, V::set1(-1.1514610310e-1f));
+			p = V::fma(p, m, V::set1(1.1676998740e-1f));
+			p = V::fma(p, m, V::set1(-1.2420140846e-1f));
+			p = V::fma(p, m, V::set1(1.4249322787e-1f));
+			p = V::fma(p, m, V::set1(-1.6668057665e-1f));
+			p = V::fma(p, m, V::set1(2.0000714765e-1f));
+			p = V::fma(p, m, V::set1(-2.4999993993e-1f));
+			p = V::fma(p, m, V::set1(3.3333331174e-1f));
+		}
+
+		type y = V::mul(V::mul(p, m), z);
+		y = V::fma(e, V::set1(-2.12194440e-4f), y);
+		y = V::fma(z, V::set1(-0.5f), y);
+		type res = V::fma(e, V::set1(0.693359375f), V::add(m, y));
+
+		res = V::select(V::equalMask(x, V::set1(std::numeric_limits<float>::infinity())), x, res);
+		res = V::select(V::equalMask(x, V::set1(0)), V::set1(-std::numeric_limits<float>::infinity()), res);
+		res = V::select(V::lessMask(x, V::set1(0)), V::set1(std::numeric_limits<float>::quiet_NaN()), res);
+		return V::select(V::nanMask(x), x, res);
+	}
+
+	// sin(x + q * pi / 2), calculated from sin and cos of the reduced
+	// argument in the right quadrant
+	static inline type sinQuadrant(type x, type offset, bool fast)
+	{
+		type q = round(V::mul(x, V::set1(0.636619772367581343f)));
+
+		// pi / 2 is split into parts of 11 bits or less, so that their
+		// products with q are exact even without fused multiply-add
+		type r = V::fma(q, V::set1(-1.5703125f), x);
+		r = V::fma(q, V::set1(-4.837512969970703125e-4f), r);
+		r = V::fma(q, V::set1(-7.54953362047672271729e-8f), r);
+		r = V::fma(q, V::set1(-2.56334406825708960298e-12f), r);
+		q = V::add(q, offset);
+
+		const type z = V::mul(r, r);
+		type s, c;
+
+		if (fast)
+		{
+			s = V::fma(V::set1(8.1632820481e-3f), z, V::set1(-1.6663390384e-1f));
+			c = V::fma(V::set1(-1.3648713563e-3f), z, V::set1(4.1661071261e-2f));
+		}
+		else
+		{
+			s = V::fma(V::set1(-1.9515295891e-4f), z, V::set1(8.3321608736e-3f));
+			s = V::fma(s, z, V::set1(-1.6666654611e-1f));
+			c = V::fma(V::set1(2.443315711809948e-5f), z, V::set1(-1.388731625493765e-3f));
+			c = V::fma(c, z, V::set1(4.166664568298827e-2f));
+		}
+
+		s = V::fma(V::mul(s, z), r, r);
+		c = V::fma(V::mul(c, z), z, V::fma(z, V::set1(-0.5f), V::set1(1)));
+
+		// Odd quadrants use cos, and the third and fourth are negated
+		const auto even = V::equalMask(V::sub(q, V::add(round(V::mul(q, V::set1(0.5f))), round(V::mul(q, V::set1(0.5f))))), V::set1(0));
+		const type sign = V::bitAnd(V::template shiftLeft<30>(V::add(q, V::set1(magic))), V::set1(-0.0f));
+		return V::bitXor(V::select(even, s, c), sign);
+	}
+
+	static inline type sin(type x, bool fast)
+	{
+		return sinQuadrant(x, V::set1(0), fast);
+	}
+
+	static inline type cos(type x, bool fast)
+	{
+		return sinQuadrant(x, V::set1(1), fast);
+	}
+
+	static inline type tanh(type x, bool fast)
+	{
+		const type a = V::abs(x);
+		const type z = V::mul(x, x);
+		type p;
+
+		// Near zero, tanh(x) = x + x^3 p(x^2)
+		if (fast)
+		{
+			p = V::fma(V::set1(-4.0514752826e-2f), z, V::set1(1.3048276620e-1f));
+			p = V::fma(p, z, V::set1(-3.3315511691e-1f));
+		}
+		else
+		{
+			p = V::fma(V::set1(-5.70498872745e-3f), z, V::set1(2.06390887954e-2f));
+			p = V::fma(p, z, V::set1(-5.37397155531e-2f));
+			p = V::fma(p, z, V::set1(1.33314422036e-1f));
+			p = V::fma(p, z, V::set1(-3.33332819422e-1f));
+		}
+
+		const type small = V::fma(V::mul(p, z), x, x);
+
+		// Elsewhere, tanh(|x|) = 1 - 2 / (exp(2|x|) + 1), which is 1 in
+		// single precision above 9
+		const type e = V::add(exp(V::mul(V::min(V::set1(9.0f), a), V::set1(2)), fast), V::set1(1));
+		type large = V::sub(V::set1(1), V::mul(V::set1(2), fast ? V::rcp(e) : V::div(V::set1(1), e)));
+		large = V::bitOr(large, V::bitAnd(x, V::set1(-0.0f)));
+
+		return V::select(V::lessMask(a, V::set1(0.625f)), small, large);
+	}
+
+	// 1 / (1 + e^-x) for positive x, and e^x / (1 + e^x) for negative
+	// x, so the exponent never overflows
+	static inline type sigmoid(type x, bool fast)
+	{
+		const type e = exp(V::neg(V::abs(x)), fast);
+		const type d = V::add(V::set1(1), e);
+		const type num = V::select(V::lessMask(x, V::set1(0)), e, V::set1(1));
+		return fast ? V::mul(num, V::rcp(d)) : V::div(num, d);
+	}
+
+	// x^y = exp(y log(x)) for x >= 0
+	static inline type pow(type x, type y)
+	{
+		type res = exp(V::mul(y, log(x, true)), true);
+		res = V::select(V::equalMask(y, V::set1(0)), V::set1(1), res);
+		return V::select(V::equalMask(x, V::set1(1)), V::set1(1), res);
+	}
+};
+
+template<typename V>
+struct Elementary<V, double>
+{
+	using type = typename V::type;
+
+	static constexpr double magic = 6755399441055744.0;
+	static constexpr double trigLimit = 268435456.0;
+
+	static inline type round(type x)
+	{
+		return V::sub(V::add(x, V::set1(magic)), V::set1(magic));
+	}
+
+	// 2^n, for an integer n from -1022 to 1023
+	static inline type pow2(type n)
+	{
+		return V::template shiftLeft<52>(V::add(n, V::set1(magic + 1023)));
+	}
+
+	static inline type exp(type x, bool /*fast*/)
+	{
+		x = V::min(V::set1(710.0), V::max(V::set1(-746.0), x));
+
+		const type n = round(V::mul(x, V::set1(1.4426950408889634073599)));
+		type r = V::fma(n, V::set1(-6.93145751953125e-1), x);
+		r = V::fma(n, V::set1(-1.42860682030941723212e-6), r);
+
+		// exp(r) = 1 + 2 r p(r^2) / (q(r^2) - r p(r^2))
+		const type z = V::mul(r, r);
+		type p = V::fma(V::set1(1.26177193074810590878e-4), z, V::set1(3.02994407707441961300e-2));
+		p = V::mul(V::fma(p, z, V::set1(9.99999999999999999910e-1)), r);
+
+		type q = V::fma(V::set1(3.00198505138664455042e-6), z, V::set1(2.52448340349684104192e-3));
+		q = V::fma(q, z, V::set1(2.27265548208155028766e-1));
+		q = V::fma(q, z, V::set1(2.00000000000000000009e0));
+
+		p = V::fma(V::set1(2), V::div(p, V::sub(q, p)), V::set1(1));
+
+		const type half = round(V::mul(n, V::set1(0.5)));
+		return V::mul(V::mul(p, pow2(half)), pow2(V::sub(n, half)));
+	}
+
+	static inline type log(type x, bool /*fast*/)
+	{
+		const auto subnormal = V::lessMask(x, V::set1(std::numeric_limits<double>::min()));
+		type m = V::select(subnormal, V::mul(x, V::set1(4503599627370496.0)), x);
+		type e = V::select(subnormal, V::set1(-52.0), V::set1(0));
+
+		const type field = V::template shiftRight<52>(V::bitAnd(m, V::set1(std::numeric_limits<double>::infinity())));
+		e = V::add(e, V::sub(V::bitOr(field, V::set1(4503599627370496.0)), V::set1(4503599627370496.0 + 1022)));
+		m = V::bitOr(V::bitAnd(m, V::set1(imp::fromBits<double>(0x000FFFFFFFFFFFFFull))), V::set1(0.5));
+
+		const auto low = V::lessMask(m, V::set1(0.70710678118654752440));
+		e = V::select(low, V::sub(e, V::set1(1)), e);
+		m = V::sub(V::select(low, V::add(m, m), m), V::set1(1));
+
+		// log(1 + m) = m - m^2 / 2 + m^3 p(m) / q(m)
+		const type z = V::mul(m, m);
+		type p = V::fma(V::set1(1.01875663804580931796e-4), m, V::set1(4.97494994976747001425e-1));
+		p = V::fma(p, m, V::set1(4.70579119878881725854e0));
+		p = V::fma(p, m, V::set1(1.44989225341610930846e1));
+		p = V::fma(p, m, V::set1(1.79368678507819816313e1));
+		p = V::fma(p, m, V::set1(7.70838733755885391666e0));
+
+		type q = V::add(m, V::set1(1.12873587189167450590e1));
+		q = V::fma(q, m, V::set1(4.52279145837532221105e1));
+		q = V::fma(q, m, V::set1(8.29875266912776603211e1));
+		q = V::fma(q, m, V::set1(7.11544750618563894466e1));
+		q = V::fma(q, m, V::set1(2.31251620126765340583e1));
+
+		type y = V::mul(m, V::div(V::mul(z, p), q));
+		y = V::fma(e, V::set1(-2.121944400546905827679e-4), y);
+		y = V::fma(z, V::set1(-0.5), y);
+		type res = V::fma(e, V::set1(0.693359375), V::add(m, y));
+
+		res = V::select(V::equalMask(x, V::set1(std::numeric_limits<double>::infinity())), x, res);
+		res = V::select(V::equalMask(x, V::set1(0)), V::set1(-std::numeric_limits<double>::infinity()), res);
+		res = V::select(V::lessMask(x, V::set1(0)), V::set1(std::numeric_limits<double>::quiet_NaN()), res);
+		return V::select(V::nanMask(x), x, res);
+	}
+
+	static inline type sinQuadrant(type x, type offset, bool /*fast*/)
+	{
+		type q = round(V::mul(x, V::set1(0.63661977236758134308)));
+
+		type r = V::fma(q, V::set1(-1.57079625129699707031e0), x);
+		r = V::fma(q, V::set1(-7.54978941586159635336e-8), r);
+		r = V::fma(q, V::set1(-5.39030285815811905290e-15), r);
+		q = V::add(q, offset);
+
+		const type z = V::mul(r, r);
+
+		type s = V::fma(V::set1(1.58962301576546568060e-10), z, V::set1(-2.50507477628578072866e-8));
+		s = V::fma(s, z, V::set1(2.75573136213857245213e-6));
+		s = V::fma(s, z, V::set1(-1.98412698295895385996e-4));
+		s = V::fma(s, z, V::set1(8.33333333332211858878e-3));
+		s = V::fma(s, z, V::set1(-1.66666666666666307295e-1));
+		s = V::fma(V::mul(s, z), r, r);
+
+		type c = V::fma(V::set1(-1.13585365213876817300e-11), z, V::set1(2.08757008419747316778e-9));
+		c = V::fma(c, z, V::set1(-2.75573141792967388112e-7));
+		c = V::fma(c, z, V::set1(2.48015872888517045348e-5));
+		c = V::fma(c, z, V::set1(-1.38888888888730564116e-3));
+		c = V::fma(c, z, V::set1(4.16666666666665929218e-2));
+		c = V::fma(V::mul(c, z), z, V::fma(z, V::set1(-0.5), V::set1(1)));
+
+		const type halfQ = round(V::mul(q, V::set1(0.5)));
+		const auto even = V::equalMask(V::sub(q, V::add(halfQ, halfQ)), V::set1(0));
+		const type sign = V::bitAnd(V::template shiftLeft<62>(V::add(q, V::set1(magic))), V::set1(-0.0));
+		return V::bitXor(V::select(even, s, c), sign);
+	}
+
+	static inline type sin(type x, bool fast)
+	{
+		return sinQuadrant(x, V::set1(0), fast);
+	}
+
+	static inline type cos(type x, bool fast)
+	{
+		return sinQuadrant(x, V::set1(1), fast);
+	}
+
+	static inline type tanh(type x, bool fast)
+	{
+		const type a = V::abs(x);
+
+		// Near zero, tanh(x) = x + x^3 p(x^2) / q(x^2)
+		const type z = V::mul(x, x);
+		type p = V::fma(V::set1(-9.64399179425052238628e-1), z, V::set1(-9.92877231001918586564e1));
+		p = V::fma(p, z, V::set1(-1.61468768441708447952e3));
+
+		type q = V::add(z, V::set1(1.12811678491632931402e2));
+		q = V::fma(q, z, V::set1(2.23548839060100448583e3));
+		q = V::fma(q, z, V::set1(4.84406305325125486048e3));
+
+		const type small = V::fma(V::mul(V::div(p, q), z), x, x);
+
+		const type e = V::add(exp(V::mul(V::min(V::set1(20.0), a), V::set1(2)), fast), V::set1(1));
+		type large = V::sub(V::set1(1), V::div(V::set1(2), e));
+		large = V::bitOr(large, V::bitAnd(x, V::set1(-0.0)));
+
+		return V::select(V::lessMask(a, V::set1(0.625)), small, large);
+	}
+
+	static inline type sigmoid(type x, bool fast)
+	{
+		const type e = exp(V::neg(V::abs(x)), fast);
+		const type num = V::select(V::lessMask(x, V::set1(0)), e, V::set1(1));
+		return V::div(num, V::add(V::set1(1), e));
+	}
+
+	static inline type pow(type x, type y)
+	{
+		type res = exp(V::mul(y, log(x, true)), true);
+		res = V::select(V::equalMask(y, V::set1(0)), V::set1(1), res);
+		return V::select(V::equalMask(x, V::set1(1)), V::set1(1), res);
+	}
+};
+
+// Calculate the elements of "res" selected by "m" with the scalar
+// function Op::apply, for arguments the polynomials do not cover
+template<typename Op, typename V>
+inline typename V::type scalarLanes(typename V::mask m, typename V::type x, typename V::type res)
+{
+	if (!V::any(m))
+		return res;
+
+	using s = typename V::scalar;
+	s in[V::width], out[V::width], sel[V::width];
+	V::store(in, x);
+	V::store(out, res);
+	V::store(sel, V::select(m, V::set1(1), V::set1(0)));
+
+	for (uint64 i = 0; i < V::width; i++)
+		if (sel[i] != 0)
+			out[i] = Op::apply(in[i]);
+
+	return V::load(out);
+}
+
+template<Accuracy mode>
+struct Apply<expr::Sqrt<mode>>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x) { return V::sqrt(x); }
+};
+
+template<Accuracy mode>
+struct Apply<expr::Rsqrt<mode>>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x)
+	{
+		return isFast(mode) ? V::rsqrt(x) : V::div(V::set1(1), V::sqrt(x));
+	}
+};
+
+template<Accuracy mode>
+struct Apply<expr::Exp<mode>>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x) { return Elementary<V>::exp(x, isFast(mode)); }
+};
+
+template<Accuracy mode>
+struct Apply<expr::Log<mode>>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x) { return Elementary<V>::log(x, isFast(mode)); }
+};
+
+template<Accuracy mode>
+struct Apply<expr::Sin<mode>>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x)
+	{
+		const auto large = V::greaterMask(V::abs(x), V::set1(Elementary<V>::trigLimit));
+		return scalarLanes<expr::Sin<mode>, V>(large, x, Elementary<V>::sin(x, isFast(mode)));
+	}
+};
+
+template<Accuracy mode>
+struct Apply<expr::Cos<mode>>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x)
+	{
+		const auto large = V::greaterMask(V::abs(x), V::set1(Elementary<V>::trigLimit));
+		return scalarLanes<expr::Cos<mode>, V>(large, x, Elementary<V>::cos(x, isFast(mode)));
+	}
+};
+
+template<Accuracy mode>
+struct Apply<expr::Tanh<mode>>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x) { return Elementary<V>::tanh(x, isFast(mode)); }
+};
+
+template<Accuracy mode>
+struct Apply<expr::Sigmoid<mode>>
+{
+	template<typename V> static inline typename V::type unary(typename V::type x) { return Elementary<V>::sigmoid(x, isFast(mode)); }
+};
+
+// Only the FAST kernel for pow is vectorized. PRECISE powers, and
+// negative bases, are calculated with the standard library
+template<Accuracy mode>
+struct Apply<expr::Pow<mode>>
+{
+	template<typename V> static inline typename V::type binary(typename V::type x, typename V::type y)
+	{
+		using s = typename V::scalar;
+		s base[V::width], power[V::width], res[V::width];
+		V::store(base, x);
+		V::store(power, y);
+
+		if (isFast(mode))
+		{
+			const auto negative = V::lessMask(x, V::set1(0));
+			const auto approx = Elementary<V>::pow(x, y);
+
+			if (!V::any(negative))
+				return approx;
+
+			V::store(res, approx);
+			for (uint64 i = 0; i < V::width; i++)
+				if (base[i] < 0)
+					res[i] = std::pow(base[i], power[i]);
+
+			return V::load(res);
+		}
+
+		for (uint64 i = 0; i < V::width; i++)
+			res[i] = std::pow(base[i], power[i]);
+
+		return V::load(res);
+	}
+};
+
+template<typename Op, typename t>
+inline void binary(const t *lhs, bool lhsStep, const t *rhs, bool rhsStep, t *out, uint64 len)
+{
+	using V = Vec<t>;
+	uint64 i = 0;
+
+	if (lhsStep && rhsStep)
+	{
+		for (; i + V::width <= len; i += V::width)
+			V::store(out + i, Apply<Op>::template binary<V>(V::load(lhs + i), V::load(rhs + i)));
+
+		for (; i < len; i++)
+			out[i] = Op::apply(lhs[i], rhs[i]);
+	}
+	else if (lhsStep)
+	{
+		const auto val = V::set1(rhs[0]);
+
+		for (; i + V::width <= len; i += V::width)
+			V::store(out + i, Apply<Op>::template binary<V>(V::load(lhs + i), val));
+
+		for (; i < len; i++)
+			out[i] = Op::apply(lhs[i], rhs[0]);
+	}
+	else
+	{
+		const auto val = V::set1(lhs[0]);
+
+		for (; i + V::width <= len; i += V::width)
+			V::store(out + i, Apply<Op>::template binary<V>(val, V::load(rhs + i)));
+
+		for (; i < len; i++)
+			out[i] = Op::apply(lhs[0], rhs[i]);
+	}
+}
+
+template<typename Op, typename t>
+inline void unary(const t *src, t *out, uint64 len)
+{
+	using V = Vec<t>;
+	uint64 i = 0;
+
+	for (; i + V::width <= len; i += V::width)
+		V::store(out + i, Apply<Op>::template unary<V>(V::load(src + i)));
+
+	for (; i < len; i++)
+		out[i] = Op::apply(src[i]);
+}
+
+template<typename Op, uint64 L, typename t>
+inline t accumulate(const t *src, uint64 len, t init)
+{
+	using V = Vec<t>;
+	constexpr uint64 count = L / V::width;
+	static_assert(count * V::width == L, "Accumulators must fill a whole number of vectors");
+
+	typename V::type acc[count];
+	for (uint64 a = 0; a < count; a++)
+		acc[a] = V::set1(init);
+
+	uint64 i = 0;
+	for (; i + L <= len; i += L)
+		for (uint64 a = 0; a < count; a++)
+			acc[a] = Apply<Op>::template binary<V>(acc[a], V::load(src + i + a * V::width));
+
+	t lanes[L];
+
+	if (i < len)
+	{
+		for (uint64 a = 0; a < count; a++)
+			V::store(lanes + a * V::width, acc[a]);
+
+		for (uint64 j = 0; i < len; i++, j++)
+			lanes[j] = Op::apply(lanes[j], src[i]);
+
+		for (uint64 a = 0; a < count; a++)
+			acc[a] = V::load(lanes + a * V::width);
+	}
+
+	// The first steps of the pairwise combination pair up whole vectors
+	for (uint64 half = count / 2; half > 0; half /= 2)
+		for (uint64 a = 0; a < half; a++)
+			acc[a] = Apply<Op>::template binary<V>(acc[a], acc[a + half]);
+
+	V::store(lanes, acc[0]);
+	return imp::combineLanes<Op, V::width>(lanes);
+}
+
+template<typename Op, typename t>
+inline t reduce(const t *src, uint64 len, t init, bool deterministic)
+{
+	if (deterministic)
+		return accumulate<Op, reduceLanes>(src, len, init);
+	return accumulate<Op, 4 * Vec<t>::width>(src, len, init);
+}
+
+template<uint64 L, typename t>
+inline t kahanAccumulate(const t *src, uint64 len)
+{
+	using V = Vec<t>;
+	constexpr uint64 count = L / V::width;
+	static_assert(count * V::width == L, "Accumulators must fill a whole number of vectors");
+
+	typename V::type sum[count], comp[count];
+	for (uint64 a = 0; a < count; a++)
+	{
+		sum[a] = V::set1(0);
+		comp[a] = V::set1(0);
+	}
+
+	uint64 i = 0;
+	for (; i + L <= len; i += L)
+	{
+		for (uint64 a = 0; a < count; a++)
+		{
+			const auto y = V::sub(V::load(src + i + a * V::width), comp[a]);
+			const auto tmp = V::add(sum[a], y);
+			comp[a] = V::sub(V::sub(tmp, sum[a]), y);
+			sum[a] = tmp;
+		}
+	}
+
+	t sumLanes[L], compLanes[L];
+	for (uint64 a = 0; a < count; a++)
+	{
+		V::store(sumLanes + a * V::width, sum[a]);
+		V::store(compLanes + a * V::width, comp[a]);
+	}
+
+	for (uint64 j = 0; i < len; i++, j++)
+	{
+		const t y = src[i] - compLanes[j];
+		const t tmp = sumLanes[j] + y;
+		compLanes[j] = (tmp - sumLanes[j]) - y;
+		sumLanes[j] = tmp;
+	}
+
+	return imp::combineKahan<L>(sumLanes, compLanes);
+}
+
+template<typename t>
+inline t kahan(const t *src, uint64 len, bool deterministic)
+{
+	if (deterministic)
+		return kahanAccumulate<reduceLanes>(src, len);
+	return kahanAccumulate<4 * Vec<t>::width>(src, len);
+}
+
+template<typename t>
+inline void transposeBlock(const t *src, uint64 srcStride, t *dst, uint64 dstStride, uint64 rows, uint64 cols)
+{
+	using bits = typename std::conditional<sizeof(t) == 4, float, double>::type;
+	using V = Vec<bits>;
+	constexpr uint64 W = V::width;
+
+	uint64 i = 0;
+	for (; i + W <= rows; i += W)
+	{
+		uint64 j = 0;
+		for (; j + W <= cols; j += W)
+		{
+			typename V::type tile[W];
+
+			for (uint64 k = 0; k < W; k++)
+				tile[k] = V::load(reinterpret_cast<const bits *>(src + (i + k) * srcStride + j));
+
+			V::transpose(tile);
+
+			for (uint64 k = 0; k < W; k++)
+				V::store(reinterpret_cast<bits *>(dst + (j + k) * dstStride + i), tile[k]);
+		}
+
+		for (; j < cols; j++)
+			for (uint64 k = 0; k < W; k++)
+				dst[j * dstStride + i + k] = src[(i + k) * srcStride + j];
+	}
+
+	for (; i < rows; i++)
+		for (uint64 j = 0; j < cols; j++)
+			dst[j * dstStride + i] = src[i * srcStride + j];
+}
+
+// The register tile of the matrix product kernel is gemmRows rows of C by
+// two vectors, which leaves enough registers for a row of B and a
+// broadcast element of A
+constexpr uint64 gemmRows = 6;
+
+template<typename t>
+inline void gemmKernel(uint64 depth, const t *a, const t *b, t *c, uint64 ldc, bool accumulate)
+{
+	using V = Vec<t>;
+	constexpr uint64 W = V::width;
+
+	typename V::type acc[gemmRows][2];
+	for (uint64 r = 0; r < gemmRows; r++)
+	{
+		acc[r][0] = V::set1(0);
+		acc[r][1] = V::set1(0);
+	}
+
+	for (uint64 p = 0; p < depth; p++)
+	{
+		const auto b0 = V::load(b);
+		const auto b1 = V::load(b + W);
+
+		for (uint64 r = 0; r < gemmRows; r++)
+		{
+			const auto val = V::set1(a[r]);
+			acc[r][0] = V::fma(val, b0, acc[r][0]);
+			acc[r][1] = V::fma(val, b1, acc[r][1]);
+		}
+
+		a += gemmRows;
+		b += 2 * W;
+	}
+
+	for (uint64 r = 0; r < gemmRows; r++)
+	{
+		t *row = c + r * ldc;
+
+		if (accumulate)
+		{
+			acc[r][0] = V::add(acc[r][0], V::load(row));
+			acc[r][1] = V::add(acc[r][1], V::load(row + W));
+		}
+
+		V::store(row, acc[r][0]);
+		V::store(row + W, acc[r][1]);
+	}
+}
+
+template<typename t>
+inline t dot(const t *a, const t *b, uint64 len)
+{
+	using V = Vec<t>;
+	constexpr uint64 W = V::width;
+
+	typename V::type acc[4];
+	for (uint64 k = 0; k < 4; k++)
+		acc[k] = V::set1(0);
+
+	uint64 i = 0;
+	for (; i + 4 * W <= len; i += 4 * W)
+		for (uint64 k = 0; k < 4; k++)
+			acc[k] = V::fma(V::load(a + i + k * W), V::load(b + i + k * W), acc[k]);
+
+	for (; i + W <= len; i += W)
+		acc[0] = V::fma(V::load(a + i), V::load(b + i), acc[0]);
+
+	acc[0] = V::add(V::add(acc[0], acc[1]), V::add(acc[2], acc[3]));
+
+	t lanes[W];
+	V::store(lanes, acc[0]);
+	t res = imp::combineLanes<expr::Add, W>(lanes);
+
+	for (; i < len; i++)
+		res += a[i] * b[i];
+
+	return res;
+}
+
+template<typename t>
+inline void axpy(t alpha, const t *x, t *y, uint64 len)
+{
+	using V = Vec<t>;
+	const auto scale = V::set1(alpha);
+
+	uint64 i = 0;
+	for (; i + V::width <= len; i += V::width)
+		V::store(y + i, V::fma(scale, V::load(x + i), V::load(y + i)));
+
+	for (; i < len; i++)
+		y[i] += alpha * x[i];
+}
+
+template<typename t>
+inline void gather(const t *src, const int64 *index, t *dst, uint64 len)
+{
+	using V = Vec<t>;
+
+	uint64 i = 0;
+	for (; i + V::width <= len; i += V::width)
+		V::store(dst + i, V::gather(src, index + i));
+
+	for (; i < len; i++)
+		dst[i] = src[index[i]];
+}
+
+// The inclusive prefix of the lanes of a vector, where each step combines
+// every lane with the lane "n" below it
+template<typename Op, typename V, uint64 n = 1, bool done = (n >= V::width)>
+struct Prefix
+{
+	static inline typename V::type apply(typename V::type x, typename V::type fill)
+	{
+		x = Apply<Op>::template binary<V>(V::template shiftLanes<(int) n>(x, fill), x);
+		return Prefix<Op, V, 2 * n>::apply(x, fill);
+	}
+};
+
+template<typename Op, typename V, uint64 n>
+struct Prefix<Op, V, n, true>
+{
+	static inline typename V::type apply(typename V::type x, typename V::type /*fill*/) { return x; }
+};
+
+template<typename Op, typename t>
+inline void scan(const t *src, t *out, uint64 len, t identity)
+{
+	using V = Vec<t>;
+	const auto fill = V::set1(identity);
+	auto carry = fill;
+
+	uint64 i = 0;
+	for (; i + V::width <= len; i += V::width)
+	{
+		const auto x = Apply<Op>::template binary<V>(carry, Prefix<Op, V>::apply(V::load(src + i), fill));
+		V::store(out + i, x);
+		carry = V::broadcastLast(x);
+	}
+
+	t acc = i > 0 ? out[i - 1] : identity;
+	for (; i < len; i++)
+		out[i] = acc = Op::apply(acc, src[i]);
+}
+
+// Half precision conversions, where "s" or "d" is a half precision type
+// and the other is float
+template<typename s, typename d>
+inline void convert(const s *src, d *dst, uint64 len)
+{
+	using V = Vec<float>;
+
+	uint64 i = 0;
+	for (; i + V::width <= len; i += V::width)
+		V::store(dst + i, V::load(src + i));
+
+	for (; i < len; i++)
+		dst[i] = (d) src[i];
+}
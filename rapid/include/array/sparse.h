@@ -0,0 +1,593 @@
+#pragma once
+
+#include "../internal.h"
+#include "../tuning.h"
+
+#include "arrayCore.h"
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		/// <summary>
+		/// The layouts a sparse matrix can be stored in. CSR (compressed
+		/// sparse row) stores the nonzero values of each row together,
+		/// CSC (compressed sparse column) stores the values of each column
+		/// together, and COO (coordinate) stores the row and column of
+		/// every value separately, in any order
+		/// </summary>
+		enum class SparseFormat
+		{
+			CSR = 0,
+			CSC = 1,
+			COO = 2
+		};
+
+		namespace sparse
+		{
+			/// <summary>
+			/// The number of columns of a dense matrix updated together by
+			/// each thread when a CSC matrix is multiplied by it
+			/// </summary>
+			constexpr uint64 columnBlock = 64;
+
+			namespace imp
+			{
+				/// <summary>
+				/// Sort a list of (major, minor, value) entries into compressed
+				/// form, where the entries of major index i are stored from
+				/// offsets[i] to offsets[i + 1], ordered by minor index. Entries
+				/// with the same position are summed
+				/// </summary>
+				template<typename t>
+				inline void compress(const std::vector<uint64> &major, const std::vector<uint64> &minor,
+									 const std::vector<t> &vals, uint64 majorLen,
+									 std::vector<uint64> &offsets, std::vector<uint64> &indices, std::vector<t> &values)
+				{
+					const uint64 count = vals.size();
+
+					// Counting sort by the major index
+					std::vector<uint64> start(majorLen + 1, 0);
+					for (uint64 i = 0; i < count; i++)
+						start[major[i] + 1]++;
+					for (uint64 i = 0; i < majorLen; i++)
+						start[i + 1] += start[i];
+
+					std::vector<uint64> order(count);
+					std::vector<uint64> next(start.begin(), start.end() - 1);
+					for (uint64 i = 0; i < count; i++)
+						order[next[major[i]]++] = i;
+
+					offsets.assign(majorLen + 1, 0);
+					indices.clear();
+					values.clear();
+					indices.reserve(count);
+					values.reserve(count);
+
+					for (uint64 m = 0; m < majorLen; m++)
+					{
+						std::sort(order.begin() + start[m], order.begin() + start[m + 1], [&](uint64 a, uint64 b)
+						{
+							return minor[a] < minor[b];
+						});
+
+						for (uint64 i = start[m]; i < start[m + 1]; i++)
+						{
+							const uint64 entry = order[i];
+
+							if (indices.size() > offsets[m] && indices.back() == minor[entry])
+							{
+								values.back() += vals[entry];
+							}
+							else
+							{
+								indices.push_back(minor[entry]);
+								values.push_back(vals[entry]);
+							}
+						}
+
+						offsets[m + 1] = indices.size();
+					}
+				}
+			}
+		}
+
+		/// <summary>
+		/// A two dimensional array that only stores its nonzero values, in
+		/// CSR, CSC or COO format. Sparse matrices can be multiplied by
+		/// dense vectors and matrices from either side, multiplied
+		/// elementwise by dense arrays, and transposed, all without
+		/// creating a dense copy.
+		///
+		/// Products are fastest with CSR matrices, and CSC matrices are
+		/// the transposes of CSR matrices, so transposing never moves any
+		/// values. COO matrices are converted to CSR before a product, so
+		/// matrices used more than once should be converted once with
+		/// asFormat
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		template<typename t>
+		class SparseArray
+		{
+		public:
+			std::vector<uint64> shape;			// Always {rows, cols}
+			SparseFormat format = SparseFormat::CSR;
+			std::vector<uint64> offsets;		// CSR: start of each row. CSC: start of each column. COO: empty
+			std::vector<uint64> indices;		// CSR and COO: column of each value. CSC: row of each value
+			std::vector<uint64> rowIndices;		// COO: row of each value. Otherwise empty
+			std::vector<t> values;
+
+			SparseArray() = default;
+
+			/// <summary>
+			/// Create a sparse matrix of the given shape with no nonzero values
+			/// </summary>
+			/// <param name="arrShape"></param>
+			/// <param name="arrFormat"></param>
+			SparseArray(const std::vector<uint64> &arrShape, SparseFormat arrFormat = SparseFormat::CSR)
+				: shape(arrShape), format(arrFormat)
+			{
+				rapidAssert(shape.size() == 2, "Sparse arrays must have two dimensions");
+
+				if (format == SparseFormat::CSR)
+					offsets.assign(shape[0] + 1, 0);
+				else if (format == SparseFormat::CSC)
+					offsets.assign(shape[1] + 1, 0);
+			}
+
+			/// <summary>
+			/// Create a sparse matrix from the row, column and value of each
+			/// nonzero element. Values with the same position are summed
+			/// </summary>
+			/// <param name="arrShape"></param>
+			/// <param name="rows"></param>
+			/// <param name="cols"></param>
+			/// <param name="vals"></param>
+			/// <param name="arrFormat"></param>
+			/// <returns></returns>
+			static inline SparseArray<t> fromTriplets(const std::vector<uint64> &arrShape, const std::vector<uint64> &rows,
+													  const std::vector<uint64> &cols, const std::vector<t> &vals,
+													  SparseFormat arrFormat = SparseFormat::CSR)
+			{
+				rapidAssert(rows.size() == vals.size() && cols.size() == vals.size(),
+							"Sparse array triplets must have the same length");
+
+				SparseArray<t> res(arrShape, arrFormat);
+
+			#ifdef RAPID_DEBUG
+				// The positions are used as offsets while compressing, so
+				// they are checked before anything is counted
+				for (uint64 i = 0; i < vals.size(); i++)
+					rapidAssert(rows[i] < arrShape[0] && cols[i] < arrShape[1],
+								"Sparse array triplet at (" + std::to_string(rows[i]) + ", " + std::to_string(cols[i]) +
+								") is out of range for shape (" + expr::shapeToString(arrShape) + ")");
+			#endif
+
+				switch (arrFormat)
+				{
+					case SparseFormat::CSR:
+						sparse::imp::compress(rows, cols, vals, arrShape[0], res.offsets, res.indices, res.values);
+						break;
+					case SparseFormat::CSC:
+						sparse::imp::compress(cols, rows, vals, arrShape[1], res.offsets, res.indices, res.values);
+						break;
+					case SparseFormat::COO:
+						res.rowIndices = rows;
+						res.indices = cols;
+						res.values = vals;
+						break;
+				}
+
+				return res;
+			}
+
+			/// <summary>
+			/// Create a sparse matrix from the nonzero values of a two
+			/// dimensional dense array
+			/// </summary>
+			/// <param name="arr"></param>
+			/// <param name="arrFormat"></param>
+			/// <returns></returns>
+			static inline SparseArray<t> fromDense(const Array<t> &arr, SparseFormat arrFormat = SparseFormat::CSR)
+			{
+				rapidAssert(arr.shape.size() == 2, "Sparse arrays must have two dimensions");
+
+				const auto stride = arr.strides();
+				SparseArray<t> res(arr.shape, SparseFormat::CSR);
+
+				for (uint64 i = 0; i < arr.shape[0]; i++)
+				{
+					for (uint64 j = 0; j < arr.shape[1]; j++)
+					{
+						const t val = arr.dataStart[i * stride[0] + j * stride[1]];
+
+						if (val != (t) 0)
+						{
+							res.indices.push_back(j);
+							res.values.push_back(val);
+						}
+					}
+
+					res.offsets[i + 1] = res.values.size();
+				}
+
+				return res.asFormat(arrFormat);
+			}
+
+			/// <summary>
+			/// The number of values stored
+			/// </summary>
+			/// <returns></returns>
+			inline uint64 nnz() const
+			{
+				return values.size();
+			}
+
+			/// <summary>
+			/// Return a dense array with the same values
+			/// </summary>
+			/// <returns></returns>
+			inline Array<t> toDense() const
+			{
+				auto res = zeros<t>(shape);
+				t *data = res.dataStart;
+				const uint64 cols = shape[1];
+
+				forEach([&](uint64 row, uint64 col, uint64 index)
+				{
+					data[row * cols + col] += values[index];
+				});
+
+				return res;
+			}
+
+			/// <summary>
+			/// Return the same matrix stored in another format
+			/// </summary>
+			/// <param name="newFormat"></param>
+			/// <returns></returns>
+			inline SparseArray<t> asFormat(SparseFormat newFormat) const
+			{
+				if (newFormat == format)
+					return *this;
+
+				std::vector<uint64> rows, cols;
+				rows.reserve(nnz());
+				cols.reserve(nnz());
+
+				forEach([&](uint64 row, uint64 col, uint64 /*index*/)
+				{
+					rows.push_back(row);
+					cols.push_back(col);
+				});
+
+				return fromTriplets(shape, rows, cols, values, newFormat);
+			}
+
+			/// <summary>
+			/// Return the transpose of the matrix. A CSR matrix becomes a
+			/// CSC matrix with the same values and indices, and the reverse,
+			/// so no values are sorted or moved
+			/// </summary>
+			/// <returns></returns>
+			inline SparseArray<t> transposed() const
+			{
+				SparseArray<t> res;
+				res.shape = {shape[1], shape[0]};
+				res.offsets = offsets;
+				res.values = values;
+
+				switch (format)
+				{
+					case SparseFormat::CSR:
+						res.format = SparseFormat::CSC;
+						res.indices = indices;
+						break;
+					case SparseFormat::CSC:
+						res.format = SparseFormat::CSR;
+						res.indices = indices;
+						break;
+					case SparseFormat::COO:
+						res.format = SparseFormat::COO;
+						res.indices = rowIndices;
+						res.rowIndices = indices;
+						break;
+				}
+
+				return res;
+			}
+
+			/// <summary>
+			/// Multiply the matrix by a dense vector or matrix. A vector
+			/// gives a vector with one element for each row, and a matrix
+			/// gives a dense matrix
+			/// </summary>
+			/// <param name="other"></param>
+			/// <returns></returns>
+			inline Array<t> dot(const Array<t> &other) const
+			{
+				Array<t> res;
+				dot(other, res);
+				return res;
+			}
+
+			/// <summary>
+			/// Multiply the matrix by a dense vector or matrix and store
+			/// "alpha * product + beta * out" in "out", which must be
+			/// contiguous. If "out" has not been initialized, it is created.
+			/// Rows of a CSR matrix are processed in parallel, as are blocks
+			/// of columns of the result of a CSC matrix product
+			/// </summary>
+			/// <param name="other"></param>
+			/// <param name="out"></param>
+			/// <param name="alpha"></param>
+			/// <param name="beta"></param>
+			/// <returns></returns>
+			inline Array<t> &dot(const Array<t> &other, Array<t> &out, t alpha = 1, t beta = 0) const
+			{
+				rapidAssert(other.shape.size() == 1 || other.shape.size() == 2, "Invalid number of dimensions for sparse dot product");
+				rapidAssert(other.shape[0] == shape[1], "Invalid shape for sparse dot product");
+
+				if (format == SparseFormat::COO)
+					return asFormat(SparseFormat::CSR).dot(other, out, alpha, beta);
+
+				const bool vector = other.shape.size() == 1;
+				const std::vector<uint64> resShape = vector ? std::vector<uint64>{shape[0]} : std::vector<uint64>{shape[0], other.shape[1]};
+
+				if (!out.isInitialized())
+				{
+					out.set(Array<t>(resShape));
+					beta = 0;
+				}
+
+				rapidAssert(out.shape == resShape, "Invalid shape for output of sparse dot product");
+				rapidAssert(out.isContiguous(), "Output of sparse dot product must be contiguous");
+				rapidAssert(out.isWritable(), "Cannot write the output of a sparse dot product to a read-only array");
+
+				const auto dense = other.isContiguous() ? other : other.copy();
+				const uint64 width = vector ? 1 : other.shape[1];
+				scale(out.dataStart, shape[0] * width, beta);
+
+				if (format == SparseFormat::CSR)
+					csrProduct(dense.dataStart, width, out.dataStart, alpha);
+				else
+					cscProduct(dense.dataStart, width, out.dataStart, alpha);
+
+				return out;
+			}
+
+			/// <summary>
+			/// Calculate lhs.dot(*this), the product of a dense vector or
+			/// matrix with this matrix. The rows of a dense matrix are
+			/// processed in parallel
+			/// </summary>
+			/// <param name="lhs"></param>
+			/// <returns></returns>
+			inline Array<t> rdot(const Array<t> &lhs) const
+			{
+				rapidAssert(lhs.shape.size() == 1 || lhs.shape.size() == 2, "Invalid number of dimensions for sparse dot product");
+				rapidAssert(lhs.shape[lhs.shape.size() - 1] == shape[0], "Invalid shape for sparse dot product");
+
+				if (format == SparseFormat::COO)
+					return asFormat(SparseFormat::CSR).rdot(lhs);
+
+				const bool vector = lhs.shape.size() == 1;
+				const uint64 rows = vector ? 1 : lhs.shape[0];
+				const uint64 depth = shape[0], cols = shape[1];
+
+				auto res = zeros<t>(vector ? std::vector<uint64>{cols} : std::vector<uint64>{rows, cols});
+				const auto dense = lhs.isContiguous() ? lhs : lhs.copy();
+				const t *a = dense.dataStart;
+				t *c = res.dataStart;
+
+				auto row = [&](uint64 r)
+				{
+					const t *aRow = a + r * depth;
+					t *cRow = c + r * cols;
+
+					if (format == SparseFormat::CSR)
+					{
+						// Add a multiple of each row of this matrix
+						for (uint64 k = 0; k < depth; k++)
+						{
+							const t factor = aRow[k];
+							if (factor == (t) 0)
+								continue;
+
+							for (uint64 p = offsets[k]; p < offsets[k + 1]; p++)
+								cRow[indices[p]] += factor * values[p];
+						}
+					}
+					else
+					{
+						// Each column of this matrix gives one element
+						for (uint64 j = 0; j < cols; j++)
+						{
+							t sum = 0;
+							for (uint64 p = offsets[j]; p < offsets[j + 1]; p++)
+								sum += aRow[indices[p]] * values[p];
+							cRow[j] = sum;
+						}
+					}
+				};
+
+				if (!tuning::parallel(tuning::Op::MATMUL, rows * nnz()) || rows < 2)
+				{
+					for (uint64 r = 0; r < rows; r++)
+						row(r);
+				}
+				else
+				{
+					long r = 0;
+
+				#pragma omp parallel for shared(rows, row) private(r) default(none)
+					for (r = 0; r < (long) rows; ++r)
+						row(r);
+				}
+
+				return res;
+			}
+
+			/// <summary>
+			/// Multiply every stored value by the element at the same position
+			/// of a dense array with the same shape. The result has the same
+			/// nonzero positions as this matrix. The dense array may be a
+			/// strided view
+			/// </summary>
+			/// <param name="other"></param>
+			/// <returns></returns>
+			inline SparseArray<t> multiply(const Array<t> &other) const
+			{
+				rapidAssert(other.shape == shape, "Invalid shape for sparse elementwise product");
+
+				SparseArray<t> res = *this;
+				const auto stride = other.strides();
+				const t *data = other.dataStart;
+
+				forEach([&](uint64 row, uint64 col, uint64 index)
+				{
+					res.values[index] *= data[row * stride[0] + col * stride[1]];
+				});
+
+				return res;
+			}
+
+		private:
+			/// <summary>
+			/// Call func(row, col, index) for every stored value
+			/// </summary>
+			template<typename Func>
+			inline void forEach(Func func) const
+			{
+				switch (format)
+				{
+					case SparseFormat::CSR:
+						for (uint64 i = 0; i + 1 < offsets.size(); i++)
+							for (uint64 p = offsets[i]; p < offsets[i + 1]; p++)
+								func(i, indices[p], p);
+						break;
+					case SparseFormat::CSC:
+						for (uint64 j = 0; j + 1 < offsets.size(); j++)
+							for (uint64 p = offsets[j]; p < offsets[j + 1]; p++)
+								func(indices[p], j, p);
+						break;
+					case SparseFormat::COO:
+						for (uint64 p = 0; p < values.size(); p++)
+							func(rowIndices[p], indices[p], p);
+						break;
+				}
+			}
+
+			static inline void scale(t *data, uint64 len, t beta)
+			{
+				if (beta == (t) 0)
+					std::fill(data, data + len, (t) 0);
+				else if (beta != (t) 1)
+					for (uint64 i = 0; i < len; i++)
+						data[i] *= beta;
+			}
+
+			// Each row of the result depends only on one row of this matrix
+			inline void csrProduct(const t *b, uint64 width, t *c, t alpha) const
+			{
+				const uint64 rows = shape[0];
+
+				auto row = [&](uint64 i)
+				{
+					if (width == 1)
+					{
+						t sum = 0;
+						for (uint64 p = offsets[i]; p < offsets[i + 1]; p++)
+							sum += values[p] * b[indices[p]];
+						c[i] += alpha * sum;
+						return;
+					}
+
+					for (uint64 p = offsets[i]; p < offsets[i + 1]; p++)
+						simd::axpy((t) (alpha * values[p]), b + indices[p] * width, c + i * width, width);
+				};
+
+				if (!tuning::parallel(tuning::Op::MATMUL, nnz() * width))
+				{
+					for (uint64 i = 0; i < rows; i++)
+						row(i);
+				}
+				else
+				{
+					long i = 0;
+
+				#pragma omp parallel for shared(rows, row) private(i) default(none) schedule(dynamic, 64)
+					for (i = 0; i < (long) rows; ++i)
+						row(i);
+				}
+			}
+
+			// Every column of this matrix adds to many rows of the result,
+			// so threads take separate blocks of the result's columns
+			inline void cscProduct(const t *b, uint64 width, t *c, t alpha) const
+			{
+				const uint64 cols = shape[1];
+				const long blocks = (long) ((width + sparse::columnBlock - 1) / sparse::columnBlock);
+
+				auto block = [&](uint64 index)
+				{
+					const uint64 first = index * sparse::columnBlock;
+					const uint64 len = math::min(sparse::columnBlock, width - first);
+
+					for (uint64 j = 0; j < cols; j++)
+					{
+						for (uint64 p = offsets[j]; p < offsets[j + 1]; p++)
+						{
+							const t factor = alpha * values[p];
+							const t *src = b + j * width + first;
+							t *dst = c + indices[p] * width + first;
+
+							for (uint64 k = 0; k < len; k++)
+								dst[k] += factor * src[k];
+						}
+					}
+				};
+
+				if (!tuning::parallel(tuning::Op::MATMUL, nnz() * width) || blocks < 2)
+				{
+					for (long index = 0; index < blocks; index++)
+						block(index);
+				}
+				else
+				{
+					long index = 0;
+
+				#pragma omp parallel for shared(blocks, block) private(index) default(none)
+					for (index = 0; index < blocks; ++index)
+						block(index);
+				}
+			}
+		};
+
+		/// <summary>
+		/// Multiply a sparse matrix elementwise by a dense array
+		/// with the same shape, giving a sparse matrix
+		/// </summary>
+		/// <typeparam name="t"></typeparam>
+		/// <param name="lhs"></param>
+		/// <param name="rhs"></param>
+		/// <returns></returns>
+		template<typename t>
+		inline SparseArray<t> operator*(const SparseArray<t> &lhs, const Array<t> &rhs)
+		{
+			return lhs.multiply(rhs);
+		}
+
+		template<typename t>
+		inline SparseArray<t> operator*(const Array<t> &lhs, const SparseArray<t> &rhs)
+		{
+			return rhs.multiply(lhs);
+		}
+
+		template<typename arrayType>
+		inline Array<arrayType> Array<arrayType>::dot(const SparseArray<arrayType> &other) const
+		{
+			return other.rdot(*this);
+		}
+	}
+}
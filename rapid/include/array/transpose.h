@@ -0,0 +1,235 @@
+#pragma once
+
+#include "../internal.h"
+#include "../tuning.h"
+
+#include "simd.h"
+
+namespace rapid
+{
+	namespace ndarray
+	{
+		namespace transpose
+		{
+			/// <summary>
+			/// The side length of the square tiles used when the source and
+			/// destination are laid out in different orders. A tile of each
+			/// fits in the L1 cache for every element size up to 8 bytes
+			/// </summary>
+			constexpr uint64 tileSize = 32;
+
+			namespace imp
+			{
+				/// <summary>
+				/// A dimension of a strided copy, with the number of elements
+				/// to step over in the source and in the destination for each
+				/// position along it
+				/// </summary>
+				struct Dim
+				{
+					uint64 len;
+					uint64 src;
+					uint64 dst;
+				};
+
+				/// <summary>
+				/// Sort the dimensions of a copy into the order the destination
+				/// is laid out in memory, and merge dimensions that are laid out
+				/// the same way in both arrays, so they can be copied as one
+				/// </summary>
+				inline std::vector<Dim> simplify(const std::vector<uint64> &shape, const std::vector<uint64> &srcStrides,
+												 const std::vector<uint64> &dstStrides)
+				{
+					std::vector<Dim> dims;
+					for (uint64 i = 0; i < shape.size(); i++)
+						if (shape[i] != 1)
+							dims.push_back({shape[i], srcStrides[i], dstStrides[i]});
+
+					std::stable_sort(dims.begin(), dims.end(), [](const Dim &a, const Dim &b)
+					{
+						return a.dst > b.dst;
+					});
+
+					std::vector<Dim> res;
+					for (const auto &dim : dims)
+					{
+						if (!res.empty() && res.back().src == dim.src * dim.len && res.back().dst == dim.dst * dim.len)
+						{
+							res.back().len *= dim.len;
+							res.back().src = dim.src;
+							res.back().dst = dim.dst;
+						}
+						else
+						{
+							res.push_back(dim);
+						}
+					}
+
+					if (res.empty())
+						res.push_back({1, 1, 1});
+
+					return res;
+				}
+
+				/// <summary>
+				/// Copy every element covered by "dims", one row of the
+				/// innermost dimension at a time
+				/// </summary>
+				template<typename t>
+				inline void copyRows(const Dim *dims, uint64 count, const t *src, t *dst)
+				{
+					const Dim &dim = dims[0];
+
+					if (count > 1)
+					{
+						for (uint64 i = 0; i < dim.len; i++)
+							copyRows(dims + 1, count - 1, src + i * dim.src, dst + i * dim.dst);
+						return;
+					}
+
+					if (dim.src == 1 && dim.dst == 1)
+					{
+						std::copy(src, src + dim.len, dst);
+					}
+					else
+					{
+						for (uint64 i = 0; i < dim.len; i++)
+							dst[i * dim.dst] = src[i * dim.src];
+					}
+				}
+
+				/// <summary>
+				/// Copy a tile spanning "rows" positions of dimension "a",
+				/// which is innermost in the destination, and "cols" positions
+				/// of dimension "b", which is innermost in the source
+				/// </summary>
+				template<typename t>
+				inline void copyTile(const Dim &a, const Dim &b, const t *src, t *dst, uint64 rows, uint64 cols)
+				{
+					if (a.dst == 1 && b.src == 1)
+					{
+						simd::transposeBlock(src, a.src, dst, b.dst, rows, cols);
+						return;
+					}
+
+					for (uint64 i = 0; i < rows; i++)
+						for (uint64 j = 0; j < cols; j++)
+							dst[i * a.dst + j * b.dst] = src[i * a.src + j * b.src];
+				}
+			}
+
+			/// <summary>
+			/// Copy the elements of an N-D array with the given shape from
+			/// one strided layout to another. The arrays must not overlap.
+			///
+			/// Dimensions that are laid out in the same way in both arrays
+			/// are merged. If the innermost dimension of the destination is
+			/// also the innermost dimension of the source, rows are copied
+			/// directly. Otherwise, the innermost dimensions of the source and
+			/// of the destination are copied in square tiles, which are
+			/// transposed in registers where possible, and the tiles are
+			/// copied in parallel for large arrays
+			/// </summary>
+			/// <typeparam name="t"></typeparam>
+			/// <param name="src"></param>
+			/// <param name="srcStrides"></param>
+			/// <param name="dst"></param>
+			/// <param name="dstStrides"></param>
+			/// <param name="shape"></param>
+			template<typename t>
+			inline void copy(const t *src, const std::vector<uint64> &srcStrides, t *dst,
+							 const std::vector<uint64> &dstStrides, const std::vector<uint64> &shape)
+			{
+				const uint64 size = math::prod(shape);
+				if (size == 0)
+					return;
+
+				const auto dims = imp::simplify(shape, srcStrides, dstStrides);
+				const bool parallel = tuning::parallel(tuning::Op::COPY, size);
+
+				// Find the innermost dimension of the source. Broadcast
+				// dimensions, which do not step at all, are never used
+				// for tiling
+				const uint64 a = dims.size() - 1;
+				uint64 b = a;
+
+				for (uint64 i = 0; i < dims.size(); i++)
+					if (dims[i].src != 0 && dims[i].src < dims[b].src)
+						b = i;
+
+				if (b == a || dims[a].src == 0)
+				{
+					if (!parallel || dims.size() == 1)
+					{
+						imp::copyRows(dims.data(), dims.size(), src, dst);
+						return;
+					}
+
+					// Split the outermost dimension between the threads
+					const imp::Dim outer = dims[0];
+					long index = 0;
+
+				#pragma omp parallel for shared(dims, outer, src, dst) private(index) default(none)
+					for (index = 0; index < (long) outer.len; ++index)
+						imp::copyRows(dims.data() + 1, dims.size() - 1, src + index * outer.src, dst + index * outer.dst);
+
+					return;
+				}
+
+				// Every other dimension is looped over outside the tiles
+				std::vector<imp::Dim> outer;
+				uint64 outerCount = 1;
+
+				for (uint64 i = 0; i < dims.size(); i++)
+				{
+					if (i != a && i != b)
+					{
+						outer.push_back(dims[i]);
+						outerCount *= dims[i].len;
+					}
+				}
+
+				const imp::Dim dimA = dims[a], dimB = dims[b];
+				const uint64 tilesA = (dimA.len + tileSize - 1) / tileSize;
+				const uint64 tilesB = (dimB.len + tileSize - 1) / tileSize;
+				const long tiles = (long) (outerCount * tilesA * tilesB);
+
+				auto copyTile = [&](uint64 tile)
+				{
+					const uint64 tileA = tile % tilesA;
+					const uint64 tileB = (tile / tilesA) % tilesB;
+					uint64 rest = tile / (tilesA * tilesB);
+
+					const t *tileSrc = src + tileA * tileSize * dimA.src + tileB * tileSize * dimB.src;
+					t *tileDst = dst + tileA * tileSize * dimA.dst + tileB * tileSize * dimB.dst;
+
+					for (uint64 i = outer.size(); i > 0; i--)
+					{
+						const uint64 pos = rest % outer[i - 1].len;
+						rest /= outer[i - 1].len;
+						tileSrc += pos * outer[i - 1].src;
+						tileDst += pos * outer[i - 1].dst;
+					}
+
+					imp::copyTile(dimA, dimB, tileSrc, tileDst,
+								  math::min(tileSize, dimA.len - tileA * tileSize),
+								  math::min(tileSize, dimB.len - tileB * tileSize));
+				};
+
+				if (!parallel)
+				{
+					for (long tile = 0; tile < tiles; tile++)
+						copyTile(tile);
+				}
+				else
+				{
+					long tile = 0;
+
+				#pragma omp parallel for shared(tiles, copyTile) private(tile) default(none)
+					for (tile = 0; tile < tiles; ++tile)
+						copyTile(tile);
+				}
+			}
+		}
+	}
+}
@@ -1,10 +1,12 @@
 ﻿#pragma once
 
 #include <cstdlib>
+#include <cstring>
 
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
 
 #include <array>
 #include <string>
@@ -27,6 +29,7 @@
 #include <unordered_map>
 
 #include <thread>
+#include <atomic>
 
 // Doesn't work for unknown reasons
 #define RAPID_NO_AMP
@@ -168,9 +171,9 @@ using float64 = double;
 #endif
 #endif
 
-#if defined(_M_IX86)
+#if defined(_M_IX86) || defined(__i386__)
 #define RAPID_X86
-#elif defined(_M_X64)
+#elif defined(_M_X64) || defined(__x86_64__)
 #define RAPID_X64
 #else
 #define RAPID_BUILD_UNKNOWN
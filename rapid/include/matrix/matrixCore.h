@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../internal.h"
+#include "../tuning.h"
+#include "../array/reduce.h"
 #include "matrixArrayView.h"
 #include "../IO/createDir.h"
 #include "../messageBox.h"
@@ -73,7 +75,7 @@ namespace rapid
 				// Matrix-matrix and matrix-scalar arithmetic operators
 				if (op >= RAPID_MATH_OP_MATRIX_MATRIX_ADDITION && op <= RAPID_MATH_OP_MATRIX_SCALAR_DIVISION)
 				{
-					if (M * N < 600 * 600)
+					if (!tuning::parallel(tuning::Op::ARITHMETIC, M * N))
 						return RAPID_MATH_MODE_SERIAL;
 					return RAPID_MATH_MODE_PARALLEL;
 				}
@@ -81,7 +83,7 @@ namespace rapid
 				// Matrix unary operation
 				if (op == RAPID_MATH_OP_MATRIX_UNARY)
 				{
-					if (M * N < 600 * 600)
+					if (!tuning::parallel(tuning::Op::MAP, M * N))
 						return RAPID_MATH_MODE_SERIAL;
 					return RAPID_MATH_MODE_PARALLEL;
 				}
@@ -89,7 +91,7 @@ namespace rapid
 				// Transposition
 				if (op == RAPID_MATH_OP_MATRIX_TRANSPOSE)
 				{
-					if (M * N < 550 * 500)
+					if (!tuning::parallel(tuning::Op::COPY, M * N))
 						return RAPID_MATH_MODE_SERIAL;
 					return RAPID_MATH_MODE_PARALLEL;
 				}
@@ -101,8 +103,7 @@ namespace rapid
 					if (M * N * K >= 400 * 400 * 400)
 						return RAPID_MATH_MODE_MASSIVE_PARALLEL;
 				#endif
-					// if (M * N * K >= 50 * 50 * 50)
-					if (M * N * K >= 20 * 20 * 20)
+					if (tuning::parallel(tuning::Op::MATMUL, M * N * K))
 						return RAPID_MATH_MODE_PARALLEL;
 					return RAPID_MATH_MODE_SERIAL;
 				}
@@ -1053,32 +1054,17 @@ namespace rapid
 
 			inline dataType largest() const
 			{
-				auto big = (dataType) -INFINITY;
-
-				for (const auto &val : data)
-					if (val > big)
-						big = val;
-
-				return big;
+				return ndarray::reduce::reduce<ndarray::expr::Maximum>(data.data(), rows * cols);
 			}
 
 			inline dataType smallest() const
 			{
-				auto smol = (dataType) INFINITY;
-
-				for (const auto &val : data)
-					if (val < smol)
-						smol = val;
-
-				return smol;
+				return ndarray::reduce::reduce<ndarray::expr::Minimum>(data.data(), rows * cols);
 			}
 
 			inline dataType sum() const
 			{
-				dataType total = 0;
-
-				for (const auto &val : data)
-					total += val;
+				dataType total = ndarray::reduce::reduce<ndarray::expr::Add>(data.data(), rows * cols);
 
 			#ifdef RAPID_CHECK_NAN
 				if (total != total)
@@ -1098,22 +1084,19 @@ namespace rapid
 			inline dataType stddev() const
 			{
 				auto meanAverage = mean();
-				Matrix<dataType> variance(rows * cols, 1, 0);
+				std::vector<dataType> variance(rows * cols);
 
-				uint64 index = 0;
-				for (const auto &val : data)
-				{
-					variance[index][0] = (val - meanAverage) * (val - meanAverage);
+				for (uint64 index = 0; index < rows * cols; index++)
+					variance[index] = (data[index] - meanAverage) * (data[index] - meanAverage);
 
-				#ifdef RAPID_CHECK_NAN
-					if (variance[index] != variance[index])
-						message::RapidError("NaN detected", "NaN detected in matrix-scalar inplace addition");
-				#endif
+				auto total = ndarray::reduce::reduce<ndarray::expr::Add>(variance.data(), rows * cols);
 
-					index++;
-				}
+			#ifdef RAPID_CHECK_NAN
+				if (total != total)
+					message::RapidError("NaN detected", "NaN detected in matrix standard deviation");
+			#endif
 
-				return sqrt(variance.mean());
+				return sqrt(total / (rows * cols));
 			}
 
 			inline MatrixSize size() const
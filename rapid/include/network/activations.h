@@ -65,10 +65,10 @@ namespace rapid
 
 				ndarray::Array<t> weight(const std::vector<uint64> &shape) const override
 				{
-					auto std = std::sqrt(2. / (t) m_PrevNodes);
-					auto res = ndarray::Array<t>(shape);
-					res.fillRandom();
-					return res * std;
+					// He initialization. Truncating at two standard deviations
+					// shrinks the spread by a factor of 0.8796, which is undone here
+					auto std = std::sqrt(2. / (t) m_PrevNodes) / 0.87962566103423978;
+					return ndarray::truncatedNormal<t>(shape, 0, (t) std);
 				}
 
 			private:
@@ -96,10 +96,10 @@ namespace rapid
 
 				ndarray::Array<t> weight(const std::vector<uint64> &shape) const override
 				{
-					auto std = std::sqrt(2. / (t) m_PrevNodes);
-					auto res = ndarray::Array<t>(shape);
-					res.fillRandom();
-					return res * std;
+					// He initialization. Truncating at two standard deviations
+					// shrinks the spread by a factor of 0.8796, which is undone here
+					auto std = std::sqrt(2. / (t) m_PrevNodes) / 0.87962566103423978;
+					return ndarray::truncatedNormal<t>(shape, 0, (t) std);
 				}
 
 			private:
@@ -129,9 +129,7 @@ namespace rapid
 				{
 					auto lower = -1. / std::sqrt((t) m_PrevNodes);
 					auto upper = 1. / std::sqrt((t) m_PrevNodes);
-					auto res = ndarray::Array<t>(shape);
-					res.fillRandom(lower, upper);
-					return lower + res * (upper - lower);
+					return ndarray::uniform<t>(shape, (t) lower, (t) upper);
 				}
 
 			private:
@@ -149,7 +147,7 @@ namespace rapid
 
 				ndarray::Array<t> f(const ndarray::Array<t> &arr) const override
 				{
-					return 1. / (1. + ndarray::exp(-arr));
+					return ndarray::sigmoid(arr);
 				}
 
 				ndarray::Array<t> df(const ndarray::Array<t> &arr) const override
@@ -161,9 +159,7 @@ namespace rapid
 				{
 					auto lower = -1 / std::sqrt((t) m_PrevNodes);
 					auto upper = 1 / std::sqrt((t) m_PrevNodes);
-					auto res = ndarray::Array<t>(shape);
-					res.fillRandom(lower, upper);
-					return lower + res * (upper - lower);
+					return ndarray::uniform<t>(shape, (t) lower, (t) upper);
 				}
 
 			private:
@@ -68,7 +68,7 @@ namespace rapid
 					// is controlled by the optimizer, while the bias is
 					// updated by adding the gradients
 
-					auto gradient = m_Activation->df(m_PrevOutput) * error;
+					ndarray::Array<t> gradient = m_Activation->df(m_PrevOutput) * error;
 					auto transposed = m_PrevLayer->getPrevOutput().transposed();
 					auto dx = gradient.dot(transposed);
 					m_W = m_Optimizer->apply(m_W, dx);
@@ -401,7 +401,7 @@ namespace rapid
 			#endif
 
 				auto output = forward(fixedInput, false);
-				auto loss = fixedTarget - output;
+				ndarray::Array<t> loss = fixedTarget - output;
 
 				for (int64 i = m_Layers.size() - 1; i >= 0; i--)
 					loss.set(m_Layers[i]->backward(loss));
@@ -540,7 +540,7 @@ namespace rapid
 
 					if (m_TrackLoss)
 					{
-						auto meanAvg = ndarray::mean(totalLoss / (t) batchSize);
+						auto meanAvg = (t) ndarray::mean(totalLoss / (t) batchSize);
 						m_LossRecord.emplace_back(meanAvg * meanAvg);
 					}
 
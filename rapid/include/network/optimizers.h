@@ -185,7 +185,7 @@ namespace rapid
 					if (!m_Cache.isInitialized())
 						m_Cache.set(ndarray::zerosLike(x));
 
-					m_Cache.set(m_DecayRate * m_Cache + (1 - m_DecayRate) * (dx * dx));
+					m_Cache = m_DecayRate * m_Cache + (1 - m_DecayRate) * (dx * dx);
 					auto nextX = x + (m_LearningRate * dx) / (ndarray::sqrt(m_Cache) + m_Epsilon);
 
 					return nextX;
@@ -93,8 +93,12 @@ namespace rapid
 		{
 			// Random floating point value in range [min, max)
 
-			static std::uniform_real_distribution<type> distribution(0., 1.);
-			static std::mt19937 generator(TIME * 1000000);
+			// Each thread has its own generator, so this can be called
+			// from parallel loops
+
+			static thread_local std::uniform_real_distribution<type> distribution(0., 1.);
+			static thread_local std::mt19937 generator((uint32) (TIME * 1000000) ^
+													   (uint32) std::hash<std::thread::id>()(std::this_thread::get_id()));
 			return min + (max - min) * distribution(generator);
 		}
 
@@ -103,8 +107,6 @@ namespace rapid
 		{
 			// Random integral value in range [min, max]
 
-			static std::uniform_real_distribution<float64> distribution(0., 1.);
-			static std::mt19937 generator(TIME * 1000000);
 			return (type) random((float64) min, (float64) max + 1);
 		}
 
@@ -0,0 +1,463 @@
+#pragma once
+
+#include "internal.h"
+
+#include <limits>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace rapid
+{
+	namespace tuning
+	{
+		/// <summary>
+		/// Classes of operation with their own serial/parallel crossover
+		/// point. The work of an operation is the number of elements it
+		/// produces, except for MATMUL, where it is the number of
+		/// multiply-adds (M * N * K)
+		/// </summary>
+		enum class Op
+		{
+			ARITHMETIC = 0,		// Cheap elementwise expressions and fills
+			ELEMENTWISE = 1,	// Expensive elementwise functions, such as exp, pow and casts
+			MAP = 2,			// User supplied functions and random values
+			COPY = 3,			// Strided copies, such as transposes
+			MATMUL = 4,			// Matrix products without BLAS
+			REDUCE = 5,			// Sums, products, minimums and maximums
+			COUNT = 6
+		};
+
+		/// <summary>
+		/// A threshold of this value means the operation is never run
+		/// in parallel
+		/// </summary>
+		constexpr uint64 never = (uint64) -1;
+
+		/// <summary>
+		/// A set of crossover points, one for each class of operation.
+		/// An operation is run in parallel if its work is greater than
+		/// the threshold
+		/// </summary>
+		struct Profile
+		{
+			uint64 thresholds[(int) Op::COUNT] = {1000000, 10000, 10000, 1000000, 8000, 100000};
+
+			inline uint64 &operator[](Op op)
+			{
+				return thresholds[(int) op];
+			}
+
+			inline uint64 operator[](Op op) const
+			{
+				return thresholds[(int) op];
+			}
+		};
+
+		namespace imp
+		{
+			/// <summary>
+			/// The names used for each operation in profile files and in
+			/// environment variables (upper case, prefixed by RAPID_THRESHOLD_)
+			/// </summary>
+			inline const char *opName(Op op)
+			{
+				static const char *names[] = {"arithmetic", "elementwise", "map", "copy", "matmul", "reduce"};
+				return names[(int) op];
+			}
+
+			inline bool parseThreshold(const std::string &str, uint64 &res)
+			{
+				if (str == "never")
+				{
+					res = never;
+					return true;
+				}
+
+				try
+				{
+					size_t end;
+					res = std::stoull(str, &end);
+					return end == str.size();
+				}
+				catch (...)
+				{
+					return false;
+				}
+			}
+
+			inline std::string thresholdString(uint64 threshold)
+			{
+				return threshold == never ? std::string("never") : std::to_string(threshold);
+			}
+
+			inline std::atomic<uint64> *activeThresholds();
+		}
+
+		/// <summary>
+		/// Return the default location of the profile. This is the value of
+		/// the RAPID_PROFILE environment variable if it is set, otherwise
+		/// ".rapid_profile" in the home directory
+		/// </summary>
+		/// <returns></returns>
+		inline std::string defaultProfilePath()
+		{
+			const char *path = std::getenv("RAPID_PROFILE");
+			if (path != nullptr)
+				return path;
+
+		#ifdef RAPID_OS_WINDOWS
+			const char *home = std::getenv("USERPROFILE");
+		#else
+			const char *home = std::getenv("HOME");
+		#endif
+
+			return home == nullptr ? std::string(".rapid_profile") : std::string(home) + "/.rapid_profile";
+		}
+
+		/// <summary>
+		/// Read a profile from a file containing one "name value" pair per
+		/// line, starting from "profile". Returns false if the file could
+		/// not be opened. Unknown names are ignored
+		/// </summary>
+		/// <param name="path"></param>
+		/// <param name="profile"></param>
+		/// <returns></returns>
+		inline bool readProfile(const std::string &path, Profile &profile)
+		{
+			std::ifstream file(path);
+			if (!file.is_open())
+				return false;
+
+			std::string name, value;
+			while (file >> name >> value)
+			{
+				for (int op = 0; op < (int) Op::COUNT; op++)
+				{
+					uint64 threshold;
+					if (name == imp::opName((Op) op) && imp::parseThreshold(value, threshold))
+						profile[(Op) op] = threshold;
+				}
+			}
+
+			return true;
+		}
+
+		/// <summary>
+		/// Write a profile to a file in the format read by readProfile.
+		/// Returns false if the file could not be written
+		/// </summary>
+		/// <param name="path"></param>
+		/// <param name="profile"></param>
+		/// <returns></returns>
+		inline bool writeProfile(const std::string &path, const Profile &profile)
+		{
+			std::ofstream file(path);
+			if (!file.is_open())
+				return false;
+
+			for (int op = 0; op < (int) Op::COUNT; op++)
+				file << imp::opName((Op) op) << " " << imp::thresholdString(profile[(Op) op]) << "\n";
+
+			return file.good();
+		}
+
+		/// <summary>
+		/// Replace thresholds in a profile with the values of any
+		/// RAPID_THRESHOLD_<NAME> environment variables, such as
+		/// RAPID_THRESHOLD_ARITHMETIC=500000 or RAPID_THRESHOLD_MATMUL=never
+		/// </summary>
+		/// <param name="profile"></param>
+		inline void applyEnvironment(Profile &profile)
+		{
+			for (int op = 0; op < (int) Op::COUNT; op++)
+			{
+				std::string name = std::string("RAPID_THRESHOLD_") + imp::opName((Op) op);
+				std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+
+				const char *value = std::getenv(name.c_str());
+				uint64 threshold;
+
+				if (value != nullptr && imp::parseThreshold(value, threshold))
+					profile[(Op) op] = threshold;
+			}
+		}
+
+		/// <summary>
+		/// Return the profile used when the program starts. This is made
+		/// from the default thresholds, then the profile file, if there is
+		/// one, then the environment
+		/// </summary>
+		/// <returns></returns>
+		inline Profile startupProfile()
+		{
+			Profile profile;
+			readProfile(defaultProfilePath(), profile);
+			applyEnvironment(profile);
+			return profile;
+		}
+
+		/// <summary>
+		/// Return the threshold in use for a class of operation
+		/// </summary>
+		/// <param name="op"></param>
+		/// <returns></returns>
+		inline uint64 threshold(Op op)
+		{
+			return imp::activeThresholds()[(int) op].load(std::memory_order_relaxed);
+		}
+
+		/// <summary>
+		/// Set the threshold for a class of operation
+		/// </summary>
+		/// <param name="op"></param>
+		/// <param name="value"></param>
+		inline void setThreshold(Op op, uint64 value)
+		{
+			imp::activeThresholds()[(int) op].store(value, std::memory_order_relaxed);
+		}
+
+		/// <summary>
+		/// Return the thresholds in use
+		/// </summary>
+		/// <returns></returns>
+		inline Profile activeProfile()
+		{
+			Profile profile;
+			for (int op = 0; op < (int) Op::COUNT; op++)
+				profile[(Op) op] = threshold((Op) op);
+			return profile;
+		}
+
+		/// <summary>
+		/// Use the thresholds of a profile for every operation
+		/// </summary>
+		/// <param name="profile"></param>
+		inline void setProfile(const Profile &profile)
+		{
+			for (int op = 0; op < (int) Op::COUNT; op++)
+				setThreshold((Op) op, profile[(Op) op]);
+		}
+
+		/// <summary>
+		/// Returns true if an operation with the given amount of work
+		/// should be run in parallel
+		/// </summary>
+		/// <param name="op"></param>
+		/// <param name="work"></param>
+		/// <returns></returns>
+		inline bool parallel(Op op, uint64 work)
+		{
+			return work > threshold(op);
+		}
+
+		namespace imp
+		{
+			inline std::atomic<uint64> *activeThresholds()
+			{
+				static std::atomic<uint64> thresholds[(int) Op::COUNT];
+				static bool initialized = [&]()
+				{
+					const auto profile = startupProfile();
+					for (int op = 0; op < (int) Op::COUNT; op++)
+						thresholds[op].store(profile[(Op) op]);
+					return true;
+				}();
+
+				(void) initialized;
+				return thresholds;
+			}
+
+			/// <summary>
+			/// Return the shortest time, in seconds, taken to run a function
+			/// </summary>
+			template<typename Lambda>
+			inline double bestTime(int repeats, Lambda func)
+			{
+				double best = std::numeric_limits<double>::max();
+
+				for (int i = 0; i < repeats; i++)
+				{
+					auto start = std::chrono::steady_clock::now();
+					func();
+					auto end = std::chrono::steady_clock::now();
+					best = std::min(best, std::chrono::duration<double>(end - start).count());
+				}
+
+				return best;
+			}
+
+			/// <summary>
+			/// Calculate the amount of work above which running in parallel
+			/// is faster, given the time taken to fork and join the threads
+			/// and the time taken for "work" units of work in serial and in
+			/// parallel
+			/// </summary>
+			inline uint64 crossover(double overhead, uint64 work, double serial, double parallel)
+			{
+				const double serialCost = serial / (double) work;
+				const double parallelCost = (parallel - overhead) / (double) work;
+
+				// Treat parallel execution as useless unless it saves at least
+				// 10% of the time spent on each unit of work
+				if (parallelCost >= serialCost * 0.9)
+					return never;
+
+				return (uint64) std::max(1.0, overhead / (serialCost - parallelCost));
+			}
+
+			using unaryFunc = double (*)(double);
+
+			inline double opaque(double x)
+			{
+				return x * 0.5 + 1;
+			}
+		}
+
+		/// <summary>
+		/// Measure the crossover points on this computer. The time taken to
+		/// start and finish a parallel loop is measured, as is the time for
+		/// a representative loop of every class of operation, run both in
+		/// serial and in parallel. This takes around a second. The result
+		/// is returned, but not used until passed to setProfile, and can be
+		/// saved with writeProfile so it is loaded at startup
+		/// </summary>
+		/// <returns></returns>
+		inline Profile calibrate()
+		{
+			Profile profile;
+
+		#ifdef _OPENMP
+			const long threads = omp_get_max_threads();
+		#else
+			const long threads = 1;
+		#endif
+
+			if (threads < 2)
+			{
+				for (int op = 0; op < (int) Op::COUNT; op++)
+					profile[(Op) op] = never;
+				return profile;
+			}
+
+			const int repeats = 10;
+
+			// Fork/join overhead of an empty parallel loop
+			std::vector<double> sink(threads * 8);
+			const double overhead = imp::bestTime(repeats * 10, [&]()
+			{
+				long i = 0;
+
+			#pragma omp parallel for shared(threads, sink) private(i) default(none)
+				for (i = 0; i < threads; ++i)
+					sink[i * 8] += 1;
+			});
+
+			// Each loop is run over "n" elements in serial (parallel = false)
+			// and in parallel, and the results compared
+			const long n = 1 << 22;
+			std::vector<double> a(n), b(n), c(n);
+
+			for (long i = 0; i < n; i++)
+			{
+				a[i] = (double) (i % 1000) * 0.001;
+				b[i] = (double) (i % 7);
+			}
+
+			auto measure = [&](Op op, long work, const std::function<void(bool)> &loop)
+			{
+				loop(false);
+				const double serial = imp::bestTime(repeats, [&]() { loop(false); });
+				const double parallel = imp::bestTime(repeats, [&]() { loop(true); });
+				profile[op] = imp::crossover(overhead, work, serial, parallel);
+			};
+
+			measure(Op::ARITHMETIC, n, [&](bool par)
+			{
+				long i = 0;
+				double *pa = a.data(), *pb = b.data(), *pc = c.data();
+
+			#pragma omp parallel for if(par) shared(pa, pb, pc, n) private(i) default(none)
+				for (i = 0; i < n; ++i)
+					pc[i] = pa[i] + pb[i];
+			});
+
+			const long expN = n / 16;
+			measure(Op::ELEMENTWISE, expN, [&](bool par)
+			{
+				long i = 0;
+				double *pa = a.data(), *pc = c.data();
+
+			#pragma omp parallel for if(par) shared(pa, pc, expN) private(i) default(none)
+				for (i = 0; i < expN; ++i)
+					pc[i] = std::exp(pa[i]);
+			});
+
+			// Functions are called through a pointer, as the compiler cannot
+			// see into the functions passed to "mapped"
+			volatile imp::unaryFunc func = imp::opaque;
+			measure(Op::MAP, n, [&](bool par)
+			{
+				long i = 0;
+				double *pa = a.data(), *pc = c.data();
+				imp::unaryFunc f = func;
+
+			#pragma omp parallel for if(par) shared(pa, pc, n, f) private(i) default(none)
+				for (i = 0; i < n; ++i)
+					pc[i] = f(pa[i]);
+			});
+
+			const long side = 2048;
+			measure(Op::COPY, side * side, [&](bool par)
+			{
+				long row = 0;
+				double *pa = a.data(), *pc = c.data();
+
+			#pragma omp parallel for if(par) shared(pa, pc, side) private(row) default(none)
+				for (row = 0; row < side; ++row)
+					for (long col = 0; col < side; col++)
+						pc[row * side + col] = pa[col * side + row];
+			});
+
+			const long dim = 128;
+			measure(Op::MATMUL, dim * dim * dim, [&](bool par)
+			{
+				long i = 0;
+				double *pa = a.data(), *pb = b.data(), *pc = c.data();
+
+			#pragma omp parallel for if(par) shared(pa, pb, pc, dim) private(i) default(none)
+				for (i = 0; i < dim; ++i)
+				{
+					for (long j = 0; j < dim; j++)
+					{
+						double tmp = 0;
+						for (long k = 0; k < dim; k++)
+							tmp += pa[i * dim + k] * pb[k * dim + j];
+						pc[i * dim + j] = tmp;
+					}
+				}
+			});
+
+			// Reductions write one partial result per block, so the cost of
+			// each element is that of reading it
+			const long blocks = n / 4096;
+			measure(Op::REDUCE, n, [&](bool par)
+			{
+				long block = 0;
+				double *pa = a.data(), *pc = c.data();
+
+			#pragma omp parallel for if(par) shared(pa, pc, blocks) private(block) default(none)
+				for (block = 0; block < blocks; ++block)
+				{
+					double tmp = 0;
+					for (long i = block * 4096; i < (block + 1) * 4096; i++)
+						tmp += pa[i];
+					pc[block] = tmp;
+				}
+			});
+
+			return profile;
+		}
+	}
+}
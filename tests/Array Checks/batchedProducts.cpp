@@ -0,0 +1,81 @@
+#include "checks.h"
+
+// Batched matrix products of arrays with three or more dimensions: many
+// small products split between threads, a few large products, batches of
+// transposed matrices and results accumulated into an existing array
+
+using namespace checks;
+
+// The products of every pair of "m x n" and "n x k" matrices of two
+// contiguous stacks of "batch" matrices
+template<typename t>
+std::vector<t> products(const std::vector<t> &a, const std::vector<t> &b,
+						uint64 batch, uint64 m, uint64 n, uint64 k)
+{
+	std::vector<t> res(batch * m * k, 0);
+	for (uint64 i = 0; i < batch; i++)
+		for (uint64 r = 0; r < m; r++)
+			for (uint64 c = 0; c < k; c++)
+				for (uint64 x = 0; x < n; x++)
+					res[(i * m + r) * k + c] += a[(i * m + r) * n + x] * b[(i * n + x) * k + c];
+	return res;
+}
+
+template<typename t>
+void checkBatch(const std::vector<uint64> &batch, uint64 m, uint64 n, uint64 k, const std::string &name)
+{
+	auto shapeA = batch, shapeB = batch, shapeC = batch;
+	shapeA.insert(shapeA.end(), {m, n});
+	shapeB.insert(shapeB.end(), {n, k});
+	shapeC.insert(shapeC.end(), {m, k});
+
+	const uint64 count = math::prod(batch);
+	const auto a = pattern<t>(shapeA), b = pattern<t>(shapeB, 4);
+	const auto expected = products(values(a), values(b), count, m, n, k);
+
+	expectEqual(a.dot(b), shapeC, expected, name);
+
+	// Stacks of transposed matrices, which are views of the last two
+	// dimensions of contiguous arrays
+	std::vector<uint64> swap(batch.size() + 2);
+	for (uint64 i = 0; i < swap.size(); i++)
+		swap[i] = i;
+	std::swap(swap[batch.size()], swap[batch.size() + 1]);
+
+	const auto at = a.transposed(swap).copy().transposed(swap);
+	const auto bt = b.transposed(swap).copy().transposed(swap);
+	expectEqual(at.dot(b), shapeC, expected, name + " transposed lhs");
+	expectEqual(a.dot(bt), shapeC, expected, name + " transposed rhs");
+	expectEqual(at.dot(bt), shapeC, expected, name + " transposed both");
+
+	// c = 2 a b + c
+	auto c = pattern<t>(shapeC, 9);
+	auto withBeta = values(c);
+	for (uint64 i = 0; i < withBeta.size(); i++)
+		withBeta[i] += 2 * expected[i];
+	a.dot(b, c, 2, 1);
+	expectEqual(c, shapeC, withBeta, name + " into out with alpha and beta");
+}
+
+template<typename t>
+void checkType(const std::string &type)
+{
+	checkBatch<t>({3}, 2, 5, 4, type + " rank 3");
+	checkBatch<t>({2, 3}, 4, 5, 6, type + " rank 4");
+	checkBatch<t>({2, 1, 2}, 3, 1, 3, type + " rank 5 outer products");
+
+	// Many small products, which are split between threads, and a few
+	// products large enough to be split on their own, with edges that
+	// do not fill a whole kernel block
+	checkBatch<t>({300}, 8, 8, 8, type + " many small");
+	checkBatch<t>({2}, 130, 70, 90, type + " few large");
+}
+
+int main()
+{
+	checkType<float>("float");
+	checkType<double>("double");
+	checkType<int64>("int64");
+
+	return finish("BatchedProducts");
+}
@@ -0,0 +1,114 @@
+#include "checks.h"
+
+// Arithmetic between arrays of different shapes, which are broadcast
+// against each other as in NumPy, with strided operands and results, and
+// with arrays large enough to be evaluated in several blocks
+
+using namespace checks;
+
+// The shape two shapes broadcast to. The shapes are assumed to be
+// compatible
+inline std::vector<uint64> broadcastShape(std::vector<uint64> a, std::vector<uint64> b)
+{
+	while (a.size() < b.size())
+		a.insert(a.begin(), 1);
+	while (b.size() < a.size())
+		b.insert(b.begin(), 1);
+
+	std::vector<uint64> res(a.size());
+	for (uint64 i = 0; i < a.size(); i++)
+		res[i] = a[i] == 1 ? b[i] : a[i];
+	return res;
+}
+
+// The element of a contiguous array of "shape" that is broadcast to the
+// element "index" of an array of "target"
+inline uint64 sourceIndex(const std::vector<uint64> &shape, const std::vector<uint64> &target, uint64 index)
+{
+	uint64 res = 0, stride = 1;
+	for (uint64 i = 0; i < shape.size(); i++)
+	{
+		const uint64 dim = shape.size() - 1 - i;
+		const uint64 targetDim = target.size() - 1 - i;
+		const uint64 pos = index % target[targetDim];
+
+		if (shape[dim] != 1)
+			res += pos * stride;
+		stride *= shape[dim];
+
+		index /= target[targetDim];
+	}
+	return res;
+}
+
+// Apply "op" to every pair of elements of "a" and "b" after broadcasting
+template<typename t, typename F>
+std::vector<t> reference(const Array<t> &a, const Array<t> &b, F op)
+{
+	const auto shape = broadcastShape(a.shape, b.shape);
+	const auto va = values(a), vb = values(b);
+
+	std::vector<t> res(math::prod(shape));
+	for (uint64 i = 0; i < res.size(); i++)
+		res[i] = op(va[sourceIndex(a.shape, shape, i)], vb[sourceIndex(b.shape, shape, i)]);
+	return res;
+}
+
+template<typename t>
+void checkPair(const Array<t> &a, const Array<t> &b, const std::string &name)
+{
+	const auto shape = broadcastShape(a.shape, b.shape);
+
+	expectEqual(Array<t>(a + b), shape, reference(a, b, [](t x, t y) { return x + y; }), name + " add");
+	expectEqual(Array<t>(a - b), shape, reference(a, b, [](t x, t y) { return x - y; }), name + " sub");
+	expectEqual(Array<t>(b * a), shape, reference(b, a, [](t x, t y) { return x * y; }), name + " mul");
+
+	// Offset the divisor so it is never zero
+	const Array<t> divisor = b + (t) 6;
+	expectEqual(Array<t>(a / divisor), shape, reference(a, divisor, [](t x, t y) { return x / y; }), name + " div");
+}
+
+template<typename t>
+void checkType(const std::string &type)
+{
+	// Rows, columns, outer products and a single element
+	checkPair(pattern<t>({4, 6}), pattern<t>({6}, 2), type + " row");
+	checkPair(pattern<t>({4, 6}), pattern<t>({4, 1}, 2), type + " column");
+	checkPair(pattern<t>({4, 1}), pattern<t>({1, 6}, 2), type + " outer");
+	checkPair(pattern<t>({4, 6}), pattern<t>({1}, 2), type + " single element");
+	checkPair(pattern<t>({1}), pattern<t>({4, 6}, 2), type + " single element first");
+
+	// Dimensions broadcast on both sides, with different numbers of
+	// dimensions
+	checkPair(pattern<t>({3, 1, 4}), pattern<t>({5, 1}, 2), type + " both sides");
+	checkPair(pattern<t>({2, 1, 3, 1}), pattern<t>({4, 1, 5}, 2), type + " four dimensions");
+
+	// Strided operands
+	checkPair(pattern<t>({6, 4}).transposed(), pattern<t>({6}, 2), type + " transposed row");
+	checkPair(pattern<t>({4, 6}), pattern<t>({1, 4}, 2).transposed(), type + " transposed column");
+
+	// An expression assigned to a transposed view of an existing array
+	{
+		Array<t> parent({6, 4});
+		auto view = parent.transposed();
+		const auto a = pattern<t>({4, 6}), row = pattern<t>({6}, 2);
+		view = a + row;
+
+		expectEqual(parent.transposed(), {4, 6}, reference(a, row, [](t x, t y) { return x + y; }),
+					type + " transposed result");
+	}
+}
+
+int main()
+{
+	checkType<float>("float");
+	checkType<double>("double");
+	checkType<int64>("int64");
+
+	// Arrays of several blocks, which may be evaluated in parallel
+	checkPair(pattern<double>({300, 1000}), pattern<double>({1000}, 2), "large row");
+	checkPair(pattern<double>({300, 1000}), pattern<double>({300, 1}, 2), "large column");
+	checkPair(pattern<float>({30, 1, 1000}), pattern<float>({40, 1}, 2), "large both sides");
+
+	return finish("Broadcasting");
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <array.h>
+
+// Helpers shared by the array checks. Each check reports every case
+// that fails and exits with a non-zero code if any did. Values are
+// small integers, so sums and products of them are exact in floating
+// point and results can be compared for equality
+
+namespace checks
+{
+	using namespace rapid;
+	using namespace rapid::ndarray;
+
+	inline int &failures()
+	{
+		static int count = 0;
+		return count;
+	}
+
+	inline void expect(bool condition, const std::string &name)
+	{
+		if (!condition)
+		{
+			std::cout << "FAILED: " << name << "\n";
+			failures()++;
+		}
+	}
+
+	/// <summary>
+	/// An array of the given shape holding small integers in a fixed,
+	/// irregular pattern
+	/// </summary>
+	template<typename t>
+	inline Array<t> pattern(const std::vector<uint64> &shape, uint64 seed = 1)
+	{
+		Array<t> res(shape);
+		const uint64 size = math::prod(shape);
+		for (uint64 i = 0; i < size; i++)
+			res.dataStart[i] = (t) ((int64) ((i + seed) * 7 % 11) - 5);
+		return res;
+	}
+
+	/// <summary>
+	/// The elements of an array in row-major order
+	/// </summary>
+	template<typename t>
+	inline std::vector<t> values(const Array<t> &arr)
+	{
+		const auto data = arr.copy();
+		return std::vector<t>(data.dataStart, data.dataStart + math::prod(data.shape));
+	}
+
+	template<typename t>
+	inline void expectEqual(const Array<t> &arr, const std::vector<uint64> &shape,
+							const std::vector<t> &expected, const std::string &name)
+	{
+		if (arr.shape != shape)
+		{
+			expect(false, name + " (shape)");
+			return;
+		}
+
+		expect(values(arr) == expected, name);
+	}
+
+	inline int finish(const std::string &name)
+	{
+		if (failures() == 0)
+			std::cout << name << ": all checks passed\n";
+		return failures() == 0 ? 0 : 1;
+	}
+}
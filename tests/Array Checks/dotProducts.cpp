@@ -0,0 +1,110 @@
+#include "checks.h"
+
+// Dense dot products: vector, matrix-vector, vector-matrix, matrix,
+// batched and broadcast products, with transposed views and with
+// results written into an existing array
+
+using namespace checks;
+
+// The product of matrix "i" of "a" with matrix "j" of "b", where both
+// are contiguous and have "m x n" and "n x k" matrices
+template<typename t>
+std::vector<t> product(const std::vector<t> &a, uint64 i, const std::vector<t> &b, uint64 j,
+					   uint64 m, uint64 n, uint64 k)
+{
+	std::vector<t> res(m * k, 0);
+	for (uint64 r = 0; r < m; r++)
+		for (uint64 c = 0; c < k; c++)
+			for (uint64 x = 0; x < n; x++)
+				res[r * k + c] += a[i * m * n + r * n + x] * b[j * n * k + x * k + c];
+	return res;
+}
+
+template<typename t>
+void checkType(const std::string &type)
+{
+	// Vector dot product
+	{
+		const auto a = pattern<t>({7}), b = pattern<t>({7}, 3);
+		const auto va = values(a), vb = values(b);
+		t expected = 0;
+		for (uint64 i = 0; i < 7; i++)
+			expected += va[i] * vb[i];
+
+		expect((t) a.dot(b) == expected, type + " vector . vector");
+	}
+
+	// Matrix-vector and vector-matrix products
+	{
+		const auto m = pattern<t>({4, 5}), v = pattern<t>({5}, 2);
+		expectEqual(m.dot(v), {4}, product(values(m), 0, values(v), 0, 4, 5, 1), type + " matrix . vector");
+		// A vector with the shape of the rows of a matrix is multiplied
+		// by the matrix from the right, as matrix . vector
+		expectEqual(v.dot(m), {4}, product(values(m), 0, values(v), 0, 4, 5, 1), type + " vector . matrix");
+
+		const auto mt = pattern<t>({5, 4}).transposed();
+		expectEqual(mt.dot(v), {4}, product(values(mt), 0, values(v), 0, 4, 5, 1), type + " transposed matrix . vector");
+	}
+
+	// Matrix products, with transposed views
+	{
+		const auto a = pattern<t>({3, 4}), b = pattern<t>({4, 6}, 5);
+		const auto expected = product(values(a), 0, values(b), 0, 3, 4, 6);
+		expectEqual(a.dot(b), {3, 6}, expected, type + " matrix . matrix");
+
+		const auto at = a.transposed().copy().transposed();
+		const auto bt = b.transposed().copy().transposed();
+		expectEqual(at.dot(bt), {3, 6}, expected, type + " transposed matrix . matrix");
+
+		// c = 2 a b + c
+		auto c = pattern<t>({3, 6}, 9);
+		auto withBeta = values(c);
+		for (uint64 i = 0; i < withBeta.size(); i++)
+			withBeta[i] += 2 * expected[i];
+		a.dot(b, c, 2, 1);
+		expectEqual(c, {3, 6}, withBeta, type + " matrix . matrix into out with alpha and beta");
+	}
+
+	// Batched products of the final two dimensions
+	{
+		const auto a = pattern<t>({2, 3, 4}), b = pattern<t>({2, 4, 5}, 4);
+		std::vector<t> expected;
+		for (uint64 i = 0; i < 2; i++)
+		{
+			const auto mat = product(values(a), i, values(b), i, 3, 4, 5);
+			expected.insert(expected.end(), mat.begin(), mat.end());
+		}
+
+		expectEqual(a.dot(b), {2, 3, 5}, expected, type + " batched matrix . matrix");
+	}
+
+	// Every matrix of a stack multiplied by one matrix. As for vectors,
+	// the matrix is on the right whichever side it is given on
+	{
+		const auto stack = pattern<t>({5, 3, 3}), mat = pattern<t>({3, 3}, 6);
+		std::vector<t> expected;
+		for (uint64 i = 0; i < 5; i++)
+		{
+			const auto res = product(values(stack), i, values(mat), 0, 3, 3, 3);
+			expected.insert(expected.end(), res.begin(), res.end());
+		}
+
+		expectEqual(stack.dot(mat), {5, 3, 3}, expected, type + " stack . matrix");
+		expectEqual(mat.dot(stack), {5, 3, 3}, expected, type + " matrix . stack");
+
+		// Every element of an existing output is written
+		Array<t> out({5, 3, 3});
+		out.fill(1000);
+		mat.dot(stack, out);
+		expectEqual(out, {5, 3, 3}, expected, type + " matrix . stack into out");
+	}
+}
+
+int main()
+{
+	checkType<float>("float");
+	checkType<double>("double");
+	checkType<int64>("int64");
+
+	return finish("DotProducts");
+}
@@ -0,0 +1,183 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <array.h>
+
+// Sweep the vectorized elementary functions against a long double
+// reference at every instruction set the processor supports, and check
+// the errors against the table in simdKernels.h. The scalar fallback
+// calls the standard library, so it is not checked. The number of
+// samples for each function can be given as the first argument
+
+using namespace rapid::ndarray;
+
+using Accuracy = simd::Accuracy;
+using Level = simd::Level;
+
+template<typename t>
+long double ulpError(t val, long double ref)
+{
+	if (std::isnan(ref))
+		return std::isnan(val) ? 0 : INFINITY;
+	if (std::isinf(ref) || std::isinf(val))
+		return (long double) val == ref ? 0 : INFINITY;
+
+	// The spacing of the values of type t around the exact result
+	int exponent;
+	std::frexp(ref, &exponent);
+	exponent = std::max(exponent, std::numeric_limits<t>::min_exponent);
+	const long double ulp = std::ldexp(1.0L, exponent - std::numeric_limits<t>::digits);
+
+	return std::fabs((long double) val - ref) / ulp;
+}
+
+// A value of type t spread evenly over [lo, hi]
+template<typename t>
+std::vector<t> uniform(uint64 count, long double lo, long double hi, std::mt19937_64 &rng)
+{
+	std::uniform_real_distribution<long double> dist(lo, hi);
+	std::vector<t> res(count);
+	for (auto &val : res)
+		val = (t) dist(rng);
+	return res;
+}
+
+// A positive value of type t spread evenly over the exponents in
+// [2^lo, 2^hi], with a random sign if "sign" is set
+template<typename t>
+std::vector<t> logUniform(uint64 count, int lo, int hi, bool sign, std::mt19937_64 &rng)
+{
+	std::uniform_real_distribution<long double> dist((long double) lo, (long double) hi);
+	std::vector<t> res(count);
+	for (uint64 i = 0; i < count; i++)
+	{
+		res[i] = (t) std::exp2(dist(rng));
+		if (sign && (rng() & 1))
+			res[i] = -res[i];
+	}
+	return res;
+}
+
+struct Check
+{
+	std::string name;
+	double bound;
+};
+
+static bool passed = true;
+
+template<typename Op, typename t, typename Ref>
+void sweep(const std::string &name, const std::vector<t> &args, Ref ref, double bound, Accuracy mode)
+{
+	const Level levels[] = {Level::SSE2, Level::AVX2, Level::AVX512};
+	const std::string type = std::is_same<t, float>::value ? "float" : "double";
+	const std::string accuracy = mode == Accuracy::FAST ? "FAST" : "PRECISE";
+
+	std::vector<t> out(args.size());
+	long double worst = 0;
+	t worstArg = 0;
+
+	for (const auto level : levels)
+	{
+		if ((int) level > (int) simd::detectLevel())
+			continue;
+
+		simd::setLevel(level);
+		simd::unary<Op>(args.data(), out.data(), args.size());
+
+		for (uint64 i = 0; i < args.size(); i++)
+		{
+			const long double err = ulpError(out[i], ref((long double) args[i]));
+			if (err > worst)
+			{
+				worst = err;
+				worstArg = args[i];
+			}
+		}
+	}
+
+	simd::setLevel(simd::detectLevel());
+
+	const bool ok = worst <= bound;
+	passed = passed && ok;
+
+	std::cout << std::left << std::setw(8) << name << std::setw(8) << type << std::setw(9) << accuracy
+		<< std::setprecision(3) << std::fixed << std::setw(10) << (double) worst << " <= " << bound
+		<< std::setprecision(9) << std::scientific << "  (at " << (double) worstArg << ")"
+		<< (ok ? "" : "  FAILED") << "\n";
+}
+
+long double sigmoidRef(long double x)
+{
+	return 1.0L / (1.0L + std::exp(-x));
+}
+
+long double rsqrtRef(long double x)
+{
+	return 1.0L / std::sqrt(x);
+}
+
+template<typename t, Accuracy mode>
+void sweepAll(uint64 count, const double (&bounds)[6])
+{
+	std::mt19937_64 rng(1234);
+	constexpr bool single = std::is_same<t, float>::value;
+
+	// Arguments over the whole range where the result is finite and
+	// normal, and a second set of small arguments near zero
+	const long double expLimit = single ? 87.0L : 708.0L;
+	auto expArgs = uniform<t>(count, -expLimit, expLimit, rng);
+	auto expSmall = logUniform<t>(count / 4, -30, 0, true, rng);
+	expArgs.insert(expArgs.end(), expSmall.begin(), expSmall.end());
+
+	// Subnormal arguments are only handled by the PRECISE kernels
+	const int minExponent = mode == Accuracy::PRECISE
+		? std::numeric_limits<t>::min_exponent - std::numeric_limits<t>::digits
+		: std::numeric_limits<t>::min_exponent;
+	const auto logArgs = logUniform<t>(count, minExponent, std::numeric_limits<t>::max_exponent - 1, false, rng);
+
+	auto trigArgs = uniform<t>(count, -8192.0L, 8192.0L, rng);
+	auto trigWide = logUniform<t>(count / 4, -20, 24, true, rng);
+	trigArgs.insert(trigArgs.end(), trigWide.begin(), trigWide.end());
+
+	auto tanhArgs = uniform<t>(count, -20.0L, 20.0L, rng);
+	auto tanhSmall = logUniform<t>(count / 4, -30, 0, true, rng);
+	tanhArgs.insert(tanhArgs.end(), tanhSmall.begin(), tanhSmall.end());
+
+	const long double sigmoidLimit = single ? 80.0L : 700.0L;
+	auto sigmoidArgs = uniform<t>(count, -sigmoidLimit, sigmoidLimit, rng);
+	auto sigmoidSmall = logUniform<t>(count / 4, -30, 0, true, rng);
+	sigmoidArgs.insert(sigmoidArgs.end(), sigmoidSmall.begin(), sigmoidSmall.end());
+
+	const auto rsqrtArgs = logUniform<t>(count, minExponent, std::numeric_limits<t>::max_exponent - 1, false, rng);
+
+	sweep<expr::Exp<mode>>("exp", expArgs, [](long double x) { return std::exp(x); }, bounds[0], mode);
+	sweep<expr::Log<mode>>("log", logArgs, [](long double x) { return std::log(x); }, bounds[1], mode);
+	sweep<expr::Sin<mode>>("sin", trigArgs, [](long double x) { return std::sin(x); }, bounds[2], mode);
+	sweep<expr::Cos<mode>>("cos", trigArgs, [](long double x) { return std::cos(x); }, bounds[2], mode);
+	sweep<expr::Tanh<mode>>("tanh", tanhArgs, [](long double x) { return std::tanh(x); }, bounds[3], mode);
+	sweep<expr::Sigmoid<mode>>("sigmoid", sigmoidArgs, sigmoidRef, bounds[4], mode);
+	sweep<expr::Rsqrt<mode>>("rsqrt", rsqrtArgs, rsqrtRef, bounds[5], mode);
+}
+
+int main(int argc, char **argv)
+{
+	const uint64 count = argc > 1 ? std::stoull(argv[1]) : 1000000;
+
+	// The table in simdKernels.h, in the order exp, log, sin and cos,
+	// tanh, sigmoid and rsqrt
+	const double preciseFloat[6] = {2, 1, 3, 2, 3, 2};
+	const double fastFloat[6] = {3, 26, 27, 52, 6, 4};
+	const double precise[6] = {2, 1, 2, 2, 3, 2};
+
+	sweepAll<float, Accuracy::PRECISE>(count, preciseFloat);
+	sweepAll<float, Accuracy::FAST>(count, fastFloat);
+	sweepAll<double, Accuracy::PRECISE>(count, precise);
+	sweepAll<double, Accuracy::FAST>(count, precise);
+
+	std::cout << (passed ? "All errors are within the table\n" : "Some errors are larger than the table\n");
+	return passed ? 0 : 1;
+}
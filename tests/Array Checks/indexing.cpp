@@ -0,0 +1,202 @@
+#include "checks.h"
+
+// Gathers and scatters: take along an axis and of the flattened array,
+// put, extract with a mask and scatterAdd with repeated indices, on
+// contiguous arrays and transposed views
+
+using namespace checks;
+
+// Indices in an irregular order, with repeats, in the range [0, len)
+inline Array<int64> indexPattern(const std::vector<uint64> &shape, uint64 len, uint64 seed = 1)
+{
+	Array<int64> res(shape);
+	const uint64 size = math::prod(shape);
+	for (uint64 i = 0; i < size; i++)
+		res.dataStart[i] = (int64) ((i * 5 + seed) * 13 % len);
+	return res;
+}
+
+// Take "index" along "axis" of a contiguous array of "shape"
+template<typename t>
+std::vector<t> takeReference(const std::vector<t> &data, const std::vector<uint64> &shape,
+							 const std::vector<int64> &index, uint64 axis)
+{
+	uint64 outer = 1, inner = 1;
+	for (uint64 i = 0; i < axis; i++)
+		outer *= shape[i];
+	for (uint64 i = axis + 1; i < shape.size(); i++)
+		inner *= shape[i];
+
+	std::vector<t> res;
+	for (uint64 o = 0; o < outer; o++)
+		for (int64 k : index)
+			for (uint64 c = 0; c < inner; c++)
+				res.push_back(data[(o * shape[axis] + (uint64) k) * inner + c]);
+	return res;
+}
+
+// Add the rows of "values" at "index" along "axis" of "data"
+template<typename t>
+void scatterReference(std::vector<t> &data, const std::vector<uint64> &shape,
+					  const std::vector<int64> &index, const std::vector<t> &values, uint64 axis)
+{
+	uint64 outer = 1, inner = 1;
+	for (uint64 i = 0; i < axis; i++)
+		outer *= shape[i];
+	for (uint64 i = axis + 1; i < shape.size(); i++)
+		inner *= shape[i];
+
+	uint64 row = 0;
+	for (uint64 o = 0; o < outer; o++)
+		for (int64 k : index)
+		{
+			for (uint64 c = 0; c < inner; c++)
+				data[(o * shape[axis] + (uint64) k) * inner + c] += values[row * inner + c];
+			row++;
+		}
+}
+
+template<typename t>
+void checkType(const std::string &type)
+{
+	// Take along each axis, with a two dimensional array of indices
+	{
+		const auto arr = pattern<t>({4, 5, 3});
+		for (uint64 axis = 0; axis < 3; axis++)
+		{
+			const auto index = indexPattern({2, 3}, arr.shape[axis]);
+			auto shape = arr.shape;
+			shape.erase(shape.begin() + axis);
+			shape.insert(shape.begin() + axis, {2, 3});
+
+			expectEqual(take(arr, index, axis), shape, takeReference(values(arr), arr.shape, values(index), axis),
+						type + " take axis " + std::to_string(axis));
+		}
+	}
+
+	// Take from the flattened array and from a transposed view, with
+	// negative indices
+	{
+		const auto arr = pattern<t>({6, 4});
+		const auto index = Array<int64>::fromData({3, -1, 0, -24});
+
+		const auto v = values(arr);
+		expectEqual(take(arr, index), {4}, std::vector<t>({v[3], v[23], v[0], v[0]}), type + " take flattened");
+
+		const auto transposed = arr.transposed();
+		const auto tv = values(transposed);
+		expectEqual(take(transposed, index), {4}, std::vector<t>({tv[3], tv[23], tv[0], tv[0]}),
+					type + " take transposed");
+		const auto rowIndex = Array<int64>::fromData({3, -1, 0, -6});
+		expectEqual(take(transposed, rowIndex, 1), {4, 4},
+					takeReference(tv, {4, 6}, {3, 5, 0, 0}, 1), type + " take transposed axis 1");
+	}
+
+	// Put values, or a single value, at indices of the flattened array
+	{
+		auto arr = pattern<t>({3, 4});
+		auto expected = values(arr);
+		const auto index = Array<int64>::fromData({7, 0, -1});
+		const auto vals = Array<t>::fromData({(t) 9, (t) 8, (t) 7});
+
+		put(arr, index, vals);
+		expected[7] = 9;
+		expected[0] = 8;
+		expected[11] = 7;
+		expectEqual(arr, {3, 4}, expected, type + " put");
+
+		put(arr, index, Array<t>::fromData({(t) 1}));
+		expected[7] = expected[0] = expected[11] = 1;
+		expectEqual(arr, {3, 4}, expected, type + " put single value");
+
+		// A transposed view is written through to its parent
+		auto parent = pattern<t>({3, 4});
+		auto parentExpected = values(parent);
+		auto view = parent.transposed();
+		put(view, Array<int64>::fromData({1, 5}), Array<t>::fromData({(t) 6, (t) 2}));
+		parentExpected[4] = 6;
+		parentExpected[9] = 2;
+		expectEqual(parent, {3, 4}, parentExpected, type + " put transposed");
+	}
+
+	// Extract the elements where a mask is set
+	{
+		const auto arr = pattern<t>({4, 5});
+		const auto v = values(arr);
+		Array<uint8_t> mask({4, 5});
+		std::vector<t> expected;
+		for (uint64 i = 0; i < 20; i++)
+		{
+			mask.dataStart[i] = (uint8_t) (v[i] > 0);
+			if (v[i] > 0)
+				expected.push_back(v[i]);
+		}
+
+		expectEqual(extract(mask, arr), {(uint64) expected.size()}, expected, type + " extract");
+
+		const auto transposed = arr.transposed();
+		const auto tv = values(transposed);
+		expected.clear();
+		for (uint64 i = 0; i < 20; i++)
+			if (tv[i] > 0)
+				expected.push_back(tv[i]);
+
+		expectEqual(extract(mask.transposed(), transposed), {(uint64) expected.size()}, expected,
+					type + " extract transposed");
+	}
+
+	// Scatter rows with repeated indices along each axis
+	{
+		const std::vector<uint64> shape = {4, 5, 3};
+		for (uint64 axis = 0; axis < 3; axis++)
+		{
+			auto out = pattern<t>(shape);
+			const auto index = indexPattern({7}, shape[axis]);
+			auto valueShape = shape;
+			valueShape[axis] = 7;
+			const auto vals = pattern<t>(valueShape, 4);
+
+			auto expected = values(out);
+			scatterReference(expected, shape, values(index), values(vals), axis);
+			scatterAdd(out, index, vals, axis);
+			expectEqual(out, shape, expected, type + " scatterAdd axis " + std::to_string(axis));
+		}
+	}
+}
+
+int main()
+{
+	checkType<float>("float");
+	checkType<double>("double");
+	checkType<int64>("int64");
+
+	// Large gathers of single elements and of rows, which are split
+	// between threads
+	{
+		const auto arr = pattern<int64>({50000});
+		const auto index = indexPattern({100000}, 50000);
+		expectEqual(take(arr, index), {100000}, takeReference(values(arr), {50000}, values(index), 0), "large take");
+
+		const auto rows = pattern<double>({1000, 16});
+		const auto rowIndex = indexPattern({20000}, 1000);
+		expectEqual(take(rows, rowIndex, 0), {20000, 16}, takeReference(values(rows), {1000, 16}, values(rowIndex), 0),
+					"large row take");
+	}
+
+	// Large scatters into a small array, which are summed per thread, and
+	// into a large one, which are added atomically
+	for (uint64 len : {10, 50000})
+	{
+		const std::vector<uint64> shape = {len, 8};
+		auto out = pattern<double>(shape);
+		const auto index = indexPattern({60000}, len);
+		const auto vals = pattern<double>({60000, 8}, 3);
+
+		auto expected = values(out);
+		scatterReference(expected, shape, values(index), values(vals), 0);
+		scatterAdd(out, index, vals, 0);
+		expectEqual(out, shape, expected, "large scatterAdd into " + std::to_string(len) + " rows");
+	}
+
+	return finish("Indexing");
+}
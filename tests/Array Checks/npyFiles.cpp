@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <fstream>
+#include "checks.h"
+
+// Round trips through .npy files and .npz archives: every supported
+// element type, strided arrays, loading with conversion, each mapping
+// mode, and files written in Fortran order
+
+using namespace checks;
+
+template<typename t>
+void checkType(const std::string &type)
+{
+	const std::string path = "npyCheck_" + type + ".npy";
+
+	// Contiguous arrays of several dimensions, including a vector
+	for (const auto &shape : std::vector<std::vector<uint64>>({{7}, {3, 4}, {2, 3, 4}}))
+	{
+		const auto arr = pattern<t>(shape);
+		expect(save(path, arr), type + " save " + expr::shapeToString(shape));
+		expectEqual(load<t>(path), shape, values(arr), type + " load " + expr::shapeToString(shape));
+	}
+
+	// A strided view is saved in row-major order
+	{
+		const auto arr = pattern<t>({3, 5}).transposed();
+		expect(save(path, arr), type + " save transposed");
+		expectEqual(load<t>(path), {5, 3}, values(arr), type + " load transposed");
+	}
+
+	// Values are converted when loaded as another type
+	{
+		const auto arr = pattern<t>({4, 3});
+		std::vector<double> expected;
+		for (t val : values(arr))
+			expected.push_back((double) val);
+
+		save(path, arr);
+		expectEqual(load<double>(path), {4, 3}, expected, type + " load as double");
+	}
+
+	// Mapped files are read-only, copied on write, or written through
+	{
+		const auto arr = pattern<t>({2, 6});
+		auto expected = values(arr);
+		save(path, arr);
+
+		expect(!load<t>(path, MapMode::READ_ONLY).isWritable(), type + " read-only map");
+
+		{
+			auto copy = load<t>(path, MapMode::COPY_ON_WRITE);
+			copy.dataStart[0] = (t) 9;
+		}
+		expectEqual(load<t>(path), {2, 6}, expected, type + " copy-on-write map");
+
+		{
+			auto mapped = load<t>(path, MapMode::READ_WRITE);
+			mapped.dataStart[0] = (t) 9;
+		}
+		expected[0] = (t) 9;
+		expectEqual(load<t>(path), {2, 6}, expected, type + " read-write map");
+	}
+
+	// Several named arrays of different shapes in one archive
+	{
+		const std::string archive = "npyCheck_" + type + ".npz";
+		const auto a = pattern<t>({3, 4}), b = pattern<t>({5}, 2), c = pattern<t>({2, 3}, 3).transposed();
+		expect(savez<t>(archive, {{"a", a}, {"b", b}, {"c", c}}), type + " savez");
+
+		const auto loaded = loadz<t>(archive);
+		expect(loaded.size() == 3, type + " loadz count");
+		if (loaded.size() == 3)
+		{
+			expectEqual(loaded.at("a"), {3, 4}, values(a), type + " loadz a");
+			expectEqual(loaded.at("b"), {5}, values(b), type + " loadz b");
+			expectEqual(loaded.at("c"), {3, 2}, values(c), type + " loadz c");
+		}
+
+		std::remove(archive.c_str());
+	}
+
+	std::remove(path.c_str());
+}
+
+int main()
+{
+	checkType<float>("float");
+	checkType<double>("double");
+	checkType<int64>("int64");
+	checkType<int32_t>("int32");
+	checkType<uint8_t>("uint8");
+	checkType<float16>("float16");
+
+	// A file written by NumPy in Fortran order is loaded as a transposed
+	// view with the same logical layout
+	{
+		const std::string path = "npyCheck_fortran.npy";
+		auto header = npy::imp::makeHeader("<f8", {2, 3}, false);
+		const auto pos = header.find("'fortran_order': False,");
+		header.replace(pos, 23, "'fortran_order': True, ");
+
+		// Column-major data of [[1, 2, 3], [4, 5, 6]]
+		const double data[] = {1, 4, 2, 5, 3, 6};
+		{
+			std::ofstream file(path, std::ios::binary);
+			file.write(header.data(), (std::streamsize) header.size());
+			file.write((const char *) data, sizeof(data));
+		}
+
+		expectEqual(load<double>(path), {2, 3}, std::vector<double>({1, 2, 3, 4, 5, 6}), "fortran order");
+		expectEqual(load<float>(path), {2, 3}, std::vector<float>({1, 2, 3, 4, 5, 6}), "fortran order as float");
+		std::remove(path.c_str());
+	}
+
+	return finish("NpyFiles");
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include <array.h>
+
+// Write to a read-only array in one of several ways, which must report
+// an error instead of writing to the memory. The source of the array
+// and the kind of write are given as arguments, as in
+// "ReadOnlyWrites map fill". The "map" source is a READ_ONLY mapping
+// of a file and "buffer" wraps constant memory with fromBuffer. The
+// "writable" source gives an ordinary array, where every write must
+// succeed
+
+using namespace rapid::ndarray;
+
+Array<float> source(const std::string &kind)
+{
+	if (kind == "map")
+	{
+		const std::string path = "readOnlyWrites.bin";
+		const float vals[6] = {1, 2, 3, 4, 5, 6};
+		std::ofstream file(path, std::ios::binary);
+		file.write((const char *) vals, sizeof(vals));
+		file.close();
+
+		return Array<float>::mapFile(path, {2, 3}, MapMode::READ_ONLY);
+	}
+
+	if (kind == "buffer")
+	{
+		static const float vals[6] = {1, 2, 3, 4, 5, 6};
+		return Array<float>::fromBuffer(vals, {2, 3});
+	}
+
+	return Array<float>::fromData({{1, 2, 3}, {4, 5, 6}});
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: ReadOnlyWrites <source> <write>\n";
+		return 2;
+	}
+
+	// Errors wait for enter to be pressed before exiting
+#ifndef RAPID_OS_WINDOWS
+	std::freopen("/dev/null", "r", stdin);
+#endif
+
+	const std::string write = argv[2];
+	auto arr = source(argv[1]);
+	const auto other = Array<float>::fromData({{6, 5, 4}, {3, 2, 1}});
+
+	if (write == "assign")
+		arr = other;
+	else if (write == "move")
+		arr = Array<float>(other.copy());
+	else if (write == "expression")
+		arr = other * 2.0f;
+	else if (write == "scalar")
+		arr = 1.0f;
+	else if (write == "fill")
+		arr.fill(1);
+	else if (write == "fillRandom")
+		arr.fillRandom();
+	else if (write == "fillNormal")
+		arr.fillNormal();
+	else if (write == "fillTruncatedNormal")
+		arr.fillTruncatedNormal();
+	else if (write == "addArray")
+		arr += other;
+	else if (write == "subScalar")
+		arr -= 1.0f;
+	else if (write == "mulArray")
+		arr *= other;
+	else if (write == "divScalar")
+		arr /= 2.0f;
+	else if (write == "index")
+		arr[1] = other[0];
+	else if (write == "indexScalar")
+		arr[1][2] = 1.0f;
+	else if (write == "setVal")
+		arr.setVal({1, 2}, 1.0f);
+	else if (write == "transposed")
+		arr.transposed().transposed(arr);
+	else if (write == "dot")
+		Array<float>::fromData({{1, 0}, {0, 1}}).dot(other, arr);
+	else if (write == "mapped")
+		other.mapped([](float x) { return x + 1; }, arr);
+	else if (write == "exp")
+		exp(other, arr);
+	else if (write == "put")
+		put(arr, Array<int64>::fromData({0, 4}), Array<float>::fromData({1, 2}));
+	else if (write == "scatterAdd")
+		scatterAdd(arr, Array<int64>::fromData({1, 0}), other);
+	else
+	{
+		std::cerr << "Unknown write \"" << write << "\"\n";
+		return 2;
+	}
+
+	std::cout << "Written " << arr.toString() << "\n";
+	return 0;
+}
@@ -0,0 +1,120 @@
+#include "checks.h"
+
+// Cumulative sums, products, maxima and minima of flattened arrays and
+// along each axis, with and without segments. The long and tall cases
+// are split into blocks, which must be combined in order
+
+using namespace checks;
+
+// Scan "len" elements "stride" apart, starting again wherever "heads" is
+// set. "op" is the binary operation of the scan
+template<typename t, typename F>
+void reference(std::vector<t> &data, uint64 outer, uint64 len, uint64 inner,
+			   const std::vector<uint8_t> &heads, F op)
+{
+	for (uint64 o = 0; o < outer; o++)
+	{
+		for (uint64 c = 0; c < inner; c++)
+		{
+			for (uint64 i = 1; i < len; i++)
+			{
+				if (!heads.empty() && heads[i])
+					continue;
+
+				t &x = data[(o * len + i) * inner + c];
+				x = op(data[(o * len + i - 1) * inner + c], x);
+			}
+		}
+	}
+}
+
+template<typename t>
+void checkScans(const std::vector<uint64> &shape, uint64 axis, const std::string &name,
+				bool products = true)
+{
+	const auto arr = pattern<t>(shape);
+	const std::vector<uint64> flat = {math::prod(shape)};
+
+	uint64 outer = 1, len = flat[0], inner = 1;
+	if (axis != (uint64) -1)
+	{
+		len = shape[axis];
+		for (uint64 i = 0; i < axis; i++)
+			outer *= shape[i];
+		for (uint64 i = axis + 1; i < shape.size(); i++)
+			inner *= shape[i];
+	}
+
+	const auto resultShape = axis == (uint64) -1 ? flat : shape;
+
+	// Segments of irregular lengths, including one of a single element
+	Array<uint8_t> heads({len});
+	std::vector<uint8_t> flags(len);
+	for (uint64 i = 0; i < len; i++)
+		heads.dataStart[i] = flags[i] = (uint8_t) (i == 3 || i % 37 == 5 || i % 37 == 6);
+
+	for (bool segmented : {false, true})
+	{
+		const auto segments = segmented ? flags : std::vector<uint8_t>();
+		const std::string prefix = name + (segmented ? " segmented" : "");
+
+		auto sums = values(arr), maxima = values(arr), minima = values(arr), prods = values(arr);
+		reference(sums, outer, len, inner, segments, [](t a, t b) { return a + b; });
+		reference(maxima, outer, len, inner, segments, [](t a, t b) { return a > b ? a : b; });
+		reference(minima, outer, len, inner, segments, [](t a, t b) { return a < b ? a : b; });
+		reference(prods, outer, len, inner, segments, [](t a, t b) { return a * b; });
+
+		if (segmented)
+		{
+			expectEqual(cumsum(arr, heads, axis), resultShape, sums, prefix + " cumsum");
+			expectEqual(cummax(arr, heads, axis), resultShape, maxima, prefix + " cummax");
+			expectEqual(cummin(arr, heads, axis), resultShape, minima, prefix + " cummin");
+			if (products)
+				expectEqual(cumprod(arr, heads, axis), resultShape, prods, prefix + " cumprod");
+		}
+		else
+		{
+			expectEqual(cumsum(arr, axis), resultShape, sums, prefix + " cumsum");
+			expectEqual(cummax(arr, axis), resultShape, maxima, prefix + " cummax");
+			expectEqual(cummin(arr, axis), resultShape, minima, prefix + " cummin");
+			if (products)
+				expectEqual(cumprod(arr, axis), resultShape, prods, prefix + " cumprod");
+		}
+	}
+}
+
+template<typename t>
+void checkType(const std::string &type)
+{
+	// Products of the pattern overflow quickly, so they are only checked
+	// on short lines
+	checkScans<t>({7}, (uint64) -1, type + " vector");
+	checkScans<t>({3, 4, 5}, (uint64) -1, type + " flattened", false);
+	checkScans<t>({3, 4, 5}, 0, type + " axis 0");
+	checkScans<t>({3, 4, 5}, 1, type + " axis 1");
+	checkScans<t>({3, 4, 5}, 2, type + " axis 2");
+
+	// Scans of a transposed view and of an expression
+	{
+		const auto arr = pattern<t>({4, 6});
+		expectEqual(cumsum(arr.transposed(), 1), {6, 4}, values(cumsum(arr.transposed().copy(), 1)),
+					type + " transposed cumsum");
+		expectEqual(cummax(arr * (t) 2, 0), {4, 6}, values(cummax(Array<t>(arr * (t) 2), 0)),
+					type + " expression cummax");
+	}
+}
+
+int main()
+{
+	checkType<float>("float");
+	checkType<double>("double");
+	checkType<int64>("int64");
+
+	// A line longer than a block, and a tall, narrow array whose rows
+	// are split into blocks
+	checkScans<int64>({200000}, (uint64) -1, "long line", false);
+	checkScans<int64>({100000, 3}, 0, "tall axis", false);
+	checkScans<double>({2, 40000, 3}, 1, "tall inner axis", false);
+
+	return finish("Scans");
+}
@@ -0,0 +1,145 @@
+#include "checks.h"
+
+// Sparse matrices in CSR, CSC and COO form: construction from triplets
+// and dense arrays, conversion between formats, transposes, products
+// with dense vectors and matrices on either side, and elementwise
+// products with dense arrays
+
+using namespace checks;
+
+static const std::vector<SparseFormat> formats = {SparseFormat::CSR, SparseFormat::CSC, SparseFormat::COO};
+static const std::vector<std::string> formatNames = {"CSR", "CSC", "COO"};
+
+// A dense matrix with about a quarter of its elements nonzero
+template<typename t>
+Array<t> sparsePattern(const std::vector<uint64> &shape, uint64 seed = 1)
+{
+	auto res = pattern<t>(shape, seed);
+	const uint64 size = math::prod(shape);
+	for (uint64 i = 0; i < size; i++)
+		if (res.dataStart[i] < (t) 3)
+			res.dataStart[i] = 0;
+	return res;
+}
+
+// The product of an "m x n" and an "n x k" contiguous matrix
+template<typename t>
+std::vector<t> product(const std::vector<t> &a, const std::vector<t> &b, uint64 m, uint64 n, uint64 k)
+{
+	std::vector<t> res(m * k, 0);
+	for (uint64 r = 0; r < m; r++)
+		for (uint64 c = 0; c < k; c++)
+			for (uint64 x = 0; x < n; x++)
+				res[r * k + c] += a[r * n + x] * b[x * k + c];
+	return res;
+}
+
+template<typename t>
+void checkFormat(SparseFormat format, const std::string &name)
+{
+	const auto dense = sparsePattern<t>({6, 5});
+	const auto dv = values(dense);
+	const auto sparse = SparseArray<t>::fromDense(dense, format);
+
+	uint64 nonzero = 0;
+	for (t val : dv)
+		nonzero += val != 0;
+
+	expect(sparse.format == format, name + " format");
+	expect(sparse.nnz() == nonzero, name + " nnz");
+	expectEqual(sparse.toDense(), {6, 5}, dv, name + " fromDense");
+
+	// Repeated positions are summed. COO matrices keep every entry until
+	// they are converted
+	{
+		const std::vector<uint64> rows = {2, 0, 2, 5, 0}, cols = {1, 4, 1, 0, 0};
+		const std::vector<t> vals = {(t) 3, (t) 1, (t) 4, (t) -2, (t) 5};
+		const auto triplets = SparseArray<t>::fromTriplets({6, 5}, rows, cols, vals, format);
+
+		std::vector<t> expected(30, 0);
+		for (uint64 i = 0; i < vals.size(); i++)
+			expected[rows[i] * 5 + cols[i]] += vals[i];
+
+		expect(triplets.nnz() == (format == SparseFormat::COO ? 5 : 4), name + " fromTriplets nnz");
+		expectEqual(triplets.toDense(), {6, 5}, expected, name + " fromTriplets");
+	}
+
+	// Conversions and transposes keep the same values
+	for (uint64 f = 0; f < formats.size(); f++)
+		expectEqual(sparse.asFormat(formats[f]).toDense(), {6, 5}, dv, name + " as " + formatNames[f]);
+
+	expectEqual(sparse.transposed().toDense(), {5, 6}, values(dense.transposed()), name + " transposed");
+
+	// Products with a dense vector and matrix on the right
+	{
+		const auto v = pattern<t>({5}, 2), m = pattern<t>({5, 4}, 3);
+		expectEqual(sparse.dot(v), {6}, product(dv, values(v), 6, 5, 1), name + " dot vector");
+		expectEqual(sparse.dot(m), {6, 4}, product(dv, values(m), 6, 5, 4), name + " dot matrix");
+		expectEqual(sparse.dot(m.transposed().copy().transposed()), {6, 4}, product(dv, values(m), 6, 5, 4),
+					name + " dot transposed matrix");
+
+		auto out = pattern<t>({6, 4}, 4);
+		auto expected = product(dv, values(m), 6, 5, 4);
+		const auto previous = values(out);
+		for (uint64 i = 0; i < expected.size(); i++)
+			expected[i] = (t) 2 * expected[i] + previous[i];
+
+		sparse.dot(m, out, (t) 2, (t) 1);
+		expectEqual(out, {6, 4}, expected, name + " dot into out");
+
+		const auto w = pattern<t>({6}, 5);
+		expectEqual(sparse.transposed().dot(w), {5}, product(values(w), dv, 1, 6, 5), name + " transposed dot vector");
+	}
+
+	// Products with a dense vector and matrix on the left
+	{
+		const auto v = pattern<t>({6}, 2), m = pattern<t>({3, 6}, 3);
+		expectEqual(sparse.rdot(v), {5}, product(values(v), dv, 1, 6, 5), name + " rdot vector");
+		expectEqual(sparse.rdot(m), {3, 5}, product(values(m), dv, 3, 6, 5), name + " rdot matrix");
+		expectEqual(m.dot(sparse), {3, 5}, product(values(m), dv, 3, 6, 5), name + " dense dot sparse");
+	}
+
+	// Elementwise products keep the nonzero positions
+	{
+		const auto other = pattern<t>({6, 5}, 2);
+		const auto ov = values(other);
+		std::vector<t> expected(30);
+		for (uint64 i = 0; i < 30; i++)
+			expected[i] = dv[i] * ov[i];
+
+		const auto res = sparse * other;
+		expect(res.nnz() == nonzero, name + " multiply nnz");
+		expectEqual(res.toDense(), {6, 5}, expected, name + " multiply");
+		expectEqual((other.transposed().copy().transposed() * sparse).toDense(), {6, 5}, expected,
+					name + " multiply transposed");
+	}
+}
+
+template<typename t>
+void checkType(const std::string &type)
+{
+	for (uint64 f = 0; f < formats.size(); f++)
+		checkFormat<t>(formats[f], type + " " + formatNames[f]);
+}
+
+int main()
+{
+	checkType<float>("float");
+	checkType<double>("double");
+
+	// Products large enough to be split between threads, with more than
+	// one block of result columns
+	for (uint64 f = 0; f < formats.size(); f++)
+	{
+		const auto dense = sparsePattern<double>({2000, 300});
+		const auto sparse = SparseArray<double>::fromDense(dense, formats[f]);
+		const auto m = pattern<double>({300, 70}, 2), left = pattern<double>({40, 2000}, 3);
+
+		expectEqual(sparse.dot(m), {2000, 70}, product(values(dense), values(m), 2000, 300, 70),
+					"large " + formatNames[f] + " dot matrix");
+		expectEqual(sparse.rdot(left), {40, 300}, product(values(left), values(dense), 40, 2000, 300),
+					"large " + formatNames[f] + " rdot matrix");
+	}
+
+	return finish("Sparse");
+}